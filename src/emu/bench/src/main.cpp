@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <common/algorithm.h>
+#include <common/arghandler.h>
+#include <common/cvt.h>
+#include <common/log.h>
+#include <common/path.h>
+
+#include <config/app_settings.h>
+#include <config/config.h>
+
+#include <cpu/arm_interface.h>
+#include <drivers/audio/audio.h>
+#include <drivers/graphics/graphics.h>
+
+#include <kernel/kernel.h>
+#include <kernel/libmanager.h>
+#include <kernel/process.h>
+#include <kernel/timing.h>
+
+#include <system/devices.h>
+#include <system/epoc.h>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace eka2l1;
+
+static const char *PATCH_FOLDER_PATH = ".//patch//";
+
+struct bench_options {
+    std::optional<std::uint8_t> device_;
+    std::string app_path_;
+    std::string app_cmd_;
+    std::string until_exit_;
+    std::string output_path_;
+    double guest_seconds_ = 10.0;
+    std::optional<bool> hle_user_heap_;
+};
+
+struct bench_result {
+    std::string device_;
+    std::string stop_reason_;
+    bool hle_user_heap_ = false;
+
+    std::uint64_t boot_wall_us_ = 0;
+    std::uint64_t wall_us_ = 0;
+    std::uint64_t guest_us_ = 0;
+    std::uint64_t instructions_ = 0;
+    std::uint64_t svc_calls_ = 0;
+    std::uint64_t ipc_sends_ = 0;
+
+    std::optional<std::uint64_t> jit_compile_us_;
+};
+
+static bool help_option_handler(common::arg_parser *parser, void *userdata, std::string *err) {
+    std::cout << "Usage: eka2l1_bench [options]\n"
+              << parser->get_help_string() << std::endl;
+
+    return false;
+}
+
+static bool device_option_handler(common::arg_parser *parser, void *userdata, std::string *err) {
+    const char *tok = parser->next_token();
+
+    if (!tok) {
+        *err = "No device index specified";
+        return false;
+    }
+
+    reinterpret_cast<bench_options *>(userdata)->device_ = static_cast<std::uint8_t>(std::atoi(tok));
+    return true;
+}
+
+static bool app_option_handler(common::arg_parser *parser, void *userdata, std::string *err) {
+    const char *tok = parser->next_token();
+
+    if (!tok) {
+        *err = "No executable specified";
+        return false;
+    }
+
+    bench_options *options = reinterpret_cast<bench_options *>(userdata);
+    options->app_path_ = tok;
+
+    // Optional command line, as long as it does not look like another option
+    const char *cmdline = parser->peek_token();
+
+    if (cmdline && (std::string(cmdline).substr(0, 2) != "--")) {
+        options->app_cmd_ = cmdline;
+        parser->next_token();
+    }
+
+    return true;
+}
+
+static bool seconds_option_handler(common::arg_parser *parser, void *userdata, std::string *err) {
+    const char *tok = parser->next_token();
+
+    if (!tok) {
+        *err = "No duration specified";
+        return false;
+    }
+
+    reinterpret_cast<bench_options *>(userdata)->guest_seconds_ = std::atof(tok);
+    return true;
+}
+
+static bool until_exit_option_handler(common::arg_parser *parser, void *userdata, std::string *err) {
+    const char *tok = parser->next_token();
+
+    if (!tok) {
+        *err = "No process name specified";
+        return false;
+    }
+
+    reinterpret_cast<bench_options *>(userdata)->until_exit_ = tok;
+    return true;
+}
+
+static bool output_option_handler(common::arg_parser *parser, void *userdata, std::string *err) {
+    const char *tok = parser->next_token();
+
+    if (!tok) {
+        *err = "No output path specified";
+        return false;
+    }
+
+    reinterpret_cast<bench_options *>(userdata)->output_path_ = tok;
+    return true;
+}
+
+static bool hle_user_heap_option_handler(common::arg_parser *parser, void *userdata, std::string *err) {
+    const char *tok = parser->next_token();
+
+    if (!tok) {
+        *err = "No value specified for the host user heap, use 0 or 1";
+        return false;
+    }
+
+    reinterpret_cast<bench_options *>(userdata)->hle_user_heap_ = (std::atoi(tok) != 0);
+    return true;
+}
+
+static kernel::process *find_process(kernel_system *kern, const std::string &name, const std::optional<kernel::uid> uid) {
+    for (auto &obj : kern->get_process_list()) {
+        kernel::process *pr = reinterpret_cast<kernel::process *>(obj.get());
+
+        if (!pr) {
+            continue;
+        }
+
+        if (uid.has_value() ? (pr->unique_id() == uid.value()) : (common::compare_ignore_case(pr->raw_name().c_str(), name.c_str()) == 0)) {
+            return pr;
+        }
+    }
+
+    return nullptr;
+}
+
+static bool boot(eka2l1::system *symsys, config::state &conf, const bench_options &options, bench_result &result) {
+    device_manager *dvcmngr = symsys->get_device_manager();
+
+    if (dvcmngr->total() == 0) {
+        std::cout << "No device installed" << std::endl;
+        return false;
+    }
+
+    symsys->startup();
+
+    const std::uint8_t device_index = options.device_.value_or(static_cast<std::uint8_t>(conf.device));
+
+    if (!symsys->set_device(device_index)) {
+        std::cout << "Device index " << static_cast<int>(device_index) << " is out of range" << std::endl;
+        return false;
+    }
+
+    symsys->mount(drive_c, drive_media::physical, eka2l1::add_path(conf.storage, "/drives/c/"), io_attrib_internal);
+    symsys->mount(drive_d, drive_media::physical, eka2l1::add_path(conf.storage, "/drives/d/"), io_attrib_internal);
+    symsys->mount(drive_e, drive_media::physical, eka2l1::add_path(conf.storage, "/drives/e/"), io_attrib_removeable);
+    symsys->mount(drive_z, drive_media::rom, eka2l1::add_path(conf.storage, "/drives/z/"), io_attrib_internal | io_attrib_write_protected);
+
+    device *dvc = dvcmngr->get_current();
+    result.device_ = fmt::format("{} ({})", dvc->model, dvc->firmware_code);
+
+    kernel_system *kern = symsys->get_kernel_system();
+    kern->start_bootload();
+    kern->get_lib_manager()->load_patch_libraries(PATCH_FOLDER_PATH);
+
+    if (!options.app_path_.empty()) {
+        if (!symsys->load(common::utf8_to_ucs2(options.app_path_), common::utf8_to_ucs2(options.app_cmd_))) {
+            std::cout << "Failed to launch " << options.app_path_ << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void run(eka2l1::system *symsys, const bench_options &options, bench_result &result) {
+    kernel_system *kern = symsys->get_kernel_system();
+    ntimer *timing = symsys->get_ntimer();
+    arm::core *cpu = symsys->get_cpu();
+
+    const std::uint64_t guest_limit_us = static_cast<std::uint64_t>(options.guest_seconds_ * common::microsecs_per_sec);
+
+    std::optional<kernel::uid> watched_uid;
+    std::uint64_t pending_cycles = 0;
+
+    result.stop_reason_ = "time_limit";
+
+    while (timing->microseconds() < guest_limit_us) {
+        const bool has_thread = (kern->crr_thread() != nullptr);
+
+        if (symsys->loop() == 0) {
+            result.stop_reason_ = "kernel_exit";
+            break;
+        }
+
+        if (has_thread) {
+            const std::uint32_t executed = cpu->get_num_instruction_executed();
+
+            result.instructions_ += executed;
+            pending_cycles += executed;
+
+            // Guest time is what the executed instructions would take at the emulated clock
+            const std::uint64_t elapsed_us = timing->cycles_to_us(pending_cycles);
+            pending_cycles -= timing->us_to_cycles(elapsed_us);
+
+            timing->advance_clock(elapsed_us);
+        } else {
+            // Nothing to run, skip straight to the next event
+            const std::optional<std::uint64_t> next_us = timing->advance_clock(0);
+
+            if (!next_us.has_value() && !kern->crr_thread()) {
+                result.stop_reason_ = "idle";
+                break;
+            }
+
+            if (next_us.has_value()) {
+                timing->advance_clock(next_us.value());
+            }
+        }
+
+        if (!options.until_exit_.empty()) {
+            kernel::process *pr = find_process(kern, options.until_exit_, watched_uid);
+
+            if (!watched_uid.has_value()) {
+                if (pr) {
+                    watched_uid = pr->unique_id();
+                }
+            } else if (!pr || (pr->get_exit_type() != kernel::entity_exit_type::pending)) {
+                result.stop_reason_ = "process_exit";
+                break;
+            }
+        }
+    }
+
+    result.guest_us_ = timing->microseconds();
+    result.svc_calls_ = kern->get_svc_call_count();
+    result.ipc_sends_ = kern->get_ipc_send_count();
+    result.jit_compile_us_ = cpu->get_jit_compile_time();
+}
+
+static std::string make_json_report(const bench_result &result) {
+    return fmt::format("{{\n"
+                       "    \"device\": \"{}\",\n"
+                       "    \"stop_reason\": \"{}\",\n"
+                       "    \"hle_user_heap\": {},\n"
+                       "    \"boot_wall_time_us\": {},\n"
+                       "    \"wall_time_us\": {},\n"
+                       "    \"guest_time_us\": {},\n"
+                       "    \"guest_instructions\": {},\n"
+                       "    \"svc_calls\": {},\n"
+                       "    \"ipc_sends\": {},\n"
+                       "    \"jit_compile_time_us\": {}\n"
+                       "}}\n",
+        result.device_, result.stop_reason_, result.hle_user_heap_, result.boot_wall_us_, result.wall_us_, result.guest_us_,
+        result.instructions_, result.svc_calls_, result.ipc_sends_,
+        result.jit_compile_us_.has_value() ? std::to_string(result.jit_compile_us_.value()) : "null");
+}
+
+int main(const int argc, const char **argv) {
+    // Same layout as the main frontend: configs and patches are next to the executable
+    eka2l1::set_current_directory(eka2l1::file_directory(argv[0]));
+
+    bench_options options;
+    common::arg_parser parser(argc, argv);
+
+    parser.add("--help, --h", "Display helps menu", help_option_handler);
+    parser.add("--device", "Index of the device to boot. Defaults to the one in the config file.", device_option_handler);
+    parser.add("--app", "Absolute virtual path to the executable to run, with an optional command line.\n"
+                        "\t\t  Without it, only the device's startup runs.",
+        app_option_handler);
+    parser.add("--seconds", "Guest seconds to run for. Defaults to 10.", seconds_option_handler);
+    parser.add("--until-exit", "Stop when the process with this name exits.", until_exit_option_handler);
+    parser.add("--output", "Write the JSON report to this file instead of the standard output.", output_option_handler);
+    parser.add("--hle-user-heap", "1 to serve guest heaps from the host allocator, 0 to keep the guest's own.\n"
+                                  "\t\t  Defaults to the config file.",
+        hle_user_heap_option_handler);
+
+    std::string err;
+
+    if (!parser.parse(&options, &err)) {
+        if (!err.empty()) {
+            std::cout << err << std::endl;
+            return -1;
+        }
+
+        return 0;
+    }
+
+    eka2l1::log::setup_log(nullptr);
+
+    config::state conf;
+    conf.deserialize();
+
+    // Idling the core would wait on host time, and stepping would skew the numbers
+    conf.cpu_load_save = false;
+    conf.stepping = false;
+    conf.enable_gdbstub = false;
+
+    if (options.hle_user_heap_.has_value()) {
+        conf.hle_user_heap = options.hle_user_heap_.value();
+    }
+
+    config::app_settings settings(&conf);
+
+    drivers::graphics_driver_ptr graphics_driver = drivers::create_graphics_driver(drivers::graphic_api::null);
+    std::unique_ptr<drivers::audio_driver> audio_driver = drivers::make_audio_driver(drivers::audio_driver_backend::null);
+
+    system_create_components comp;
+    comp.graphics_ = graphics_driver.get();
+    comp.audio_ = audio_driver.get();
+    comp.conf_ = &conf;
+    comp.settings_ = &settings;
+    comp.manual_timing_ = true;
+
+    std::unique_ptr<eka2l1::system> symsys = std::make_unique<eka2l1::system>(comp);
+    bench_result result;
+    result.hle_user_heap_ = conf.hle_user_heap;
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (!boot(symsys.get(), conf, options, result)) {
+        return -1;
+    }
+
+    result.boot_wall_us_ = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+
+    run(symsys.get(), options, result);
+
+    result.wall_us_ = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+    const std::string report = make_json_report(result);
+
+    if (options.output_path_.empty()) {
+        std::cout << report;
+    } else {
+        std::ofstream stream(options.output_path_);
+        stream << report;
+    }
+
+    symsys.reset();
+    return 0;
+}
@@ -367,6 +367,12 @@ namespace eka2l1 {
          */
         int count_leading_zero(const std::uint32_t v);
 
+        /**
+         * \brief Count the number of trailing zero bits of a 64-bit integer.
+         * \returns 64 if the value is zero.
+         */
+        int count_trailing_zero(const std::uint64_t v);
+
         /**
          * \brief Get the most significant set bit.
          */
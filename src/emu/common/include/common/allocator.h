@@ -79,9 +79,41 @@ namespace eka2l1::common {
         }
     };
 
+    /**
+     * \brief Allocate runs of cells tracked by a bitmap.
+     * 
+     * A set bit marks a free cell. Cell 0 is the most significant bit of the first word.
+     * 
+     * Two summary levels are kept over the 32-bit words, using 64-bit summary words: one bit per word
+     * telling if the word has any free cell, one bit per word telling if the word is entirely free,
+     * and a top level over the first summary. Searches jump between words with free cells using
+     * trailing zero counts, and walk over fully free words a summary word at a time.
+     */
     struct bitmap_allocator {
         std::vector<std::uint32_t> words_;
 
+    private:
+        std::vector<std::uint64_t> non_empty_summary_;
+        std::vector<std::uint64_t> non_empty_top_;
+        std::vector<std::uint64_t> full_summary_;
+
+        void rebuild_summary();
+        void update_summary(const std::size_t word_index);
+
+        std::size_t next_non_empty_word(const std::size_t from) const;
+        std::size_t next_non_full_word(const std::size_t from) const;
+
+        /**
+         * \brief Find a free run.
+         * 
+         * \param start_offset  The cell to start searching from.
+         * \param size          Minimum size of the run.
+         * \param best_fit      True to return the smallest fitting run, else the first one.
+         * 
+         * \returns Offset of the run, -1 if not found.
+         */
+        int find_free_run(const std::uint32_t start_offset, const int size, const bool best_fit) const;
+
     public:
         // For testing, don't use this if not neccessary
         bool set_word(const std::uint32_t off, const std::uint32_t val);
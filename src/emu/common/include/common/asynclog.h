@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common/log.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace eka2l1::log {
+    /**
+     * \brief Logging backend that moves formatting and writing off the logging thread.
+     *
+     * Callers claim a slot in a fixed-size lock-free ring and store a compact record in it: the
+     * source location and format string, which identify the message, and a copy of the raw
+     * arguments. A background thread formats the records in order and hands them to the
+     * synchronous logger's sinks.
+     *
+     * When the ring is full, or a log class goes over its rate limit, records are dropped and
+     * counted. The background thread reports the drops through the sinks.
+     */
+    class async_logger {
+    public:
+        static constexpr std::size_t RECORD_ARGS_SIZE = 192;
+        static constexpr std::size_t DEFAULT_CAPACITY = 8192;
+
+    private:
+        struct record {
+            std::atomic<std::uint64_t> sequence_;
+
+            log_class cls_;
+            spdlog::level::level_enum level_;
+            const char *file_;
+            int line_;
+            const char *format_;
+
+            void (*format_func_)(const record &rec, std::string &out);
+            void (*destroy_func_)(record &rec);
+
+            alignas(std::max_align_t) unsigned char args_[RECORD_ARGS_SIZE];
+        };
+
+        struct class_budget {
+            std::atomic<std::uint64_t> window_start_us_{ 0 };
+            std::atomic<std::uint32_t> count_{ 0 };
+            std::atomic<std::uint64_t> dropped_{ 0 };
+        };
+
+        // Copies that stay valid after the call: text is owned, everything else is kept by value
+        template <typename T, typename D = std::decay_t<T>>
+        using captured_t = std::conditional_t<std::is_same_v<D, const char *> || std::is_same_v<D, char *>
+                || std::is_same_v<D, std::string_view> || std::is_same_v<D, fmt::string_view>,
+            std::string, D>;
+
+        template <typename... Args>
+        static constexpr bool is_storable() {
+            using tuple_type = std::tuple<captured_t<Args>...>;
+
+            return (sizeof(tuple_type) <= RECORD_ARGS_SIZE) && (alignof(tuple_type) <= alignof(std::max_align_t))
+                && std::is_copy_constructible_v<tuple_type>;
+        }
+
+        template <typename Tuple>
+        static void format_args(const record &rec, std::string &out) {
+            const Tuple &args = *std::launder(reinterpret_cast<const Tuple *>(rec.args_));
+
+            std::apply([&](const auto &...arg) {
+                out = fmt::vformat(rec.format_, fmt::make_format_args(arg...));
+            },
+                args);
+        }
+
+        template <typename Tuple>
+        static void destroy_args(record &rec) {
+            std::launder(reinterpret_cast<Tuple *>(rec.args_))->~Tuple();
+        }
+
+        std::shared_ptr<spdlog::logger> target_;
+
+        std::unique_ptr<record[]> records_;
+        std::size_t mask_;
+
+        alignas(64) std::atomic<std::uint64_t> write_pos_;
+        alignas(64) std::atomic<std::uint64_t> read_pos_;    ///< Advanced by the background thread only.
+
+        std::atomic<std::uint64_t> overflow_count_;
+        std::uint64_t overflow_reported_;
+
+        class_budget budgets_[LOG_CLASS_COUNT];
+        std::uint64_t rate_limited_reported_[LOG_CLASS_COUNT];
+        std::uint32_t max_per_class_per_second_;
+
+        std::thread worker_;
+        std::atomic<bool> stop_;
+
+        std::mutex wake_lock_;
+        std::condition_variable wake_cond_;
+
+        bool pass_rate_limit(const log_class cls, const spdlog::level::level_enum level);
+
+        record *claim(const log_class cls, const spdlog::level::level_enum level);
+        void publish(record *rec);
+
+        bool write_one();
+        void report_drops();
+        void worker_loop();
+
+    public:
+        /**
+         * \brief Start the background thread.
+         *
+         * \param target                    Logger whose sinks receive the formatted records.
+         * \param capacity                  Number of records the ring holds. Rounded up to a power of two.
+         * \param max_per_class_per_second  Records a log class can push each second, errors excluded.
+         *                                  Zero for no limit.
+         */
+        explicit async_logger(std::shared_ptr<spdlog::logger> target, const std::size_t capacity = DEFAULT_CAPACITY,
+            const std::uint32_t max_per_class_per_second = 0);
+
+        /**
+         * \brief Write all pending records, then stop the background thread.
+         */
+        ~async_logger();
+
+        /**
+         * \brief Queue a record. Never blocks, the record is dropped if the ring is full.
+         *
+         * \param file    Source file, must outlive the logger. Normally __FILE__.
+         * \param format  Format string, must outlive the logger. Normally a literal.
+         */
+        template <typename... Args>
+        void push(const log_class cls, const spdlog::level::level_enum level, const char *file, const int line,
+            const char *format, Args &&...args) {
+            record *rec = claim(cls, level);
+
+            if (!rec) {
+                return;
+            }
+
+            // The slot is claimed already, it must be published whatever happens
+            try {
+                if constexpr (is_storable<Args...>()) {
+                    using tuple_type = std::tuple<captured_t<Args>...>;
+
+                    new (rec->args_) tuple_type(std::forward<Args>(args)...);
+
+                    rec->format_ = format;
+                    rec->format_func_ = format_args<tuple_type>;
+                    rec->destroy_func_ = destroy_args<tuple_type>;
+                } else {
+                    // Too big or not copyable: pay for the formatting here, only the text is deferred
+                    using tuple_type = std::tuple<std::string>;
+
+                    std::string text;
+
+                    try {
+                        text = fmt::vformat(format, fmt::make_format_args(args...));
+                    } catch (const std::exception &e) {
+                        text = e.what();
+                    }
+
+                    new (rec->args_) tuple_type(std::move(text));
+
+                    rec->format_ = "{}";
+                    rec->format_func_ = format_args<tuple_type>;
+                    rec->destroy_func_ = destroy_args<tuple_type>;
+                }
+            } catch (...) {
+                // Copying the arguments failed, keep the message position with a record that owns nothing
+                using tuple_type = std::tuple<>;
+
+                new (rec->args_) tuple_type();
+
+                rec->format_ = "<unable to capture log arguments>";
+                rec->format_func_ = format_args<tuple_type>;
+                rec->destroy_func_ = destroy_args<tuple_type>;
+            }
+
+            rec->file_ = file;
+            rec->line_ = line;
+
+            publish(rec);
+        }
+
+        /**
+         * \brief Block until every record pushed before this call is written and flushed.
+         */
+        void flush();
+
+        std::uint64_t overflow_count() const {
+            return overflow_count_.load(std::memory_order_relaxed);
+        }
+
+        std::uint64_t rate_limited_count(const log_class cls) const {
+            return budgets_[static_cast<int>(cls)].dropped_.load(std::memory_order_relaxed);
+        }
+    };
+}
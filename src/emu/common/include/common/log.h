@@ -58,17 +58,37 @@ namespace eka2l1 {
 
     /*! \brief Contains function to setup logging. */
     namespace log {
+        class async_logger;
+
         extern std::shared_ptr<spdlog::logger> spd_logger;
         extern std::unique_ptr<log_filterings> filterings;
+        extern std::unique_ptr<async_logger> async_log;
 
         /**
          * \brief Set up the logging.
          * \param extra_logger The extra logger you want to provide to the emulator.
 		*/
         void setup_log(std::shared_ptr<base_logger> extra_logger);
+
+        /**
+         * \brief Route the logging macros through a background thread.
+         *
+         * Must be called after setup_log, before other threads start logging.
+         *
+         * \param max_per_class_per_second Records a log class can emit each second, errors excluded.
+         *                                 Zero for no limit.
+         */
+        void enable_async_log(const std::uint32_t max_per_class_per_second = 0);
+
+        /**
+         * \brief Write pending records and go back to logging synchronously.
+         */
+        void disable_async_log();
     }
 }
 
+#include <common/asynclog.h>
+
 #ifdef DISABLE_LOGGING
 #define LOG_TRACE(class, fmt, ...)
 #define LOG_DEBUG(class, fmt, ...)
@@ -91,29 +111,34 @@ namespace eka2l1 {
 #define COND_CHECK_AND(class, serv) &&eka2l1::log::filterings->is_passed(class, spdlog::level::serv)
 #endif
 
-#define LOG_TRACE(class, fmt, ...) COND_CHECK(class, trace) eka2l1::log::spd_logger->trace("{:s}:{} [{:s}]: " fmt, __FILE__, __LINE__, log_class_to_string(class), ##__VA_ARGS__)
-#define LOG_DEBUG(class, fmt, ...) COND_CHECK(class, debug) eka2l1::log::spd_logger->debug("{:s}:{} [{:s}]: " fmt, __FILE__, __LINE__, log_class_to_string(class), ##__VA_ARGS__)
-#define LOG_INFO(class, fmt, ...) COND_CHECK(class, info) eka2l1::log::spd_logger->info("{:s}:{} [{:s}]: " fmt, __FILE__, __LINE__, log_class_to_string(class), ##__VA_ARGS__)
-#define LOG_WARN(class, fmt, ...) COND_CHECK(class, warn) eka2l1::log::spd_logger->warn("{:s}:{} [{:s}]: " fmt, __FILE__, __LINE__, log_class_to_string(class), ##__VA_ARGS__)
-#define LOG_ERROR(class, fmt, ...) COND_CHECK(class, err) eka2l1::log::spd_logger->error("{:s}:{} [{:s}]: " fmt, __FILE__, __LINE__, log_class_to_string(class), ##__VA_ARGS__)
-#define LOG_CRITICAL(class, fmt, ...) COND_CHECK(class, critical) eka2l1::log::spd_logger->critical("{:s}:{} [{:s}]: " fmt, __FILE__, __LINE__, log_class_to_string(class), ##__VA_ARGS__)
+#define LOG_DISPATCH(class, lvl, method, fmt, ...)                                                                   \
+    (eka2l1::log::async_log                                                                                           \
+            ? eka2l1::log::async_log->push(class, spdlog::level::lvl, __FILE__, __LINE__, fmt, ##__VA_ARGS__)         \
+            : eka2l1::log::spd_logger->method("{:s}:{} [{:s}]: " fmt, __FILE__, __LINE__, log_class_to_string(class), ##__VA_ARGS__))
+
+#define LOG_TRACE(class, fmt, ...) COND_CHECK(class, trace) LOG_DISPATCH(class, trace, trace, fmt, ##__VA_ARGS__)
+#define LOG_DEBUG(class, fmt, ...) COND_CHECK(class, debug) LOG_DISPATCH(class, debug, debug, fmt, ##__VA_ARGS__)
+#define LOG_INFO(class, fmt, ...) COND_CHECK(class, info) LOG_DISPATCH(class, info, info, fmt, ##__VA_ARGS__)
+#define LOG_WARN(class, fmt, ...) COND_CHECK(class, warn) LOG_DISPATCH(class, warn, warn, fmt, ##__VA_ARGS__)
+#define LOG_ERROR(class, fmt, ...) COND_CHECK(class, err) LOG_DISPATCH(class, err, error, fmt, ##__VA_ARGS__)
+#define LOG_CRITICAL(class, fmt, ...) COND_CHECK(class, critical) LOG_DISPATCH(class, critical, critical, fmt, ##__VA_ARGS__)
 
 #define LOG_TRACE_IF(class, flag, fmt, ...) \
     if (flag COND_CHECK_AND(class, trace))         \
-    eka2l1::log::spd_logger->trace("{:s}:{} [{:s}]: " fmt, __FILE__, __LINE__, log_class_to_string(class), ##__VA_ARGS__)
+    LOG_DISPATCH(class, trace, trace, fmt, ##__VA_ARGS__)
 #define LOG_DEBUG_IF(class, flag, fmt, ...) \
     if (flag COND_CHECK_AND(class, debug))         \
-    eka2l1::log::spd_logger->debug("{:s}:{} [{:s}]: " fmt, __FILE__, __LINE__, log_class_to_string(class), ##__VA_ARGS__)
+    LOG_DISPATCH(class, debug, debug, fmt, ##__VA_ARGS__)
 #define LOG_INFO_IF(class, flag, fmt, ...) \
     if (flag COND_CHECK_AND(class, info))        \
-    eka2l1::log::spd_logger->info("{:s}:{} [{:s}]: " fmt, __FILE__, __LINE__, log_class_to_string(class), ##__VA_ARGS__)
+    LOG_DISPATCH(class, info, info, fmt, ##__VA_ARGS__)
 #define LOG_WARN_IF(class, flag, fmt, ...) \
     if (flag COND_CHECK_AND(class, warn))        \
-    eka2l1::log::spd_logger->warn("{:s}:{} [{:s}]: " fmt, __FILE__, __LINE__, log_class_to_string(class), ##__VA_ARGS__)
+    LOG_DISPATCH(class, warn, warn, fmt, ##__VA_ARGS__)
 #define LOG_ERROR_IF(class, flag, fmt, ...) \
     if (flag COND_CHECK_AND(class, err))         \
-    eka2l1::log::spd_logger->error("{:s}:{} [{:s}]: " fmt, __FILE__, __LINE__, log_class_to_string(class), ##__VA_ARGS__)
+    LOG_DISPATCH(class, err, error, fmt, ##__VA_ARGS__)
 #define LOG_CRITICAL_IF(class, flag, fmt, ...) \
     if (flag COND_CHECK_AND(class, critical))            \
-    eka2l1::log::spd_logger->critical("{:s}:{} [{:s}]: " fmt, __FILE__, __LINE__, log_class_to_string(class), ##__VA_ARGS__)
+    LOG_DISPATCH(class, critical, critical, fmt, ##__VA_ARGS__)
 #endif
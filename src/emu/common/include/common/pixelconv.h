@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace eka2l1::common {
+    enum pixel_format {
+        pixel_format_palette1, ///< Palette index, 1 bit per pixel. Lowest bits of each byte come first.
+        pixel_format_palette2, ///< Palette index, 2 bits per pixel.
+        pixel_format_palette4, ///< Palette index, 4 bits per pixel.
+        pixel_format_palette8, ///< Palette index, 1 byte per pixel.
+        pixel_format_rgb444, ///< 16-bit word, 0x0RGB.
+        pixel_format_rgb565, ///< 16-bit word, red in the top bits.
+        pixel_format_bgr24, ///< Bytes B, G, R.
+        pixel_format_bgra32 ///< Bytes B, G, R, A.
+    };
+
+    enum pixel_kernel_level {
+        pixel_kernel_scalar,
+        pixel_kernel_sse2,
+        pixel_kernel_ssse3,
+        pixel_kernel_avx2,
+        pixel_kernel_neon,
+        pixel_kernel_best ///< The fastest one the host CPU supports.
+    };
+
+    /**
+     * \brief Check if conversions can run with the given instruction set on this host.
+     */
+    bool is_pixel_kernel_supported(const pixel_kernel_level level);
+
+    /**
+     * \brief Fill a palette of evenly spaced greys, for the given number of bits per pixel.
+     *
+     * \param bpp      1, 2, 4 or 8.
+     * \param palette  Receives 1 << bpp entries.
+     */
+    void make_grey_palette(const int bpp, std::uint32_t *palette);
+
+    /**
+     * \brief Convert a block of pixels to 24-bit or 32-bit.
+     *
+     * Palette entries are TRgb words (0x00BBGGRR). Alpha is filled with 0xFF, unless the source has
+     * alpha too. Only the pixel bytes of each destination row are written, the padding is left as is.
+     *
+     * \param dest         Destination pixels.
+     * \param dest_stride  Bytes from a destination row to the next.
+     * \param dest_format  pixel_format_bgr24 or pixel_format_bgra32.
+     * \param src          Source pixels.
+     * \param src_stride   Bytes from a source row to the next.
+     * \param src_format   Format of the source pixels.
+     * \param width        Number of pixels in a row.
+     * \param height       Number of rows.
+     * \param palette      Palette for the palette formats, 1 << bpp entries. Ignored for others.
+     * \param level        Instruction set to use. Falls back to the best one if not supported.
+     *
+     * \returns False if the conversion is not supported, or a palette is required but missing.
+     */
+    bool convert_pixels(std::uint8_t *dest, const std::size_t dest_stride, const pixel_format dest_format,
+        const std::uint8_t *src, const std::size_t src_stride, const pixel_format src_format,
+        const std::size_t width, const std::size_t height, const std::uint32_t *palette = nullptr,
+        const pixel_kernel_level level = pixel_kernel_best);
+}
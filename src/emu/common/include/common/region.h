@@ -24,6 +24,16 @@
 #include <vector>
 
 namespace eka2l1::common {
+    /**
+     * @brief A set of pixels, stored as y-x banded rectangles.
+     * 
+     * Rectangles are grouped in bands: rectangles of a band share the same top and height, are sorted by x
+     * and never overlap or touch each other. Bands are sorted by y and do not overlap. Two bands touching
+     * vertically with the same horizontal spans are merged into one.
+     * 
+     * Union, subtract and intersect are done in one sweep over the bands of both regions, and keep the
+     * representation above. Do not modify the rectangle list directly.
+     */
     struct region {
         std::vector<eka2l1::rect> rects_;
 
@@ -41,6 +51,12 @@ namespace eka2l1::common {
          */
         bool add_rect(const eka2l1::rect &rect);
 
+        /**
+         * @brief       Add all pixels of another region to this region.
+         * @param       reg     The region to merge in.
+         */
+        void unite(const region &reg);
+
         /**
          * @brief       Get the rectangle that bound the whole region.
          * @returns     Rectangle that bound the region.
@@ -68,5 +84,21 @@ namespace eka2l1::common {
          * @param reg   The region to remove from.
          */
         void eliminate(const region &reg);
+
+        /**
+         * @brief   Check if a pixel is in this region.
+         * 
+         * @param   point   The pixel position.
+         * @returns True if the pixel is in the region.
+         */
+        bool contains(const eka2l1::vec2 &point) const;
+
+        /**
+         * @brief   Check if a rectangle is fully covered by this region.
+         * 
+         * @param   rect    The rectangle to check.
+         * @returns True if every pixel of the rectangle is in the region.
+         */
+        bool contains(const eka2l1::rect &rect) const;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace eka2l1::common {
+    /**
+     * \brief Lock-free ring buffer, with one producer and one consumer.
+     * 
+     * The capacity is rounded up to a power of two. Push and pop never allocate.
+     */
+    template <typename T>
+    class spsc_ring {
+        std::unique_ptr<T[]> items_;
+        std::size_t mask_;
+
+        alignas(64) std::atomic<std::size_t> head_;     ///< Next position to pop. Owned by consumer.
+        alignas(64) std::atomic<std::size_t> tail_;     ///< Next position to push. Owned by producer.
+
+    public:
+        explicit spsc_ring(const std::size_t capacity)
+            : head_(0)
+            , tail_(0) {
+            std::size_t real_cap = 1;
+            while (real_cap < capacity) {
+                real_cap <<= 1;
+            }
+
+            items_ = std::make_unique<T[]>(real_cap);
+            mask_ = real_cap - 1;
+        }
+
+        /**
+         * \brief Push an item to the ring. Only call from the producer thread.
+         * \returns False if the ring is full.
+         */
+        bool push(const T &item) {
+            const std::size_t tail = tail_.load(std::memory_order_relaxed);
+
+            if (tail - head_.load(std::memory_order_acquire) > mask_) {
+                return false;
+            }
+
+            items_[tail & mask_] = item;
+            tail_.store(tail + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        /**
+         * \brief Pop an item from the ring. Only call from the consumer thread.
+         * \returns False if the ring is empty.
+         */
+        bool pop(T &item) {
+            const std::size_t head = head_.load(std::memory_order_relaxed);
+
+            if (head == tail_.load(std::memory_order_acquire)) {
+                return false;
+            }
+
+            item = items_[head & mask_];
+            head_.store(head + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        /**
+         * \brief Pop at most a number of items into a contiguous array. Only call from the consumer thread.
+         * \returns Number of items popped.
+         */
+        std::size_t pop_bulk(T *dest, const std::size_t max_count) {
+            const std::size_t head = head_.load(std::memory_order_relaxed);
+            const std::size_t avail = tail_.load(std::memory_order_acquire) - head;
+            const std::size_t count = (avail < max_count) ? avail : max_count;
+
+            for (std::size_t i = 0; i < count; i++) {
+                dest[i] = items_[(head + i) & mask_];
+            }
+
+            head_.store(head + count, std::memory_order_release);
+            return count;
+        }
+
+        std::size_t size() const {
+            return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+        }
+
+        std::size_t capacity() const {
+            return mask_ + 1;
+        }
+
+        bool empty() const {
+            return size() == 0;
+        }
+    };
+
+    /**
+     * \brief Lock-free ring of variable-sized byte records, with one producer and one consumer.
+     *
+     * Each record is stored as its length followed by its bytes, both wrapping around the end of the
+     * storage. The capacity is rounded up to a power of two. Push never allocates, and pop only does
+     * when the destination has never held a record that big.
+     */
+    class spsc_byte_ring {
+        using length_type = std::uint32_t;
+
+        std::unique_ptr<std::uint8_t[]> data_;
+        std::size_t mask_;
+
+        alignas(64) std::atomic<std::size_t> head_;     ///< Next byte to pop. Owned by consumer.
+        alignas(64) std::atomic<std::size_t> tail_;     ///< Next byte to push. Owned by producer.
+
+        void copy_in(const std::size_t pos, const void *src, const std::size_t size) {
+            const std::size_t start = pos & mask_;
+            const std::size_t first_part = std::min<std::size_t>(size, mask_ + 1 - start);
+
+            std::memcpy(&data_[start], src, first_part);
+            std::memcpy(&data_[0], reinterpret_cast<const std::uint8_t *>(src) + first_part, size - first_part);
+        }
+
+        void copy_out(const std::size_t pos, void *dest, const std::size_t size) const {
+            const std::size_t start = pos & mask_;
+            const std::size_t first_part = std::min<std::size_t>(size, mask_ + 1 - start);
+
+            std::memcpy(dest, &data_[start], first_part);
+            std::memcpy(reinterpret_cast<std::uint8_t *>(dest) + first_part, &data_[0], size - first_part);
+        }
+
+    public:
+        explicit spsc_byte_ring(const std::size_t capacity)
+            : head_(0)
+            , tail_(0) {
+            std::size_t real_cap = sizeof(length_type);
+            while (real_cap < capacity) {
+                real_cap <<= 1;
+            }
+
+            data_ = std::make_unique<std::uint8_t[]>(real_cap);
+            mask_ = real_cap - 1;
+        }
+
+        /**
+         * \brief Push a record to the ring. Only call from the producer thread.
+         * \returns False if there is not enough room for it.
+         */
+        bool push(const void *data, const std::size_t size) {
+            const std::size_t total = sizeof(length_type) + size;
+            const std::size_t tail = tail_.load(std::memory_order_relaxed);
+
+            if (total > mask_ + 1 - (tail - head_.load(std::memory_order_acquire))) {
+                return false;
+            }
+
+            const length_type length = static_cast<length_type>(size);
+
+            copy_in(tail, &length, sizeof(length_type));
+            copy_in(tail + sizeof(length_type), data, size);
+
+            tail_.store(tail + total, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * \brief Pop a record from the ring. Only call from the consumer thread.
+         *
+         * \param dest Receives the record. Its storage is reused if it is big enough.
+         * \returns False if the ring is empty.
+         */
+        bool pop(std::vector<std::uint8_t> &dest) {
+            const std::size_t head = head_.load(std::memory_order_relaxed);
+
+            if (head == tail_.load(std::memory_order_acquire)) {
+                return false;
+            }
+
+            length_type length = 0;
+            copy_out(head, &length, sizeof(length_type));
+
+            dest.resize(length);
+            copy_out(head + sizeof(length_type), dest.data(), length);
+
+            head_.store(head + sizeof(length_type) + length, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * \brief Drop every record pushed until now. Only call from the consumer thread.
+         */
+        void clear() {
+            head_.store(tail_.load(std::memory_order_acquire), std::memory_order_release);
+        }
+
+        /**
+         * \brief Get the number of bytes in use, record lengths included.
+         */
+        std::size_t size() const {
+            return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+        }
+
+        std::size_t capacity() const {
+            return mask_ + 1;
+        }
+
+        /**
+         * \brief Get the size of the biggest record that fits in the ring when it is empty.
+         */
+        std::size_t max_record_size() const {
+            return capacity() - sizeof(length_type);
+        }
+
+        bool empty() const {
+            return size() == 0;
+        }
+    };
+}
\ No newline at end of file
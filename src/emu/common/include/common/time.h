@@ -23,6 +23,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 
@@ -82,6 +83,36 @@ namespace eka2l1::common {
 
     std::unique_ptr<teletimer> make_teletimer(const std::uint32_t target_frequency);
 
+    /**
+     * @brief Timer that only moves when told to.
+     *
+     * Used to drive emulation time from guest execution instead of the host clock,
+     * so that runs can be reproduced regardless of host speed.
+     */
+    struct manual_teletimer : public teletimer {
+    private:
+        std::atomic<std::uint64_t> elapsed_us_;
+        std::uint32_t target_freq_;
+
+    public:
+        explicit manual_teletimer(const std::uint32_t freq);
+
+        void start() override;
+        void stop() override;
+
+        bool set_target_frequency(const std::uint32_t freq) override;
+
+        std::uint64_t ticks() override;
+        std::uint64_t microseconds() override;
+        std::uint64_t nanoseconds() override;
+
+        /**
+         * @brief Move the timer forward.
+         * @param microsecs Number of microseconds to move.
+         */
+        void advance(const std::uint64_t microsecs);
+    };
+
     struct high_resolution_timer_period_guard {
     private:
         bool set_;
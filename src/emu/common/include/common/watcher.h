@@ -82,7 +82,7 @@ namespace eka2l1::common {
          * \param   callback_userdata     The userdata that will be passed to the callback.
          * \param   filters               Bitmask flags to choose what changes to notify us.
          * 
-         * \returns Handle to the watch (> 0), else error code.
+         * \returns Handle to the watch (> 0), else -1.
          * 
          * \see     unwatch
          */
@@ -204,6 +204,31 @@ namespace eka2l1 {
 #endif
         }
 
+        int count_trailing_zero(const std::uint64_t v) {
+            if (v == 0) {
+                return 64;
+            }
+
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_ctzll(v);
+#elif defined(_MSC_VER)
+            DWORD tz = 0;
+
+#if EKA2L1_ARCH(X64) || EKA2L1_ARCH(ARM64)
+            _BitScanForward64(&tz, v);
+#else
+            if (static_cast<std::uint32_t>(v) != 0) {
+                _BitScanForward(&tz, static_cast<std::uint32_t>(v));
+            } else {
+                _BitScanForward(&tz, static_cast<std::uint32_t>(v >> 32));
+                tz += 32;
+            }
+#endif
+
+            return static_cast<int>(tz);
+#endif
+        }
+
         int find_most_significant_bit_one(const std::uint32_t v) {
             return 32 - count_leading_zero(v);
         }
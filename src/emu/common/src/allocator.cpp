@@ -24,6 +24,7 @@
 #include <algorithm>
 #include <exception>
 #include <iostream>
+#include <limits>
 #include <stdexcept>
 
 namespace eka2l1::common {
@@ -112,149 +113,233 @@ namespace eka2l1::common {
         return true;
     }
 
+    static constexpr std::uint32_t BITMAP_WORD_BITS = 32;
+    static constexpr std::uint32_t BITMAP_SUMMARY_BITS = 64;
+    static constexpr std::uint32_t BITMAP_FULL_WORD = 0xFFFFFFFFU;
+
+    // Number of set bits from the most significant bit
+    static int count_leading_one(const std::uint32_t v) {
+        if (v == BITMAP_FULL_WORD) {
+            return 32;
+        }
+
+        return common::count_leading_zero(~v);
+    }
+
     bitmap_allocator::bitmap_allocator(const std::size_t total_bits)
         : words_((total_bits >> 5) + ((total_bits % 32 != 0) ? 1 : 0), 0xFFFFFFFF) {
+        rebuild_summary();
     }
 
     void bitmap_allocator::set_maximum(const std::size_t total_bits) {
-        const std::size_t total_before = words_.size();
         const std::size_t total_after = (total_bits >> 5) + ((total_bits % 32 != 0) ? 1 : 0);
+        words_.resize(total_after, BITMAP_FULL_WORD);
 
-        words_.resize(total_after);
+        rebuild_summary();
+    }
 
-        if (total_after > total_before) {
-            for (std::size_t i = total_before; i < total_after; i++) {
-                words_[i] = 0xFFFFFFFFU;
-            }
+    void bitmap_allocator::rebuild_summary() {
+        const std::size_t summary_count = (words_.size() + BITMAP_SUMMARY_BITS - 1) / BITMAP_SUMMARY_BITS;
+
+        non_empty_summary_.assign(summary_count, 0);
+        full_summary_.assign(summary_count, 0);
+        non_empty_top_.assign((summary_count + BITMAP_SUMMARY_BITS - 1) / BITMAP_SUMMARY_BITS, 0);
+
+        for (std::size_t i = 0; i < words_.size(); i++) {
+            update_summary(i);
         }
     }
 
-    int bitmap_allocator::force_fill(const std::uint32_t offset, const int size, const bool or_mode) {
-        std::uint32_t *word = &words_[0] + (offset >> 5);
-        const std::uint32_t set_bit = offset & 31;
-        int end_bit = static_cast<int>(set_bit + size);
+    void bitmap_allocator::update_summary(const std::size_t word_index) {
+        const std::uint32_t wv = words_[word_index];
 
-        std::uint32_t wval = *word;
+        const std::size_t summary_index = word_index / BITMAP_SUMMARY_BITS;
+        const std::uint64_t summary_bit = 1ULL << (word_index % BITMAP_SUMMARY_BITS);
 
-        if (end_bit < 32) {
-            // The bit we need to allocate is in single word
-            const std::uint32_t mask = ((~(0xFFFFFFFFU >> size)) >> set_bit);
+        if (wv != 0) {
+            non_empty_summary_[summary_index] |= summary_bit;
+        } else {
+            non_empty_summary_[summary_index] &= ~summary_bit;
+        }
 
-            if (or_mode) {
-                *word = wval | mask;
-            } else {
-                *word = wval & (~mask);
-            }
+        if (wv == BITMAP_FULL_WORD) {
+            full_summary_[summary_index] |= summary_bit;
+        } else {
+            full_summary_[summary_index] &= ~summary_bit;
+        }
 
-            return std::min<int>(size, static_cast<int>((words_.size() << 5) - set_bit));
+        const std::uint64_t top_bit = 1ULL << (summary_index % BITMAP_SUMMARY_BITS);
+
+        if (non_empty_summary_[summary_index] != 0) {
+            non_empty_top_[summary_index / BITMAP_SUMMARY_BITS] |= top_bit;
+        } else {
+            non_empty_top_[summary_index / BITMAP_SUMMARY_BITS] &= ~top_bit;
         }
+    }
 
-        // All the bits trails across some other words
-        std::uint32_t mask = 0xFFFFFFFFU >> set_bit;
+    std::size_t bitmap_allocator::next_non_empty_word(const std::size_t from) const {
+        if (from >= words_.size()) {
+            return words_.size();
+        }
 
-        while (end_bit > 0 && word != words_.data() + words_.size()) {
-            wval = *word;
+        std::size_t summary_index = from / BITMAP_SUMMARY_BITS;
+        const std::uint64_t summary_val = non_empty_summary_[summary_index] & (~0ULL << (from % BITMAP_SUMMARY_BITS));
 
-            if (or_mode) {
-                *word = wval | mask;
-            } else {
-                *word = wval & (~mask);
-            }
+        if (summary_val != 0) {
+            return summary_index * BITMAP_SUMMARY_BITS + common::count_trailing_zero(summary_val);
+        }
 
-            word += 1;
+        // Use the top level to find the next summary word having any free cell
+        summary_index++;
 
-            // We only need to be careful with the first word, since it only fills
-            // some first bits. We should fully fill with other word, so set the mask full
-            mask = 0xFFFFFFFFU;
-            end_bit -= 32;
+        if (summary_index >= non_empty_summary_.size()) {
+            return words_.size();
+        }
 
-            if (end_bit < 32) {
-                mask = ~(mask >> static_cast<std::uint32_t>(end_bit));
+        std::size_t top_index = summary_index / BITMAP_SUMMARY_BITS;
+        std::uint64_t top_val = non_empty_top_[top_index] & (~0ULL << (summary_index % BITMAP_SUMMARY_BITS));
+
+        while (top_val == 0) {
+            if (++top_index >= non_empty_top_.size()) {
+                return words_.size();
             }
+
+            top_val = non_empty_top_[top_index];
         }
 
-        return std::min<int>(size, static_cast<int>((words_.size() << 5) - set_bit));
+        summary_index = top_index * BITMAP_SUMMARY_BITS + common::count_trailing_zero(top_val);
+        return summary_index * BITMAP_SUMMARY_BITS + common::count_trailing_zero(non_empty_summary_[summary_index]);
     }
 
-    void bitmap_allocator::free(const std::uint32_t offset, const int size) {
-        force_fill(offset, size, true);
+    std::size_t bitmap_allocator::next_non_full_word(const std::size_t from) const {
+        std::size_t summary_index = from / BITMAP_SUMMARY_BITS;
+
+        if (summary_index >= full_summary_.size()) {
+            return words_.size();
+        }
+
+        std::uint64_t summary_val = ~full_summary_[summary_index] & (~0ULL << (from % BITMAP_SUMMARY_BITS));
+
+        while (summary_val == 0) {
+            if (++summary_index >= full_summary_.size()) {
+                return words_.size();
+            }
+
+            summary_val = ~full_summary_[summary_index];
+        }
+
+        // Bits past the last word are never marked as full
+        return common::min<std::size_t>(summary_index * BITMAP_SUMMARY_BITS + common::count_trailing_zero(summary_val),
+            words_.size());
     }
 
-    int bitmap_allocator::allocate_from(const std::uint32_t start_offset, int &size, const bool best_fit) {
-        std::uint32_t *word = &words_[0] + (start_offset << 5);
-
-        // We have arrived at le word that still have free position (bit 1)
-        std::uint32_t *word_end = &words_[words_.size() - 1];
-        std::uint32_t soc = start_offset;
-
-        int bflmin = 0xFFFFFF;
-        int bofmin = -1;
-        std::uint32_t *wordmin = nullptr;
-
-        // Keep finding
-        while (word <= word_end) {
-            std::uint32_t wv = *word;
-
-            if (wv != 0) {
-                // Still have free stuff
-                int bflen = 0;
-                int boff = 0;
-                std::uint32_t *bword = nullptr;
-
-                int cursor = 31;
-
-                while (cursor > 0) {
-                    if (((wv >> cursor) & 1) == 1) {
-                        boff = cursor;
-                        bflen = 0;
-                        bword = word;
-
-                        while (cursor >= 0 && ((wv >> cursor) & 1) == 1) {
-                            bflen++;
-                            cursor--;
-
-                            if (cursor < 0 && word + 1 <= word_end) {
-                                cursor = 31;
-                                soc = 32;
-                                word++;
-                                wv = *word;
-                            }
-                        }
-
-                        if (bflen >= size) {
-                            if (!best_fit) {
-                                // Force allocate and then return
-                                const int offset = static_cast<int>(31 - boff + ((bword - &words_[0]) << 5));
-                                size = force_fill(static_cast<const std::uint32_t>(offset), size, false);
-
-                                return offset;
-                            } else {
-                                if (bflen < bflmin) {
-                                    bflmin = bflen;
-                                    bofmin = boff;
-                                    wordmin = bword;
-                                }
-                            }
-                        }
+    int bitmap_allocator::find_free_run(const std::uint32_t start_offset, const int size, const bool best_fit) const {
+        const int needed = common::max<int>(size, 1);
+
+        int best_offset = -1;
+        int best_length = std::numeric_limits<int>::max();
+
+        // Cells of the current word that have not been walked through yet
+        std::size_t word_index = start_offset / BITMAP_WORD_BITS;
+        std::uint32_t word_mask = BITMAP_FULL_WORD >> (start_offset % BITMAP_WORD_BITS);
+
+        while (word_index < words_.size()) {
+            std::uint32_t wv = words_[word_index] & word_mask;
+            std::size_t next_word = word_index + 1;
+
+            word_mask = BITMAP_FULL_WORD;
+
+            while (wv != 0) {
+                const int run_pos = common::count_leading_zero(wv);
+                const int run_in_word = count_leading_one(wv << run_pos);
+
+                const int run_offset = static_cast<int>(word_index * BITMAP_WORD_BITS) + run_pos;
+                int run_length = run_in_word;
+
+                if (run_pos + run_in_word == BITMAP_WORD_BITS) {
+                    // The run continues to the next words. Walk through the fully free ones.
+                    std::size_t cont_index = next_non_full_word(word_index + 1);
+                    run_length += static_cast<int>((cont_index - word_index - 1) * BITMAP_WORD_BITS);
+
+                    if (cont_index < words_.size()) {
+                        const int cont_length = count_leading_one(words_[cont_index]);
+                        run_length += cont_length;
+
+                        // Continue from the cells after this run
+                        word_mask = BITMAP_FULL_WORD >> cont_length;
                     }
 
-                    cursor--;
+                    next_word = cont_index;
+                    wv = 0;
+                } else {
+                    wv &= BITMAP_FULL_WORD >> (run_pos + run_in_word);
+                }
+
+                if (run_length >= needed) {
+                    if (!best_fit || (run_length == needed)) {
+                        return run_offset;
+                    }
+
+                    if (run_length < best_length) {
+                        best_length = run_length;
+                        best_offset = run_offset;
+                    }
                 }
             }
 
-            soc = 32;
-            word++;
+            word_index = (word_mask == BITMAP_FULL_WORD) ? next_non_empty_word(next_word) : next_word;
+        }
+
+        return best_offset;
+    }
+
+    int bitmap_allocator::force_fill(const std::uint32_t offset, const int size, const bool or_mode) {
+        const std::size_t total_bits = words_.size() * BITMAP_WORD_BITS;
+
+        if ((size <= 0) || (offset >= total_bits)) {
+            return 0;
+        }
+
+        const std::size_t end = common::min<std::size_t>(static_cast<std::size_t>(offset) + size, total_bits);
+
+        const std::size_t first_word = offset / BITMAP_WORD_BITS;
+        const std::size_t last_word = (end - 1) / BITMAP_WORD_BITS;
+
+        for (std::size_t i = first_word; i <= last_word; i++) {
+            const std::uint32_t lo = (i == first_word) ? (offset % BITMAP_WORD_BITS) : 0;
+            const std::uint32_t hi = (i == last_word) ? static_cast<std::uint32_t>((end - 1) % BITMAP_WORD_BITS + 1) : BITMAP_WORD_BITS;
+
+            std::uint32_t mask = BITMAP_FULL_WORD >> lo;
+
+            if (hi < BITMAP_WORD_BITS) {
+                mask &= ~(BITMAP_FULL_WORD >> hi);
+            }
+
+            if (or_mode) {
+                words_[i] |= mask;
+            } else {
+                words_[i] &= ~mask;
+            }
+
+            update_summary(i);
         }
 
-        if (best_fit && bofmin) {
-            // Force allocate and then return
-            const int offset = static_cast<int>(31 - bofmin + ((wordmin - &words_[0]) << 5));
-            size = force_fill(static_cast<std::uint32_t>(offset), size, false);
+        return static_cast<int>(end - offset);
+    }
+
+    void bitmap_allocator::free(const std::uint32_t offset, const int size) {
+        force_fill(offset, size, true);
+    }
+
+    int bitmap_allocator::allocate_from(const std::uint32_t start_offset, int &size, const bool best_fit) {
+        const int offset = find_free_run(start_offset, size, best_fit);
 
-            return offset;
+        if (offset < 0) {
+            return -1;
         }
 
-        return -1;
+        size = force_fill(static_cast<std::uint32_t>(offset), size, false);
+        return offset;
     }
 
     bool bitmap_allocator::set_word(const std::uint32_t off, const std::uint32_t val) {
@@ -263,6 +348,8 @@ namespace eka2l1::common {
         }
 
         words_[off] = val;
+        update_summary(off);
+
         return true;
     }
 
@@ -274,12 +361,6 @@ namespace eka2l1::common {
         return words_[off];
     }
 
-    static int number_of_set_bits(std::uint32_t i) {
-        i = i - ((i >> 1) & 0x55555555);
-        i = (i & 0x33333333) + ((i >> 2) & 0x33333333);
-        return (((i + (i >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
-    }
-
     int bitmap_allocator::allocated_count(const std::uint32_t offset, const std::uint32_t offset_end) {
         if (offset > offset_end) {
             return -1;
@@ -292,18 +373,17 @@ namespace eka2l1::common {
             return -1;
         }
 
-        std::uint32_t start_bit = offset;
-        const std::uint32_t end_bit = offset_end;
+        int allocated_count = 0;
 
-        std::uint32_t allocated_count = 0;
+        // This counts from the least significant bit, the end is exclusive
+        for (std::uint32_t i = beg_off; (i <= end_off) && (i * BITMAP_WORD_BITS < offset_end); i++) {
+            const std::uint32_t lo = (i == beg_off) ? (offset & 31) : 0;
+            const std::uint32_t hi = common::min<std::uint32_t>(offset_end - i * BITMAP_WORD_BITS, BITMAP_WORD_BITS);
 
-        while (start_bit < end_bit) {
-            const std::uint32_t next_end_bit = common::min<std::uint32_t>(((start_bit + 32) >> 5) << 5, end_bit);
+            std::uint32_t mask = (hi == BITMAP_WORD_BITS) ? BITMAP_FULL_WORD : ((1U << hi) - 1);
+            mask &= ~((1U << lo) - 1);
 
-            std::uint32_t word_to_scan = (words_[start_bit >> 5] >> (start_bit & 31)) << (31 - (next_end_bit - 1) & 31);
-            allocated_count += number_of_set_bits(word_to_scan);
-            
-            start_bit = next_end_bit;
+            allocated_count += common::count_bit_set(words_[i] & mask);
         }
 
         return allocated_count;
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <common/asynclog.h>
+#include <common/log.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace eka2l1::log {
+    static std::uint64_t now_us() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    async_logger::async_logger(std::shared_ptr<spdlog::logger> target, const std::size_t capacity,
+        const std::uint32_t max_per_class_per_second)
+        : target_(target)
+        , write_pos_(0)
+        , read_pos_(0)
+        , overflow_count_(0)
+        , overflow_reported_(0)
+        , max_per_class_per_second_(max_per_class_per_second)
+        , stop_(false) {
+        std::size_t real_capacity = 2;
+
+        while (real_capacity < capacity) {
+            real_capacity <<= 1;
+        }
+
+        records_ = std::make_unique<record[]>(real_capacity);
+        mask_ = real_capacity - 1;
+
+        for (std::size_t i = 0; i < real_capacity; i++) {
+            records_[i].sequence_.store(i, std::memory_order_relaxed);
+        }
+
+        std::fill(rate_limited_reported_, rate_limited_reported_ + LOG_CLASS_COUNT, 0);
+
+        worker_ = std::thread([this]() { worker_loop(); });
+    }
+
+    async_logger::~async_logger() {
+        stop_.store(true, std::memory_order_release);
+        wake_cond_.notify_one();
+
+        worker_.join();
+    }
+
+    bool async_logger::pass_rate_limit(const log_class cls, const spdlog::level::level_enum level) {
+        if (!max_per_class_per_second_ || (level >= spdlog::level::err) || (cls >= LOG_CLASS_COUNT)) {
+            return true;
+        }
+
+        class_budget &budget = budgets_[static_cast<int>(cls)];
+
+        const std::uint64_t now = now_us();
+        std::uint64_t window_start = budget.window_start_us_.load(std::memory_order_relaxed);
+
+        if (now - window_start >= 1000000) {
+            // Only the thread that moves the window resets the count
+            if (budget.window_start_us_.compare_exchange_strong(window_start, now, std::memory_order_relaxed)) {
+                budget.count_.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        if (budget.count_.fetch_add(1, std::memory_order_relaxed) >= max_per_class_per_second_) {
+            budget.dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        return true;
+    }
+
+    async_logger::record *async_logger::claim(const log_class cls, const spdlog::level::level_enum level) {
+        if (!pass_rate_limit(cls, level)) {
+            return nullptr;
+        }
+
+        std::uint64_t pos = write_pos_.load(std::memory_order_relaxed);
+
+        while (true) {
+            record &rec = records_[pos & mask_];
+
+            const std::uint64_t sequence = rec.sequence_.load(std::memory_order_acquire);
+            const std::int64_t diff = static_cast<std::int64_t>(sequence - pos);
+
+            if (diff == 0) {
+                if (write_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    rec.cls_ = cls;
+                    rec.level_ = level;
+
+                    // Wake the writer every half ring, so a burst does not wait for its next poll
+                    if ((pos & (mask_ >> 1)) == 0) {
+                        wake_cond_.notify_one();
+                    }
+
+                    return &rec;
+                }
+            } else if (diff < 0) {
+                // The writer has not freed this slot yet: the ring is full
+                overflow_count_.fetch_add(1, std::memory_order_relaxed);
+                wake_cond_.notify_one();
+
+                return nullptr;
+            } else {
+                pos = write_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void async_logger::publish(record *rec) {
+        // While claimed, the sequence is the write position of the slot
+        rec->sequence_.store(rec->sequence_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool async_logger::write_one() {
+        const std::uint64_t pos = read_pos_.load(std::memory_order_relaxed);
+        record &rec = records_[pos & mask_];
+
+        if (rec.sequence_.load(std::memory_order_acquire) != pos + 1) {
+            return false;
+        }
+
+        std::string text;
+
+        try {
+            rec.format_func_(rec, text);
+        } catch (const std::exception &e) {
+            text = e.what();
+        }
+
+        rec.destroy_func_(rec);
+
+        target_->log(rec.level_, "{:s}:{} [{:s}]: {}", rec.file_, rec.line_, log_class_to_string(rec.cls_), text);
+
+        rec.sequence_.store(pos + mask_ + 1, std::memory_order_release);
+        read_pos_.store(pos + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    void async_logger::report_drops() {
+        const std::uint64_t overflowed = overflow_count_.load(std::memory_order_relaxed);
+
+        if (overflowed != overflow_reported_) {
+            target_->warn("Log ring full, {} records dropped", overflowed - overflow_reported_);
+            overflow_reported_ = overflowed;
+        }
+
+        for (int i = 0; i < LOG_CLASS_COUNT; i++) {
+            const std::uint64_t dropped = budgets_[i].dropped_.load(std::memory_order_relaxed);
+
+            if (dropped != rate_limited_reported_[i]) {
+                target_->warn("[{:s}]: {} records dropped by the rate limit", log_class_to_string(static_cast<log_class>(i)),
+                    dropped - rate_limited_reported_[i]);
+
+                rate_limited_reported_[i] = dropped;
+            }
+        }
+    }
+
+    void async_logger::worker_loop() {
+        auto last_report = std::chrono::steady_clock::now();
+
+        while (true) {
+            bool wrote_any = false;
+
+            while (write_one()) {
+                wrote_any = true;
+            }
+
+            const auto now = std::chrono::steady_clock::now();
+
+            if (now - last_report >= std::chrono::seconds(1)) {
+                report_drops();
+                last_report = now;
+            }
+
+            if (stop_.load(std::memory_order_acquire)) {
+                // Producers are gone by now, take what they published before stopping
+                while (write_one()) {
+                }
+
+                break;
+            }
+
+            if (!wrote_any) {
+                std::unique_lock<std::mutex> guard(wake_lock_);
+                wake_cond_.wait_for(guard, std::chrono::milliseconds(1));
+            }
+        }
+
+        report_drops();
+        target_->flush();
+    }
+
+    void async_logger::flush() {
+        const std::uint64_t target_pos = write_pos_.load(std::memory_order_acquire);
+
+        while (read_pos_.load(std::memory_order_acquire) < target_pos) {
+            wake_cond_.notify_one();
+            std::this_thread::yield();
+        }
+
+        target_->flush();
+    }
+}
@@ -18,6 +18,7 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <common/asynclog.h>
 #include <common/log.h>
 #include <common/platform.h>
 
@@ -73,6 +74,7 @@ namespace eka2l1 {
     namespace log {
         std::shared_ptr<spdlog::logger> spd_logger;
         std::unique_ptr<log_filterings> filterings;
+        std::unique_ptr<async_logger> async_log;
 
         struct imgui_logger_sink : public spdlog::sinks::base_sink<std::mutex> {
             explicit imgui_logger_sink(std::shared_ptr<base_logger> _logger)
@@ -145,5 +147,17 @@ namespace eka2l1 {
             filterings = std::make_unique<log_filterings>();
             already_setup = true;
         }
+
+        void enable_async_log(const std::uint32_t max_per_class_per_second) {
+            if (!spd_logger || async_log) {
+                return;
+            }
+
+            async_log = std::make_unique<async_logger>(spd_logger, async_logger::DEFAULT_CAPACITY, max_per_class_per_second);
+        }
+
+        void disable_async_log() {
+            async_log.reset();
+        }
     }
 }
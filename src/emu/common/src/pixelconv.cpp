@@ -0,0 +1,796 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <common/cpudetect.h>
+#include <common/pixelconv.h>
+#include <common/platform.h>
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+#if EKA2L1_ARCH(X86) || EKA2L1_ARCH(X64)
+#define PIXELCONV_X86 1
+#include <immintrin.h>
+#endif
+
+#if EKA2L1_ARCH(ARM64) || defined(__ARM_NEON)
+#define PIXELCONV_NEON 1
+#include <arm_neon.h>
+#endif
+
+// x86 kernels are picked at runtime, so they are compiled for their instruction set whatever the build targets
+#if defined(_MSC_VER) && !defined(__clang__)
+#define PIXELCONV_TARGET(isa)
+#else
+#define PIXELCONV_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace eka2l1::common {
+    using row_convert_func = void (*)(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width);
+
+    struct row_kernels {
+        row_convert_func rgb444_to_bgr24;
+        row_convert_func rgb444_to_bgra32;
+        row_convert_func rgb565_to_bgr24;
+        row_convert_func rgb565_to_bgra32;
+        row_convert_func bgr24_to_bgra32;
+        row_convert_func bgra32_to_bgr24;
+    };
+
+    static inline std::uint16_t read_pixel16(const std::uint8_t *src) {
+        std::uint16_t pixel = 0;
+        std::memcpy(&pixel, src, sizeof(std::uint16_t));
+
+        return pixel;
+    }
+
+    // Expand channels by repeating their top bits, so full intensity stays full
+    static inline void expand_rgb444(const std::uint16_t pixel, std::uint8_t *bgr) {
+        bgr[0] = static_cast<std::uint8_t>((pixel & 0xF) * 0x11);
+        bgr[1] = static_cast<std::uint8_t>(((pixel >> 4) & 0xF) * 0x11);
+        bgr[2] = static_cast<std::uint8_t>(((pixel >> 8) & 0xF) * 0x11);
+    }
+
+    static inline void expand_rgb565(const std::uint16_t pixel, std::uint8_t *bgr) {
+        const std::uint8_t b5 = pixel & 0x1F;
+        const std::uint8_t g6 = (pixel >> 5) & 0x3F;
+        const std::uint8_t r5 = (pixel >> 11) & 0x1F;
+
+        bgr[0] = static_cast<std::uint8_t>((b5 << 3) | (b5 >> 2));
+        bgr[1] = static_cast<std::uint8_t>((g6 << 2) | (g6 >> 4));
+        bgr[2] = static_cast<std::uint8_t>((r5 << 3) | (r5 >> 2));
+    }
+
+    static void rgb444_to_bgr24_scalar(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        for (std::size_t x = 0; x < width; x++) {
+            expand_rgb444(read_pixel16(src + x * 2), dest + x * 3);
+        }
+    }
+
+    static void rgb444_to_bgra32_scalar(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        for (std::size_t x = 0; x < width; x++) {
+            expand_rgb444(read_pixel16(src + x * 2), dest + x * 4);
+            dest[x * 4 + 3] = 0xFF;
+        }
+    }
+
+    static void rgb565_to_bgr24_scalar(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        for (std::size_t x = 0; x < width; x++) {
+            expand_rgb565(read_pixel16(src + x * 2), dest + x * 3);
+        }
+    }
+
+    static void rgb565_to_bgra32_scalar(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        for (std::size_t x = 0; x < width; x++) {
+            expand_rgb565(read_pixel16(src + x * 2), dest + x * 4);
+            dest[x * 4 + 3] = 0xFF;
+        }
+    }
+
+    static void bgr24_to_bgra32_scalar(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        for (std::size_t x = 0; x < width; x++) {
+            dest[x * 4] = src[x * 3];
+            dest[x * 4 + 1] = src[x * 3 + 1];
+            dest[x * 4 + 2] = src[x * 3 + 2];
+            dest[x * 4 + 3] = 0xFF;
+        }
+    }
+
+    static void bgra32_to_bgr24_scalar(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        for (std::size_t x = 0; x < width; x++) {
+            dest[x * 3] = src[x * 4];
+            dest[x * 3 + 1] = src[x * 4 + 1];
+            dest[x * 3 + 2] = src[x * 4 + 2];
+        }
+    }
+
+#if PIXELCONV_X86
+    // Channels come out as 16-bit lanes holding 0-255
+    PIXELCONV_TARGET("sse2")
+    static inline void expand_rgb444_sse2(const __m128i pixels, __m128i &b, __m128i &g, __m128i &r) {
+        const __m128i mask = _mm_set1_epi16(0xF);
+
+        b = _mm_and_si128(pixels, mask);
+        g = _mm_and_si128(_mm_srli_epi16(pixels, 4), mask);
+        r = _mm_and_si128(_mm_srli_epi16(pixels, 8), mask);
+
+        b = _mm_or_si128(b, _mm_slli_epi16(b, 4));
+        g = _mm_or_si128(g, _mm_slli_epi16(g, 4));
+        r = _mm_or_si128(r, _mm_slli_epi16(r, 4));
+    }
+
+    PIXELCONV_TARGET("sse2")
+    static inline void expand_rgb565_sse2(const __m128i pixels, __m128i &b, __m128i &g, __m128i &r) {
+        b = _mm_and_si128(pixels, _mm_set1_epi16(0x1F));
+        g = _mm_and_si128(_mm_srli_epi16(pixels, 5), _mm_set1_epi16(0x3F));
+        r = _mm_srli_epi16(pixels, 11);
+
+        b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+        g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+        r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+    }
+
+    // Interleave 8 pixels of 16-bit channel lanes to BGRA bytes
+    PIXELCONV_TARGET("sse2")
+    static inline void pack_bgra32_sse2(const __m128i b, const __m128i g, const __m128i r, __m128i &low, __m128i &high) {
+        const __m128i bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+        const __m128i ra = _mm_or_si128(r, _mm_set1_epi16(static_cast<short>(0xFF00)));
+
+        low = _mm_unpacklo_epi16(bg, ra);
+        high = _mm_unpackhi_epi16(bg, ra);
+    }
+
+    PIXELCONV_TARGET("sse2")
+    static void rgb444_to_bgra32_sse2(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        std::size_t x = 0;
+
+        for (; x + 8 <= width; x += 8) {
+            __m128i b, g, r, low, high;
+
+            expand_rgb444_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 2)), b, g, r);
+            pack_bgra32_sse2(b, g, r, low, high);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + x * 4), low);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + x * 4 + 16), high);
+        }
+
+        rgb444_to_bgra32_scalar(dest + x * 4, src + x * 2, width - x);
+    }
+
+    PIXELCONV_TARGET("sse2")
+    static void rgb565_to_bgra32_sse2(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        std::size_t x = 0;
+
+        for (; x + 8 <= width; x += 8) {
+            __m128i b, g, r, low, high;
+
+            expand_rgb565_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 2)), b, g, r);
+            pack_bgra32_sse2(b, g, r, low, high);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + x * 4), low);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + x * 4 + 16), high);
+        }
+
+        rgb565_to_bgra32_scalar(dest + x * 4, src + x * 2, width - x);
+    }
+
+    // Drop the alpha of 16 BGRA pixels, storing 48 bytes
+    PIXELCONV_TARGET("ssse3")
+    static inline void store_bgr24_ssse3(std::uint8_t *dest, const __m128i p0, const __m128i p1, const __m128i p2, const __m128i p3) {
+        const __m128i drop_alpha = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+        const __m128i c0 = _mm_shuffle_epi8(p0, drop_alpha);
+        const __m128i c1 = _mm_shuffle_epi8(p1, drop_alpha);
+        const __m128i c2 = _mm_shuffle_epi8(p2, drop_alpha);
+        const __m128i c3 = _mm_shuffle_epi8(p3, drop_alpha);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest), _mm_or_si128(c0, _mm_slli_si128(c1, 12)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 16), _mm_or_si128(_mm_srli_si128(c1, 4), _mm_slli_si128(c2, 8)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 32), _mm_or_si128(_mm_srli_si128(c2, 8), _mm_slli_si128(c3, 4)));
+    }
+
+    PIXELCONV_TARGET("ssse3")
+    static void rgb444_to_bgr24_ssse3(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        std::size_t x = 0;
+
+        for (; x + 16 <= width; x += 16) {
+            __m128i b, g, r, p0, p1, p2, p3;
+
+            expand_rgb444_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 2)), b, g, r);
+            pack_bgra32_sse2(b, g, r, p0, p1);
+
+            expand_rgb444_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 2 + 16)), b, g, r);
+            pack_bgra32_sse2(b, g, r, p2, p3);
+
+            store_bgr24_ssse3(dest + x * 3, p0, p1, p2, p3);
+        }
+
+        rgb444_to_bgr24_scalar(dest + x * 3, src + x * 2, width - x);
+    }
+
+    PIXELCONV_TARGET("ssse3")
+    static void rgb565_to_bgr24_ssse3(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        std::size_t x = 0;
+
+        for (; x + 16 <= width; x += 16) {
+            __m128i b, g, r, p0, p1, p2, p3;
+
+            expand_rgb565_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 2)), b, g, r);
+            pack_bgra32_sse2(b, g, r, p0, p1);
+
+            expand_rgb565_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 2 + 16)), b, g, r);
+            pack_bgra32_sse2(b, g, r, p2, p3);
+
+            store_bgr24_ssse3(dest + x * 3, p0, p1, p2, p3);
+        }
+
+        rgb565_to_bgr24_scalar(dest + x * 3, src + x * 2, width - x);
+    }
+
+    PIXELCONV_TARGET("ssse3")
+    static void bgra32_to_bgr24_ssse3(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        std::size_t x = 0;
+
+        for (; x + 16 <= width; x += 16) {
+            const __m128i *source = reinterpret_cast<const __m128i *>(src + x * 4);
+
+            store_bgr24_ssse3(dest + x * 3, _mm_loadu_si128(source), _mm_loadu_si128(source + 1),
+                _mm_loadu_si128(source + 2), _mm_loadu_si128(source + 3));
+        }
+
+        bgra32_to_bgr24_scalar(dest + x * 3, src + x * 4, width - x);
+    }
+
+    PIXELCONV_TARGET("ssse3")
+    static void bgr24_to_bgra32_ssse3(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        const __m128i add_alpha = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+        std::size_t x = 0;
+
+        for (; x + 16 <= width; x += 16) {
+            const __m128i *source = reinterpret_cast<const __m128i *>(src + x * 3);
+            __m128i *target = reinterpret_cast<__m128i *>(dest + x * 4);
+
+            const __m128i s0 = _mm_loadu_si128(source);
+            const __m128i s1 = _mm_loadu_si128(source + 1);
+            const __m128i s2 = _mm_loadu_si128(source + 2);
+
+            // Bring each group of 4 pixels (12 bytes) to the start of a register
+            _mm_storeu_si128(target, _mm_or_si128(_mm_shuffle_epi8(s0, add_alpha), alpha));
+            _mm_storeu_si128(target + 1, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(s1, s0, 12), add_alpha), alpha));
+            _mm_storeu_si128(target + 2, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(s2, s1, 8), add_alpha), alpha));
+            _mm_storeu_si128(target + 3, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(s2, 4), add_alpha), alpha));
+        }
+
+        bgr24_to_bgra32_scalar(dest + x * 4, src + x * 3, width - x);
+    }
+
+    PIXELCONV_TARGET("avx2")
+    static inline void expand_rgb444_avx2(const __m256i pixels, __m256i &b, __m256i &g, __m256i &r) {
+        const __m256i mask = _mm256_set1_epi16(0xF);
+
+        b = _mm256_and_si256(pixels, mask);
+        g = _mm256_and_si256(_mm256_srli_epi16(pixels, 4), mask);
+        r = _mm256_and_si256(_mm256_srli_epi16(pixels, 8), mask);
+
+        b = _mm256_or_si256(b, _mm256_slli_epi16(b, 4));
+        g = _mm256_or_si256(g, _mm256_slli_epi16(g, 4));
+        r = _mm256_or_si256(r, _mm256_slli_epi16(r, 4));
+    }
+
+    PIXELCONV_TARGET("avx2")
+    static inline void expand_rgb565_avx2(const __m256i pixels, __m256i &b, __m256i &g, __m256i &r) {
+        b = _mm256_and_si256(pixels, _mm256_set1_epi16(0x1F));
+        g = _mm256_and_si256(_mm256_srli_epi16(pixels, 5), _mm256_set1_epi16(0x3F));
+        r = _mm256_srli_epi16(pixels, 11);
+
+        b = _mm256_or_si256(_mm256_slli_epi16(b, 3), _mm256_srli_epi16(b, 2));
+        g = _mm256_or_si256(_mm256_slli_epi16(g, 2), _mm256_srli_epi16(g, 4));
+        r = _mm256_or_si256(_mm256_slli_epi16(r, 3), _mm256_srli_epi16(r, 2));
+    }
+
+    // Interleave 16 pixels. Unpacking works inside 128-bit lanes, so the halves are put back in order after.
+    PIXELCONV_TARGET("avx2")
+    static inline void pack_bgra32_avx2(const __m256i b, const __m256i g, const __m256i r, __m256i &low, __m256i &high) {
+        const __m256i bg = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+        const __m256i ra = _mm256_or_si256(r, _mm256_set1_epi16(static_cast<short>(0xFF00)));
+
+        const __m256i lane_low = _mm256_unpacklo_epi16(bg, ra);
+        const __m256i lane_high = _mm256_unpackhi_epi16(bg, ra);
+
+        low = _mm256_permute2x128_si256(lane_low, lane_high, 0x20);
+        high = _mm256_permute2x128_si256(lane_low, lane_high, 0x31);
+    }
+
+    PIXELCONV_TARGET("avx2")
+    static void rgb444_to_bgra32_avx2(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        std::size_t x = 0;
+
+        for (; x + 16 <= width; x += 16) {
+            __m256i b, g, r, low, high;
+
+            expand_rgb444_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x * 2)), b, g, r);
+            pack_bgra32_avx2(b, g, r, low, high);
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + x * 4), low);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + x * 4 + 32), high);
+        }
+
+        rgb444_to_bgra32_scalar(dest + x * 4, src + x * 2, width - x);
+    }
+
+    PIXELCONV_TARGET("avx2")
+    static void rgb565_to_bgra32_avx2(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        std::size_t x = 0;
+
+        for (; x + 16 <= width; x += 16) {
+            __m256i b, g, r, low, high;
+
+            expand_rgb565_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x * 2)), b, g, r);
+            pack_bgra32_avx2(b, g, r, low, high);
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + x * 4), low);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + x * 4 + 32), high);
+        }
+
+        rgb565_to_bgra32_scalar(dest + x * 4, src + x * 2, width - x);
+    }
+
+    PIXELCONV_TARGET("avx2")
+    static void rgb444_to_bgr24_avx2(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        std::size_t x = 0;
+
+        for (; x + 16 <= width; x += 16) {
+            __m256i b, g, r, low, high;
+
+            expand_rgb444_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x * 2)), b, g, r);
+            pack_bgra32_avx2(b, g, r, low, high);
+
+            store_bgr24_ssse3(dest + x * 3, _mm256_castsi256_si128(low), _mm256_extracti128_si256(low, 1),
+                _mm256_castsi256_si128(high), _mm256_extracti128_si256(high, 1));
+        }
+
+        rgb444_to_bgr24_scalar(dest + x * 3, src + x * 2, width - x);
+    }
+
+    PIXELCONV_TARGET("avx2")
+    static void rgb565_to_bgr24_avx2(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        std::size_t x = 0;
+
+        for (; x + 16 <= width; x += 16) {
+            __m256i b, g, r, low, high;
+
+            expand_rgb565_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x * 2)), b, g, r);
+            pack_bgra32_avx2(b, g, r, low, high);
+
+            store_bgr24_ssse3(dest + x * 3, _mm256_castsi256_si128(low), _mm256_extracti128_si256(low, 1),
+                _mm256_castsi256_si128(high), _mm256_extracti128_si256(high, 1));
+        }
+
+        rgb565_to_bgr24_scalar(dest + x * 3, src + x * 2, width - x);
+    }
+#endif
+
+#if PIXELCONV_NEON
+    static inline uint16x8_t load_pixels16_neon(const std::uint8_t *src) {
+        return vreinterpretq_u16_u8(vld1q_u8(src));
+    }
+
+    static inline void expand_rgb444_neon(const uint16x8_t pixels, uint8x8_t &b, uint8x8_t &g, uint8x8_t &r) {
+        const uint8x8_t mask = vdup_n_u8(0xF);
+
+        b = vand_u8(vmovn_u16(pixels), mask);
+        g = vand_u8(vshrn_n_u16(pixels, 4), mask);
+        r = vand_u8(vshrn_n_u16(pixels, 8), mask);
+
+        b = vorr_u8(b, vshl_n_u8(b, 4));
+        g = vorr_u8(g, vshl_n_u8(g, 4));
+        r = vorr_u8(r, vshl_n_u8(r, 4));
+    }
+
+    static inline void expand_rgb565_neon(const uint16x8_t pixels, uint8x8_t &b, uint8x8_t &g, uint8x8_t &r) {
+        // Narrow so each channel sits in the top bits of a byte
+        b = vshl_n_u8(vmovn_u16(pixels), 3);
+        g = vand_u8(vshrn_n_u16(pixels, 3), vdup_n_u8(0xFC));
+        r = vand_u8(vshrn_n_u16(pixels, 8), vdup_n_u8(0xF8));
+
+        b = vorr_u8(b, vshr_n_u8(b, 5));
+        g = vorr_u8(g, vshr_n_u8(g, 6));
+        r = vorr_u8(r, vshr_n_u8(r, 5));
+    }
+
+    static void rgb444_to_bgr24_neon(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        std::size_t x = 0;
+
+        for (; x + 8 <= width; x += 8) {
+            uint8x8x3_t result;
+            expand_rgb444_neon(load_pixels16_neon(src + x * 2), result.val[0], result.val[1], result.val[2]);
+
+            vst3_u8(dest + x * 3, result);
+        }
+
+        rgb444_to_bgr24_scalar(dest + x * 3, src + x * 2, width - x);
+    }
+
+    static void rgb444_to_bgra32_neon(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        std::size_t x = 0;
+
+        for (; x + 8 <= width; x += 8) {
+            uint8x8x4_t result;
+            expand_rgb444_neon(load_pixels16_neon(src + x * 2), result.val[0], result.val[1], result.val[2]);
+            result.val[3] = vdup_n_u8(0xFF);
+
+            vst4_u8(dest + x * 4, result);
+        }
+
+        rgb444_to_bgra32_scalar(dest + x * 4, src + x * 2, width - x);
+    }
+
+    static void rgb565_to_bgr24_neon(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        std::size_t x = 0;
+
+        for (; x + 8 <= width; x += 8) {
+            uint8x8x3_t result;
+            expand_rgb565_neon(load_pixels16_neon(src + x * 2), result.val[0], result.val[1], result.val[2]);
+
+            vst3_u8(dest + x * 3, result);
+        }
+
+        rgb565_to_bgr24_scalar(dest + x * 3, src + x * 2, width - x);
+    }
+
+    static void rgb565_to_bgra32_neon(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        std::size_t x = 0;
+
+        for (; x + 8 <= width; x += 8) {
+            uint8x8x4_t result;
+            expand_rgb565_neon(load_pixels16_neon(src + x * 2), result.val[0], result.val[1], result.val[2]);
+            result.val[3] = vdup_n_u8(0xFF);
+
+            vst4_u8(dest + x * 4, result);
+        }
+
+        rgb565_to_bgra32_scalar(dest + x * 4, src + x * 2, width - x);
+    }
+
+    static void bgr24_to_bgra32_neon(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        std::size_t x = 0;
+
+        for (; x + 16 <= width; x += 16) {
+            const uint8x16x3_t source = vld3q_u8(src + x * 3);
+            uint8x16x4_t result;
+
+            result.val[0] = source.val[0];
+            result.val[1] = source.val[1];
+            result.val[2] = source.val[2];
+            result.val[3] = vdupq_n_u8(0xFF);
+
+            vst4q_u8(dest + x * 4, result);
+        }
+
+        bgr24_to_bgra32_scalar(dest + x * 4, src + x * 3, width - x);
+    }
+
+    static void bgra32_to_bgr24_neon(std::uint8_t *dest, const std::uint8_t *src, const std::size_t width) {
+        std::size_t x = 0;
+
+        for (; x + 16 <= width; x += 16) {
+            const uint8x16x4_t source = vld4q_u8(src + x * 4);
+            uint8x16x3_t result;
+
+            result.val[0] = source.val[0];
+            result.val[1] = source.val[1];
+            result.val[2] = source.val[2];
+
+            vst3q_u8(dest + x * 3, result);
+        }
+
+        bgra32_to_bgr24_scalar(dest + x * 3, src + x * 4, width - x);
+    }
+#endif
+
+    static pixel_kernel_level detect_best_kernel_level() {
+#if PIXELCONV_X86
+        cpu_info info;
+        info.detect();
+
+        if (info.bAVX2) {
+            return pixel_kernel_avx2;
+        }
+
+        if (info.bSSSE3) {
+            return pixel_kernel_ssse3;
+        }
+
+        if (info.bSSE2) {
+            return pixel_kernel_sse2;
+        }
+#elif PIXELCONV_NEON
+        return pixel_kernel_neon;
+#endif
+
+        return pixel_kernel_scalar;
+    }
+
+    static pixel_kernel_level best_kernel_level() {
+        static const pixel_kernel_level best = detect_best_kernel_level();
+        return best;
+    }
+
+    bool is_pixel_kernel_supported(const pixel_kernel_level level) {
+        switch (level) {
+        case pixel_kernel_scalar:
+        case pixel_kernel_best:
+            return true;
+
+        case pixel_kernel_sse2:
+        case pixel_kernel_ssse3:
+        case pixel_kernel_avx2:
+#if PIXELCONV_X86
+            return level <= best_kernel_level();
+#else
+            return false;
+#endif
+
+        case pixel_kernel_neon:
+#if PIXELCONV_NEON
+            return true;
+#else
+            return false;
+#endif
+
+        default:
+            break;
+        }
+
+        return false;
+    }
+
+    static std::array<row_kernels, pixel_kernel_best> make_row_kernels() {
+        std::array<row_kernels, pixel_kernel_best> kernels;
+
+        row_kernels &scalar = kernels[pixel_kernel_scalar];
+        scalar.rgb444_to_bgr24 = rgb444_to_bgr24_scalar;
+        scalar.rgb444_to_bgra32 = rgb444_to_bgra32_scalar;
+        scalar.rgb565_to_bgr24 = rgb565_to_bgr24_scalar;
+        scalar.rgb565_to_bgra32 = rgb565_to_bgra32_scalar;
+        scalar.bgr24_to_bgra32 = bgr24_to_bgra32_scalar;
+        scalar.bgra32_to_bgr24 = bgra32_to_bgr24_scalar;
+
+        kernels.fill(scalar);
+
+        // Each level builds on the one before it
+#if PIXELCONV_X86
+        row_kernels &sse2 = kernels[pixel_kernel_sse2];
+        sse2.rgb444_to_bgra32 = rgb444_to_bgra32_sse2;
+        sse2.rgb565_to_bgra32 = rgb565_to_bgra32_sse2;
+
+        row_kernels &ssse3 = kernels[pixel_kernel_ssse3];
+        ssse3 = sse2;
+        ssse3.rgb444_to_bgr24 = rgb444_to_bgr24_ssse3;
+        ssse3.rgb565_to_bgr24 = rgb565_to_bgr24_ssse3;
+        ssse3.bgr24_to_bgra32 = bgr24_to_bgra32_ssse3;
+        ssse3.bgra32_to_bgr24 = bgra32_to_bgr24_ssse3;
+
+        row_kernels &avx2 = kernels[pixel_kernel_avx2];
+        avx2 = ssse3;
+        avx2.rgb444_to_bgr24 = rgb444_to_bgr24_avx2;
+        avx2.rgb444_to_bgra32 = rgb444_to_bgra32_avx2;
+        avx2.rgb565_to_bgr24 = rgb565_to_bgr24_avx2;
+        avx2.rgb565_to_bgra32 = rgb565_to_bgra32_avx2;
+#endif
+
+#if PIXELCONV_NEON
+        row_kernels &neon = kernels[pixel_kernel_neon];
+        neon.rgb444_to_bgr24 = rgb444_to_bgr24_neon;
+        neon.rgb444_to_bgra32 = rgb444_to_bgra32_neon;
+        neon.rgb565_to_bgr24 = rgb565_to_bgr24_neon;
+        neon.rgb565_to_bgra32 = rgb565_to_bgra32_neon;
+        neon.bgr24_to_bgra32 = bgr24_to_bgra32_neon;
+        neon.bgra32_to_bgr24 = bgra32_to_bgr24_neon;
+#endif
+
+        return kernels;
+    }
+
+    static const row_kernels &get_row_kernels(pixel_kernel_level level) {
+        static const std::array<row_kernels, pixel_kernel_best> kernels = make_row_kernels();
+
+        if (!is_pixel_kernel_supported(level) || (level == pixel_kernel_best)) {
+            level = best_kernel_level();
+        }
+
+        return kernels[level];
+    }
+
+    void make_grey_palette(const int bpp, std::uint32_t *palette) {
+        const std::uint32_t count = 1 << bpp;
+
+        for (std::uint32_t i = 0; i < count; i++) {
+            const std::uint32_t level = i * 255 / (count - 1);
+            palette[i] = level | (level << 8) | (level << 16);
+        }
+    }
+
+    // Rows of packed indices go through a table of what each source byte expands to
+    template <std::size_t ENTRY_SIZE>
+    static void expand_packed_indices(std::uint8_t *dest, const std::size_t dest_stride, const std::uint8_t *src,
+        const std::size_t src_stride, const std::size_t width, const std::size_t height, const std::uint8_t *table,
+        const std::size_t pixels_per_byte, const std::size_t pixel_size) {
+        const std::size_t full_bytes = width / pixels_per_byte;
+        const std::size_t remain_size = (width % pixels_per_byte) * pixel_size;
+
+        for (std::size_t y = 0; y < height; y++) {
+            const std::uint8_t *source = src + y * src_stride;
+            std::uint8_t *target = dest + y * dest_stride;
+
+            for (std::size_t i = 0; i < full_bytes; i++) {
+                std::memcpy(target + i * ENTRY_SIZE, table + source[i] * ENTRY_SIZE, ENTRY_SIZE);
+            }
+
+            if (remain_size) {
+                std::memcpy(target + full_bytes * ENTRY_SIZE, table + source[full_bytes] * ENTRY_SIZE, remain_size);
+            }
+        }
+    }
+
+    template <std::size_t PIXEL_SIZE>
+    static void expand_byte_indices(std::uint8_t *dest, const std::size_t dest_stride, const std::uint8_t *src,
+        const std::size_t src_stride, const std::size_t width, const std::size_t height, const std::uint32_t *colors) {
+        if (width == 0) {
+            return;
+        }
+
+        for (std::size_t y = 0; y < height; y++) {
+            const std::uint8_t *source = src + y * src_stride;
+            std::uint8_t *target = dest + y * dest_stride;
+
+            // A whole word is stored for each pixel, the next pixel overwrites the extra byte
+            for (std::size_t x = 0; x < width - 1; x++) {
+                std::memcpy(target + x * PIXEL_SIZE, colors + source[x], sizeof(std::uint32_t));
+            }
+
+            std::memcpy(target + (width - 1) * PIXEL_SIZE, colors + source[width - 1], PIXEL_SIZE);
+        }
+    }
+
+    static void convert_palette_pixels(std::uint8_t *dest, const std::size_t dest_stride, const std::size_t pixel_size,
+        const std::uint8_t *src, const std::size_t src_stride, const int bpp, const std::size_t width,
+        const std::size_t height, const std::uint32_t *palette) {
+        const std::uint32_t color_count = 1 << bpp;
+        std::uint32_t colors[256];
+
+        // Reorder the TRgb words to the destination byte order
+        for (std::uint32_t i = 0; i < color_count; i++) {
+            const std::uint32_t color = palette[i];
+
+            colors[i] = ((color >> 16) & 0xFF) | (color & 0xFF00) | ((color & 0xFF) << 16)
+                | ((pixel_size == 4) ? 0xFF000000 : 0);
+        }
+
+        if (bpp == 8) {
+            if (pixel_size == 3) {
+                expand_byte_indices<3>(dest, dest_stride, src, src_stride, width, height, colors);
+            } else {
+                expand_byte_indices<4>(dest, dest_stride, src, src_stride, width, height, colors);
+            }
+
+            return;
+        }
+
+        const std::size_t pixels_per_byte = 8 / bpp;
+        const std::size_t entry_size = pixels_per_byte * pixel_size;
+
+        std::vector<std::uint8_t> table(256 * entry_size);
+
+        for (std::size_t value = 0; value < 256; value++) {
+            for (std::size_t i = 0; i < pixels_per_byte; i++) {
+                const std::uint32_t index = (value >> (i * bpp)) & (color_count - 1);
+                std::memcpy(table.data() + value * entry_size + i * pixel_size, colors + index, pixel_size);
+            }
+        }
+
+        switch (entry_size) {
+        case 6:
+            expand_packed_indices<6>(dest, dest_stride, src, src_stride, width, height, table.data(), pixels_per_byte, pixel_size);
+            break;
+
+        case 8:
+            expand_packed_indices<8>(dest, dest_stride, src, src_stride, width, height, table.data(), pixels_per_byte, pixel_size);
+            break;
+
+        case 12:
+            expand_packed_indices<12>(dest, dest_stride, src, src_stride, width, height, table.data(), pixels_per_byte, pixel_size);
+            break;
+
+        case 16:
+            expand_packed_indices<16>(dest, dest_stride, src, src_stride, width, height, table.data(), pixels_per_byte, pixel_size);
+            break;
+
+        case 24:
+            expand_packed_indices<24>(dest, dest_stride, src, src_stride, width, height, table.data(), pixels_per_byte, pixel_size);
+            break;
+
+        default:
+            expand_packed_indices<32>(dest, dest_stride, src, src_stride, width, height, table.data(), pixels_per_byte, pixel_size);
+            break;
+        }
+    }
+
+    bool convert_pixels(std::uint8_t *dest, const std::size_t dest_stride, const pixel_format dest_format,
+        const std::uint8_t *src, const std::size_t src_stride, const pixel_format src_format,
+        const std::size_t width, const std::size_t height, const std::uint32_t *palette,
+        const pixel_kernel_level level) {
+        if ((dest_format != pixel_format_bgr24) && (dest_format != pixel_format_bgra32)) {
+            return false;
+        }
+
+        const bool to_bgr24 = (dest_format == pixel_format_bgr24);
+        const std::size_t pixel_size = to_bgr24 ? 3 : 4;
+
+        row_convert_func convert_func = nullptr;
+        const row_kernels &kernels = get_row_kernels(level);
+
+        switch (src_format) {
+        case pixel_format_palette1:
+        case pixel_format_palette2:
+        case pixel_format_palette4:
+        case pixel_format_palette8:
+            if (!palette) {
+                return false;
+            }
+
+            convert_palette_pixels(dest, dest_stride, pixel_size, src, src_stride, 1 << (src_format - pixel_format_palette1),
+                width, height, palette);
+
+            return true;
+
+        case pixel_format_rgb444:
+            convert_func = to_bgr24 ? kernels.rgb444_to_bgr24 : kernels.rgb444_to_bgra32;
+            break;
+
+        case pixel_format_rgb565:
+            convert_func = to_bgr24 ? kernels.rgb565_to_bgr24 : kernels.rgb565_to_bgra32;
+            break;
+
+        case pixel_format_bgr24:
+            convert_func = to_bgr24 ? nullptr : kernels.bgr24_to_bgra32;
+            break;
+
+        case pixel_format_bgra32:
+            convert_func = to_bgr24 ? kernels.bgra32_to_bgr24 : nullptr;
+            break;
+
+        default:
+            return false;
+        }
+
+        for (std::size_t y = 0; y < height; y++) {
+            if (convert_func) {
+                convert_func(dest + y * dest_stride, src + y * src_stride, width);
+            } else {
+                std::memcpy(dest + y * dest_stride, src + y * src_stride, width * pixel_size);
+            }
+        }
+
+        return true;
+    }
+}
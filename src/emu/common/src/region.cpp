@@ -20,147 +20,338 @@
 #include <common/region.h>
 #include <common/algorithm.h>
 
+#include <algorithm>
 #include <climits>
 
 namespace eka2l1::common {
-    /**
-     * NOTE: CODE REVIEWED FROM SYMBIAN OPEN SOURCE.
-     */
+    namespace {
+        struct region_span {
+            int x1;
+            int x2;
+        };
+
+        enum class region_op_type {
+            unite,
+            intersect,
+            subtract
+        };
+    }
 
-    eka2l1::rect region::bounding_rect() const {
-        eka2l1::vec2 tl { INT_MAX, INT_MAX };
-        eka2l1::vec2 br { INT_MIN, INT_MIN };
+    static bool is_rect_blank(const eka2l1::rect &rect) {
+        return (rect.size.x <= 0) || (rect.size.y <= 0);
+    }
 
-        for (std::size_t i = 0; i < rects_.size(); i++) {
-            tl.x = common::min(tl.x, rects_[i].top.x);
-            tl.y = common::min(tl.y, rects_[i].top.y);
-            br.x = common::max(br.x, rects_[i].top.x + rects_[i].size.x);
-            br.y = common::max(br.y, rects_[i].top.y + rects_[i].size.y);
+    static std::size_t region_band_end(const std::vector<eka2l1::rect> &rects, const std::size_t band_start) {
+        std::size_t end = band_start + 1;
+
+        while ((end < rects.size()) && (rects[end].top.y == rects[band_start].top.y)) {
+            end++;
         }
 
-        return eka2l1::rect { tl, br - tl };
+        return end;
     }
 
-    bool region::add_rect(const eka2l1::rect &rect) {
-        if (rect.empty()) {
-            return true;
+    static void region_push_span(std::vector<region_span> &spans, const int x1, const int x2) {
+        if (!spans.empty() && (spans.back().x2 >= x1)) {
+            spans.back().x2 = common::max(spans.back().x2, x2);
+            return;
         }
 
-        if (rects_.empty()) {
-            rects_.push_back(rect);
-            return true;
-        }
+        spans.push_back({ x1, x2 });
+    }
 
-        if (rect.contains(bounding_rect())) {
-            rects_.clear();
-            rects_.push_back(rect);
-            
-            return true;
+    static void region_unite_spans(const eka2l1::rect *a, const eka2l1::rect *a_end, const eka2l1::rect *b,
+        const eka2l1::rect *b_end, std::vector<region_span> &result) {
+        while ((a != a_end) || (b != b_end)) {
+            const eka2l1::rect *pick = nullptr;
+
+            if ((b == b_end) || ((a != a_end) && (a->top.x <= b->top.x))) {
+                pick = a++;
+            } else {
+                pick = b++;
+            }
+
+            region_push_span(result, pick->top.x, pick->top.x + pick->size.x);
         }
+    }
 
-        for (std::size_t i = 0; i < rects_.size(); i++) {
-            if ((rects_[i].top.x + rects_[i].size.x <= rect.top.x) || (rects_[i].top.x >= rect.top.x + rect.size.x) ||
-                (rects_[i].top.y + rects_[i].size.y <= rect.top.y) || (rects_[i].top.y >= rect.top.y + rect.size.y))
-                continue;
-
-            if ((rects_[i].top.x <= rect.top.x) && (rects_[i].top.y <= rect.top.y) && 
-                (rects_[i].top.x + rects_[i].size.x >= rect.top.x + rect.size.x) && 
-                (rects_[i].top.y + rects_[i].size.y >= rect.top.y + rect.size.y)) {
-                // This rectangle already covers the new rectangle, no modification done
-                return false;
+    static void region_intersect_spans(const eka2l1::rect *a, const eka2l1::rect *a_end, const eka2l1::rect *b,
+        const eka2l1::rect *b_end, std::vector<region_span> &result) {
+        while ((a != a_end) && (b != b_end)) {
+            const int a_x2 = a->top.x + a->size.x;
+            const int b_x2 = b->top.x + b->size.x;
+
+            const int lo = common::max(a->top.x, b->top.x);
+            const int hi = common::min(a_x2, b_x2);
+
+            if (lo < hi) {
+                result.push_back({ lo, hi });
             }
 
-            eka2l1::rect intersector;
-            intersector = rect.intersect(rects_[i]);
+            if (a_x2 < b_x2) {
+                a++;
+            } else {
+                b++;
+            }
+        }
+    }
 
-            if (intersector.top.y + intersector.size.y != rect.top.y + rect.size.y)
-                rects_.push_back(eka2l1::rect( { rect.top.x, intersector.top.y }, { rect.size.x, rect.size.y + rect.top.y - intersector.top.y }));
+    static void region_subtract_spans(const eka2l1::rect *a, const eka2l1::rect *a_end, const eka2l1::rect *b,
+        const eka2l1::rect *b_end, std::vector<region_span> &result) {
+        for (; a != a_end; a++) {
+            int cur = a->top.x;
+            const int a_x2 = a->top.x + a->size.x;
 
-            if (intersector.top.y != rect.top.y)
-                rects_.push_back(eka2l1::rect( { rect.top.x, rect.top.y }, { rect.size.x, intersector.top.y - rect.top.y }));
+            // Spans of B ending before this one never matter again, since spans of A are sorted
+            while ((b != b_end) && (b->top.x + b->size.x <= cur)) {
+                b++;
+            }
 
-			if (intersector.top.x + intersector.size.x != rect.top.x + rect.size.x)
-				rects_.push_back(eka2l1::rect({ intersector.top.x + intersector.size.x, intersector.top.y },
-                    { rect.top.x + rect.size.x - intersector.top.x - intersector.size.x, intersector.size.y }));
+            for (const eka2l1::rect *sub = b; (sub != b_end) && (sub->top.x < a_x2) && (cur < a_x2); sub++) {
+                if (sub->top.x > cur) {
+                    result.push_back({ cur, sub->top.x });
+                }
 
-            if (intersector.top.x != rect.top.x)
-                rects_.push_back(eka2l1::rect( { rect.top.x, intersector.top.y }, { intersector.top.x - rect.top.x,
-                    intersector.size.y}));
+                cur = common::max(cur, sub->top.x + sub->size.x);
+            }
 
-            rects_.erase(rects_.begin() + i);
-            return true;
+            if (cur < a_x2) {
+                result.push_back({ cur, a_x2 });
+            }
         }
-
-        rects_.push_back(rect);
-        return true;
     }
 
-    void region::eliminate(const eka2l1::rect &rect) {
-        if (rect.empty()) {
+    /**
+     * Append a band to the banded rectangle list. If the last band touches this one and has the
+     * same spans, it gets extended instead.
+     */
+    static void region_append_band(std::vector<eka2l1::rect> &rects, std::size_t &last_band_start, const int y1,
+        const int y2, const std::vector<region_span> &spans) {
+        if (spans.empty()) {
             return;
         }
 
-        std::size_t limit = rects_.size();
+        if (last_band_start < rects.size()) {
+            const eka2l1::rect &last_band_rect = rects[last_band_start];
 
-        for (std::size_t i = 0; i < limit; i++) {
-            if ((rect.top == rects_[i].top) && (rect.size == rects_[i].size)) {
-                rects_.erase(rects_.begin() + i);
-                return;
-            }
-            
-            const eka2l1::rect intersection_reg = rect.intersect(rects_[i]);
-
-            if (!intersection_reg.empty()) {
-                const eka2l1::rect original_iterate = rects_[i];
-                rects_.erase(rects_.begin() + i);
+            if ((last_band_rect.top.y + last_band_rect.size.y == y1) && (rects.size() - last_band_start == spans.size())) {
+                bool same_spans = true;
 
-                const eka2l1::vec2 intersect_reg_br = intersection_reg.bottom_right();
-                const eka2l1::vec2 iterate_br = original_iterate.bottom_right();
+                for (std::size_t i = 0; i < spans.size(); i++) {
+                    const eka2l1::rect &rect = rects[last_band_start + i];
 
-                if (iterate_br.y != intersect_reg_br.y) {
-                    rects_.push_back(eka2l1::rect({ original_iterate.top.x, intersect_reg_br.y }, { iterate_br.x, iterate_br.y }));
-                    rects_.back().transform_from_symbian_rectangle();
+                    if ((rect.top.x != spans[i].x1) || (rect.top.x + rect.size.x != spans[i].x2)) {
+                        same_spans = false;
+                        break;
+                    }
                 }
 
-                if (iterate_br.x != intersect_reg_br.x) {
-                    rects_.push_back(eka2l1::rect({ intersect_reg_br.x, intersection_reg.top.y }, { iterate_br.x, intersect_reg_br.y }));
-                    rects_.back().transform_from_symbian_rectangle();
-                }
+                if (same_spans) {
+                    for (std::size_t i = last_band_start; i < rects.size(); i++) {
+                        rects[i].size.y += y2 - y1;
+                    }
 
-                if (intersection_reg.top.x != original_iterate.top.x) {
-                    rects_.push_back(eka2l1::rect({ original_iterate.top.x, intersection_reg.top.y }, { intersection_reg.top.x, intersect_reg_br.y }));
-                    rects_.back().transform_from_symbian_rectangle();
+                    return;
                 }
+            }
+        }
 
-                if (intersection_reg.top.y != original_iterate.top.y) {
-                    rects_.push_back(eka2l1::rect(original_iterate.top, { iterate_br.x, intersection_reg.top.y }));
-                    rects_.back().transform_from_symbian_rectangle();
-                }
+        last_band_start = rects.size();
+
+        for (const region_span &span : spans) {
+            rects.push_back(eka2l1::rect({ span.x1, y1 }, { span.x2 - span.x1, y2 - y1 }));
+        }
+    }
+
+    /**
+     * Sweep both banded lists from top to bottom. Each step covers a stripe of rows where the set of
+     * bands of both sides does not change, combines their spans and appends the result.
+     */
+    static std::vector<eka2l1::rect> region_op(const std::vector<eka2l1::rect> &a, const std::vector<eka2l1::rect> &b,
+        const region_op_type op) {
+        std::vector<eka2l1::rect> result;
+        std::vector<region_span> spans;
+
+        std::size_t last_band_start = 0;
+
+        std::size_t a_band = 0;
+        std::size_t b_band = 0;
+        std::size_t a_band_end = a.empty() ? 0 : region_band_end(a, 0);
+        std::size_t b_band_end = b.empty() ? 0 : region_band_end(b, 0);
+
+        int y = INT_MIN;
+
+        while ((a_band < a.size()) || (b_band < b.size())) {
+            if ((op != region_op_type::unite) && (a_band >= a.size())) {
+                break;
+            }
+
+            if ((op == region_op_type::intersect) && (b_band >= b.size())) {
+                break;
+            }
+
+            const int a_top = (a_band < a.size()) ? common::max(a[a_band].top.y, y) : INT_MAX;
+            const int b_top = (b_band < b.size()) ? common::max(b[b_band].top.y, y) : INT_MAX;
+            const int top = common::min(a_top, b_top);
+
+            const bool a_active = (a_top == top);
+            const bool b_active = (b_top == top);
+
+            // The stripe ends where an active band ends, or an inactive one starts
+            int bottom = INT_MAX;
+
+            if (a_band < a.size()) {
+                bottom = common::min(bottom, a_active ? (a[a_band].top.y + a[a_band].size.y) : a[a_band].top.y);
+            }
+
+            if (b_band < b.size()) {
+                bottom = common::min(bottom, b_active ? (b[b_band].top.y + b[b_band].size.y) : b[b_band].top.y);
+            }
+
+            const eka2l1::rect *a_beg = a_active ? (a.data() + a_band) : nullptr;
+            const eka2l1::rect *a_end = a_active ? (a.data() + a_band_end) : nullptr;
+            const eka2l1::rect *b_beg = b_active ? (b.data() + b_band) : nullptr;
+            const eka2l1::rect *b_end = b_active ? (b.data() + b_band_end) : nullptr;
+
+            spans.clear();
 
-                limit--;
+            switch (op) {
+            case region_op_type::unite:
+                region_unite_spans(a_beg, a_end, b_beg, b_end, spans);
+                break;
+
+            case region_op_type::intersect:
+                region_intersect_spans(a_beg, a_end, b_beg, b_end, spans);
+                break;
+
+            case region_op_type::subtract:
+                region_subtract_spans(a_beg, a_end, b_beg, b_end, spans);
+                break;
+
+            default:
+                break;
             }
+
+            region_append_band(result, last_band_start, top, bottom, spans);
+            y = bottom;
+
+            if (a_active && (a[a_band].top.y + a[a_band].size.y == bottom)) {
+                a_band = a_band_end;
+                a_band_end = (a_band < a.size()) ? region_band_end(a, a_band) : a_band;
+            }
+
+            if (b_active && (b[b_band].top.y + b[b_band].size.y == bottom)) {
+                b_band = b_band_end;
+                b_band_end = (b_band < b.size()) ? region_band_end(b, b_band) : b_band;
+            }
+        }
+
+        return result;
+    }
+
+    eka2l1::rect region::bounding_rect() const {
+        if (rects_.empty()) {
+            return eka2l1::rect{};
+        }
+
+        eka2l1::vec2 tl { INT_MAX, rects_.front().top.y };
+        eka2l1::vec2 br { INT_MIN, rects_.back().top.y + rects_.back().size.y };
+
+        // Bands are sorted by y, so only the horizontal bound needs a full scan
+        for (std::size_t i = 0; i < rects_.size(); i++) {
+            tl.x = common::min(tl.x, rects_[i].top.x);
+            br.x = common::max(br.x, rects_[i].top.x + rects_[i].size.x);
+        }
+
+        return eka2l1::rect { tl, br - tl };
+    }
+
+    bool region::add_rect(const eka2l1::rect &rect) {
+        if (is_rect_blank(rect)) {
+            return true;
+        }
+
+        if (contains(rect)) {
+            return false;
+        }
+
+        rects_ = region_op(rects_, { rect }, region_op_type::unite);
+        return true;
+    }
+
+    void region::unite(const region &reg) {
+        if (reg.empty()) {
+            return;
         }
+
+        rects_ = region_op(rects_, reg.rects_, region_op_type::unite);
+    }
+
+    void region::eliminate(const eka2l1::rect &rect) {
+        if (is_rect_blank(rect) || rects_.empty()) {
+            return;
+        }
+
+        rects_ = region_op(rects_, { rect }, region_op_type::subtract);
     }
 
     void region::eliminate(const region &reg) {
-        for (std::size_t i = 0; i < reg.rects_.size(); i++) {
-            eliminate(reg.rects_[i]);
+        if (reg.empty() || rects_.empty()) {
+            return;
         }
+
+        rects_ = region_op(rects_, reg.rects_, region_op_type::subtract);
     }
 
     region region::intersect(const region &target) const {
         region intersection;
+        intersection.rects_ = region_op(rects_, target.rects_, region_op_type::intersect);
 
-        for (std::size_t i = 0; i < rects_.size(); i++) {
-            for (std::size_t j = 0; j < target.rects_.size(); j++) {
-                eka2l1::rect the_intersect = target.rects_[j].intersect(rects_[i]);
+        return intersection;
+    }
 
-                if (!the_intersect.empty()) {
-                    intersection.rects_.push_back(the_intersect);
-                }
-            }
+    bool region::contains(const eka2l1::vec2 &point) const {
+        // Last rectangle whose band starts at or above the point
+        auto band_last = std::upper_bound(rects_.begin(), rects_.end(), point.y, [](const int y, const eka2l1::rect &rect) {
+            return y < rect.top.y;
+        });
+
+        if (band_last == rects_.begin()) {
+            return false;
         }
 
-        return intersection;
+        band_last--;
+
+        if (point.y >= band_last->top.y + band_last->size.y) {
+            return false;
+        }
+
+        const int band_y = band_last->top.y;
+        auto band_first = std::lower_bound(rects_.begin(), band_last, band_y, [](const eka2l1::rect &rect, const int y) {
+            return rect.top.y < y;
+        });
+
+        auto span = std::upper_bound(band_first, band_last + 1, point.x, [](const int x, const eka2l1::rect &rect) {
+            return x < rect.top.x;
+        });
+
+        if (span == band_first) {
+            return false;
+        }
+
+        span--;
+        return point.x < span->top.x + span->size.x;
+    }
+
+    bool region::contains(const eka2l1::rect &rect) const {
+        if (is_rect_blank(rect)) {
+            return true;
+        }
+
+        if (rects_.empty()) {
+            return false;
+        }
+
+        return region_op({ rect }, rects_, region_op_type::subtract).empty();
     }
-}
\ No newline at end of file
+}
@@ -124,6 +124,39 @@ namespace eka2l1::common {
         return std::make_unique<basic_teletimer_micro>(target_frequency);
     }
 
+    manual_teletimer::manual_teletimer(const std::uint32_t freq)
+        : elapsed_us_(0)
+        , target_freq_(freq) {
+    }
+
+    void manual_teletimer::start() {
+        elapsed_us_ = 0;
+    }
+
+    void manual_teletimer::stop() {
+    }
+
+    bool manual_teletimer::set_target_frequency(const std::uint32_t freq) {
+        target_freq_ = freq;
+        return true;
+    }
+
+    std::uint64_t manual_teletimer::ticks() {
+        return multiply_and_divide_qwords(elapsed_us_.load(), target_freq_, 1000000);
+    }
+
+    std::uint64_t manual_teletimer::microseconds() {
+        return elapsed_us_.load();
+    }
+
+    std::uint64_t manual_teletimer::nanoseconds() {
+        return us_to_ns(elapsed_us_.load());
+    }
+
+    void manual_teletimer::advance(const std::uint64_t microsecs) {
+        elapsed_us_ += microsecs;
+    }
+
 #if EKA2L1_PLATFORM(WIN32)
     static constexpr DWORD MILLISECS_SOLUTION_PERIOD_HR = 1;
 #endif
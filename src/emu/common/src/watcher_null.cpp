@@ -28,7 +28,8 @@ namespace eka2l1::common {
 
     std::int32_t directory_watcher_impl::watch(const std::string &folder, directory_watcher_callback callback,
         void *callback_userdata, const std::uint32_t mask) {
-        return 1;
+        // Nothing can be watched, don't let callers rely on change callbacks
+        return -1;
     }
 
     bool directory_watcher_impl::unwatch(const std::int32_t watch_handle) {
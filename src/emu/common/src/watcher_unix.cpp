@@ -20,14 +20,19 @@
 #include "watcher_unix.h"
 #include <common/log.h>
 
+#include <algorithm>
+
+#include <poll.h>
 #include <sys/inotify.h>
 
 namespace eka2l1::common {
     static constexpr std::size_t EVENT_MAX_SIZE = sizeof(struct inotify_event) + 16;
 
     directory_watcher_impl::directory_watcher_impl()
-        : should_stop(false) {
+        : should_stop(false)
+        , next_handle_(1) {
         instance_ = inotify_init();
+        stop_event_ = eventfd(0, 0);
 
         if (instance_ == -1) {
             LOG_ERROR(COMMON, "Error creating INotify instance!");
@@ -40,24 +45,48 @@ namespace eka2l1::common {
         wait_thread_ = std::make_unique<std::thread>([this]() {
             std::vector<directory_change> changes;
 
-            auto flush_changes = [&](const int wd) {
-                // Flush changes
-                auto ite = std::find(container_.begin(), container_.end(), wd);
+            std::vector<directory_watcher_callback_pair> callback_pairs;
 
-                if (ite != container_.end()) {
-                    auto &callback = callbacks_[std::distance(container_.begin(), ite)];
-                    callback.callback_pair_.first(callback.callback_pair_.second, changes);
+            auto flush_changes = [&](const int wd) {
+                {
+                    // Don't hold the lock in the callback, it may need to watch or unwatch
+                    const std::lock_guard<std::mutex> guard(lock_);
+
+                    for (std::size_t i = 0; i < container_.size(); i++) {
+                        if (container_[i] == wd) {
+                            callback_pairs.push_back(callbacks_[i].callback_pair_);
+                        }
+                    }
+                }
 
-                    changes.clear();
+                // Flush changes to every watch of the folder
+                for (auto &callback_pair : callback_pairs) {
+                    directory_changes changes_copy = changes;
+                    callback_pair.first(callback_pair.second, changes_copy);
                 }
+
+                callback_pairs.clear();
+                changes.clear();
             };
 
+            pollfd wait_fds[2];
+            wait_fds[0].fd = instance_;
+            wait_fds[0].events = POLLIN;
+            wait_fds[1].fd = stop_event_;
+            wait_fds[1].events = POLLIN;
+
             while (!should_stop) {
+                if ((poll(wait_fds, 2, -1) <= 0) || should_stop || !(wait_fds[0].revents & POLLIN)) {
+                    continue;
+                }
+
                 const ssize_t length = read(instance_, &events_[0], events_.size());
 
                 if (length == -1) {
                     LOG_ERROR(COMMON, "Error reading notify event!");
                     should_stop = true;
+
+                    break;
                 }
 
                 std::size_t i = 0;
@@ -65,7 +94,7 @@ namespace eka2l1::common {
                 int last_wd = -1;
 
                 // Parse all event
-                while (i < length) {
+                while (i < static_cast<std::size_t>(length)) {
                     struct inotify_event *evt = reinterpret_cast<struct inotify_event *>(&events_[i]);
 
                     directory_change change;
@@ -100,12 +129,13 @@ namespace eka2l1::common {
                         change.change_ |= directory_change_action_modified;
                     }
 
-                    changes.push_back(change);
-
+                    // Changes gathered so far belong to the previous watch
                     if ((last_wd != -1) && (last_wd != evt->wd)) {
-                        flush_changes(evt->wd);
+                        flush_changes(last_wd);
                     }
 
+                    changes.push_back(change);
+
                     last_wd = evt->wd;
                     i += evt->len + sizeof(struct inotify_event);
                 }
@@ -118,30 +148,50 @@ namespace eka2l1::common {
     }
 
     directory_watcher_impl::~directory_watcher_impl() {
+        should_stop = true;
+
+        if (wait_thread_) {
+            // Without a wake up, the thread would wait for an event that never comes
+            const std::uint64_t wake_value = 1;
+            write(stop_event_, &wake_value, sizeof(wake_value));
+
+            wait_thread_->join();
+        }
+
+        std::sort(container_.begin(), container_.end());
+        container_.erase(std::unique(container_.begin(), container_.end()), container_.end());
+
         for (auto &wd : container_) {
             inotify_rm_watch(instance_, wd);
         }
 
-        should_stop = true;
-        wait_thread_->join();
-
+        close(stop_event_);
         close(instance_);
     }
 
     bool directory_watcher_impl::unwatch(const std::int32_t watch_handle) {
+        const std::lock_guard<std::mutex> guard(lock_);
+
         // Find in container
-        auto ite = std::find(container_.begin(), container_.end(), watch_handle);
+        auto ite = std::find(handles_.begin(), handles_.end(), watch_handle);
 
-        if (ite == container_.end()) {
+        if (ite == handles_.end()) {
             return false;
         }
 
-        auto callback_ite = callbacks_.begin() + std::distance(container_.begin(), ite);
+        const std::size_t index = std::distance(handles_.begin(), ite);
+        const int wd = container_[index];
 
-        callbacks_.erase(callback_ite);
-        container_.erase(ite);
+        handles_.erase(ite);
+        callbacks_.erase(callbacks_.begin() + index);
+        container_.erase(container_.begin() + index);
 
-        const bool remove_result = (inotify_rm_watch(instance_, watch_handle) != -1);
+        // Other watches of the same folder still need the descriptor
+        if (std::find(container_.begin(), container_.end(), wd) != container_.end()) {
+            return true;
+        }
+
+        const bool remove_result = (inotify_rm_watch(instance_, wd) != -1);
 
         if (!remove_result) {
             LOG_WARN(COMMON, "Can not removing watch from inotify!");
@@ -157,6 +207,10 @@ namespace eka2l1::common {
             filters |= (IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE | IN_CREATE);
         }
 
+        if (masks & directory_change_attrib) {
+            filters |= IN_ATTRIB;
+        }
+
         if ((masks & directory_change_last_access) || (masks & directory_change_last_write)) {
             filters |= IN_ATTRIB;
 
@@ -174,16 +228,25 @@ namespace eka2l1::common {
 
     std::int32_t directory_watcher_impl::watch(const std::string &folder, directory_watcher_callback callback,
         void *callback_userdata, const std::uint32_t mask) {
-        const int wd_handle = inotify_add_watch(instance_, folder.c_str(), IN_CREATE | IN_DELETE | IN_MODIFY);
+        const int filters = convert_to_unix_notify_mask(mask);
+
+        // Hold the lock while adding, so unwatching another watch of the folder can't drop the descriptor under us
+        const std::lock_guard<std::mutex> guard(lock_);
+
+        // Adding to the mask keeps the events other watches of the same folder asked for
+        const int wd_handle = inotify_add_watch(instance_, folder.c_str(), filters | IN_MASK_ADD);
 
         if (wd_handle == -1) {
             LOG_ERROR(COMMON, "Error creating new inotify watch!");
-            return 0;
+            return -1;
         }
 
+        const std::int32_t handle = next_handle_++;
+
         container_.push_back(wd_handle);
-        callbacks_.emplace_back(callback, callback_userdata, convert_to_unix_notify_mask(mask));
+        handles_.push_back(handle);
+        callbacks_.emplace_back(callback, callback_userdata, filters);
 
-        return wd_handle;
+        return handle;
     }
 }
\ No newline at end of file
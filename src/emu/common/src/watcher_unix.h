@@ -39,11 +39,15 @@ namespace eka2l1::common {
         std::vector<std::uint8_t> events_;
 
         int instance_;
+        int stop_event_; ///< Wakes the wait thread up when the watcher is destroyed.
 
         std::atomic<bool> should_stop;
 
+        // Watches of the same folder share the inotify descriptor, so each watch gets its own handle
         std::vector<int> container_;
+        std::vector<std::int32_t> handles_;
         std::vector<directory_watcher_data> callbacks_;
+        std::int32_t next_handle_;
 
         std::mutex lock_;
 
@@ -254,7 +254,7 @@ namespace eka2l1::common {
 
         if (!h || h == INVALID_HANDLE_VALUE) {
             LOG_ERROR(COMMON, "Can't create directory watch of folder {}", folder);
-            return 0;
+            return -1;
         }
 
         HANDLE dir_handle = CreateFileA(folder.c_str(), GENERIC_READ, FILE_LIST_DIRECTORY,
@@ -264,7 +264,7 @@ namespace eka2l1::common {
         if (dir_handle == INVALID_HANDLE_VALUE) {
             LOG_ERROR(COMMON, "Can't open directory handle");
             FindCloseChangeNotification(h);
-            return 0;
+            return -1;
         }
 
         HANDLE added_nof = CreateEvent(NULL, true, false, NULL);
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <common/platform.h>
+
+#if EKA2L1_ARCH(X86) || EKA2L1_ARCH(X64)
+
+#include <common/cpudetect.h>
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+static void do_cpuid(int info[4], const int function_id, const int subfunction_id = 0) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    __cpuidex(info, function_id, subfunction_id);
+#else
+    unsigned int regs[4] = { 0, 0, 0, 0 };
+    __cpuid_count(function_id, subfunction_id, regs[0], regs[1], regs[2], regs[3]);
+
+    std::memcpy(info, regs, sizeof(regs));
+#endif
+}
+
+static std::uint64_t do_xgetbv(const std::uint32_t index) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return _xgetbv(index);
+#else
+    std::uint32_t eax = 0;
+    std::uint32_t edx = 0;
+
+    __asm__ __volatile__("xgetbv"
+                         : "=a"(eax), "=d"(edx)
+                         : "c"(index));
+
+    return (static_cast<std::uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+namespace eka2l1::common {
+    void cpu_info::detect() {
+        std::memset(static_cast<void *>(this), 0, sizeof(cpu_info));
+
+#if EKA2L1_ARCH(X64)
+        OS64bit = true;
+        CPU64bit = true;
+        Mode64bit = true;
+#endif
+
+        int info[4] = { 0, 0, 0, 0 };
+
+        // Vendor string is in EBX, EDX, ECX order
+        do_cpuid(info, 0);
+        const int max_std_fn = info[0];
+
+        std::memcpy(cpu_string, &info[1], 4);
+        std::memcpy(cpu_string + 4, &info[3], 4);
+        std::memcpy(cpu_string + 8, &info[2], 4);
+
+        if (std::strcmp(cpu_string, "GenuineIntel") == 0) {
+            vendor = VENDOR_INTEL;
+        } else if (std::strcmp(cpu_string, "AuthenticAMD") == 0) {
+            vendor = VENDOR_AMD;
+        } else {
+            vendor = VENDOR_OTHER;
+        }
+
+        do_cpuid(info, 0x80000000);
+        const unsigned int max_ex_fn = static_cast<unsigned int>(info[0]);
+
+        if (max_ex_fn >= 0x80000004) {
+            for (int i = 0; i < 3; i++) {
+                do_cpuid(info, 0x80000002 + i);
+                std::memcpy(brand_string + i * 16, info, 16);
+            }
+        } else {
+            std::strcpy(brand_string, cpu_string);
+        }
+
+        logical_cpu_count = static_cast<int>(std::thread::hardware_concurrency());
+        num_cores = logical_cpu_count;
+
+        if (max_std_fn >= 1) {
+            do_cpuid(info, 1);
+
+            bSSE3 = (info[2] >> 0) & 1;
+            bSSSE3 = (info[2] >> 9) & 1;
+            bFMA = (info[2] >> 12) & 1;
+            bSSE4_1 = (info[2] >> 19) & 1;
+            bSSE4_2 = (info[2] >> 20) & 1;
+            bMOVBE = (info[2] >> 22) & 1;
+            bPOPCNT = (info[2] >> 23) & 1;
+            bAES = (info[2] >> 25) & 1;
+
+            bFXSR = (info[3] >> 24) & 1;
+            bSSE = (info[3] >> 25) & 1;
+            bSSE2 = (info[3] >> 26) & 1;
+            HTT = (info[3] >> 28) & 1;
+
+            // AVX also needs the OS to save the YMM registers on context switches
+            const bool os_saves_ymm = ((info[2] >> 27) & 1) && ((do_xgetbv(0) & 0x6) == 0x6);
+            bAVX = os_saves_ymm && ((info[2] >> 28) & 1);
+            bFMA = bFMA && bAVX;
+        }
+
+        if (max_std_fn >= 7) {
+            do_cpuid(info, 7);
+
+            bBMI1 = (info[1] >> 3) & 1;
+            bAVX2 = bAVX && ((info[1] >> 5) & 1);
+            bBMI2 = (info[1] >> 8) & 1;
+        }
+
+        if (max_ex_fn >= 0x80000001) {
+            do_cpuid(info, 0x80000001);
+
+            bLAHFSAHF64 = (info[2] >> 0) & 1;
+            bLZCNT = (info[2] >> 5) & 1;
+            bSSE4A = (info[2] >> 6) & 1;
+            bLongMode = (info[3] >> 29) & 1;
+        }
+    }
+}
+
+#endif
@@ -58,6 +58,8 @@ namespace eka2l1::config {
         bool log_ipc{ false };
         bool log_passed{ false };
         bool log_exports{ false };
+        bool log_async{ false };
+        int log_class_rate_limit{ 0 };
 
         std::string cpu_backend{ "dynarmic" };
         int device{ 0 };
@@ -83,8 +85,10 @@ namespace eka2l1::config {
         bool enable_srv_socket{ true };
 
         bool fbs_enable_compression_queue{ false };
+        int akn_icon_cache_budget_kb{ 4096 };
         bool accurate_ipc_timing{ false };
         bool enable_btrace{ false };
+        bool hle_user_heap{ false };
 
         bool stop_warn_touch_disabled { false };
         bool dump_imb_range_code { false };
@@ -31,6 +31,8 @@ OPTION(log-ipc, log_ipc, false)
 OPTION(log-svc, log_svc, false)
 OPTION(log-passed, log_passed, false)
 OPTION(log-exports, log_exports, false)
+OPTION(log-async, log_async, false)
+OPTION(log-class-rate-limit, log_class_rate_limit, 0)
 OPTION(cpu, cpu_backend, 0)
 OPTION(device, device, 0)
 OPTION(language, language, -1)
@@ -51,8 +53,10 @@ OPTION(enable-srv-akn-skin, enable_srv_akn_skin, true)
 OPTION(enable-srv-cdl, enable_srv_cdl, true)
 OPTION(enable-srv-socket, enable_srv_socket, false)
 OPTION(fbs-enable-compression-queue, fbs_enable_compression_queue, false)
+OPTION(akn-icon-cache-budget-kb, akn_icon_cache_budget_kb, 4096)
 OPTION(accurate-ipc-timing, accurate_ipc_timing, false)
 OPTION(enable-btrace, enable_btrace, false)
+OPTION(hle-user-heap, hle_user_heap, false)
 OPTION(stop-warn-touchscreen-disabled, stop_warn_touch_disabled, false)
 OPTION(dump-imb-range-code, dump_imb_range_code, false)
 OPTION(hide-mouse-in-screen-space, hide_mouse_in_screen_space, false)
@@ -69,6 +69,11 @@ namespace eka2l1::desktop {
 
         // Start to read the configs
         conf.deserialize();
+
+        if (conf.log_async) {
+            log::enable_async_log(static_cast<std::uint32_t>(std::max(conf.log_class_rate_limit, 0)));
+        }
+
         app_settings = std::make_unique<config::app_settings>(&conf);
 
         system_create_components comp;
@@ -692,6 +692,8 @@ namespace eka2l1::desktop {
                 std::cout << err << std::endl;
                 os_thread_obj.join();
 
+                log::disable_async_log();
+
                 return -1;
             }
         }
@@ -707,6 +709,9 @@ namespace eka2l1::desktop {
         // Wait for the UI to be killed next. Resources of the UI need to be destroyed before ending graphics driver life.
         ui_thread_obj.join();
 
+        // Everyone that logs is gone, write what is still queued while the UI logger sink is alive
+        log::disable_async_log();
+
 #if EKA2L1_PLATFORM(WIN32)
         CoUninitialize();
 #endif
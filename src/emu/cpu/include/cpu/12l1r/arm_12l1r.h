@@ -91,5 +91,6 @@ namespace eka2l1::arm {
         std::uint8_t get_max_asid_available() const override;
 
         std::uint32_t get_num_instruction_executed() override;
+        std::optional<std::uint64_t> get_jit_compile_time() override;
     };
 }
\ No newline at end of file
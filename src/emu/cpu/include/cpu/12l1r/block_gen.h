@@ -63,6 +63,7 @@ namespace eka2l1::arm::r12l1 {
         const void *fast_dispatch_ent_;
 
         r12l1_core *parent_;
+        std::uint64_t compile_time_us_;
 
     protected:
         void assemble_control_funcs();
@@ -73,6 +74,14 @@ namespace eka2l1::arm::r12l1 {
         void enter_dispatch(core_state *cstate);
 
         translated_block *compile_new_block(core_state *state, const vaddress addr);
+
+        void add_compile_time(const std::uint64_t microsecs) {
+            compile_time_us_ += microsecs;
+        }
+
+        std::uint64_t get_compile_time() const {
+            return compile_time_us_;
+        }
         translated_block *get_block(const vaddress addr, const asid aid);
 
         void emit_block_links(translated_block *block);
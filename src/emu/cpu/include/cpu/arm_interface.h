@@ -22,6 +22,7 @@
 #include <array>
 #include <functional>
 #include <memory>
+#include <optional>
 
 #include <common/types.h>
 
@@ -203,5 +204,13 @@ namespace eka2l1::arm {
         virtual std::uint8_t get_max_asid_available() const = 0;
 
         virtual std::uint32_t get_num_instruction_executed() = 0;
+
+        /**
+         * \brief Get total time spent translating guest code, in microseconds.
+         * \returns The time, or nothing if this core can't measure it.
+         */
+        virtual std::optional<std::uint64_t> get_jit_compile_time() {
+            return std::nullopt;
+        }
     };
 }
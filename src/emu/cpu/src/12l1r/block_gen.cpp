@@ -33,6 +33,8 @@
 #include <common/algorithm.h>
 #include <common/log.h>
 
+#include <chrono>
+
 namespace eka2l1::arm::r12l1 {
     static constexpr std::size_t MAX_CODE_SPACE_BYTES = common::MB(32);
 
@@ -41,7 +43,11 @@ namespace eka2l1::arm::r12l1 {
     }
 
     static translated_block *dashixiong_compile_new_block_proxy(dashixiong_block *self, core_state *state, const vaddress addr) {
-        return self->compile_new_block(state, addr);
+        const auto start = std::chrono::steady_clock::now();
+        translated_block *block = self->compile_new_block(state, addr);
+
+        self->add_compile_time(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+        return block;
     }
 
     static void emit_pc_flush_with_this_emitter(common::armgen::armx_emitter *emitter, const address current_pc) {
@@ -52,7 +58,8 @@ namespace eka2l1::arm::r12l1 {
     dashixiong_block::dashixiong_block(r12l1_core *parent)
         : dispatch_func_(nullptr)
         , dispatch_ent_for_block_(nullptr)
-        , parent_(parent) {
+        , parent_(parent)
+        , compile_time_us_(0) {
         context_info.detect();
         clear_fast_dispatch();
 
@@ -33,6 +33,7 @@
 #include <debugger/debugger.h>
 #include <drivers/graphics/common.h>
 #include <drivers/input/common.h>
+#include <kernel/profiler.h>
 #include <services/window/common.h>
 
 struct ImFont;
@@ -69,6 +70,7 @@ namespace eka2l1 {
         bool should_save_state;
         bool should_package_manager;
         bool should_show_disassembler;
+        bool should_show_profiler;
         bool should_show_logger;
         bool should_show_preferences;
 
@@ -169,6 +171,10 @@ namespace eka2l1 {
 
         int last_cursor;
 
+        int profiler_sample_interval_us;
+        double profiler_last_report_time;
+        std::vector<kernel::profiler_process_report> profiler_reports;
+
         void show_app_launch();
         void show_app_list_classical(ImGuiTextFilter &filter);
         void show_app_list_with_icons(ImGuiTextFilter &filter);
@@ -181,6 +187,7 @@ namespace eka2l1 {
         void show_chunks();
         void show_timers();
         void show_disassembler();
+        void show_profiler();
         void show_menu();
         void show_preferences();
         void show_package_manager();
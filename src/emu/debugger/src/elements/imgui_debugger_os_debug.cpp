@@ -36,8 +36,11 @@
 #include <disasm/disasm.h>
 #include <system/epoc.h>
 #include <common/cvt.h>
+
+#include <fmt/format.h>
 #include <imgui.h>
 
+#include <algorithm>
 #include <mutex>
 #include <thread>
 
@@ -375,4 +378,63 @@ namespace eka2l1 {
 
         ImGui::End();
     }
-}
\ No newline at end of file
+
+    void imgui_debugger::show_profiler() {
+        if (ImGui::Begin("Profiler", &should_show_profiler)) {
+            kernel::profiler *prof = sys->get_kernel_system()->get_profiler();
+
+            if (!prof) {
+                ImGui::End();
+                return;
+            }
+
+            if (prof->is_running()) {
+                if (ImGui::Button("Stop")) {
+                    prof->stop();
+                }
+            } else {
+                ImGui::InputInt("Interval (us)", &profiler_sample_interval_us);
+
+                if (ImGui::Button("Start")) {
+                    prof->start(static_cast<std::uint32_t>(std::max(profiler_sample_interval_us, 100)));
+                }
+            }
+
+            ImGui::SameLine();
+
+            if (ImGui::Button("Reset")) {
+                prof->reset();
+            }
+
+            ImGui::SameLine();
+
+            if (ImGui::Button("Dump stacks")) {
+                prof->dump_collapsed_stacks("profile.folded");
+            }
+
+            ImGui::Separator();
+
+            // Symbolizing takes the kernel lock, so only refresh the report every second
+            if ((profiler_last_report_time < 0.0) || (ImGui::GetTime() - profiler_last_report_time >= 1.0)) {
+                profiler_reports = prof->report(30);
+                profiler_last_report_time = ImGui::GetTime();
+            }
+
+            for (const auto &report : profiler_reports) {
+                const std::string header = fmt::format("{} ({} samples)", report.name_, report.total_hits_);
+
+                if (ImGui::CollapsingHeader(header.c_str())) {
+                    ImGui::TextColored(GUI_COLOR_TEXT_TITLE, "%-8s    %-8s    %s", "Samples", "Percent", "Function");
+
+                    for (const auto &func : report.functions_) {
+                        const float percent = static_cast<float>(func.hits_) * 100.0f / static_cast<float>(report.total_hits_);
+                        ImGui::TextColored(GUI_COLOR_TEXT, "%-8llu    %6.2f%%     %s", static_cast<unsigned long long>(func.hits_),
+                            percent, func.name_.c_str());
+                    }
+                }
+            }
+        }
+
+        ImGui::End();
+    }
+}
@@ -152,6 +152,7 @@ namespace eka2l1 {
         , should_show_chunks(false)
         , should_show_window_tree(false)
         , should_show_disassembler(false)
+        , should_show_profiler(false)
         , should_show_logger(true)
         , should_show_preferences(false)
         , should_package_manager(false)
@@ -188,6 +189,8 @@ namespace eka2l1 {
         , back_from_fullscreen(false)
         , last_scale(1.0f)
         , last_cursor(ImGuiMouseCursor_Arrow)
+        , profiler_sample_interval_us(1000)
+        , profiler_last_report_time(-1.0)
         , font_to_use(nullptr)
         , active_app_config(nullptr)
         , sys_reset_callback_h(0)
@@ -468,7 +471,11 @@ namespace eka2l1 {
                 const std::string object_submenu_name = common::get_localised_string(localised_strings,
                     "debugger_menu_objects_item_name");
 
+                const std::string profiler_item_name = common::get_localised_string(localised_strings,
+                    "debugger_menu_profiler_item_name");
+
                 ImGui::MenuItem(disassembler_item_name.c_str(), nullptr, &should_show_disassembler);
+                ImGui::MenuItem(profiler_item_name.c_str(), nullptr, &should_show_profiler);
 
                 if (ImGui::BeginMenu(object_submenu_name.c_str())) {
                     const std::string threads_item_name = common::get_localised_string(localised_strings,
@@ -633,6 +640,10 @@ namespace eka2l1 {
             show_disassembler();
         }
 
+        if (should_show_profiler) {
+            show_profiler();
+        }
+
         if (should_show_preferences) {
             show_preferences();
         }
@@ -22,12 +22,14 @@
 #include <cstdint>
 #include <drivers/audio/dsp.h>
 #include <drivers/audio/player.h>
+#include <dispatch/heap.h>
 #include <dispatch/management.h>
 
 #include <utils/des.h>
 #include <utils/reqsts.h>
 
 #include <atomic>
+#include <map>
 #include <vector>
 #include <memory>
 
@@ -46,6 +48,13 @@ namespace eka2l1::dispatch {
         std::unique_ptr<drivers::dsp_stream> ll_stream_;
         epoc::notify_info copied_info_;
 
+        // One guest buffer the output stream had no room for, written again once it has copied a buffer.
+        // Storage is reserved up front and kept across clears, so refused writes do not allocate in steady
+        // state. While it is occupied, further writes are refused with not ready.
+        std::vector<std::uint8_t> pending_data_;
+
+        static constexpr std::size_t PENDING_DATA_RESERVE = 64 * 1024;
+
         dsp_epoc_audren_sema *audren_sema_;
 
         std::mutex lock_;
@@ -93,7 +102,13 @@ namespace eka2l1::dispatch {
     struct dispatcher {
     private:
         std::unique_ptr<dsp_epoc_audren_sema> audren_sema_;
+        std::map<std::uint64_t, std::unique_ptr<hle_heap>> heaps_;
+
+        kernel_system *kern_;
+        std::size_t thread_kill_cb_handle_;
+
         void shutdown();
+        void remove_hle_heaps(kernel::process *pr);
 
     public:
         window_server *winserv_;
@@ -108,6 +123,15 @@ namespace eka2l1::dispatch {
 
         dsp_epoc_audren_sema *get_audren_sema();
 
+        /**
+         * \brief Get the host state of a guest RHeap, creating it on first use.
+         * 
+         * \param kern      The kernel system.
+         * \param pr        The process owning the heap.
+         * \param heap_addr Address of the RHeap object in the process's address space.
+         */
+        hle_heap *get_hle_heap(kernel_system *kern, kernel::process *pr, const eka2l1::address heap_addr);
+
         void resolve(eka2l1::system *sys, const std::uint32_t function_ord);
         void update_all_screens(eka2l1::system *sys);
     };
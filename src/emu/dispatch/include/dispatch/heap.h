@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <dispatch/def.h>
+#include <mem/ptr.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace eka2l1 {
+    class kernel_system;
+
+    namespace kernel {
+        class process;
+    }
+}
+
+namespace eka2l1::dispatch {
+    /**
+     * \brief Host implementation of an EKA2 user heap (RHeap).
+     * 
+     * Cells keep the guest layout: a 4-byte length header (header included) followed by user data.
+     * The guest free list (RHeap::iFree) stays the source of truth: it is kept ordered by address
+     * with adjacent free cells merged, exactly like the original allocator, so RHeap::Check, Compress
+     * and heap walking in guest code still see a valid heap.
+     * 
+     * The host only keeps an index over that list, and nothing in it allocates once the heap stops growing:
+     * - By address, a bitmap with one bit per 4-byte granule marking where free cells start, with a second
+     *   level marking the non-empty words. It finds a cell's free neighbours and the link that points to it.
+     * - By size, segregated bins: one per 8 bytes below 256 bytes, four per power of two above. Each bin is a
+     *   doubly linked list threaded through the free cells themselves, after the guest length and next fields.
+     *   Cells shorter than 16 bytes have no room for the links and stay out of the bins, they are only reused
+     *   once merged with a neighbour.
+     *
+     * The index can be rebuilt from the guest list at any time.
+     */
+    class hle_heap {
+    public:
+        static constexpr std::uint32_t CELL_HEADER_SIZE = 4;
+        static constexpr std::uint32_t CELL_GRANULARITY = 8;
+
+        // RHeap::ReAlloc modes
+        static constexpr std::uint32_t REALLOC_NEVER_MOVE = 1;
+
+    private:
+        kernel_system *kern_;
+        kernel::process *pr_;
+        eka2l1::address heap_addr_;
+
+        eka2l1::address base_;
+        eka2l1::address top_;
+
+        static constexpr std::uint32_t SMALL_BIN_COUNT = 32;
+        static constexpr std::uint32_t SMALL_BIN_LIMIT = SMALL_BIN_COUNT * 8;
+        static constexpr std::uint32_t BINS_PER_OCTAVE = 4;
+        static constexpr std::uint32_t BIN_COUNT = SMALL_BIN_COUNT + (32 - 8) * BINS_PER_OCTAVE;
+
+        std::vector<std::uint64_t> free_map_;
+        std::vector<std::uint64_t> free_map_summary_;
+
+        std::array<eka2l1::address, BIN_COUNT> bins_;
+        std::array<std::uint64_t, BIN_COUNT / 64> bin_map_;
+
+        // Head of the guest free list after our last change, and its length
+        eka2l1::address synced_first_free_;
+        std::uint32_t synced_first_free_len_;
+
+        std::uint8_t *host_ptr(const eka2l1::address addr);
+        std::uint32_t &field(const std::uint32_t offset);
+
+        std::uint32_t &cell_len(const eka2l1::address cell) {
+            return *reinterpret_cast<std::uint32_t *>(host_ptr(cell));
+        }
+
+        std::uint32_t &cell_next(const eka2l1::address cell) {
+            return *reinterpret_cast<std::uint32_t *>(host_ptr(cell + 4));
+        }
+
+        std::uint32_t &cell_bin_prev(const eka2l1::address cell) {
+            return *reinterpret_cast<std::uint32_t *>(host_ptr(cell + 8));
+        }
+
+        std::uint32_t &cell_bin_next(const eka2l1::address cell) {
+            return *reinterpret_cast<std::uint32_t *>(host_ptr(cell + 12));
+        }
+
+        static std::uint32_t bin_index(const std::uint32_t len);
+
+        void bin_insert(const eka2l1::address cell, const std::uint32_t len);
+        void bin_remove(const eka2l1::address cell, const std::uint32_t len);
+
+        void resize_free_map();
+        void set_free_bit(const eka2l1::address cell, const bool free);
+
+        bool is_free_cell(const eka2l1::address cell);
+        eka2l1::address next_free_cell(const eka2l1::address addr);
+        eka2l1::address prev_free_cell(const eka2l1::address addr);
+
+        void add_free_cell(const eka2l1::address cell, const std::uint32_t len);
+        void remove_free_cell(const eka2l1::address cell, const std::uint32_t len);
+
+        /**
+         * \brief Get the guest link that points to a free cell: the next field of the free cell before it,
+         *        or the heap's free list head.
+         */
+        std::uint32_t &link_to(const eka2l1::address cell);
+
+        eka2l1::address find_fit(const std::uint32_t size);
+        void mark_synced();
+
+        void rebuild_index();
+        bool grow(const eka2l1::address new_top);
+        bool is_allocated_cell(const eka2l1::address cell);
+
+        void insert_free_cell(const eka2l1::address cell, std::uint32_t len);
+        std::uint32_t consume_free_cell(const eka2l1::address cell, const std::uint32_t size);
+
+    public:
+        explicit hle_heap(kernel_system *kern, kernel::process *pr, const eka2l1::address heap_addr);
+
+        static std::uint32_t cell_size_for(const std::uint32_t user_size);
+
+        /**
+         * \brief Check if the guest heap still matches the index kept on host.
+         * 
+         * A heap object can be destroyed and another one constructed at the same address, or the guest
+         * may touch the free list itself (RHeap::Compress, Reset...). In that case the index must be rebuilt.
+         */
+        bool in_sync();
+
+        eka2l1::address alloc(const std::uint32_t size);
+        void free(const eka2l1::address ptr);
+        eka2l1::address realloc(const eka2l1::address ptr, const std::uint32_t size, const std::uint32_t mode);
+        std::uint32_t alloc_len(const eka2l1::address ptr);
+    };
+
+    BRIDGE_FUNC_DISPATCHER(eka2l1::ptr<void>, hle_heap_alloc, eka2l1::ptr<void> heap, const std::int32_t size);
+    BRIDGE_FUNC_DISPATCHER(void, hle_heap_free, eka2l1::ptr<void> heap, eka2l1::ptr<void> cell);
+    BRIDGE_FUNC_DISPATCHER(eka2l1::ptr<void>, hle_heap_realloc, eka2l1::ptr<void> heap, eka2l1::ptr<void> cell,
+        const std::int32_t size, const std::int32_t mode);
+    BRIDGE_FUNC_DISPATCHER(std::int32_t, hle_heap_alloc_len, eka2l1::ptr<void> heap, eka2l1::ptr<void> cell);
+}
@@ -56,6 +56,7 @@ namespace eka2l1::dispatch {
     dsp_epoc_stream::dsp_epoc_stream(std::unique_ptr<drivers::dsp_stream> &stream, dsp_epoc_audren_sema *sema)
         : ll_stream_(std::move(stream))
         , audren_sema_(sema) {
+        pending_data_.reserve(PENDING_DATA_RESERVE);
     }
 
     dsp_epoc_stream::~dsp_epoc_stream() {
@@ -401,15 +402,30 @@ namespace eka2l1::dispatch {
         auto stream_new = std::make_unique<dsp_epoc_stream>(ll_stream, dispatcher->get_audren_sema());
 
         stream_new->ll_stream_->register_callback(
-            drivers::dsp_stream_notification_buffer_copied, [](void *userdata) {
+            drivers::dsp_stream_notification_buffer_copied, [kern = sys->get_kernel_system()](void *userdata) {
                 dsp_epoc_stream *epoc_stream = reinterpret_cast<dsp_epoc_stream *>(userdata);
-                const std::lock_guard<std::mutex> guard(epoc_stream->lock_);
-
-                epoc::notify_info &info = epoc_stream->copied_info_;
-                kernel_system *kern = info.requester->get_kernel_object_owner();
 
                 kern->lock();
-                info.complete(epoc::error_none);
+                std::unique_lock<std::mutex> guard(epoc_stream->lock_);
+
+                if (!epoc_stream->pending_data_.empty()) {
+                    // The stream was full when the guest wrote, now it has made some room
+                    drivers::dsp_output_stream &out_stream = static_cast<drivers::dsp_output_stream &>(*epoc_stream->ll_stream_);
+
+                    if (out_stream.write(epoc_stream->pending_data_.data(), epoc_stream->pending_data_.size())) {
+                        epoc_stream->pending_data_.clear();
+                    }
+
+                    // The guest gets notified once this data is copied
+                    guard.unlock();
+                    kern->unlock();
+
+                    return;
+                }
+
+                epoc_stream->copied_info_.complete(epoc::error_none);
+
+                guard.unlock();
                 kern->unlock();
             },
             stream_new.get());
@@ -482,6 +498,11 @@ namespace eka2l1::dispatch {
             return epoc::error_general;
         }
 
+        {
+            const std::lock_guard<std::mutex> guard(stream->lock_);
+            stream->pending_data_.clear();
+        }
+
         stream->audren_sema_->release(stream);
         return epoc::error_none;
     }
@@ -495,11 +516,25 @@ namespace eka2l1::dispatch {
         }
 
         drivers::dsp_output_stream &out_stream = static_cast<drivers::dsp_output_stream &>(*stream->ll_stream_);
+        const std::lock_guard<std::mutex> guard(stream->lock_);
 
-        if (!out_stream.write(data, data_size)) {
+        // Keep the order: nothing goes to the stream before what's already waiting
+        if (!stream->pending_data_.empty()) {
             return epoc::error_not_ready;
         }
 
+        if (data_size > out_stream.max_write_size()) {
+            // Holding it back would stall the stream for good
+            LOG_ERROR(HLE_AUD, "DSP buffer of {} bytes is bigger than the stream can ever take", data_size);
+            return epoc::error_too_big;
+        }
+
+        if (!out_stream.write(data, data_size)) {
+            // The guest may reuse its buffer once this returns, so keep a copy.
+            // Retried on its own when the stream notifies that it has copied a buffer.
+            stream->pending_data_.assign(data, data + data_size);
+        }
+
         return epoc::error_none;
     }
 
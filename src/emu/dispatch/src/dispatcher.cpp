@@ -21,6 +21,8 @@
 #include <dispatch/register.h>
 #include <dispatch/screen.h>
 #include <kernel/kernel.h>
+#include <kernel/process.h>
+#include <kernel/thread.h>
 #include <services/window/window.h>
 #include <utils/event.h>
 #include <utils/err.h>
@@ -30,7 +32,8 @@
 
 namespace eka2l1::dispatch {
     dispatcher::dispatcher(kernel_system *kern, ntimer *timing)
-        : winserv_(nullptr) {
+        : kern_(kern)
+        , winserv_(nullptr) {
         winserv_ = reinterpret_cast<eka2l1::window_server *>(kern->get_by_name<service::server>(
             eka2l1::get_winserv_name_by_epocver(kern->get_epoc_version())));
 
@@ -38,6 +41,15 @@ namespace eka2l1::dispatch {
 
         // Set global variables
         timing_ = timing;
+
+        // Heap state of a process is useless once its last thread is gone
+        thread_kill_cb_handle_ = kern->register_thread_kill_callback([this](kernel::thread *target, const std::string &, const std::int32_t) {
+            kernel::process *owner = target->owning_process();
+
+            if (owner && (owner->get_thread_count() == 0)) {
+                remove_hle_heaps(owner);
+            }
+        });
     }
 
     dispatcher::~dispatcher() {
@@ -56,6 +68,14 @@ namespace eka2l1::dispatch {
     }
 
     void dispatcher::shutdown() {
+        kern_->unregister_thread_kill_callback(thread_kill_cb_handle_);
+        heaps_.clear();
+    }
+
+    void dispatcher::remove_hle_heaps(kernel::process *pr) {
+        const std::uint64_t first_key = static_cast<std::uint64_t>(pr->unique_id()) << 32;
+
+        heaps_.erase(heaps_.lower_bound(first_key), heaps_.lower_bound(first_key + (1ULL << 32)));
     }
 
     void dispatcher::update_all_screens(eka2l1::system *sys) {
@@ -74,6 +94,21 @@ namespace eka2l1::dispatch {
     dsp_epoc_audren_sema *dispatcher::get_audren_sema() {
         return audren_sema_.get();
     }
+
+    hle_heap *dispatcher::get_hle_heap(kernel_system *kern, kernel::process *pr, const eka2l1::address heap_addr) {
+        const std::uint64_t key = (static_cast<std::uint64_t>(pr->unique_id()) << 32) | heap_addr;
+        auto ite = heaps_.find(key);
+
+        if ((ite != heaps_.end()) && ite->second->in_sync()) {
+            return ite->second.get();
+        }
+
+        auto new_heap = std::make_unique<hle_heap>(kern, pr, heap_addr);
+        hle_heap *result = new_heap.get();
+
+        heaps_[key] = std::move(new_heap);
+        return result;
+    }
 }
 
 namespace eka2l1::epoc {
@@ -0,0 +1,677 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <dispatch/dispatcher.h>
+#include <dispatch/heap.h>
+
+#include <kernel/chunk.h>
+#include <kernel/kernel.h>
+#include <kernel/process.h>
+#include <system/epoc.h>
+
+#include <common/algorithm.h>
+#include <common/log.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace eka2l1::dispatch {
+    // EKA2 RHeap layout (RAllocator fields included)
+    enum rheap_field_offset {
+        RHEAP_CELL_COUNT = 20,
+        RHEAP_TOTAL_ALLOC_SIZE = 24,
+        RHEAP_MAX_LENGTH = 32,
+        RHEAP_GROW_BY = 40,
+        RHEAP_CHUNK_HANDLE = 44,
+        RHEAP_BASE = 56,
+        RHEAP_TOP = 60,
+        RHEAP_PAGE_SIZE = 72,
+        RHEAP_FREE_LEN = 76,
+        RHEAP_FREE_NEXT = 80
+    };
+
+    static constexpr std::uint32_t MIN_FREE_CELL_SIZE = 8;
+    static constexpr std::uint32_t MIN_SPLIT_REMAINDER = 16;
+
+    // Free cells need room for the bin links after the length and next fields
+    static constexpr std::uint32_t MIN_BINNED_CELL_SIZE = 16;
+
+    static std::uint32_t highest_bit(const std::uint64_t v) {
+        const std::uint32_t high = static_cast<std::uint32_t>(v >> 32);
+
+        if (high) {
+            return 31 + common::find_most_significant_bit_one(high);
+        }
+
+        return common::find_most_significant_bit_one(static_cast<std::uint32_t>(v)) - 1;
+    }
+
+    // Mask of bits 0 to bit, both included
+    static std::uint64_t bits_up_to(const std::uint32_t bit) {
+        return (bit == 63) ? ~0ULL : ((1ULL << (bit + 1)) - 1);
+    }
+
+    hle_heap::hle_heap(kernel_system *kern, kernel::process *pr, const eka2l1::address heap_addr)
+        : kern_(kern)
+        , pr_(pr)
+        , heap_addr_(heap_addr)
+        , synced_first_free_(0)
+        , synced_first_free_len_(0) {
+        base_ = field(RHEAP_BASE);
+        top_ = field(RHEAP_TOP);
+
+        rebuild_index();
+    }
+
+    std::uint8_t *hle_heap::host_ptr(const eka2l1::address addr) {
+        return reinterpret_cast<std::uint8_t *>(pr_->get_ptr_on_addr_space(addr));
+    }
+
+    std::uint32_t &hle_heap::field(const std::uint32_t offset) {
+        return *reinterpret_cast<std::uint32_t *>(host_ptr(heap_addr_ + offset));
+    }
+
+    std::uint32_t hle_heap::cell_size_for(const std::uint32_t user_size) {
+        return common::max<std::uint32_t>(common::align(user_size + CELL_HEADER_SIZE, CELL_GRANULARITY),
+            MIN_FREE_CELL_SIZE);
+    }
+
+    std::uint32_t hle_heap::bin_index(const std::uint32_t len) {
+        if (len < SMALL_BIN_LIMIT) {
+            return len >> 3;
+        }
+
+        const std::uint32_t octave = highest_bit(len);
+        const std::uint32_t sub_bin = (len >> (octave - 2)) & (BINS_PER_OCTAVE - 1);
+
+        return SMALL_BIN_COUNT + (octave - 8) * BINS_PER_OCTAVE + sub_bin;
+    }
+
+    void hle_heap::bin_insert(const eka2l1::address cell, const std::uint32_t len) {
+        if (len < MIN_BINNED_CELL_SIZE) {
+            return;
+        }
+
+        const std::uint32_t bin = bin_index(len);
+        const eka2l1::address head = bins_[bin];
+
+        cell_bin_prev(cell) = 0;
+        cell_bin_next(cell) = head;
+
+        if (head) {
+            cell_bin_prev(head) = cell;
+        }
+
+        bins_[bin] = cell;
+        bin_map_[bin >> 6] |= 1ULL << (bin & 63);
+    }
+
+    void hle_heap::bin_remove(const eka2l1::address cell, const std::uint32_t len) {
+        if (len < MIN_BINNED_CELL_SIZE) {
+            return;
+        }
+
+        const std::uint32_t bin = bin_index(len);
+        const eka2l1::address prev = cell_bin_prev(cell);
+        const eka2l1::address next = cell_bin_next(cell);
+
+        if (prev) {
+            cell_bin_next(prev) = next;
+        } else {
+            bins_[bin] = next;
+        }
+
+        if (next) {
+            cell_bin_prev(next) = prev;
+        }
+
+        if (!bins_[bin]) {
+            bin_map_[bin >> 6] &= ~(1ULL << (bin & 63));
+        }
+    }
+
+    void hle_heap::resize_free_map() {
+        const std::size_t granule_count = (top_ - base_) >> 2;
+        const std::size_t word_count = (granule_count + 63) >> 6;
+
+        free_map_.resize(word_count, 0);
+        free_map_summary_.resize((word_count + 63) >> 6, 0);
+    }
+
+    void hle_heap::set_free_bit(const eka2l1::address cell, const bool free) {
+        const std::size_t granule = (cell - base_) >> 2;
+        const std::size_t word = granule >> 6;
+
+        if (free) {
+            free_map_[word] |= 1ULL << (granule & 63);
+            free_map_summary_[word >> 6] |= 1ULL << (word & 63);
+        } else {
+            free_map_[word] &= ~(1ULL << (granule & 63));
+
+            if (!free_map_[word]) {
+                free_map_summary_[word >> 6] &= ~(1ULL << (word & 63));
+            }
+        }
+    }
+
+    bool hle_heap::is_free_cell(const eka2l1::address cell) {
+        if ((cell < base_) || (cell >= top_) || (cell & 3)) {
+            return false;
+        }
+
+        const std::size_t granule = (cell - base_) >> 2;
+        return free_map_[granule >> 6] & (1ULL << (granule & 63));
+    }
+
+    eka2l1::address hle_heap::next_free_cell(const eka2l1::address addr) {
+        if (addr >= top_) {
+            return 0;
+        }
+
+        const std::size_t granule = (addr <= base_) ? 0 : ((addr - base_ + 3) >> 2);
+        std::size_t word = granule >> 6;
+
+        if (word >= free_map_.size()) {
+            return 0;
+        }
+
+        std::uint64_t bits = free_map_[word] & (~0ULL << (granule & 63));
+
+        if (!bits) {
+            // Skip to the next word that has a free cell
+            const std::size_t from_word = word + 1;
+            bool found = false;
+
+            for (std::size_t summary = from_word >> 6; summary < free_map_summary_.size(); summary++) {
+                std::uint64_t summary_bits = free_map_summary_[summary];
+
+                if (summary == (from_word >> 6)) {
+                    summary_bits &= ~0ULL << (from_word & 63);
+                }
+
+                if (summary_bits) {
+                    word = (summary << 6) + common::count_trailing_zero(summary_bits);
+                    found = true;
+
+                    break;
+                }
+            }
+
+            if (!found) {
+                return 0;
+            }
+
+            bits = free_map_[word];
+        }
+
+        return static_cast<eka2l1::address>(base_ + (((word << 6) + common::count_trailing_zero(bits)) << 2));
+    }
+
+    eka2l1::address hle_heap::prev_free_cell(const eka2l1::address addr) {
+        const eka2l1::address end = common::min(addr, top_);
+
+        if (end <= base_) {
+            return 0;
+        }
+
+        // Last granule that starts before the address
+        const std::size_t granule = ((end - base_ + 3) >> 2) - 1;
+        std::size_t word = granule >> 6;
+
+        std::uint64_t bits = free_map_[word] & bits_up_to(granule & 63);
+
+        if (!bits) {
+            if (word == 0) {
+                return 0;
+            }
+
+            // Skip back to the previous word that has a free cell
+            const std::size_t from_word = word - 1;
+            bool found = false;
+
+            for (std::size_t summary = (from_word >> 6) + 1; summary-- > 0;) {
+                std::uint64_t summary_bits = free_map_summary_[summary];
+
+                if (summary == (from_word >> 6)) {
+                    summary_bits &= bits_up_to(from_word & 63);
+                }
+
+                if (summary_bits) {
+                    word = (summary << 6) + highest_bit(summary_bits);
+                    found = true;
+
+                    break;
+                }
+            }
+
+            if (!found) {
+                return 0;
+            }
+
+            bits = free_map_[word];
+        }
+
+        return static_cast<eka2l1::address>(base_ + (((word << 6) + highest_bit(bits)) << 2));
+    }
+
+    void hle_heap::add_free_cell(const eka2l1::address cell, const std::uint32_t len) {
+        set_free_bit(cell, true);
+        bin_insert(cell, len);
+    }
+
+    void hle_heap::remove_free_cell(const eka2l1::address cell, const std::uint32_t len) {
+        bin_remove(cell, len);
+        set_free_bit(cell, false);
+    }
+
+    std::uint32_t &hle_heap::link_to(const eka2l1::address cell) {
+        const eka2l1::address prev = prev_free_cell(cell);
+        return prev ? cell_next(prev) : field(RHEAP_FREE_NEXT);
+    }
+
+    eka2l1::address hle_heap::find_fit(const std::uint32_t size) {
+        std::uint32_t bin = bin_index(size);
+
+        if (bin >= SMALL_BIN_COUNT) {
+            // A large bin holds a range of sizes, take the first cell that is big enough
+            for (eka2l1::address cell = bins_[bin]; cell; cell = cell_bin_next(cell)) {
+                if (cell_len(cell) >= size) {
+                    return cell;
+                }
+            }
+
+            bin++;
+        }
+
+        // Sizes are multiples of 8, so any cell in the small bin of the size fits, and any cell
+        // in a bin after it too
+        for (std::uint32_t word = bin >> 6; word < bin_map_.size(); word++) {
+            std::uint64_t bits = bin_map_[word];
+
+            if (word == (bin >> 6)) {
+                bits &= ~0ULL << (bin & 63);
+            }
+
+            if (bits) {
+                return bins_[(word << 6) + common::count_trailing_zero(bits)];
+            }
+        }
+
+        return 0;
+    }
+
+    void hle_heap::mark_synced() {
+        synced_first_free_ = field(RHEAP_FREE_NEXT);
+        synced_first_free_len_ = synced_first_free_ ? cell_len(synced_first_free_) : 0;
+    }
+
+    void hle_heap::rebuild_index() {
+        std::fill(free_map_.begin(), free_map_.end(), 0);
+        std::fill(free_map_summary_.begin(), free_map_summary_.end(), 0);
+
+        resize_free_map();
+
+        bins_.fill(0);
+        bin_map_.fill(0);
+
+        // Adopt the free list the guest constructor (or the original allocator) left behind.
+        // It is already sorted by address and merged.
+        eka2l1::address cell = field(RHEAP_FREE_NEXT);
+        eka2l1::address last_end = base_;
+
+        while (cell) {
+            if ((cell < last_end) || (cell + MIN_FREE_CELL_SIZE > top_) || (cell & 3)) {
+                LOG_ERROR(HLE_DISPATCHER, "Free list of heap 0x{:X} is corrupted at cell 0x{:X}", heap_addr_, cell);
+                break;
+            }
+
+            const std::uint32_t len = cell_len(cell);
+
+            if ((len < MIN_FREE_CELL_SIZE) || (len > top_ - cell)) {
+                LOG_ERROR(HLE_DISPATCHER, "Free cell 0x{:X} of heap 0x{:X} has bad length {}", cell, heap_addr_, len);
+                break;
+            }
+
+            add_free_cell(cell, len);
+
+            last_end = cell + len;
+            cell = cell_next(cell);
+        }
+
+        mark_synced();
+    }
+
+    bool hle_heap::in_sync() {
+        if ((field(RHEAP_BASE) != base_) || (field(RHEAP_TOP) != top_)) {
+            return false;
+        }
+
+        const eka2l1::address first_free = field(RHEAP_FREE_NEXT);
+
+        if (first_free != synced_first_free_) {
+            return false;
+        }
+
+        return !first_free || (cell_len(first_free) == synced_first_free_len_);
+    }
+
+    bool hle_heap::grow(const eka2l1::address new_top) {
+        if (new_top - heap_addr_ > field(RHEAP_MAX_LENGTH)) {
+            return false;
+        }
+
+        kernel::chunk *heap_chunk = kern_->get<kernel::chunk>(field(RHEAP_CHUNK_HANDLE));
+
+        if (!heap_chunk) {
+            LOG_ERROR(HLE_DISPATCHER, "Chunk of heap 0x{:X} not found, can't grow", heap_addr_);
+            return false;
+        }
+
+        const eka2l1::address chunk_base = heap_chunk->base(pr_).ptr_address();
+        const std::uint32_t grow_gran = common::max<std::uint32_t>(field(RHEAP_GROW_BY), field(RHEAP_PAGE_SIZE));
+
+        std::size_t new_committed = common::align(static_cast<std::size_t>(new_top - chunk_base), grow_gran);
+        new_committed = common::min<std::size_t>(new_committed, heap_chunk->max_size());
+
+        if ((chunk_base + new_committed < new_top) || !heap_chunk->adjust(new_committed)) {
+            return false;
+        }
+
+        const eka2l1::address old_top = top_;
+
+        top_ = static_cast<eka2l1::address>(chunk_base + heap_chunk->top_offset());
+        field(RHEAP_TOP) = top_;
+
+        resize_free_map();
+
+        // The new space becomes a free cell, merged with the one ending at the old top if any
+        if (top_ > old_top) {
+            insert_free_cell(old_top, top_ - old_top);
+        }
+
+        return true;
+    }
+
+    bool hle_heap::is_allocated_cell(const eka2l1::address cell) {
+        if ((cell < base_) || (cell >= top_) || (cell & 3)) {
+            return false;
+        }
+
+        const std::uint32_t len = cell_len(cell);
+
+        if ((len < MIN_FREE_CELL_SIZE) || (len > top_ - cell)) {
+            return false;
+        }
+
+        // Must not be a free cell or inside one (double free), nor run over the next one
+        if (is_free_cell(cell)) {
+            return false;
+        }
+
+        const eka2l1::address before = prev_free_cell(cell);
+
+        if (before && (before + cell_len(before) > cell)) {
+            return false;
+        }
+
+        const eka2l1::address after = next_free_cell(cell);
+        return !after || (cell + len <= after);
+    }
+
+    void hle_heap::insert_free_cell(const eka2l1::address cell, std::uint32_t len) {
+        eka2l1::address next_cell = next_free_cell(cell);
+
+        // Merge with the free cell right after
+        if (next_cell && (next_cell == cell + len)) {
+            const std::uint32_t next_len = cell_len(next_cell);
+            remove_free_cell(next_cell, next_len);
+
+            len += next_len;
+            next_cell = cell_next(next_cell);
+        }
+
+        const eka2l1::address prev = prev_free_cell(cell);
+
+        if (prev) {
+            const std::uint32_t prev_len = cell_len(prev);
+
+            // Merge with the free cell right before
+            if (prev + prev_len == cell) {
+                bin_remove(prev, prev_len);
+
+                cell_len(prev) = prev_len + len;
+                cell_next(prev) = next_cell;
+
+                bin_insert(prev, prev_len + len);
+                mark_synced();
+
+                return;
+            }
+
+            cell_next(prev) = cell;
+        } else {
+            field(RHEAP_FREE_NEXT) = cell;
+        }
+
+        cell_len(cell) = len;
+        cell_next(cell) = next_cell;
+
+        add_free_cell(cell, len);
+        mark_synced();
+    }
+
+    std::uint32_t hle_heap::consume_free_cell(const eka2l1::address cell, const std::uint32_t size) {
+        const std::uint32_t len = cell_len(cell);
+        const eka2l1::address after = cell_next(cell);
+
+        std::uint32_t &link = link_to(cell);
+        remove_free_cell(cell, len);
+
+        // Leave the rest free in the same list position, unless it's too small to be worth it
+        if (len - size >= MIN_SPLIT_REMAINDER) {
+            const eka2l1::address rest = cell + size;
+
+            cell_len(rest) = len - size;
+            cell_next(rest) = after;
+            link = rest;
+
+            add_free_cell(rest, len - size);
+            mark_synced();
+
+            return size;
+        }
+
+        link = after;
+        mark_synced();
+
+        return len;
+    }
+
+    eka2l1::address hle_heap::alloc(const std::uint32_t size) {
+        if (size >= field(RHEAP_MAX_LENGTH)) {
+            return 0;
+        }
+
+        const std::uint32_t cell_size = cell_size_for(size);
+        eka2l1::address cell = find_fit(cell_size);
+
+        if (!cell) {
+            // Grow so that the free cell at the top (if any) becomes big enough
+            eka2l1::address new_top = top_ + cell_size;
+            const eka2l1::address last = prev_free_cell(top_);
+
+            if (last && (last + cell_len(last) == top_)) {
+                new_top = last + cell_size;
+            }
+
+            if (!grow(new_top)) {
+                return 0;
+            }
+
+            cell = find_fit(cell_size);
+
+            if (!cell) {
+                return 0;
+            }
+        }
+
+        const std::uint32_t final_size = consume_free_cell(cell, cell_size);
+
+        cell_len(cell) = final_size;
+
+        field(RHEAP_CELL_COUNT)++;
+        field(RHEAP_TOTAL_ALLOC_SIZE) += final_size - CELL_HEADER_SIZE;
+
+        return cell + CELL_HEADER_SIZE;
+    }
+
+    void hle_heap::free(const eka2l1::address ptr) {
+        if (!ptr) {
+            return;
+        }
+
+        const eka2l1::address cell = ptr - CELL_HEADER_SIZE;
+
+        if (!is_allocated_cell(cell)) {
+            LOG_ERROR(HLE_DISPATCHER, "Trying to free bad cell 0x{:X} on heap 0x{:X}, ignored", ptr, heap_addr_);
+            return;
+        }
+
+        const std::uint32_t len = cell_len(cell);
+
+        field(RHEAP_CELL_COUNT)--;
+        field(RHEAP_TOTAL_ALLOC_SIZE) -= len - CELL_HEADER_SIZE;
+
+        insert_free_cell(cell, len);
+    }
+
+    eka2l1::address hle_heap::realloc(const eka2l1::address ptr, const std::uint32_t size, const std::uint32_t mode) {
+        if (!ptr) {
+            return (mode & REALLOC_NEVER_MOVE) ? 0 : alloc(size);
+        }
+
+        const eka2l1::address cell = ptr - CELL_HEADER_SIZE;
+
+        if (!is_allocated_cell(cell)) {
+            LOG_ERROR(HLE_DISPATCHER, "Trying to reallocate bad cell 0x{:X} on heap 0x{:X}", ptr, heap_addr_);
+            return 0;
+        }
+
+        if (size >= field(RHEAP_MAX_LENGTH)) {
+            return 0;
+        }
+
+        const std::uint32_t old_len = cell_len(cell);
+        const std::uint32_t new_len = cell_size_for(size);
+
+        if (new_len <= old_len) {
+            if (old_len - new_len >= MIN_SPLIT_REMAINDER) {
+                cell_len(cell) = new_len;
+                field(RHEAP_TOTAL_ALLOC_SIZE) -= old_len - new_len;
+
+                insert_free_cell(cell + new_len, old_len - new_len);
+            }
+
+            return ptr;
+        }
+
+        // Try to extend in place into the free cell that follows, growing the heap if that cell
+        // (or this one) touches the top
+        eka2l1::address next = is_free_cell(cell + old_len) ? cell + old_len : 0;
+        std::uint32_t available = old_len + (next ? cell_len(next) : 0);
+
+        if ((available < new_len) && (cell + available == top_) && grow(cell + new_len)) {
+            next = is_free_cell(cell + old_len) ? cell + old_len : 0;
+            available = old_len + (next ? cell_len(next) : 0);
+        }
+
+        if (available >= new_len) {
+            const std::uint32_t taken = consume_free_cell(next, new_len - old_len);
+
+            cell_len(cell) = old_len + taken;
+            field(RHEAP_TOTAL_ALLOC_SIZE) += taken;
+
+            return ptr;
+        }
+
+        if (mode & REALLOC_NEVER_MOVE) {
+            return 0;
+        }
+
+        const eka2l1::address new_ptr = alloc(size);
+
+        if (!new_ptr) {
+            return 0;
+        }
+
+        // Chunk may have been adjusted, so only now take host pointers
+        std::memcpy(host_ptr(new_ptr), host_ptr(ptr), old_len - CELL_HEADER_SIZE);
+        free(ptr);
+
+        return new_ptr;
+    }
+
+    std::uint32_t hle_heap::alloc_len(const eka2l1::address ptr) {
+        const eka2l1::address cell = ptr - CELL_HEADER_SIZE;
+
+        if (!is_allocated_cell(cell)) {
+            LOG_ERROR(HLE_DISPATCHER, "Trying to get length of bad cell 0x{:X} on heap 0x{:X}", ptr, heap_addr_);
+            return 0;
+        }
+
+        return cell_len(cell) - CELL_HEADER_SIZE;
+    }
+
+    static hle_heap *get_hle_heap(system *sys, const eka2l1::address heap_addr) {
+        kernel_system *kern = sys->get_kernel_system();
+        kernel::process *pr = kern->crr_process();
+
+        return sys->get_dispatcher()->get_hle_heap(kern, pr, heap_addr);
+    }
+
+    BRIDGE_FUNC_DISPATCHER(eka2l1::ptr<void>, hle_heap_alloc, eka2l1::ptr<void> heap, const std::int32_t size) {
+        if (size < 0) {
+            return 0;
+        }
+
+        return get_hle_heap(sys, heap.ptr_address())->alloc(static_cast<std::uint32_t>(size));
+    }
+
+    BRIDGE_FUNC_DISPATCHER(void, hle_heap_free, eka2l1::ptr<void> heap, eka2l1::ptr<void> cell) {
+        get_hle_heap(sys, heap.ptr_address())->free(cell.ptr_address());
+    }
+
+    BRIDGE_FUNC_DISPATCHER(eka2l1::ptr<void>, hle_heap_realloc, eka2l1::ptr<void> heap, eka2l1::ptr<void> cell,
+        const std::int32_t size, const std::int32_t mode) {
+        if (size < 0) {
+            return 0;
+        }
+
+        return get_hle_heap(sys, heap.ptr_address())->realloc(cell.ptr_address(), static_cast<std::uint32_t>(size),
+            static_cast<std::uint32_t>(mode));
+    }
+
+    BRIDGE_FUNC_DISPATCHER(std::int32_t, hle_heap_alloc_len, eka2l1::ptr<void> heap, eka2l1::ptr<void> cell) {
+        if (!cell) {
+            return 0;
+        }
+
+        return static_cast<std::int32_t>(get_hle_heap(sys, heap.ptr_address())->alloc_len(cell.ptr_address()));
+    }
+}
@@ -18,6 +18,7 @@
  */
 
 #include <dispatch/audio.h>
+#include <dispatch/heap.h>
 #include <dispatch/register.h>
 #include <dispatch/screen.h>
 
@@ -57,6 +58,10 @@ namespace eka2l1::dispatch {
         BRIDGE_REGISTER_DISPATCHER(0x4F, eaudio_dsp_stream_bytes_rendered),
         BRIDGE_REGISTER_DISPATCHER(0x50, eaudio_dsp_stream_position),
         BRIDGE_REGISTER_DISPATCHER(0x52, eaudio_dsp_stream_notify_buffer_ready_cancel),
-        BRIDGE_REGISTER_DISPATCHER(0x53, eaudio_dsp_stream_reset_stat)
+        BRIDGE_REGISTER_DISPATCHER(0x53, eaudio_dsp_stream_reset_stat),
+        BRIDGE_REGISTER_DISPATCHER(0x60, hle_heap_alloc),
+        BRIDGE_REGISTER_DISPATCHER(0x61, hle_heap_free),
+        BRIDGE_REGISTER_DISPATCHER(0x62, hle_heap_realloc),
+        BRIDGE_REGISTER_DISPATCHER(0x63, hle_heap_alloc_len)
     };
 }
\ No newline at end of file
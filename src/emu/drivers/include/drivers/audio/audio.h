@@ -51,7 +51,8 @@ namespace eka2l1::drivers {
     };
 
     enum class audio_driver_backend {
-        cubeb
+        cubeb,
+        null
     };
 
     std::unique_ptr<audio_driver> make_audio_driver(const audio_driver_backend backend);
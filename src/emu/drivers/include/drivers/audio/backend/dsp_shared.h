@@ -22,38 +22,139 @@
 #include <drivers/audio/audio.h>
 #include <drivers/audio/dsp.h>
 
-#include <common/queue.h>
+#include <common/ring.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 namespace eka2l1::drivers {
     using dsp_buffer = std::vector<std::uint8_t>;
 
+    /**
+     * \brief Ring of decoded PCM16 samples, with one producer (the decode worker) and one consumer
+     *        (the host audio callback).
+     *
+     * Positions only grow, so the consumer can never see a sample twice, even after a discard.
+     */
+    struct dsp_pcm_ring {
+        std::vector<std::int16_t> samples_;
+
+        std::atomic<std::uint64_t> read_pos_;
+        std::atomic<std::uint64_t> write_pos_;
+        std::atomic<std::uint64_t> discard_pos_;
+
+        explicit dsp_pcm_ring();
+
+        void resize(const std::size_t sample_count);
+
+        /**
+         * \brief Push samples, as many as there are room for.
+         * \returns Number of samples pushed.
+         */
+        std::size_t push(const std::int16_t *data, const std::size_t count);
+
+        /**
+         * \brief Pop samples, as many as are available.
+         * \returns Number of samples popped.
+         */
+        std::size_t pop(std::int16_t *data, const std::size_t count);
+
+        /**
+         * \brief Make the consumer skip everything pushed until now.
+         */
+        void discard();
+
+        std::size_t capacity() const {
+            return samples_.size();
+        }
+
+        /**
+         * \brief Get the number of samples pushed but not popped yet. Only exact on the consumer side.
+         */
+        std::size_t size() const {
+            return static_cast<std::size_t>(write_pos_.load(std::memory_order_acquire) - read_pos_.load(std::memory_order_relaxed));
+        }
+    };
+
     struct dsp_output_stream_shared : public dsp_output_stream {
     protected:
         drivers::audio_driver *aud_;
         std::unique_ptr<drivers::audio_output_stream> stream_;
 
-        threadsafe_cn_queue<dsp_buffer> buffers_;
+        // Guest buffers not decoded yet, one record per write
+        common::spsc_byte_ring encoded_ring_;
+        dsp_buffer encoded_;
+
+        dsp_pcm_ring ring_;
 
+        // Decoded buffer still waiting for room in the ring
         dsp_buffer decoded_;
         std::size_t pointer_;
 
+        std::unique_ptr<std::thread> decode_thread_;
+        std::mutex decode_lock_;
+        std::condition_variable decode_cond_;
+        bool decode_quit_;
+        std::atomic<bool> decode_waiting_data_;
+        std::atomic<bool> decode_waiting_room_;
+
         std::int16_t last_frame_[2];
         std::mutex callback_lock_;
 
         bool virtual_stop;
 
+        void decode_loop();
+        void decode_pcm(dsp_buffer &original, dsp_buffer &dest);
+
+        /**
+         * \brief Stop the decode worker. Backends must call this before tearing down their decoder.
+         */
+        void stop_decoder();
+
     public:
-        explicit dsp_output_stream_shared(drivers::audio_driver *aud);
+        // Decoded audio that can sit in the ring, ahead of the host audio callback
+        static constexpr std::uint32_t RING_DURATION_MS = 100;
+
+        // Guest data that can be queued for the decoder, in bytes
+        static constexpr std::size_t DEFAULT_ENCODED_CAPACITY = 256 * 1024;
+
+        /**
+         * \brief Create the stream.
+         *
+         * \param aud               Driver that plays the decoded audio.
+         * \param encoded_capacity  Bytes of guest data the stream can hold before writes are refused.
+         *                          Rounded up to a power of two.
+         */
+        explicit dsp_output_stream_shared(drivers::audio_driver *aud, const std::size_t encoded_capacity = DEFAULT_ENCODED_CAPACITY);
         ~dsp_output_stream_shared() override;
 
+        /**
+         * \brief Decode a guest buffer into signed 16-bit PCM, with the stream's rate and channel count.
+         *
+         * This is called from the decode worker, never from the host audio callback. PCM8 and PCM16
+         * buffers do not go through here.
+         */
         virtual void decode_data(dsp_buffer &original, std::vector<std::uint8_t> &dest) = 0;
         std::size_t data_callback(std::int16_t *buffer, const std::size_t frame_count);
 
+        /**
+         * \brief Queue a guest buffer for decoding. Never blocks, and does not allocate.
+         *
+         * Only one thread may write at a time.
+         *
+         * \returns False if there is no room for the buffer. The buffer copied notification comes
+         *          once the decoder has taken a buffer out, retry after it.
+         */
         bool write(const std::uint8_t *data, const std::uint32_t data_size) override;
 
+        std::size_t max_write_size() const override {
+            return encoded_ring_.max_record_size();
+        }
+
         void volume(const std::uint32_t new_volume) override;
         bool set_properties(const std::uint32_t freq, const std::uint8_t channels) override;
 
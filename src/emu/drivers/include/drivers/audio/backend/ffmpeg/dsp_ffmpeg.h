@@ -25,14 +25,28 @@ extern "C" {
 #include <libavcodec/avcodec.h>
 }
 
+struct SwrContext;
+
 namespace eka2l1::drivers {
     struct dsp_output_stream_ffmpeg : public dsp_output_stream_shared {
     protected:
         AVCodecContext *codec_;
+        AVFrame *frame_;
         std::uint64_t timestamp_in_base_;
 
+        // Resampler is kept as long as the decoded format stays the same, so its delay carries over frames
+        SwrContext *swr_;
+        std::uint64_t swr_in_layout_;
+        int swr_in_format_;
+        int swr_in_rate_;
+        std::uint32_t swr_out_rate_;
+        std::uint32_t swr_out_channels_;
+
+        bool prepare_resampler();
+        void append_frame(std::vector<std::uint8_t> &dest);
+
     public:
-        explicit dsp_output_stream_ffmpeg(drivers::audio_driver *aud);
+        explicit dsp_output_stream_ffmpeg(drivers::audio_driver *aud, const std::size_t encoded_capacity = DEFAULT_ENCODED_CAPACITY);
         ~dsp_output_stream_ffmpeg() override;
 
         bool format(const four_cc fmt) override;
@@ -125,6 +125,13 @@ namespace eka2l1::drivers {
         virtual ~dsp_output_stream() = default;
         virtual bool write(const std::uint8_t *data, const std::uint32_t data_size) = 0;
 
+        /**
+         * @brief   Get the size of the biggest buffer write can ever accept.
+         */
+        virtual std::size_t max_write_size() const {
+            return static_cast<std::size_t>(-1);
+        }
+
         virtual const std::uint32_t volume() const {
             return volume_;
         }
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <drivers/graphics/graphics.h>
+
+#include <atomic>
+#include <cstdint>
+
+namespace eka2l1::drivers {
+    /**
+     * \brief Graphics driver that draws nothing.
+     *
+     * Commands are consumed on the thread submitting them. Objects creation still hands out
+     * unique handles, so that clients that check them keep working. Used for headless runs.
+     */
+    class null_graphics_driver : public graphics_driver {
+        std::atomic<std::uint64_t> handle_counter_;
+        std::atomic_bool should_stop_;
+
+        void dispatch(command *cmd);
+        void finish(command *cmd, const int code);
+
+    public:
+        explicit null_graphics_driver();
+
+        void update_bitmap(drivers::handle h, const std::size_t size, const eka2l1::vec2 &offset,
+            const eka2l1::vec2 &dim, const void *data, const std::size_t pixels_per_line = 0) override;
+
+        void attach_descriptors(drivers::handle h, const int stride, const bool instance_move, const attribute_descriptor *descriptors,
+            const int descriptor_count) override;
+
+        void set_viewport(const eka2l1::rect &viewport) override;
+
+        std::unique_ptr<graphics_command_list> new_command_list() override;
+        std::unique_ptr<graphics_command_list_builder> new_command_builder(graphics_command_list *list) override;
+
+        void submit_command_list(graphics_command_list &command_list) override;
+
+        void run() override;
+        void abort() override;
+    };
+}
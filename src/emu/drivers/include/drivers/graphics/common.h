@@ -31,7 +31,8 @@ namespace eka2l1::drivers {
 
     enum class graphic_api {
         opengl,
-        vulkan
+        vulkan,
+        null
     };
 
     class graphics_object {
@@ -18,13 +18,82 @@
  */
 
 #include <common/log.h>
+#include <common/thread.h>
 #include <drivers/audio/backend/dsp_shared.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
 namespace eka2l1::drivers {
-    dsp_output_stream_shared::dsp_output_stream_shared(drivers::audio_driver *aud)
+    dsp_pcm_ring::dsp_pcm_ring()
+        : read_pos_(0)
+        , write_pos_(0)
+        , discard_pos_(0) {
+    }
+
+    void dsp_pcm_ring::resize(const std::size_t sample_count) {
+        samples_.assign(sample_count, 0);
+
+        read_pos_ = 0;
+        write_pos_ = 0;
+        discard_pos_ = 0;
+    }
+
+    std::size_t dsp_pcm_ring::push(const std::int16_t *data, const std::size_t count) {
+        const std::uint64_t write = write_pos_.load(std::memory_order_relaxed);
+        const std::uint64_t read = read_pos_.load(std::memory_order_acquire);
+
+        const std::size_t to_push = std::min<std::size_t>(count, samples_.size() - static_cast<std::size_t>(write - read));
+
+        if (to_push == 0) {
+            return 0;
+        }
+
+        const std::size_t start = static_cast<std::size_t>(write % samples_.size());
+        const std::size_t first_part = std::min<std::size_t>(to_push, samples_.size() - start);
+
+        std::memcpy(&samples_[start], data, first_part * sizeof(std::int16_t));
+        std::memcpy(&samples_[0], data + first_part, (to_push - first_part) * sizeof(std::int16_t));
+
+        write_pos_.store(write + to_push, std::memory_order_release);
+        return to_push;
+    }
+
+    std::size_t dsp_pcm_ring::pop(std::int16_t *data, const std::size_t count) {
+        // Load the discard mark first, so the write position seen after it can't be behind it
+        const std::uint64_t discard = discard_pos_.load(std::memory_order_acquire);
+        const std::uint64_t write = write_pos_.load(std::memory_order_acquire);
+
+        // Skip over discarded samples
+        const std::uint64_t read = std::max<std::uint64_t>(read_pos_.load(std::memory_order_relaxed), discard);
+
+        const std::size_t to_pop = std::min<std::size_t>(count, static_cast<std::size_t>(write - read));
+
+        if (to_pop != 0) {
+            const std::size_t start = static_cast<std::size_t>(read % samples_.size());
+            const std::size_t first_part = std::min<std::size_t>(to_pop, samples_.size() - start);
+
+            std::memcpy(data, &samples_[start], first_part * sizeof(std::int16_t));
+            std::memcpy(data + first_part, &samples_[0], (to_pop - first_part) * sizeof(std::int16_t));
+        }
+
+        read_pos_.store(read + to_pop, std::memory_order_release);
+        return to_pop;
+    }
+
+    void dsp_pcm_ring::discard() {
+        discard_pos_.store(write_pos_.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    dsp_output_stream_shared::dsp_output_stream_shared(drivers::audio_driver *aud, const std::size_t encoded_capacity)
         : dsp_output_stream()
         , aud_(aud)
+        , encoded_ring_(encoded_capacity)
         , pointer_(0)
+        , decode_quit_(false)
+        , decode_waiting_data_(false)
+        , decode_waiting_room_(false)
         , virtual_stop(true) {
         last_frame_[0] = 0;
         last_frame_[1] = 0;
@@ -34,11 +103,29 @@ namespace eka2l1::drivers {
         if (stream_) {
             stream_->stop();
         }
+
+        stop_decoder();
+    }
+
+    void dsp_output_stream_shared::stop_decoder() {
+        if (!decode_thread_) {
+            return;
+        }
+
+        {
+            const std::lock_guard<std::mutex> guard(decode_lock_);
+            decode_quit_ = true;
+        }
+
+        decode_cond_.notify_one();
+
+        decode_thread_->join();
+        decode_thread_.reset();
     }
 
     bool dsp_output_stream_shared::set_properties(const std::uint32_t freq, const std::uint8_t channels) {
         // Doc said: Writing to the stream must have stopped before you call this function.
-        if (buffers_.size() > 0) {
+        if (!encoded_ring_.empty()) {
             return false;
         }
 
@@ -51,8 +138,22 @@ namespace eka2l1::drivers {
             stream_.reset();
         }
 
-        channels_ = channels;
-        freq_ = freq;
+        {
+            const std::lock_guard<std::mutex> guard(decode_lock_);
+
+            channels_ = channels;
+            freq_ = freq;
+
+            // Whole frames only, so the callback never gets half of one
+            ring_.resize((freq * RING_DURATION_MS / 1000) * channels);
+
+            decoded_.clear();
+            pointer_ = 0;
+        }
+
+        if (!decode_thread_) {
+            decode_thread_ = std::make_unique<std::thread>(&dsp_output_stream_shared::decode_loop, this);
+        }
 
         stream_ = aud_->new_output_stream(freq, channels, [this](std::int16_t *buffer, const std::size_t nb_frames) {
             return data_callback(buffer, nb_frames);
@@ -101,10 +202,15 @@ namespace eka2l1::drivers {
 
         virtual_stop = true;
 
-        // Discard all buffers
-        while (auto buffer = buffers_.pop()) {
-        }
+        const std::lock_guard<std::mutex> decode_guard(decode_lock_);
 
+        // Discard all buffers, decoded or not. Popping only happens under the decoder lock, so we can act as the consumer.
+        encoded_ring_.clear();
+
+        decoded_.clear();
+        pointer_ = 0;
+
+        ring_.discard();
         return true;
     }
 
@@ -146,65 +252,137 @@ namespace eka2l1::drivers {
     }
 
     bool dsp_output_stream_shared::write(const std::uint8_t *data, const std::uint32_t data_size) {
-        // Copy buffer to queue
-        dsp_buffer buffer;
-        buffer.resize(data_size);
+        if (!encoded_ring_.push(data, data_size)) {
+            if (data_size > encoded_ring_.max_record_size()) {
+                LOG_ERROR(DRIVER_AUD, "Audio buffer of {} bytes can never fit in the stream (capacity {} bytes)", data_size,
+                    encoded_ring_.capacity());
+            }
+
+            return false;
+        }
 
-        std::memcpy(&buffer[0], data, data_size);
+        // Only wake the decoder when it sleeps for lack of data. Either it sees the record we just pushed,
+        // or we see its flag, the fences keep both from missing each other.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
 
-        // Push it to the queue
-        buffers_.push(buffer);
+        if (decode_waiting_data_.load(std::memory_order_relaxed)) {
+            // Taking the lock makes sure the decoder is already waiting
+            {
+                const std::lock_guard<std::mutex> guard(decode_lock_);
+            }
+
+            decode_cond_.notify_one();
+        }
 
         return true;
     }
 
-    std::size_t dsp_output_stream_shared::data_callback(std::int16_t *buffer, const std::size_t frame_count) {
-        std::size_t frame_wrote = 0;
+    void dsp_output_stream_shared::decode_pcm(dsp_buffer &original, dsp_buffer &dest) {
+        if (format_ == PCM16_FOUR_CC_CODE) {
+            dest.swap(original);
+            return;
+        }
+
+        // Signed 8-bit to signed 16-bit, same channel count
+        dest.resize(original.size() * sizeof(std::int16_t));
+
+        const std::int8_t *source = reinterpret_cast<const std::int8_t *>(original.data());
+        std::int16_t *target = reinterpret_cast<std::int16_t *>(dest.data());
+
+        for (std::size_t i = 0; i < original.size(); i++) {
+            target[i] = static_cast<std::int16_t>(source[i] * 256);
+        }
+    }
 
-        while (frame_wrote < frame_count) {
-            std::optional<dsp_buffer> encoded;
+    void dsp_output_stream_shared::decode_loop() {
+        common::set_thread_name("DSP stream decoder");
+        std::unique_lock<std::mutex> ulock(decode_lock_);
 
-            if ((decoded_.size() == 0) || (decoded_.size() == pointer_)) {
-                // Get the next buffer
-                encoded = buffers_.pop();
+        while (!decode_quit_) {
+            if (pointer_ >= decoded_.size()) {
+                if (!encoded_ring_.pop(encoded_)) {
+                    decode_waiting_data_.store(true, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
 
-                if (!encoded) {
-                    break;
+                    if (encoded_ring_.empty()) {
+                        decode_cond_.wait(ulock);
+                    }
+
+                    decode_waiting_data_.store(false, std::memory_order_relaxed);
+                    continue;
                 }
-                
+
+                decoded_.clear();
                 pointer_ = 0;
 
-                if (format_ == PCM16_FOUR_CC_CODE) {
-                    decoded_ = encoded.value();
+                if ((format_ == PCM16_FOUR_CC_CODE) || (format_ == PCM8_FOUR_CC_CODE)) {
+                    decode_pcm(encoded_, decoded_);
                 } else {
-                    decode_data(encoded.value(), decoded_);
+                    decode_data(encoded_, decoded_);
                 }
-                
-                // Callback that internal buffer has been copied
-                {
-                    std::size_t total_sample = (decoded_.size() / sizeof(std::uint16_t));
-                    samples_copied_ += total_sample;
-                    
-                    const std::lock_guard<std::mutex> guard(callback_lock_);
-                    if (buffer_copied_callback_) {
-                        buffer_copied_callback_(buffer_copied_userdata_);
-                    }
+
+                // Keep whole frames, the ring relies on it
+                const std::size_t frame_size = channels_ * sizeof(std::int16_t);
+
+                if (frame_size != 0) {
+                    decoded_.resize(decoded_.size() / frame_size * frame_size);
+                }
+            }
+
+            const std::size_t sample_left = (decoded_.size() - pointer_) / sizeof(std::int16_t);
+            const std::size_t sample_pushed = ring_.push(reinterpret_cast<const std::int16_t *>(decoded_.data() + pointer_),
+                sample_left);
+
+            pointer_ += sample_pushed * sizeof(std::int16_t);
+
+            if (sample_pushed < sample_left) {
+                // The ring is full. The callback wakes us once half of it has been played, but it does so
+                // without taking our lock, so also check back by ourselves in case that wake is missed.
+                decode_waiting_room_ = true;
+                decode_cond_.wait_for(ulock, std::chrono::milliseconds(RING_DURATION_MS / 4));
+                decode_waiting_room_ = false;
+
+                continue;
+            }
+
+            samples_copied_ += decoded_.size() / sizeof(std::int16_t);
+
+            decoded_.clear();
+            pointer_ = 0;
+
+            // Callback that internal buffer has been copied. The client may lock its own things
+            // and write more, don't hold the decoder while doing it.
+            ulock.unlock();
+
+            {
+                const std::lock_guard<std::mutex> guard(callback_lock_);
+                if (buffer_copied_callback_) {
+                    buffer_copied_callback_(buffer_copied_userdata_);
                 }
             }
 
-            // We want to decode more
-            std::size_t frame_to_wrote = ((decoded_.size() - pointer_) / channels_ / sizeof(std::int16_t));
-            frame_to_wrote = std::min<std::size_t>(frame_to_wrote, frame_count - frame_wrote);
+            ulock.lock();
+        }
+    }
+
+    std::size_t dsp_output_stream_shared::data_callback(std::int16_t *buffer, const std::size_t frame_count) {
+        if (channels_ == 0) {
+            return 0;
+        }
 
-            std::memcpy(&buffer[frame_wrote * channels_], &decoded_[pointer_], frame_to_wrote * channels_ * sizeof(std::int16_t));
+        // Only copy what the decoder has prepared, never decode here
+        const std::size_t sample_wrote = ring_.pop(buffer, frame_count * channels_);
+        std::size_t frame_wrote = sample_wrote / channels_;
 
+        if (frame_wrote != 0) {
             // Set last frame
-            std::memcpy(last_frame_, &decoded_[pointer_ + (frame_to_wrote - 1) * channels_ * sizeof(std::int16_t)], channels_ * sizeof(std::int16_t));
+            std::memcpy(last_frame_, &buffer[(frame_wrote - 1) * channels_], channels_ * sizeof(std::int16_t));
+        }
 
-            pointer_ += frame_to_wrote * channels_ * sizeof(std::int16_t);
-            samples_played_ += frame_to_wrote * channels_;
+        samples_played_ += sample_wrote;
 
-            frame_wrote += frame_to_wrote;
+        if (decode_waiting_room_ && (ring_.size() <= ring_.capacity() / 2) && decode_waiting_room_.exchange(false)) {
+            decode_cond_.notify_one();
         }
 
         for (; frame_wrote < frame_count; frame_wrote++) {
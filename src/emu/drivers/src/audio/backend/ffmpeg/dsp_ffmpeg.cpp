@@ -35,17 +35,34 @@ namespace eka2l1::drivers {
         { PCM8_FOUR_CC_CODE, AV_CODEC_ID_PCM_S8 }
     };
 
-    dsp_output_stream_ffmpeg::dsp_output_stream_ffmpeg(drivers::audio_driver *aud)
-        : dsp_output_stream_shared(aud)
+    dsp_output_stream_ffmpeg::dsp_output_stream_ffmpeg(drivers::audio_driver *aud, const std::size_t encoded_capacity)
+        : dsp_output_stream_shared(aud, encoded_capacity)
         , codec_(nullptr)
-        , timestamp_in_base_(0) {
+        , frame_(nullptr)
+        , timestamp_in_base_(0)
+        , swr_(nullptr)
+        , swr_in_layout_(0)
+        , swr_in_format_(-1)
+        , swr_in_rate_(0)
+        , swr_out_rate_(0)
+        , swr_out_channels_(0) {
+        frame_ = av_frame_alloc();
         format(PCM16_FOUR_CC_CODE);
     }
 
     dsp_output_stream_ffmpeg::~dsp_output_stream_ffmpeg() {
+        // The decoder may still be using the codec
+        stop_decoder();
+
         if (codec_) {
             avcodec_free_context(&codec_);
         }
+
+        if (swr_) {
+            swr_free(&swr_);
+        }
+
+        av_frame_free(&frame_);
     }
 
     void dsp_output_stream_ffmpeg::get_supported_formats(std::vector<four_cc> &cc_list) {
@@ -62,6 +79,18 @@ namespace eka2l1::drivers {
             return false;
         }
 
+        const std::lock_guard<std::mutex> guard(decode_lock_);
+
+        // PCM is converted directly by the shared stream, no codec needed
+        if ((fmt == PCM16_FOUR_CC_CODE) || (fmt == PCM8_FOUR_CC_CODE)) {
+            if (codec_) {
+                avcodec_free_context(&codec_);
+            }
+
+            format_ = fmt;
+            return true;
+        }
+
         AVCodec *decoder = avcodec_find_decoder(find_result->second);
 
         if (!decoder) {
@@ -69,61 +98,121 @@ namespace eka2l1::drivers {
             return false;
         }
 
-        codec_ = avcodec_alloc_context3(decoder);
+        AVCodecContext *new_codec = avcodec_alloc_context3(decoder);
 
-        if (!codec_) {
+        if (!new_codec) {
             LOG_ERROR(DRIVER_AUD, "Can't alloc decode context!");
             return false;
         }
 
+        if (avcodec_open2(new_codec, decoder, nullptr) < 0) {
+            LOG_ERROR(DRIVER_AUD, "Can't open decoder!");
+            avcodec_free_context(&new_codec);
+
+            return false;
+        }
+
+        if (codec_) {
+            avcodec_free_context(&codec_);
+        }
+
+        codec_ = new_codec;
         format_ = fmt;
+
         return true;
     }
 
-    void dsp_output_stream_ffmpeg::decode_data(dsp_buffer &original, std::vector<std::uint8_t> &dest) {
-        AVPacket packet;
-        av_init_packet(&packet);
+    bool dsp_output_stream_ffmpeg::prepare_resampler() {
+        const std::uint64_t in_layout = frame_->channel_layout ? frame_->channel_layout
+                                                               : av_get_default_channel_layout(frame_->channels);
 
-        packet.size = original.size();
-        packet.data = original.data();
+        if (swr_ && (swr_in_layout_ == in_layout) && (swr_in_format_ == frame_->format) && (swr_in_rate_ == frame_->sample_rate)
+            && (swr_out_rate_ == freq_) && (swr_out_channels_ == channels_)) {
+            return true;
+        }
 
-        if (avcodec_send_packet(codec_, &packet) >= 0) {
-            AVFrame *frame = av_frame_alloc();
+        if (swr_) {
+            swr_free(&swr_);
+        }
 
-            if (avcodec_receive_frame(codec_, frame) < 0) {
-                av_frame_free(&frame);
-                return;
-            }
+        swr_ = swr_alloc_set_opts(nullptr,
+            (channels_ == 1) ? AV_CH_LAYOUT_MONO : AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_S16, freq_,
+            in_layout, static_cast<AVSampleFormat>(frame_->format), frame_->sample_rate,
+            0, nullptr);
 
-            dest.resize(2 * frame->nb_samples * sizeof(std::uint16_t));
-            timestamp_in_base_ = frame->best_effort_timestamp;
+        if (!swr_ || (swr_init(swr_) < 0)) {
+            LOG_ERROR(DRIVER_AUD, "Error initializing SWR context");
+            swr_free(&swr_);
 
-            if ((channels_ != codec_->channels) || (frame->format != AV_SAMPLE_FMT_S16)) {
-                SwrContext *swr = swr_alloc_set_opts(nullptr,
-                    AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_S16, freq_,
-                    frame->channel_layout, static_cast<AVSampleFormat>(frame->format), frame->sample_rate,
-                    0, nullptr);
+            return false;
+        }
 
-                if (swr_init(swr) < 0) {
-                    LOG_ERROR(DRIVER_AUD, "Error initializing SWR context");
-                    av_frame_free(&frame);
+        swr_in_layout_ = in_layout;
+        swr_in_format_ = frame_->format;
+        swr_in_rate_ = frame_->sample_rate;
+        swr_out_rate_ = freq_;
+        swr_out_channels_ = channels_;
 
-                    return;
-                }
+        return true;
+    }
 
-                std::uint8_t *output = &dest[0];
-                const std::uint8_t *source = frame->data[0];
+    void dsp_output_stream_ffmpeg::append_frame(std::vector<std::uint8_t> &dest) {
+        const std::size_t frame_size = channels_ * sizeof(std::int16_t);
+        const std::size_t dest_offset = dest.size();
 
-                const int result = swr_convert(swr, &output, frame->nb_samples, &source, frame->nb_samples);
-                swr_free(&swr);
+        if ((channels_ == static_cast<std::uint32_t>(frame_->channels)) && (frame_->format == AV_SAMPLE_FMT_S16)
+            && (freq_ == static_cast<std::uint32_t>(frame_->sample_rate))) {
+            dest.resize(dest_offset + frame_->nb_samples * frame_size);
+            std::memcpy(&dest[dest_offset], frame_->data[0], frame_->nb_samples * frame_size);
 
-                if (result < 0) {
-                    LOG_ERROR(DRIVER_AUD, "Error resample audio data!");
-                    return;
-                }
-            } else {
-                std::memcpy(&dest[0], frame->data[0], dest.size());
-            }
+            return;
+        }
+
+        if (!prepare_resampler()) {
+            return;
+        }
+
+        const int max_output_count = swr_get_out_samples(swr_, frame_->nb_samples);
+
+        if (max_output_count <= 0) {
+            return;
+        }
+
+        dest.resize(dest_offset + max_output_count * frame_size);
+
+        std::uint8_t *output = &dest[dest_offset];
+        const int result = swr_convert(swr_, &output, max_output_count, const_cast<const std::uint8_t **>(frame_->extended_data),
+            frame_->nb_samples);
+
+        if (result < 0) {
+            LOG_ERROR(DRIVER_AUD, "Error resample audio data!");
+            dest.resize(dest_offset);
+
+            return;
+        }
+
+        dest.resize(dest_offset + result * frame_size);
+    }
+
+    void dsp_output_stream_ffmpeg::decode_data(dsp_buffer &original, std::vector<std::uint8_t> &dest) {
+        if (!codec_) {
+            return;
+        }
+
+        AVPacket packet;
+        av_init_packet(&packet);
+
+        packet.size = static_cast<int>(original.size());
+        packet.data = original.data();
+
+        if (avcodec_send_packet(codec_, &packet) < 0) {
+            return;
+        }
+
+        // A packet may hold more than one frame
+        while (avcodec_receive_frame(codec_, frame_) >= 0) {
+            timestamp_in_base_ = frame_->best_effort_timestamp;
+            append_frame(dest);
         }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <drivers/audio/backend/null/audio_null.h>
+
+namespace eka2l1::drivers {
+    static constexpr std::uint32_t NULL_NATIVE_SAMPLE_RATE = 44100;
+
+    null_audio_output_stream::null_audio_output_stream()
+        : playing_(false) {
+    }
+
+    bool null_audio_output_stream::start() {
+        playing_ = true;
+        return true;
+    }
+
+    bool null_audio_output_stream::stop() {
+        playing_ = false;
+        return true;
+    }
+
+    bool null_audio_output_stream::is_playing() {
+        return playing_;
+    }
+
+    bool null_audio_output_stream::set_volume(const float volume) {
+        return true;
+    }
+
+    std::unique_ptr<audio_output_stream> null_audio_driver::new_output_stream(const std::uint32_t sample_rate,
+        const std::uint8_t channels, data_callback callback) {
+        return std::make_unique<null_audio_output_stream>();
+    }
+
+    std::uint32_t null_audio_driver::native_sample_rate() {
+        return NULL_NATIVE_SAMPLE_RATE;
+    }
+}
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <drivers/graphics/backend/graphics_null.h>
+#include <drivers/graphics/buffer.h>
+#include <drivers/graphics/shader.h>
+#include <drivers/graphics/texture.h>
+
+namespace eka2l1::drivers {
+    null_graphics_driver::null_graphics_driver()
+        : graphics_driver(graphic_api::null)
+        , handle_counter_(0)
+        , should_stop_(false) {
+    }
+
+    void null_graphics_driver::update_bitmap(drivers::handle h, const std::size_t size, const eka2l1::vec2 &offset,
+        const eka2l1::vec2 &dim, const void *data, const std::size_t pixels_per_line) {
+    }
+
+    void null_graphics_driver::attach_descriptors(drivers::handle h, const int stride, const bool instance_move,
+        const attribute_descriptor *descriptors, const int descriptor_count) {
+    }
+
+    void null_graphics_driver::set_viewport(const eka2l1::rect &viewport) {
+    }
+
+    std::unique_ptr<graphics_command_list> null_graphics_driver::new_command_list() {
+        return std::make_unique<server_graphics_command_list>();
+    }
+
+    std::unique_ptr<graphics_command_list_builder> null_graphics_driver::new_command_builder(graphics_command_list *list) {
+        return std::make_unique<server_graphics_command_list_builder>(list);
+    }
+
+    void null_graphics_driver::finish(command *cmd, const int code) {
+        if (cmd->status_) {
+            *cmd->status_ = code;
+            cond_.notify_all();
+        }
+    }
+
+    void null_graphics_driver::dispatch(command *cmd) {
+        command_helper helper(cmd);
+
+        switch (cmd->opcode_) {
+        case graphics_driver_create_bitmap: {
+            eka2l1::vec2 size;
+            std::uint32_t bpp = 0;
+            drivers::handle *result = nullptr;
+
+            helper.pop(size);
+            helper.pop(bpp);
+            helper.pop(result);
+
+            *result = ++handle_counter_;
+            break;
+        }
+
+        case graphics_driver_create_program: {
+            const char *vert_data = nullptr;
+            const char *frag_data = nullptr;
+            std::size_t vert_size = 0;
+            std::size_t frag_size = 0;
+            std::uint8_t **metadata = nullptr;
+            drivers::handle *result = nullptr;
+
+            helper.pop(vert_data);
+            helper.pop(frag_data);
+            helper.pop(vert_size);
+            helper.pop(frag_size);
+            helper.pop(metadata);
+            helper.pop(result);
+
+            *result = ++handle_counter_;
+            break;
+        }
+
+        case graphics_driver_create_texture: {
+            std::uint8_t dim = 0;
+            std::uint8_t mip_level = 0;
+            drivers::texture_format internal_format = drivers::texture_format::none;
+            drivers::texture_format data_format = drivers::texture_format::none;
+            drivers::texture_data_type data_type = drivers::texture_data_type::ubyte;
+            void *data = nullptr;
+            std::uint32_t dim_size = 0;
+            std::size_t pixels_per_line = 0;
+            drivers::handle *result = nullptr;
+
+            helper.pop(dim);
+            helper.pop(mip_level);
+            helper.pop(internal_format);
+            helper.pop(data_format);
+            helper.pop(data_type);
+            helper.pop(data);
+
+            // One size per dimension
+            for (std::uint8_t i = 0; i < dim; i++) {
+                helper.pop(dim_size);
+            }
+
+            helper.pop(pixels_per_line);
+            helper.pop(result);
+
+            *result = ++handle_counter_;
+            break;
+        }
+
+        case graphics_driver_create_buffer: {
+            std::size_t initial_size = 0;
+            buffer_hint hint = buffer_hint::none;
+            buffer_upload_hint upload_hint = buffer_upload_static;
+            drivers::handle *result = nullptr;
+
+            helper.pop(initial_size);
+            helper.pop(hint);
+            helper.pop(upload_hint);
+            helper.pop(result);
+
+            *result = ++handle_counter_;
+            break;
+        }
+
+        // Commands below own a copy of their data
+        case graphics_driver_update_bitmap: {
+            drivers::handle h = 0;
+            std::uint8_t *data = nullptr;
+
+            helper.pop(h);
+            helper.pop(data);
+
+            delete[] data;
+            break;
+        }
+
+        case graphics_driver_set_uniform: {
+            drivers::handle h = 0;
+            drivers::shader_set_var_type var_type;
+            std::uint8_t *data = nullptr;
+
+            helper.pop(h);
+            helper.pop(var_type);
+            helper.pop(data);
+
+            delete[] data;
+            break;
+        }
+
+        case graphics_driver_update_buffer: {
+            drivers::handle h = 0;
+            std::uint8_t *data = nullptr;
+
+            helper.pop(h);
+            helper.pop(data);
+
+            delete[] data;
+            break;
+        }
+
+        case graphics_driver_attach_descriptors: {
+            drivers::handle h = 0;
+            int stride = 0;
+            bool instance_move = false;
+            std::uint8_t *descriptors = nullptr;
+
+            helper.pop(h);
+            helper.pop(stride);
+            helper.pop(instance_move);
+            helper.pop(descriptors);
+
+            delete[] descriptors;
+            break;
+        }
+
+        case graphics_driver_display:
+            if (disp_hook_) {
+                disp_hook_();
+            }
+
+            break;
+
+        case graphics_driver_native_dialog: {
+            // Nothing to show it on, so the dialog is cancelled and the callback is never called
+            const char *filter = nullptr;
+            graphics_driver_dialog_callback *callback = nullptr;
+            bool is_folder = false;
+
+            helper.pop(filter);
+            helper.pop(callback);
+            helper.pop(is_folder);
+
+            break;
+        }
+
+        default:
+            break;
+        }
+
+        // Zero is success, and for a native dialog it means nothing was picked
+        finish(cmd, 0);
+    }
+
+    void null_graphics_driver::submit_command_list(graphics_command_list &command_list) {
+        command *cmd = static_cast<server_graphics_command_list &>(command_list).list_.first_;
+        command *next = nullptr;
+
+        while (cmd) {
+            dispatch(cmd);
+            next = cmd->next_;
+
+            delete cmd;
+            cmd = next;
+        }
+    }
+
+    void null_graphics_driver::run() {
+        std::unique_lock<std::mutex> ulock(mut_);
+        cond_.wait(ulock, [this]() { return should_stop_.load(); });
+    }
+
+    void null_graphics_driver::abort() {
+        should_stop_ = true;
+        wake_clients();
+    }
+}
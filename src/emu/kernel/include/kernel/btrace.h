@@ -19,8 +19,16 @@
 
 #pragma once
 
+#include <kernel/btrace_format.h>
 #include <vfs/vfs.h>
+
+#include <common/ring.h>
+#include <common/sync.h>
+
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <thread>
 
 namespace eka2l1 {
     class kernel_system;
@@ -35,12 +43,34 @@ namespace eka2l1::kernel {
         btrace_header_subcategory_index = 3
     };
 
+    /**
+     * \brief Capture BTrace records into a binary file.
+     * 
+     * Records are pushed into a lock-free ring by the emulator thread, and drained to the
+     * capture file by a background writer thread. When the ring is full, the record is dropped
+     * and counted. Once the ring has room again, a marker record with the dropped count is pushed
+     * ahead of the next record, so the marker sits at the point of the drop in the capture.
+     * 
+     * Use the btracedump tool to decode the capture.
+     */
     struct btrace {
         io_system *io_;
         kernel_system *kern_;
 
         symfile trace_;
 
+        std::unique_ptr<common::spsc_ring<btrace_record>> ring_;
+        std::unique_ptr<std::thread> writer_;
+        common::event writer_evt_;
+        std::atomic<bool> writer_stop_;
+
+        std::atomic<std::uint64_t> dropped_count_;
+        std::uint32_t dropped_pending_;     ///< Dropped records not yet marked in the ring. Owned by producer.
+
+        bool push_dropped_marker();
+        void writer_loop();
+        void drain(std::vector<btrace_record> &batch);
+
     public:
         explicit btrace(kernel_system *kern, io_system *io);
         ~btrace();
@@ -50,5 +80,9 @@ namespace eka2l1::kernel {
 
         bool out(const std::uint32_t a0, const std::uint32_t a1, const std::uint32_t a2,
             const std::uint32_t a3);
+
+        std::uint64_t dropped_count() const {
+            return dropped_count_.load();
+        }
     };
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace eka2l1::kernel {
+    // Binary capture layout. Kept free of dependencies so tools can include it.
+    static constexpr std::uint32_t BTRACE_CAPTURE_MAGIC = 0x52544245; // EBTR
+    static constexpr std::uint32_t BTRACE_CAPTURE_VERSION = 1;
+
+    // Thread ID used by records that the capture writer injects itself.
+    static constexpr std::uint32_t BTRACE_RECORD_DROPPED_THREAD_ID = 0xFFFFFFFF;
+
+    struct btrace_capture_header {
+        std::uint32_t magic_;
+        std::uint32_t version_;
+        std::uint32_t record_size_;
+        std::uint32_t reserved_;
+    };
+
+    /**
+     * \brief A trace record, as stored in the capture file.
+     * 
+     * If the thread ID is BTRACE_RECORD_DROPPED_THREAD_ID, a1 contains the number of
+     * records dropped since the last record.
+     */
+    struct btrace_record {
+        std::uint64_t timestamp_;       ///< Emulator time in microseconds.
+        std::uint32_t thread_id_;
+        std::uint32_t a0_;
+        std::uint32_t a1_;
+        std::uint32_t a2_;
+        std::uint32_t a3_;
+        std::uint32_t reserved_;
+    };
+
+    static_assert(sizeof(btrace_record) == 32, "BTrace record must be 32 bytes");
+}
@@ -161,6 +161,12 @@ namespace eka2l1 {
             const std::uint32_t top_offset() const;
 
             void *host_base();
+
+            /*! \brief Save or restore the chunk, together with its committed pages.
+             *
+             * The chunk must already be created with the attributes it was saved with.
+             */
+            void do_state(common::chunkyseri &seri) override;
         };
     }
 }
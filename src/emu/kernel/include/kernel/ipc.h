@@ -22,6 +22,7 @@
 
 #include <kernel/common.h>
 
+#include <common/linked.h>
 #include <mem/ptr.h>
 #include <memory>
 
@@ -108,6 +109,16 @@ namespace eka2l1 {
         std::uint32_t attrib = 0;
         kernel::handle thread_handle_low = 0;
 
+        // Link in the delivered queue of the server. Unlinked when not waiting for a receive.
+        common::double_linked_queue_element delivery_link;
+
+        // Slot in the owning session's message pool, -1 if the message is not from a pool.
+        std::int32_t pool_slot = -1;
+
+        // Next free slot in the owning session's pool, valid while this slot is free.
+        std::int32_t next_free_pool_slot = -1;
+        bool pool_slot_in_use = false;
+
         enum {
             MSG_ATTRIB_LOCK_FREE = 0x1
         };
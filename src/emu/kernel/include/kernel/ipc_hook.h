@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace eka2l1::kernel {
+    enum ipc_hook_point {
+        ipc_hook_point_send = 0,
+        ipc_hook_point_complete = 1,
+        ipc_hook_point_count = 2
+    };
+
+    /**
+     * \brief Tells which IPC messages someone has hooked, without taking any lock.
+     *
+     * Server names are interned into small IDs. Every (server, opcode) pair that is subscribed has its
+     * bit set in a per-server bitmap. While nothing at all is subscribed, checking a message is one load
+     * and one branch.
+     *
+     * Subscribing is rare (scripts do it while loading), so the table is copied on write. Old copies are
+     * kept until the filter is destroyed, so a reader never sees a freed table.
+     */
+    class ipc_hook_filter {
+    public:
+        static constexpr std::uint32_t INVALID_SERVER_ID = 0xFFFFFFFF;
+
+        // Opcodes outside of this range share one flag per server
+        static constexpr std::uint32_t OPCODE_BITMAP_SIZE = 256;
+
+    private:
+        struct server_subscription {
+            std::bitset<OPCODE_BITMAP_SIZE> opcodes_[ipc_hook_point_count];
+            bool others_[ipc_hook_point_count] = { false, false };
+        };
+
+        using subscription_table = std::vector<server_subscription>;
+
+        std::atomic<bool> active_[ipc_hook_point_count];
+        std::atomic<const subscription_table *> table_;
+
+        std::mutex write_lock_;
+        std::vector<std::unique_ptr<subscription_table>> tables_;
+        std::unordered_map<std::string, std::uint32_t> ids_;
+
+
+    public:
+        explicit ipc_hook_filter();
+
+        /**
+         * \brief Get the ID of a server name, giving it a new one if it has none yet.
+         */
+        std::uint32_t intern(const std::string &server_name);
+
+        /**
+         * \brief Mark messages with the given opcode, sent to the server with given name, as hooked.
+         *
+         * The server does not need to exist yet.
+         */
+        void subscribe(const std::string &server_name, const int opcode, const ipc_hook_point point);
+
+        /**
+         * \brief Check if anything at all is subscribed at the given point. This is the only check
+         *        messages pay for while no hook is around.
+         */
+        bool is_active(const ipc_hook_point point) const {
+            return active_[point].load(std::memory_order_relaxed);
+        }
+
+        /**
+         * \brief Check if a message has any hook subscribed to it.
+         *
+         * \param server_id     Interned ID of the server the message is for.
+         * \param opcode        Opcode of the message.
+         * \param point         When the hooks would be called.
+         */
+        bool is_hooked(const std::uint32_t server_id, const int opcode, const ipc_hook_point point) const;
+    };
+}
@@ -34,6 +34,7 @@
 #include <kernel/mutex.h>
 #include <kernel/object_ix.h>
 #include <kernel/process.h>
+#include <kernel/profiler.h>
 #include <kernel/scheduler.h>
 #include <kernel/sema.h>
 #include <kernel/timer.h>
@@ -49,6 +50,7 @@
 #include <common/wildcard.h>
 
 #include <kernel/ipc.h>
+#include <kernel/ipc_hook.h>
 #include <mem/ptr.h>
 
 #include <cpu/arm_analyser.h>
@@ -172,17 +174,21 @@ namespace eka2l1 {
 
     /**
      * @brief Callback invoked by the kernel when an IPC messages are bout to be sent.
+     *
+     * Only messages subscribed through the kernel's IPC hook filter reach this callback.
      * 
-     * @param server_name       Name of the server this message is sent to.
+     * @param svr               The server this message is sent to.
      * @param ord               The opcode number of this message.
      * @param args              Arguments for this message.
      * @param reqstsaddr        Address of the request status.
      * @param callee            Thread that sent this message.
      */
-    using ipc_send_callback = std::function<void(const std::string&, const int, const ipc_arg&, address, kernel::thread*)>;
+    using ipc_send_callback = std::function<void(service::server*, const int, const ipc_arg&, address, kernel::thread*)>;
 
     /**
      * @brief Callback invoked by the kernel when an IPC message completes.
+     *
+     * Only messages subscribed through the kernel's IPC hook filter reach this callback.
      * 
      * @param msg               Pointer to the message that being completed.
      * @param complete_code     The code that used to complete this message.
@@ -271,6 +277,7 @@ namespace eka2l1 {
         std::vector<kernel_obj_unq_ptr> sessions_;
         std::vector<kernel_obj_unq_ptr> props_;
         std::vector<kernel_obj_unq_ptr> prop_refs_;
+        std::unordered_map<std::uint64_t, property_ptr> prop_index_; ///< Properties by category and key.
         std::vector<kernel_obj_unq_ptr> chunks_;
         std::vector<kernel_obj_unq_ptr> mutexes_;
         std::vector<kernel_obj_unq_ptr> semas_;
@@ -284,6 +291,7 @@ namespace eka2l1 {
         std::vector<kernel_obj_unq_ptr> undertakers_;
 
         std::unique_ptr<kernel::btrace> btrace_inst_;
+        std::unique_ptr<kernel::profiler> profiler_;
         std::unique_ptr<hle::lib_manager> lib_mngr_;
         std::unique_ptr<kernel::thread_scheduler> thr_sch_;
 
@@ -312,6 +320,7 @@ namespace eka2l1 {
         std::unique_ptr<std::locale> locale_;
         chunk_ptr global_data_chunk_;
 
+        kernel::ipc_hook_filter ipc_hooks_;
         common::identity_container<ipc_send_callback> ipc_send_callbacks_;
         common::identity_container<ipc_complete_callback> ipc_complete_callbacks_;
         common::identity_container<thread_kill_callback> thread_kill_callbacks_;
@@ -332,6 +341,9 @@ namespace eka2l1 {
         std::uint32_t dll_global_data_last_offset_;
         
         std::uint64_t inactivity_starts_;
+
+        std::uint64_t svc_call_count_;  ///< Supervisor calls made by the guest since the last reset.
+        std::uint64_t ipc_send_count_;  ///< IPC messages sent by the guest since the last reset.
         kernel::process *nanokern_pr_;
 
         kernel::chunk *custom_code_chunk;
@@ -360,10 +372,28 @@ namespace eka2l1 {
 
         void cpu_exception_handler(arm::core *core, arm::exception_type exception_type, const std::uint32_t exception_data);
 
-        void call_ipc_send_callbacks(const std::string &server_name, const int ord, const ipc_arg &args,
+        void call_ipc_send_callbacks(service::server *svr, const int ord, const ipc_arg &args,
+            address reqsts_addr, kernel::thread *callee) {
+            // Most of the time nothing is hooked, so don't even make a call
+            if (ipc_hooks_.is_active(kernel::ipc_hook_point_send)) {
+                run_ipc_send_callbacks(svr, ord, args, reqsts_addr, callee);
+            }
+        }
+
+        void call_ipc_complete_callbacks(ipc_msg *msg, const int complete_code) {
+            if (ipc_hooks_.is_active(kernel::ipc_hook_point_complete)) {
+                run_ipc_complete_callbacks(msg, complete_code);
+            }
+        }
+
+        void run_ipc_send_callbacks(service::server *svr, const int ord, const ipc_arg &args,
             address reqsts_addr, kernel::thread *callee);
 
-        void call_ipc_complete_callbacks(ipc_msg *msg, const int complete_code);
+        void run_ipc_complete_callbacks(ipc_msg *msg, const int complete_code);
+
+        kernel::ipc_hook_filter &get_ipc_hooks() {
+            return ipc_hooks_;
+        }
         void call_thread_kill_callbacks(kernel::thread *target, const std::string &category, const std::int32_t reason);
         void call_process_switch_callbacks(arm::core *run_core, kernel::process *old, kernel::process *new_one);
         void run_codeseg_loaded_callback(const std::string &lib_name, kernel::process *attacher, codeseg_ptr target);
@@ -435,8 +465,11 @@ namespace eka2l1 {
         bool subscribe_prop(prop_ident_pair ident, int *request_sts);
         bool unsubscribe_prop(prop_ident_pair ident);
 
+        void index_prop(property_ptr prop);
+        void unindex_prop(property_ptr prop);
+
         property_ptr get_prop(int category, int key); // Get property by category and key
-        property_ptr delete_prop(int category, int key);
+        bool delete_prop(int category, int key);
 
         void complete_undertakers(kernel::thread *literally_dies);
 
@@ -513,6 +546,22 @@ namespace eka2l1 {
             return btrace_inst_.get();
         }
 
+        kernel::profiler *get_profiler() {
+            return profiler_.get();
+        }
+
+        std::uint64_t get_svc_call_count() const {
+            return svc_call_count_;
+        }
+
+        std::uint64_t get_ipc_send_count() const {
+            return ipc_send_count_;
+        }
+
+        void count_ipc_send() {
+            ipc_send_count_++;
+        }
+
         loader::rom *get_rom_info() {
             return rom_info_;
         }
@@ -669,7 +718,7 @@ namespace eka2l1 {
                 ADD_OBJECT_TO_CONTAINER(kernel::object_type::process, processes_, setup_new_process(reinterpret_cast<process_ptr>(obj.get())));
                 ADD_OBJECT_TO_CONTAINER(kernel::object_type::chunk, chunks_, )
                 ADD_OBJECT_TO_CONTAINER(kernel::object_type::server, servers_, )
-                ADD_OBJECT_TO_CONTAINER(kernel::object_type::prop, props_, )
+                ADD_OBJECT_TO_CONTAINER(kernel::object_type::prop, props_, index_prop(reinterpret_cast<property_ptr>(obj.get())))
                 ADD_OBJECT_TO_CONTAINER(kernel::object_type::prop_ref, prop_refs_, )
                 ADD_OBJECT_TO_CONTAINER(kernel::object_type::session, sessions_, )
                 ADD_OBJECT_TO_CONTAINER(kernel::object_type::library, libraries_, )
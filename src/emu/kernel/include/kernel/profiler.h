@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <kernel/common.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace eka2l1 {
+    class kernel_system;
+    class ntimer;
+
+    namespace arm {
+        class core;
+    }
+}
+
+namespace eka2l1::kernel {
+    class thread;
+    class process;
+
+    struct profiler_hot_function {
+        std::string name_;
+        std::uint64_t hits_;
+    };
+
+    struct profiler_process_report {
+        std::string name_;
+        std::uint64_t total_hits_;
+        std::vector<profiler_hot_function> functions_;
+    };
+
+    /**
+     * \brief Sampling profiler for guest code.
+     * 
+     * A periodic ntimer event marks a sample as pending and stops the CPU. The emulator thread then
+     * records the PC and LR of the running thread, grouped by its owning process.
+     * 
+     * Addresses are symbolized on report, using the codesegs loaded in the sampled process.
+     * A symbol is the nearest export at or below the address, so code that is not exported is
+     * attributed to the export preceding it.
+     * 
+     * Stacks are two frames deep (LR, PC). They are dumped in collapsed stack format,
+     * compatible with flamegraph.pl and speedscope.
+     */
+    class profiler {
+        struct process_samples {
+            std::string name_;
+            std::uint64_t total_hits_ = 0;
+            std::unordered_map<address, std::uint64_t> pc_hits_;
+            std::unordered_map<std::uint64_t, std::uint64_t> stack_hits_;
+        };
+
+        kernel_system *kern_;
+        ntimer *timing_;
+
+        int sample_evt_;
+        std::uint32_t interval_us_;
+
+        std::atomic<bool> running_;
+        std::atomic<bool> sample_pending_;
+
+        enum control_request {
+            control_request_none = 0,
+            control_request_start = 1,
+            control_request_stop = 2
+        };
+
+        std::atomic<int> control_request_;
+        std::atomic<std::uint32_t> requested_interval_us_;
+
+        std::mutex lock_;
+        std::unordered_map<kernel::uid, process_samples> samples_;
+
+        void on_sample_timer();
+
+        void start_sampling();
+        void stop_sampling();
+
+    public:
+        explicit profiler(kernel_system *kern, ntimer *timing);
+        ~profiler();
+
+        /**
+         * \brief Request sampling to start.
+         * 
+         * Safe to call from any thread. The request is applied by the emulator thread
+         * on its next call to handle_requests().
+         * 
+         * \param interval_us   Microseconds between two samples.
+         */
+        void start(const std::uint32_t interval_us = 1000);
+
+        /**
+         * \brief Request sampling to stop. Safe to call from any thread.
+         */
+        void stop();
+
+        /**
+         * \brief Apply a pending start or stop request. Must be called on the emulator thread.
+         */
+        void handle_requests();
+
+        /**
+         * \brief Discard all collected samples.
+         */
+        void reset();
+
+        bool is_running() const {
+            return running_;
+        }
+
+        /**
+         * \brief Check and clear the pending sample flag. Called by the emulator thread after a CPU run.
+         */
+        bool should_sample() {
+            return sample_pending_.exchange(false, std::memory_order_acq_rel);
+        }
+
+        /**
+         * \brief Record a sample of the running thread. Must be called on the emulator thread.
+         */
+        void sample(arm::core *cpu, kernel::thread *running);
+
+        /**
+         * \brief Build a symbolized report of the hottest functions for each sampled process.
+         * 
+         * The kernel lock must not be held by the caller.
+         * 
+         * \param max_functions     Maximum number of functions to report per process.
+         */
+        std::vector<profiler_process_report> report(const std::size_t max_functions = 50);
+
+        /**
+         * \brief Dump symbolized stacks in collapsed stack format.
+         * 
+         * The kernel lock must not be held by the caller.
+         * 
+         * \param path      Host path of the file to write.
+         * \returns True on success.
+         */
+        bool dump_collapsed_stacks(const std::string &path);
+    };
+}
@@ -20,14 +20,17 @@
 
 #pragma once
 
-#include <common/queue.h>
+#include <common/linked.h>
 
 #include <kernel/kernel_obj.h>
 #include <mem/ptr.h>
 #include <utils/reqsts.h>
 
 #include <array>
+#include <cstring>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <vector>
 
 namespace eka2l1 {
@@ -38,6 +41,8 @@ namespace eka2l1 {
     using thread_ptr = kernel::thread *;
 
     namespace service {
+        struct property_reference;
+
         enum class property_type {
             int_data,
             bin_data,
@@ -50,6 +55,8 @@ namespace eka2l1 {
 		 * integer or binary data. Properties are stored in the kernel until shutdown,
 		 * and they are the way of ITC (Inter-Thread communication).
  		 *
+		 * The category and key are given at creation and must not change afterwards,
+		 * since the kernel indexes properties by them.
 		*/
         class property : public kernel::kernel_obj, public std::pair<int, int> {
         public:
@@ -63,7 +70,8 @@ namespace eka2l1 {
 
             service::property_type data_type;
 
-            threadsafe_cn_queue<epoc::notify_info *> subscription_queue;
+            std::mutex subscription_lock;
+            common::roundabout subscriptions;
 
             using data_change_callback = std::pair<void *, data_change_callback_handler>;
             std::vector<data_change_callback> data_change_callbacks;
@@ -71,7 +79,8 @@ namespace eka2l1 {
             void fire_data_change_callbacks();
 
         public:
-            explicit property(kernel_system *kern);
+            explicit property(kernel_system *kern, const int category, const int key);
+            ~property() override;
 
             /**
              * \brief Add a callback that gets waken up when data changed.
@@ -82,6 +91,11 @@ namespace eka2l1 {
 
             void define(service::property_type pt, uint32_t pre_allocated);
 
+            /**
+             * \brief Drop the definition and the data, as when the property is deleted.
+             */
+            void undefine();
+
             bool is_defined();
 
             /**
@@ -115,22 +129,40 @@ namespace eka2l1 {
             int get_int();
             std::vector<uint8_t> get_bin();
 
+            /**
+             * \brief Copy the binary data straight to a buffer.
+             *
+             * \param dest      The buffer to copy to.
+             * \param dest_size Size of the buffer. Data longer than this is truncated.
+             *
+             * \returns Size of the whole binary data, which may be bigger than what was copied.
+             */
+            std::uint32_t read_bin(std::uint8_t *dest, const std::uint32_t dest_size);
+
             template <typename T>
             std::optional<T> get_pkg() {
-                auto bin = get_bin();
-
-                if (bin.size() != sizeof(T)) {
+                if (data_len != sizeof(T)) {
                     return std::optional<T>{};
                 }
 
                 T ret;
-                memcpy(&ret, bin.data(), bin.size());
+                std::memcpy(&ret, bindata.data(), sizeof(T));
 
                 return ret;
             }
 
-            void subscribe(epoc::notify_info &info);
-            bool cancel(const epoc::notify_info &info);
+            void subscribe(property_reference *ref);
+
+            /**
+             * \brief Cancel a subscription, completing its request with cancel error.
+             * \returns True if the reference was subscribed.
+             */
+            bool cancel(property_reference *ref);
+
+            /**
+             * \brief Drop a subscription without completing its request.
+             */
+            void unsubscribe(property_reference *ref);
 
             /*! \brief Notify the request that there is data change */
             void notify_request(const std::int32_t err);
@@ -140,8 +172,11 @@ namespace eka2l1 {
             property *prop_;
             epoc::notify_info nof_;
 
+            common::double_linked_queue_element subscription_link;
+
         public:
             explicit property_reference(kernel_system *kern, property *prop);
+            ~property_reference() override;
 
             /**
              * \brief       Get the property kernel object.
@@ -23,6 +23,8 @@
 #include <kernel/kernel_obj.h>
 #include <kernel/session.h>
 
+#include <common/linked.h>
+
 #include <utils/reqsts.h>
 
 #include <functional>
@@ -103,8 +105,8 @@ namespace eka2l1 {
             /** All the sessions connected to this server */
             std::vector<session *> sessions;
 
-            /** Messages that has been delivered but not accepted yet */
-            std::vector<server_msg> delivered_msgs;
+            /** Messages that has been delivered but not accepted yet, oldest first. Linked through ipc_msg::delivery_link */
+            common::roundabout delivered_msgs;
 
             /** The thread own this server */
             //thread_ptr owning_thread;
@@ -126,6 +128,9 @@ namespace eka2l1 {
             bool hle = false;
             bool unhandle_callback_enable = false;
 
+            /** Interned name, for checking IPC hooks without comparing strings */
+            std::uint32_t hook_id;
+
         protected:
             bool is_msg_delivered(ipc_msg_ptr &msg);
             bool ready();
@@ -181,6 +186,12 @@ namespace eka2l1 {
             bool is_hle() const {
                 return hle;
             }
+
+            std::uint32_t get_hook_id() const {
+                return hook_id;
+            }
+
+            void rename(const std::string &new_name) override;
         };
     }
 }
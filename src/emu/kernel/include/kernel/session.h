@@ -50,7 +50,10 @@ namespace eka2l1 {
         class session : public kernel::kernel_obj {
             server_ptr svr;
 
-            std::vector<std::pair<bool, ipc_msg_ptr>> msgs_pool;
+            std::vector<ipc_msg_ptr> msgs_pool;
+
+            // Head of the free slot list, threaded through ipc_msg::next_free_pool_slot. -1 when all slots are in use.
+            std::int32_t free_slot_head;
 
             kernel::address cookie_address;
             kernel::handle associated_handle;
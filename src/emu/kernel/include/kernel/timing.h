@@ -47,6 +47,7 @@ namespace eka2l1 {
     struct event_type {
         timed_callback callback;
         std::string name;
+        bool restorable; ///< User data is a plain value, not a host pointer.
     };
 
     struct event {
@@ -74,6 +75,7 @@ namespace eka2l1 {
 
         std::unique_ptr<common::teletimer> teletimer_;
         std::unique_ptr<std::thread> timer_thread_; ///< Timer thread to executes callbacks
+        common::manual_teletimer *manual_clock_;    ///< Non-null if the owner drives time, no timer thread then.
 
         std::vector<event_type> event_types_;
         std::uint32_t CPU_HZ_;
@@ -89,7 +91,14 @@ namespace eka2l1 {
         void wipeout();
 
     public:
-        explicit ntimer(const std::uint32_t cpu_hz);
+        /**
+         * @brief Construct the timer.
+         *
+         * @param cpu_hz        Frequency of the emulated CPU.
+         * @param manual_clock  If true, time only moves through advance_clock, and events are run
+         *                      on the thread calling it.
+         */
+        explicit ntimer(const std::uint32_t cpu_hz, const bool manual_clock = false);
         ~ntimer();
 
         void reset();
@@ -146,7 +155,32 @@ namespace eka2l1 {
          */
         std::optional<std::uint64_t> advance();
 
-        int register_event(const std::string &name, timed_callback callback);
+        /**
+         * @brief       Move a manual clock forward and run the events that are due.
+         *
+         * Does nothing if the timer follows the host clock.
+         *
+         * @param       microsecs Microseconds to move the clock.
+         * @returns     Microseconds to next timer.
+         */
+        std::optional<std::uint64_t> advance_clock(const std::uint64_t microsecs);
+
+        bool is_manual_clock() const {
+            return manual_clock_ != nullptr;
+        }
+
+        /**
+         * @brief       Register a type of event.
+         *
+         * @param       name        Name of the type, used to match saved events back to it.
+         * @param       callback    Callback run when an event of this type is due.
+         * @param       restorable  True if the user data of the events is a plain value, which still means the
+         *                          same after restoring a snapshot. Events whose user data points to host objects
+         *                          are not saved.
+         *
+         * @returns     Index of the event type.
+         */
+        int register_event(const std::string &name, timed_callback callback, const bool restorable = false);
         int get_register_event(const std::string &name);
         void unregister_all_events();
         void remove_event(int event_type);
@@ -161,6 +195,15 @@ namespace eka2l1 {
         realtime_level get_realtime_level() const {
             return acc_level_;
         }
+
+        /**
+         * @brief       Save or restore the scheduled events.
+         *
+         * Events are stored relative to the current time, and matched back to their type by name.
+         * Their types must be registered before restoring. Only events of restorable types are saved,
+         * and their user data is kept as it is.
+         */
+        void do_state(common::chunkyseri &seri);
     };
 
     realtime_level get_realtime_level_from_string(const char *c);
@@ -1,11 +1,24 @@
 #include <common/log.h>
+#include <common/thread.h>
+
 #include <kernel/btrace.h>
+#include <kernel/kernel.h>
+#include <kernel/thread.h>
+#include <kernel/timing.h>
 
 namespace eka2l1::kernel {
+    // 64k records, 2MB of trace in flight
+    static constexpr std::size_t BTRACE_RING_CAPACITY = 1 << 16;
+    static constexpr std::size_t BTRACE_WRITE_BATCH_COUNT = 4096;
+    static constexpr std::uint64_t BTRACE_WRITER_WAKE_US = 10000;
+
     btrace::btrace(kernel_system *kern, io_system *io)
         : io_(io)
         , kern_(kern)
-        , trace_(nullptr) {
+        , trace_(nullptr)
+        , writer_stop_(false)
+        , dropped_count_(0)
+        , dropped_pending_(0) {
     }
 
     btrace::~btrace() {
@@ -17,8 +30,30 @@ namespace eka2l1::kernel {
             return false;
         }
 
-        trace_ = io_->open_file(trace_path, WRITE_MODE);
-        return (trace_ != nullptr);
+        trace_ = io_->open_file(trace_path, WRITE_MODE | BIN_MODE);
+
+        if (!trace_) {
+            return false;
+        }
+
+        btrace_capture_header header;
+        header.magic_ = BTRACE_CAPTURE_MAGIC;
+        header.version_ = BTRACE_CAPTURE_VERSION;
+        header.record_size_ = sizeof(btrace_record);
+        header.reserved_ = 0;
+
+        trace_->write_file(&header, sizeof(btrace_capture_header), 1);
+
+        if (!ring_) {
+            ring_ = std::make_unique<common::spsc_ring<btrace_record>>(BTRACE_RING_CAPACITY);
+        }
+
+        dropped_count_ = 0;
+        dropped_pending_ = 0;
+        writer_stop_ = false;
+
+        writer_ = std::make_unique<std::thread>([this]() { writer_loop(); });
+        return true;
     }
 
     bool btrace::close_trace_session() {
@@ -26,10 +61,80 @@ namespace eka2l1::kernel {
             return false;
         }
 
-        return trace_->close();
+        writer_stop_ = true;
+        writer_evt_.set();
+
+        if (writer_ && writer_->joinable()) {
+            writer_->join();
+        }
+
+        writer_.reset();
+
+        if (dropped_pending_ != 0) {
+            // The writer is gone, records dropped at the end of the session go straight to the capture
+            btrace_record marker{};
+            marker.timestamp_ = kern_->get_ntimer()->microseconds();
+            marker.thread_id_ = BTRACE_RECORD_DROPPED_THREAD_ID;
+            marker.a1_ = dropped_pending_;
+
+            trace_->write_file(&marker, sizeof(btrace_record), 1);
+            dropped_pending_ = 0;
+        }
+
+        if (dropped_count_ != 0) {
+            LOG_WARN(KERNEL, "BTrace capture dropped {} records due to buffer overflow", dropped_count_.load());
+        }
+
+        const bool result = trace_->close();
+        trace_.reset();
+
+        return result;
     }
 
-    static const std::u16string DEFAULT_TRACE_FILE = u"c:\\btrace.txt";
+    bool btrace::push_dropped_marker() {
+        // Mark the hole in the capture, after the records that made it into the ring before the drop
+        btrace_record marker{};
+        marker.timestamp_ = kern_->get_ntimer()->microseconds();
+        marker.thread_id_ = BTRACE_RECORD_DROPPED_THREAD_ID;
+        marker.a1_ = dropped_pending_;
+
+        if (!ring_->push(marker)) {
+            return false;
+        }
+
+        dropped_pending_ = 0;
+        return true;
+    }
+
+    void btrace::drain(std::vector<btrace_record> &batch) {
+        while (true) {
+            const std::size_t count = ring_->pop_bulk(batch.data(), batch.size());
+
+            if (count == 0) {
+                break;
+            }
+
+            trace_->write_file(batch.data(), static_cast<std::uint32_t>(sizeof(btrace_record)),
+                static_cast<std::uint32_t>(count));
+        }
+    }
+
+    void btrace::writer_loop() {
+        common::set_thread_name("BTrace writer thread");
+        std::vector<btrace_record> batch(BTRACE_WRITE_BATCH_COUNT);
+
+        while (!writer_stop_) {
+            writer_evt_.wait_for(BTRACE_WRITER_WAKE_US);
+            writer_evt_.reset();
+
+            drain(batch);
+        }
+
+        drain(batch);
+        trace_->flush();
+    }
+
+    static const std::u16string DEFAULT_TRACE_FILE = u"c:\\btrace.bin";
 
     bool btrace::out(const std::uint32_t a0, const std::uint32_t a1, const std::uint32_t a2,
         const std::uint32_t a3) {
@@ -37,25 +142,27 @@ namespace eka2l1::kernel {
             return false;
         }
 
-        // Check out the header
-        const std::uint32_t args_size = (a0 >> (btrace_header_size_index * 8)) & 0xFF;
-        const std::uint32_t flags = (a0 >> (btrace_header_flag_index * 8)) & 0xFF;
-        const std::uint32_t category = (a0 >> (btrace_header_category_index * 8)) & 0xFF;
-        const std::uint32_t subcategory = (a0 >> (btrace_header_subcategory_index * 8)) & 0xFF;
+        btrace_record record;
+        record.timestamp_ = kern_->get_ntimer()->microseconds();
 
-        if (trace_) {
-            std::string message = "Trace out (data size = {}, flags = {}, category = {}, subcategory = {}):\n"
-                                  "\ta1 = 0x{:X}\n"
-                                  "\ta2 = 0x{:X}\n"
-                                  "\ta3 = 0x{:X}\n"
-                                  "\n";
+        kernel::thread *crr = kern_->crr_thread();
+        record.thread_id_ = crr ? static_cast<std::uint32_t>(crr->unique_id()) : 0;
+        record.a0_ = a0;
+        record.a1_ = a1;
+        record.a2_ = a2;
+        record.a3_ = a3;
+        record.reserved_ = 0;
 
-            message = fmt::format(message, args_size, flags, category, subcategory, a1, a2, a3);
-            trace_->write_file(&message[0], static_cast<std::uint32_t>(message.size()), 1);
+        if (((dropped_pending_ != 0) && !push_dropped_marker()) || !ring_->push(record)) {
+            dropped_pending_++;
+            dropped_count_.fetch_add(1, std::memory_order_relaxed);
+        }
 
-            trace_->flush();
+        if (ring_->size() >= (ring_->capacity() >> 1)) {
+            // Wake the writer early
+            writer_evt_.set();
         }
 
         return true;
     }
-}
\ No newline at end of file
+}
@@ -213,5 +213,18 @@ namespace eka2l1 {
         void *chunk::host_base() {
             return mmc_impl_->host_base();
         }
+
+        void chunk::do_state(common::chunkyseri &seri) {
+            kernel_obj::do_state(seri);
+
+            auto s = seri.section("Chunk", 1);
+
+            if (!s) {
+                return;
+            }
+
+            seri.absorb(is_heap);
+            mmc_impl_->do_state(seri);
+        }
     }
 }
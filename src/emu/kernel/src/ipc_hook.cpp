@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <kernel/ipc_hook.h>
+
+namespace eka2l1::kernel {
+    ipc_hook_filter::ipc_hook_filter()
+        : table_(nullptr) {
+        for (int i = 0; i < ipc_hook_point_count; i++) {
+            active_[i] = false;
+        }
+    }
+
+    std::uint32_t ipc_hook_filter::intern(const std::string &server_name) {
+        const std::lock_guard<std::mutex> guard(write_lock_);
+        auto ite = ids_.find(server_name);
+
+        if (ite != ids_.end()) {
+            return ite->second;
+        }
+
+        const std::uint32_t new_id = static_cast<std::uint32_t>(ids_.size());
+        ids_.emplace(server_name, new_id);
+
+        return new_id;
+    }
+
+    void ipc_hook_filter::subscribe(const std::string &server_name, const int opcode, const ipc_hook_point point) {
+        const std::uint32_t server_id = intern(server_name);
+        const std::lock_guard<std::mutex> guard(write_lock_);
+
+        const subscription_table *current = table_.load(std::memory_order_relaxed);
+        auto new_table = current ? std::make_unique<subscription_table>(*current) : std::make_unique<subscription_table>();
+
+        if (new_table->size() <= server_id) {
+            new_table->resize(server_id + 1);
+        }
+
+        server_subscription &subscription = (*new_table)[server_id];
+
+        if ((opcode >= 0) && (static_cast<std::uint32_t>(opcode) < OPCODE_BITMAP_SIZE)) {
+            subscription.opcodes_[point].set(opcode);
+        } else {
+            subscription.others_[point] = true;
+        }
+
+        table_.store(new_table.get(), std::memory_order_release);
+        tables_.push_back(std::move(new_table));
+
+        active_[point].store(true, std::memory_order_release);
+    }
+
+    bool ipc_hook_filter::is_hooked(const std::uint32_t server_id, const int opcode, const ipc_hook_point point) const {
+        if (!is_active(point)) {
+            return false;
+        }
+
+        const subscription_table *table = table_.load(std::memory_order_acquire);
+
+        if (!table || (server_id >= table->size())) {
+            return false;
+        }
+
+        const server_subscription &subscription = (*table)[server_id];
+
+        if ((opcode >= 0) && (static_cast<std::uint32_t>(opcode) < OPCODE_BITMAP_SIZE)) {
+            return subscription.opcodes_[point].test(opcode);
+        }
+
+        return subscription.others_[point];
+    }
+}
@@ -64,6 +64,7 @@ namespace eka2l1 {
     kernel_system::kernel_system(system *esys, ntimer *timing, io_system *io_sys,
         config::state *old_conf, config::app_settings *settings, loader::rom *rom_info, arm::core *cpu, disasm *disassembler)
         : btrace_inst_(nullptr)
+        , profiler_(nullptr)
         , lib_mngr_(nullptr)
         , thr_sch_(nullptr)
         , timing_(timing)
@@ -84,6 +85,8 @@ namespace eka2l1 {
         , dll_global_data_chunk_(nullptr)
         , dll_global_data_last_offset_(0)
         , inactivity_starts_(0)
+        , svc_call_count_(0)
+        , ipc_send_count_(0)
         , nanokern_pr_(nullptr)
         , custom_code_chunk(nullptr) {
         reset();
@@ -117,6 +120,7 @@ namespace eka2l1 {
         OBJECT_CONTAINER_CLEANUP(change_notifiers_);
         OBJECT_CONTAINER_CLEANUP(undertakers_);
         OBJECT_CONTAINER_CLEANUP(props_);
+        prop_index_.clear();
         OBJECT_CONTAINER_CLEANUP(prop_refs_);
         OBJECT_CONTAINER_CLEANUP(chunks_);
         OBJECT_CONTAINER_CLEANUP(threads_);
@@ -129,16 +133,24 @@ namespace eka2l1 {
 
         if (btrace_inst_)
             btrace_inst_->close_trace_session();
+
+        profiler_.reset();
     }
 
     void kernel_system::reset() {
         wipeout();
 
+        svc_call_count_ = 0;
+        ipc_send_count_ = 0;
+
         thr_sch_ = std::make_unique<kernel::thread_scheduler>(this, timing_, cpu_);
 
         // Instantiate btrace
         btrace_inst_ = std::make_unique<kernel::btrace>(this, io_);
 
+        // Instantiate guest profiler
+        profiler_ = std::make_unique<kernel::profiler>(this, timing_);
+
         // Create real time IPC event
         realtime_ipc_signal_evt_ = timing_->register_event("RealTimeIpc", [this](std::uint64_t userdata, std::uint64_t cycles_late) {
             kernel::thread *thr = get_by_id<kernel::thread>(static_cast<kernel::uid>(userdata));
@@ -414,6 +426,7 @@ namespace eka2l1 {
 
         // Set CPU SVC handler
         cpu_->system_call_handler = [this](const std::uint32_t ordinal) {
+            svc_call_count_++;
             get_lib_manager()->call_svc(ordinal);
 
             // EKA1 does not use BX LR to jump back, they let kernel do it
@@ -476,14 +489,23 @@ namespace eka2l1 {
         get_cpu()->stop();
     }
 
-    void kernel_system::call_ipc_send_callbacks(const std::string &server_name, const int ord, const ipc_arg &args,
+    void kernel_system::run_ipc_send_callbacks(service::server *svr, const int ord, const ipc_arg &args,
         address reqsts_addr, kernel::thread *callee) {
+        if (!ipc_hooks_.is_hooked(svr->get_hook_id(), ord, kernel::ipc_hook_point_send)) {
+            return;
+        }
+
         for (auto &ipc_send_callback_func: ipc_send_callbacks_) {
-            ipc_send_callback_func(server_name, ord, args, reqsts_addr, callee);
+            ipc_send_callback_func(svr, ord, args, reqsts_addr, callee);
         }
     }
 
-    void kernel_system::call_ipc_complete_callbacks(ipc_msg *msg, const int complete_code) {
+    void kernel_system::run_ipc_complete_callbacks(ipc_msg *msg, const int complete_code) {
+        if (!msg->msg_session || !ipc_hooks_.is_hooked(msg->msg_session->get_server()->get_hook_id(), msg->function,
+            kernel::ipc_hook_point_complete)) {
+            return;
+        }
+
         for (auto &ipc_complete_callback_func: ipc_complete_callbacks_) {
             ipc_complete_callback_func(msg, complete_code);
         }
@@ -631,6 +653,10 @@ namespace eka2l1 {
     }
 
     bool kernel_system::destroy(kernel_obj_ptr obj) {
+        if (obj->get_object_type() == kernel::object_type::prop) {
+            unindex_prop(reinterpret_cast<property_ptr>(obj));
+        }
+
         switch (obj->get_object_type()) {
 #define OBJECT_SEARCH(obj_type, obj_map)                                                                         \
     case kernel::object_type::obj_type: {                                                                        \
@@ -842,46 +868,63 @@ namespace eka2l1 {
 
     /*! \brief Completely destroy a message. */
     void kernel_system::destroy_msg(ipc_msg_ptr msg) {
+        // Don't leave a dangling link in a server's delivered queue
+        msg->delivery_link.deque();
         (msgs_.begin() + msg->id)->reset();
     }
 
-    property_ptr kernel_system::get_prop(int category, int key) {
-        auto prop_res = std::find_if(props_.begin(), props_.end(),
-            [=](const auto &prop_obj) {
-                property_ptr prop = reinterpret_cast<property_ptr>(prop_obj.get());
-                if (prop->first == category && prop->second == key) {
-                    return true;
-                }
+    static std::uint64_t make_prop_index_key(const int category, const int key) {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(category)) << 32) | static_cast<std::uint32_t>(key);
+    }
 
-                return false;
-            });
+    void kernel_system::index_prop(property_ptr prop) {
+        // On duplicates, the first defined one stays visible
+        prop_index_.emplace(make_prop_index_key(prop->first, prop->second), prop);
+    }
 
-        if (prop_res == props_.end()) {
-            return property_ptr(nullptr);
+    void kernel_system::unindex_prop(property_ptr prop) {
+        auto ite = prop_index_.find(make_prop_index_key(prop->first, prop->second));
+
+        if ((ite == prop_index_.end()) || (ite->second != prop)) {
+            return;
         }
 
-        return reinterpret_cast<property_ptr>(prop_res->get());
-    }
+        const std::uint64_t index_key = ite->first;
+        prop_index_.erase(ite);
 
-    property_ptr kernel_system::delete_prop(int category, int key) {
-        auto prop_res = std::find_if(props_.begin(), props_.end(),
-            [=](const auto &prop_obj) {
-                property_ptr prop = reinterpret_cast<property_ptr>(prop_obj.get());
-                if (prop->first == category && prop->second == key) {
-                    return true;
-                }
+        // Let an older duplicate take the place, if there is any
+        for (auto &prop_obj : props_) {
+            property_ptr other = reinterpret_cast<property_ptr>(prop_obj.get());
 
-                return false;
-            });
+            if ((other != prop) && (other->first == prop->first) && (other->second == prop->second)) {
+                prop_index_.emplace(index_key, other);
+                break;
+            }
+        }
+    }
+
+    property_ptr kernel_system::get_prop(int category, int key) {
+        auto ite = prop_index_.find(make_prop_index_key(category, key));
 
-        if (prop_res == props_.end()) {
+        if (ite == prop_index_.end()) {
             return property_ptr(nullptr);
         }
 
-        property_ptr prop_ptr = reinterpret_cast<property_ptr>(prop_res->get());
-        props_.erase(prop_res);
+        return ite->second;
+    }
+
+    bool kernel_system::delete_prop(int category, int key) {
+        property_ptr prop = get_prop(category, key);
 
-        return prop_ptr;
+        if (!prop || !prop->is_defined()) {
+            return false;
+        }
+
+        // References attached to it keep the object alive, and see it as not found from now on
+        prop->undefine();
+        unindex_prop(prop);
+
+        return true;
     }
 
     kernel::handle kernel_system::mirror(kernel::thread *own_thread, kernel::handle handle, kernel::owner_type owner) {
@@ -1225,6 +1268,16 @@ namespace eka2l1 {
         if (!s) {
             return;
         }
+
+        // Keep the home time going on from where it was saved
+        std::uint64_t saved_home_time = home_time();
+        seri.absorb(saved_home_time);
+
+        if (seri.get_seri_mode() == common::SERI_MODE_READ) {
+            base_time_ = saved_home_time - timing_->microseconds();
+        }
+
+        timing_->do_state(seri);
     }
 
     std::uint64_t kernel_system::home_time() {
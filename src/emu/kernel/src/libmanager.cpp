@@ -363,6 +363,12 @@ namespace eka2l1::hle {
                 const std::string original_map_name = eka2l1::replace_extension(eka2l1::filename(entry.name), "");
                 const std::string patch_map_path = eka2l1::add_path(patch_folder, entry.name);
 
+                // The user heap patch changes how every process allocates, keep it opt-in
+                if (!kern_->get_config()->hle_user_heap && (common::compare_ignore_case(original_map_name.c_str(), "euser.dll") == 0)) {
+                    LOG_TRACE(KERNEL, "HLE user heap is disabled, skipping patch map {}", entry.name);
+                    continue;
+                }
+
                 epocver start_ver = kern_->get_epoc_version();
 
                 std::string patch_dll_map;
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kernel/codeseg.h>
+#include <kernel/kernel.h>
+#include <kernel/process.h>
+#include <kernel/profiler.h>
+#include <kernel/thread.h>
+#include <kernel/timing.h>
+
+#include <cpu/arm_interface.h>
+
+#include <common/cvt.h>
+#include <common/log.h>
+#include <common/path.h>
+
+#include <algorithm>
+#include <fstream>
+
+namespace eka2l1::kernel {
+    /**
+     * \brief Map addresses of a process to symbol names, using the loaded codesegs.
+     */
+    class profiler_symbolizer {
+        struct module_range {
+            address start_;
+            address end_;
+            std::string name_;
+            std::vector<std::pair<address, std::uint32_t>> exports_;   ///< Sorted (address, ordinal)
+        };
+
+        std::vector<module_range> modules_;
+
+    public:
+        explicit profiler_symbolizer(kernel_system *kern, kernel::process *pr) {
+            if (!pr) {
+                return;
+            }
+
+            for (auto &cs_obj : kern->get_codeseg_list()) {
+                codeseg_ptr cs = reinterpret_cast<codeseg_ptr>(cs_obj.get());
+                const address base = cs->get_code_run_addr(pr);
+
+                if (!base) {
+                    continue;
+                }
+
+                module_range range;
+                range.start_ = base;
+                range.end_ = base + cs->get_text_size();
+                range.name_ = common::ucs2_to_utf8(eka2l1::filename(cs->get_full_path(), true));
+
+                if (range.name_.empty()) {
+                    range.name_ = cs->name();
+                }
+
+                const std::vector<std::uint32_t> exports = cs->get_export_table(pr);
+
+                for (std::size_t i = 0; i < exports.size(); i++) {
+                    // Clear the thumb bit
+                    const address export_addr = exports[i] & ~1;
+
+                    if ((export_addr >= range.start_) && (export_addr < range.end_)) {
+                        range.exports_.emplace_back(export_addr, static_cast<std::uint32_t>(i + 1));
+                    }
+                }
+
+                std::sort(range.exports_.begin(), range.exports_.end());
+                modules_.push_back(std::move(range));
+            }
+
+            std::sort(modules_.begin(), modules_.end(), [](const module_range &lhs, const module_range &rhs) {
+                return lhs.start_ < rhs.start_;
+            });
+        }
+
+        std::string symbolize(const address addr) const {
+            auto module_ite = std::upper_bound(modules_.begin(), modules_.end(), addr, [](const address val, const module_range &range) {
+                return val < range.start_;
+            });
+
+            if (module_ite == modules_.begin()) {
+                return fmt::format("0x{:08X}", addr);
+            }
+
+            module_ite--;
+
+            if (addr >= module_ite->end_) {
+                return fmt::format("0x{:08X}", addr);
+            }
+
+            auto export_ite = std::upper_bound(module_ite->exports_.begin(), module_ite->exports_.end(),
+                std::make_pair(addr, 0xFFFFFFFFU));
+
+            if (export_ite == module_ite->exports_.begin()) {
+                return fmt::format("{}!0x{:X}", module_ite->name_, addr - module_ite->start_);
+            }
+
+            export_ite--;
+            return fmt::format("{}!#{}", module_ite->name_, export_ite->second);
+        }
+    };
+
+    profiler::profiler(kernel_system *kern, ntimer *timing)
+        : kern_(kern)
+        , timing_(timing)
+        , sample_evt_(-1)
+        , interval_us_(1000)
+        , running_(false)
+        , sample_pending_(false)
+        , control_request_(control_request_none)
+        , requested_interval_us_(1000) {
+    }
+
+    profiler::~profiler() {
+        stop_sampling();
+    }
+
+    void profiler::on_sample_timer() {
+        if (!running_) {
+            return;
+        }
+
+        sample_pending_ = true;
+
+        // Bring the CPU out of JIT code, so the sample is taken at the current location.
+        kern_->get_cpu()->stop();
+        timing_->schedule_event(interval_us_, sample_evt_, 0);
+    }
+
+    void profiler::start(const std::uint32_t interval_us) {
+        requested_interval_us_ = std::max<std::uint32_t>(interval_us, 100);
+        control_request_ = control_request_start;
+    }
+
+    void profiler::stop() {
+        control_request_ = control_request_stop;
+    }
+
+    void profiler::handle_requests() {
+        switch (control_request_.exchange(control_request_none, std::memory_order_acq_rel)) {
+        case control_request_start:
+            start_sampling();
+            break;
+
+        case control_request_stop:
+            stop_sampling();
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    void profiler::start_sampling() {
+        if (running_) {
+            return;
+        }
+
+        if (sample_evt_ < 0) {
+            sample_evt_ = timing_->register_event("GuestProfilerSample", [this](std::uint64_t, int) {
+                on_sample_timer();
+            });
+        }
+
+        interval_us_ = requested_interval_us_;
+        running_ = true;
+
+        timing_->schedule_event(interval_us_, sample_evt_, 0);
+    }
+
+    void profiler::stop_sampling() {
+        if (!running_) {
+            return;
+        }
+
+        running_ = false;
+        sample_pending_ = false;
+
+        timing_->unschedule_event(sample_evt_, 0);
+    }
+
+    void profiler::reset() {
+        const std::lock_guard<std::mutex> guard(lock_);
+        samples_.clear();
+    }
+
+    void profiler::sample(arm::core *cpu, kernel::thread *running) {
+        if (!running || !running_) {
+            return;
+        }
+
+        kernel::process *pr = running->owning_process();
+
+        if (!pr) {
+            return;
+        }
+
+        const address pc = cpu->get_pc();
+        const address lr = cpu->get_lr() & ~1;
+
+        const std::lock_guard<std::mutex> guard(lock_);
+        process_samples &proc_samples = samples_[pr->unique_id()];
+
+        if (proc_samples.name_.empty()) {
+            proc_samples.name_ = pr->name();
+        }
+
+        proc_samples.total_hits_++;
+        proc_samples.pc_hits_[pc]++;
+        proc_samples.stack_hits_[(static_cast<std::uint64_t>(lr) << 32) | pc]++;
+    }
+
+    std::vector<profiler_process_report> profiler::report(const std::size_t max_functions) {
+        std::vector<profiler_process_report> reports;
+        const std::lock_guard<std::mutex> guard(lock_);
+
+        kern_->lock();
+
+        for (auto &[process_id, proc_samples] : samples_) {
+            profiler_symbolizer symbolizer(kern_, kern_->get_by_id<kernel::process>(process_id));
+            std::unordered_map<std::string, std::uint64_t> function_hits;
+
+            for (auto &[pc, hits] : proc_samples.pc_hits_) {
+                function_hits[symbolizer.symbolize(pc)] += hits;
+            }
+
+            profiler_process_report proc_report;
+            proc_report.name_ = proc_samples.name_;
+            proc_report.total_hits_ = proc_samples.total_hits_;
+
+            for (auto &[name, hits] : function_hits) {
+                proc_report.functions_.push_back({ name, hits });
+            }
+
+            std::sort(proc_report.functions_.begin(), proc_report.functions_.end(), [](const profiler_hot_function &lhs,
+                const profiler_hot_function &rhs) {
+                return lhs.hits_ > rhs.hits_;
+            });
+
+            if (proc_report.functions_.size() > max_functions) {
+                proc_report.functions_.resize(max_functions);
+            }
+
+            reports.push_back(std::move(proc_report));
+        }
+
+        kern_->unlock();
+
+        std::sort(reports.begin(), reports.end(), [](const profiler_process_report &lhs, const profiler_process_report &rhs) {
+            return lhs.total_hits_ > rhs.total_hits_;
+        });
+
+        return reports;
+    }
+
+    bool profiler::dump_collapsed_stacks(const std::string &path) {
+        std::ofstream out(path);
+
+        if (out.fail()) {
+            LOG_ERROR(KERNEL, "Unable to open {} to dump profiler stacks", path);
+            return false;
+        }
+
+        const std::lock_guard<std::mutex> guard(lock_);
+        kern_->lock();
+
+        for (auto &[process_id, proc_samples] : samples_) {
+            profiler_symbolizer symbolizer(kern_, kern_->get_by_id<kernel::process>(process_id));
+            std::unordered_map<std::string, std::uint64_t> stacks;
+
+            for (auto &[stack, hits] : proc_samples.stack_hits_) {
+                const address lr = static_cast<address>(stack >> 32);
+                const address pc = static_cast<address>(stack);
+
+                stacks[fmt::format("{};{};{}", proc_samples.name_, symbolizer.symbolize(lr), symbolizer.symbolize(pc))] += hits;
+            }
+
+            for (auto &[stack, hits] : stacks) {
+                out << stack << ' ' << hits << '\n';
+            }
+        }
+
+        kern_->unlock();
+        return true;
+    }
+}
@@ -25,16 +25,29 @@
 
 #include <common/log.h>
 
+#include <algorithm>
+#include <cstring>
+
 namespace eka2l1 {
     namespace service {
-        property::property(kernel_system *kern)
+        property::property(kernel_system *kern, const int category, const int key)
             : kernel::kernel_obj(kern, "", nullptr, kernel::access_type::global_access)
+            , std::pair<int, int>(category, key)
             , data_len(0)
             , data_type(service::property_type::unk) {
             obj_type = kernel::object_type::prop;
             bindata.reserve(512);
         }
 
+        property::~property() {
+            // References may outlive us, leave no link pointing back here
+            const std::lock_guard<std::mutex> guard(subscription_lock);
+
+            while (!subscriptions.empty()) {
+                subscriptions.first()->deque();
+            }
+        }
+
         bool property::is_defined() {
             return data_type != service::property_type::unk;
         }
@@ -51,6 +64,14 @@ namespace eka2l1 {
             data_change_callbacks.clear();
         }
 
+        void property::undefine() {
+            data_type = service::property_type::unk;
+            data_len = 0;
+            ndata = 0;
+
+            bindata.clear();
+        }
+
         void property::define(service::property_type pt, uint32_t pre_allocated) {
             data_type = pt;
             data_len = pre_allocated;
@@ -105,48 +126,72 @@ namespace eka2l1 {
             return local;
         }
 
-        void property::subscribe(epoc::notify_info &info) {
-            subscription_queue.push(&info);
+        std::uint32_t property::read_bin(std::uint8_t *dest, const std::uint32_t dest_size) {
+            std::memcpy(dest, bindata.data(), std::min<std::uint32_t>(data_len, dest_size));
+            return data_len;
+        }
+
+        void property::subscribe(property_reference *ref) {
+            const std::lock_guard<std::mutex> guard(subscription_lock);
+            subscriptions.push(&ref->subscription_link);
         }
 
-        bool property::cancel(const epoc::notify_info &info) {
-            // Find the subscription
-            auto subscription_iterator = std::find(subscription_queue.begin(), subscription_queue.end(),
-                &info);
+        bool property::cancel(property_reference *ref) {
+            {
+                const std::lock_guard<std::mutex> guard(subscription_lock);
 
-            if (subscription_iterator == subscription_queue.end()) {
-                return false;
+                // Not linked means not subscribed, or already notified
+                if (!ref->subscription_link.next) {
+                    return false;
+                }
+
+                ref->subscription_link.deque();
             }
 
-            (*subscription_iterator)->complete(epoc::error_cancel);
+            ref->nof_.complete(epoc::error_cancel);
             return true;
         }
 
         void property::notify_request(const std::int32_t err) {
-            while (auto subscription = subscription_queue.pop()) {
-                subscription.value()->complete(err);
+            const std::lock_guard<std::mutex> guard(subscription_lock);
+
+            while (!subscriptions.empty()) {
+                property_reference *ref = E_LOFF(subscriptions.first()->deque(), property_reference, subscription_link);
+                ref->nof_.complete(err);
             }
         }
 
+        void property::unsubscribe(property_reference *ref) {
+            const std::lock_guard<std::mutex> guard(subscription_lock);
+            ref->subscription_link.deque();
+        }
+
         property_reference::property_reference(kernel_system *kern, property *prop)
             : kernel::kernel_obj(kern, "", prop_)
             , prop_(prop) {
             obj_type = kernel::object_type::prop_ref;
         }
 
+        property_reference::~property_reference() {
+            // Once the property is gone, the link was already taken off
+            if (subscription_link.next) {
+                prop_->unsubscribe(this);
+            }
+        }
+
         bool property_reference::subscribe(const epoc::notify_info &info) {
-            if (!nof_.empty()) {
+            if (!nof_.empty() || subscription_link.next) {
                 return false;
             }
 
             nof_ = info;
-            prop_->subscribe(nof_);
+            prop_->subscribe(this);
 
             return true;
         }
 
         bool property_reference::cancel() {
-            return prop_->cancel(nof_);
+            return prop_->cancel(this);
         }
     }
 }
@@ -29,14 +29,8 @@
 namespace eka2l1 {
     namespace service {
         bool server::is_msg_delivered(ipc_msg_ptr &msg) {
-            auto res = std::find_if(delivered_msgs.begin(), delivered_msgs.end(),
-                [&](const auto &svr_msg) { return svr_msg.real_msg->id == msg->id; });
-
-            if (res != delivered_msgs.end()) {
-                return true;
-            }
-
-            return false;
+            // A message is only linked while it waits in a delivered queue
+            return msg->delivery_link.next != nullptr;
         }
 
         server::~server() {
@@ -52,21 +46,27 @@ namespace eka2l1 {
             process_msg->lock_free();
 
             obj_type = kernel::object_type::server;
+            hook_id = kern->get_ipc_hooks().intern(name);
 
             REGISTER_IPC(server, connect, -1, "Server::Connect");
             REGISTER_IPC(server, disconnect, -2, "Server::Disconnect");
         }
 
+        void server::rename(const std::string &new_name) {
+            kernel_obj::rename(new_name);
+            hook_id = kern->get_ipc_hooks().intern(new_name);
+        }
+
         int server::receive(ipc_msg_ptr &msg) {
-            /* If there is pending message, pop the last one and accept it */
+            /* If there is pending message, pop the oldest one and accept it */
             if (!delivered_msgs.empty()) {
-                server_msg yet_pending = std::move(delivered_msgs.back());
+                common::double_linked_queue_element *oldest = delivered_msgs.first()->deque();
 
+                server_msg yet_pending;
+                yet_pending.real_msg = kern->get_msg(E_LOFF(oldest, ipc_msg, delivery_link)->id);
                 yet_pending.dest_msg = msg;
 
                 accept(yet_pending);
-                delivered_msgs.pop_back();
-
                 return 0;
             }
 
@@ -111,14 +111,18 @@ namespace eka2l1 {
 
                 finish_request_lle(msg.dest_msg, true);
             } else {
-                delivered_msgs.push_back(msg);
+                // A message is in one queue at a time. Redelivering moves it to the back.
+                msg.real_msg->delivery_link.deque();
+                delivered_msgs.push(&msg.real_msg->delivery_link);
             }
 
             return 0;
         }
 
         int server::cancel() {
-            delivered_msgs.pop_back();
+            if (!delivered_msgs.empty()) {
+                delivered_msgs.last()->deque();
+            }
 
             return 0;
         }
@@ -128,6 +132,11 @@ namespace eka2l1 {
         }
 
         void server::destroy() {
+            // Unlink pending messages, they can outlive the queue
+            while (!delivered_msgs.empty()) {
+                delivered_msgs.first()->deque();
+            }
+
             process_msg->unlock_free();
             kern->free_msg(process_msg);
         }
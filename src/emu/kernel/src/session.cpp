@@ -30,6 +30,7 @@ namespace eka2l1 {
         session::session(kernel_system *kern, server_ptr svr, int async_slot_count)
             : kernel_obj(kern, "", kern->crr_process(), kernel::access_type::global_access) 
             , svr(svr)
+            , free_slot_head(-1)
             , cookie_address(0)
             , headless_(false) {
             obj_type = kernel::object_type::session;
@@ -39,8 +40,16 @@ namespace eka2l1 {
             if (async_slot_count > 0) {
                 msgs_pool.resize(async_slot_count);
 
-                for (auto &msg : msgs_pool) {
-                    msg = std::make_pair(true, kern->create_msg(kernel::owner_type::process));
+                // Chain all slots in order, so the first free slot is given out first
+                for (std::int32_t i = async_slot_count - 1; i >= 0; i--) {
+                    ipc_msg_ptr msg = kern->create_msg(kernel::owner_type::process);
+
+                    msg->pool_slot = i;
+                    msg->pool_slot_in_use = false;
+                    msg->next_free_pool_slot = free_slot_head;
+
+                    free_slot_head = i;
+                    msgs_pool[i] = std::move(msg);
                 }
             }
         }
@@ -54,15 +63,17 @@ namespace eka2l1 {
                 return kern->create_msg(kernel::owner_type::process);
             }
 
-            auto free_msg_in_pool = std::find_if(msgs_pool.begin(), msgs_pool.end(),
-                [](const auto &msg) { return msg.first; });
-
-            if (free_msg_in_pool != msgs_pool.end()) {
-                free_msg_in_pool->first = false;
-                return free_msg_in_pool->second;
+            if (free_slot_head < 0) {
+                return ipc_msg_ptr(nullptr);
             }
 
-            return ipc_msg_ptr(nullptr);
+            ipc_msg_ptr &free_msg_in_pool = msgs_pool[free_slot_head];
+            free_slot_head = free_msg_in_pool->next_free_pool_slot;
+
+            free_msg_in_pool->pool_slot_in_use = true;
+            free_msg_in_pool->next_free_pool_slot = -1;
+
+            return free_msg_in_pool;
         }
 
         void session::set_slot_free(ipc_msg_ptr &msg) {
@@ -71,12 +82,19 @@ namespace eka2l1 {
                 return;
             }
 
-            auto wrap_msg = std::find_if(msgs_pool.begin(), msgs_pool.end(),
-                [&](const auto &wrap_msg) { return wrap_msg.second == msg; });
+            const std::int32_t slot = msg->pool_slot;
 
-            if (wrap_msg != msgs_pool.end()) {
-                wrap_msg->first = true;
+            // The message may not belong to this pool (for example the server's process message), or
+            // it may be freed already.
+            if ((slot < 0) || (slot >= static_cast<std::int32_t>(msgs_pool.size())) || (msgs_pool[slot] != msg)
+                || !msg->pool_slot_in_use) {
+                return;
             }
+
+            msg->pool_slot_in_use = false;
+            msg->next_free_pool_slot = free_slot_head;
+
+            free_slot_head = slot;
         }
 
         // This behaves a little different then other
@@ -128,9 +146,13 @@ namespace eka2l1 {
         void session::destroy() {
             // Free the message pool
             for (const auto &msg : msgs_pool) {
-                kern->free_msg(msg.second);
+                msg->pool_slot = -1;
+                kern->free_msg(msg);
             }
 
+            // Slots are gone back to the kernel, nothing can be given out anymore
+            free_slot_head = -1;
+
             if (!kern->crr_thread()) {
                 return;
             }
@@ -1029,8 +1029,8 @@ namespace eka2l1::epoc {
             LOG_TRACE(KERNEL, "Sending {} sync to {}", ord, ss->get_server()->name());
         }
 
-        const std::string server_name = ss->get_server()->name();
-        kern->call_ipc_send_callbacks(server_name, ord, arg, status.ptr_address(), kern->crr_thread());
+        kern->count_ipc_send();
+        kern->call_ipc_send_callbacks(ss->get_server(), ord, arg, status.ptr_address(), kern->crr_thread());
 
         const int result = sync ? ss->send_receive_sync(ord, arg, status) : ss->send_receive(ord, arg, status);
 
@@ -2110,21 +2110,13 @@ namespace eka2l1::epoc {
         }
 
         std::uint8_t *data_ptr = data.get(crr_pr);
-        auto data_vec = prop->get_bin();
-
-        const std::size_t size_to_copy = std::min<std::size_t>(data_vec.size(), datlength);
-        std::int32_t return_code = epoc::error_none;
-
-        if (data_vec.size() > datlength) {
-            // The given buffer can't hold ours.
-            return_code = epoc::error_overflow;
-        }
 
         // Whether the buffer is too small, we still have to either copy truncated or full data.
-        std::copy(data_vec.begin(), data_vec.begin() + size_to_copy, data.get(kern->crr_process()));
+        const std::uint32_t data_size = prop->read_bin(data_ptr, static_cast<std::uint32_t>(datlength));
 
-        if (return_code != epoc::error_none) {
-            return return_code;
+        if (data_size > static_cast<std::uint32_t>(datlength)) {
+            // The given buffer can't hold ours.
+            return epoc::error_overflow;
         }
 
         return datlength;
@@ -2138,14 +2130,11 @@ namespace eka2l1::epoc {
         if (!prop) {
             LOG_WARN(KERNEL, "Property (0x{:x}, 0x{:x}) has not been defined before, undefined behavior may rise", cage, val);
 
-            prop = kern->create<service::property>();
+            prop = kern->create<service::property>(cage, val);
 
             if (!prop) {
                 return epoc::error_general;
             }
-
-            prop->first = cage;
-            prop->second = val;
         }
 
         auto property_ref_handle_and_obj = kern->create_and_add<service::property_reference>(
@@ -2187,14 +2176,11 @@ namespace eka2l1::epoc {
         property_ptr prop = kern->get_prop(cage, key);
 
         if (!prop) {
-            prop = kern->create<service::property>();
+            prop = kern->create<service::property>(cage, key);
 
             if (!prop) {
                 return epoc::error_general;
             }
-
-            prop->first = cage;
-            prop->second = key;
         }
 
         prop->define(prop_type, info->size);
@@ -2203,12 +2189,16 @@ namespace eka2l1::epoc {
     }
 
     BRIDGE_FUNC(std::int32_t, property_delete, std::int32_t cage, std::int32_t key) {
-        property_ptr prop = kern->delete_prop(cage, key);
+        property_ptr prop = kern->get_prop(cage, key);
 
         if (!prop || !prop->is_defined()) {
             return epoc::error_not_found; 
         }
 
+        // Pending subscribers learn that the property is gone
+        prop->notify_request(epoc::error_not_found);
+        kern->delete_prop(cage, key);
+
         return epoc::error_none;
     }
 
@@ -2291,25 +2281,17 @@ namespace eka2l1::epoc {
             return epoc::error_not_found;
         }
 
-        std::vector<uint8_t> dat = prop->get_property_object()->get_bin();
+        // Whether the buffer is too small, we still have to either copy truncated or full data.
+        const std::uint32_t data_size = prop->get_property_object()->read_bin(buffer_ptr_guest.get(kern->crr_process()),
+            static_cast<std::uint32_t>(buffer_size));
 
-        if (dat.size() == 0) {
+        if (data_size == 0) {
             return epoc::error_argument;
         }
 
-        const std::size_t size_to_copy = std::min<std::size_t>(dat.size(), buffer_size);
-        std::int32_t return_code = epoc::error_none;
-
-        if (dat.size() > buffer_size) {
+        if (data_size > static_cast<std::uint32_t>(buffer_size)) {
             // The given buffer can't hold ours.
-            return_code = epoc::error_overflow;
-        }
-
-        // Whether the buffer is too small, we still have to either copy truncated or full data.
-        std::copy(dat.begin(), dat.begin() + size_to_copy, buffer_ptr_guest.get(kern->crr_process()));
-
-        if (return_code != epoc::error_none) {
-            return return_code;
+            return epoc::error_overflow;
         }
 
         return buffer_size;
@@ -32,13 +32,21 @@
 #include <vector>
 
 namespace eka2l1 {
-    ntimer::ntimer(const std::uint32_t cpu_hz) {
+    ntimer::ntimer(const std::uint32_t cpu_hz, const bool manual_clock)
+        : manual_clock_(nullptr) {
         CPU_HZ_ = cpu_hz;
         should_stop_ = false;
         should_paused_ = false;
         acc_level_ = realtime_level_low;
 
-        teletimer_ = common::make_teletimer(cpu_hz);
+        if (manual_clock) {
+            auto clock = std::make_unique<common::manual_teletimer>(cpu_hz);
+            manual_clock_ = clock.get();
+            teletimer_ = std::move(clock);
+        } else {
+            teletimer_ = common::make_teletimer(cpu_hz);
+        }
+
         set_realtime_level(realtime_level_mid);
     }
 
@@ -55,6 +63,7 @@ namespace eka2l1 {
 
         if (timer_thread_) {
             timer_thread_->join();
+            timer_thread_.reset();
         }
 
         events_.clear();
@@ -68,11 +77,13 @@ namespace eka2l1 {
 
         new_event_evt_.reset();
         pause_evt_.reset();
-        
-        timer_thread_ = std::make_unique<std::thread>([this]() {
-            loop();
-        });
-        
+
+        if (!manual_clock_) {
+            timer_thread_ = std::make_unique<std::thread>([this]() {
+                loop();
+            });
+        }
+
         teletimer_->start();
     }
 
@@ -168,6 +179,18 @@ namespace eka2l1 {
         return std::nullopt;
     }
 
+    std::optional<std::uint64_t> ntimer::advance_clock(const std::uint64_t microsecs) {
+        if (!manual_clock_) {
+            return std::nullopt;
+        }
+
+        if (!should_paused_) {
+            manual_clock_->advance(microsecs);
+        }
+
+        return advance();
+    }
+
     void ntimer::schedule_event(int64_t us_into_future, int event_type, std::uint64_t userdata) {
         const std::lock_guard<std::mutex> guard(lock_);
 
@@ -221,13 +244,14 @@ namespace eka2l1 {
         return static_cast<std::uint32_t>(CPU_HZ_ / 1000000);
     }
 
-    int ntimer::register_event(const std::string &name, timed_callback callback) {
+    int ntimer::register_event(const std::string &name, timed_callback callback, const bool restorable) {
         const std::lock_guard<std::mutex> guard(lock_);
 
         event_type evtype;
 
         evtype.name = name;
         evtype.callback = callback;
+        evtype.restorable = restorable;
 
         for (std::size_t i = 0; i < event_types_.size(); i++) {
             if (event_types_[i].callback == nullptr) {
@@ -249,6 +273,83 @@ namespace eka2l1 {
         event_types_[event_type].callback = nullptr;
     }
 
+    void ntimer::do_state(common::chunkyseri &seri) {
+        auto s = seri.section("Timing", 1);
+
+        if (!s) {
+            return;
+        }
+
+        const std::lock_guard<std::mutex> guard(lock_);
+        const std::uint64_t now = teletimer_->microseconds();
+        const bool is_reading = (seri.get_seri_mode() == common::SERI_MODE_READ);
+
+        // User data of other events may point to host objects, which won't exist in the restoring process
+        std::vector<const event *> saved;
+
+        if (!is_reading) {
+            for (const event &evt : events_) {
+                if (event_types_[evt.event_type].restorable) {
+                    saved.push_back(&evt);
+                }
+            }
+        }
+
+        std::uint32_t event_count = static_cast<std::uint32_t>(saved.size());
+        seri.absorb(event_count);
+
+        std::vector<event> restored;
+
+        for (std::uint32_t i = 0; i < event_count; i++) {
+            std::string type_name;
+            std::uint64_t us_into_future = 0;
+            std::uint64_t userdata = 0;
+
+            if (!is_reading) {
+                const event &evt = *saved[i];
+
+                type_name = event_types_[evt.event_type].name;
+                us_into_future = (evt.event_time > now) ? (evt.event_time - now) : 0;
+                userdata = evt.event_user_data;
+            }
+
+            seri.absorb(type_name);
+            seri.absorb(us_into_future);
+            seri.absorb(userdata);
+
+            if (!is_reading) {
+                continue;
+            }
+
+            auto type_ite = std::find_if(event_types_.begin(), event_types_.end(), [&](const event_type &type) {
+                return (type.name == type_name) && (type.callback != nullptr) && type.restorable;
+            });
+
+            if (type_ite == event_types_.end()) {
+                LOG_WARN(KERNEL, "Event type {} is not registered as restorable, dropping its scheduled event", type_name);
+                continue;
+            }
+
+            event evt;
+            evt.event_type = static_cast<int>(std::distance(event_types_.begin(), type_ite));
+            evt.event_time = now + us_into_future;
+            evt.event_user_data = userdata;
+
+            restored.push_back(evt);
+        }
+
+        if (is_reading) {
+            events_ = std::move(restored);
+
+            // Events due at the same time keep their saved order
+            std::stable_sort(events_.begin(), events_.end(), [](const event &lhs, const event &rhs) {
+                return lhs.event_time > rhs.event_time;
+            });
+
+            new_event_evt_.set();
+        }
+    }
+
     int ntimer::get_register_event(const std::string &name) {
         const std::lock_guard<std::mutex> guard(lock_);
 
@@ -28,6 +28,7 @@
 
 namespace eka2l1::common {
     struct bitmap_allocator;
+    class chunkyseri;
 }
 
 namespace eka2l1::mem {
@@ -84,6 +85,22 @@ namespace eka2l1::mem {
 
         virtual void *host_base() = 0;
 
+        /**
+         * \brief Check if the page containing the given offset is committed.
+         *
+         * \param offset Offset from the chunk's base.
+         */
+        virtual bool is_page_committed(const vm_address offset) const = 0;
+
+        /**
+         * \brief Save or restore the committed pages of this chunk.
+         *
+         * Only committed pages are stored, as runs of contiguous pages followed by their data.
+         * On restore, pages committed in the chunk but not in the snapshot are decommitted.
+         * The chunk must have been created with the same size and type as the saved one.
+         */
+        void do_state(common::chunkyseri &seri);
+
         /**
          * \brief Unmap the committed chunk region from the CPU.
          * 
@@ -52,6 +52,7 @@ namespace eka2l1::mem::flexible {
         const vm_address base(mem_model_process *process) override;
 
         void *host_base() override;
+        bool is_page_committed(const vm_address offset) const override;
 
         const std::size_t committed() const override {
             return committed_;
@@ -69,6 +69,8 @@ namespace eka2l1::mem {
             return host_base_;
         }
 
+        bool is_page_committed(const vm_address offset) const override;
+
         const std::size_t committed() const override {
             return committed_;
         }
@@ -25,7 +25,12 @@
 
 #include <common/algorithm.h>
 #include <common/allocator.h>
+#include <common/chunkyseri.h>
 #include <common/log.h>
+#include <common/virtualmem.h>
+
+#include <utility>
+#include <vector>
 
 namespace eka2l1::mem {
     const vm_address mem_model_chunk::bottom() const {
@@ -128,6 +133,96 @@ namespace eka2l1::mem {
         }
     }
     
+    void mem_model_chunk::do_state(common::chunkyseri &seri) {
+        auto s = seri.section("ChunkPages", 1);
+
+        if (!s) {
+            return;
+        }
+
+        std::uint32_t page_size_bits = static_cast<std::uint32_t>(control_->page_size_bits_);
+        seri.absorb(page_size_bits);
+
+        if (page_size_bits != control_->page_size_bits_) {
+            LOG_ERROR(MEMORY, "Chunk snapshot was taken with a different page size ({} bits vs {})", page_size_bits,
+                control_->page_size_bits_);
+            return;
+        }
+
+        const std::uint32_t total_pages = static_cast<std::uint32_t>(max() >> control_->page_size_bits_);
+
+        // Runs of contiguous committed pages, as first page and page count
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> runs;
+
+        for (std::uint32_t page = 0; page < total_pages; page++) {
+            if (!is_page_committed(page << control_->page_size_bits_)) {
+                continue;
+            }
+
+            if (!runs.empty() && (runs.back().first + runs.back().second == page)) {
+                runs.back().second++;
+            } else {
+                runs.emplace_back(page, 1);
+            }
+        }
+
+        const bool is_reading = (seri.get_seri_mode() == common::SERI_MODE_READ);
+
+        if (is_reading) {
+            // The snapshot alone decides what is committed
+            for (const auto &[first_page, page_count] : runs) {
+                decommit(first_page << control_->page_size_bits_, page_count << control_->page_size_bits_);
+            }
+        }
+
+        // Normal chunks check committed pages against this range, so it must be in place before the runs are restored
+        seri.absorb(bottom_);
+        seri.absorb(top_);
+
+        std::uint32_t run_count = static_cast<std::uint32_t>(runs.size());
+        seri.absorb(run_count);
+
+        if (is_reading) {
+            runs.resize(run_count);
+        }
+
+        std::uint8_t *host = reinterpret_cast<std::uint8_t *>(host_base());
+        const bool need_access = ((permission_ & prot_read_write) != prot_read_write);
+
+        for (auto &[first_page, page_count] : runs) {
+            seri.absorb(first_page);
+            seri.absorb(page_count);
+
+            if ((first_page >= total_pages) || (page_count > total_pages - first_page)) {
+                LOG_ERROR(MEMORY, "Chunk snapshot has pages out of the chunk's range!");
+                return;
+            }
+
+            const vm_address offset = first_page << control_->page_size_bits_;
+            const std::size_t size = static_cast<std::size_t>(page_count) << control_->page_size_bits_;
+
+            if (is_reading) {
+                commit(offset, size);
+
+                if (!is_page_committed(offset)) {
+                    LOG_ERROR(MEMORY, "Unable to commit chunk pages to restore the snapshot!");
+                    return;
+                }
+            }
+
+            // Code and read-only chunks still have to be read from or written to here
+            if (need_access) {
+                common::change_protection(host + offset, size, prot_read_write);
+            }
+
+            seri.absorb_impl(host + offset, size);
+
+            if (need_access) {
+                common::change_protection(host + offset, size, permission_);
+            }
+        }
+    }
+
     mem_model_chunk_impl make_new_mem_model_chunk(control_base *control, const asid addr_space_id,
         const mem_model_type mmt) {
         switch (mmt) {
@@ -166,4 +166,20 @@ namespace eka2l1::mem::flexible {
     void *flexible_mem_model_chunk::host_base() {
         return mem_obj_->ptr();
     }
-}
\ No newline at end of file
+
+    bool flexible_mem_model_chunk::is_page_committed(const vm_address offset) const {
+        if (offset >= max_size_) {
+            return false;
+        }
+
+        const std::uint32_t page = static_cast<std::uint32_t>(offset >> control_->page_size_bits_);
+
+        if (page_bma_) {
+            // A clear bit is an allocated page, the first page being the most significant bit
+            return (page_bma_->words_[page >> 5] & (0x80000000U >> (page & 31))) == 0;
+        }
+
+        // Normal chunks are committed from bottom to top
+        return (page >= bottom_) && (page < top_);
+    }
+}
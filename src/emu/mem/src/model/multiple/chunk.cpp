@@ -27,6 +27,21 @@
 #include <common/log.h>
 
 namespace eka2l1::mem {
+    bool multiple_mem_model_chunk::is_page_committed(const vm_address offset) const {
+        if (offset >= max_size_) {
+            return false;
+        }
+
+        const std::uint32_t ptid = page_tabs_[offset >> control_->chunk_shift_];
+
+        if (ptid == 0xFFFFFFFF) {
+            return false;
+        }
+
+        page_table *pt = control_->get_page_table_by_id(ptid);
+        return pt && (pt->pages_[(offset >> control_->page_index_shift_) & control_->page_index_mask_].host_addr != nullptr);
+    }
+
     std::size_t multiple_mem_model_chunk::commit(const vm_address offset, const std::size_t size) {
         // Align the offset
         vm_address running_offset = offset;
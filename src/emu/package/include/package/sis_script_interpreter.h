@@ -21,9 +21,17 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <stack>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
 #include <loader/sis_fields.h>
@@ -47,6 +55,66 @@ namespace eka2l1 {
     }
 
     namespace loader {
+        /**
+         * \brief Stream a file's data out of a SIS, inflating it if needed.
+         *
+         * \param stream      Stream of the SIS file.
+         * \param compressed  Descriptor of the file's data in the SIS.
+         * \param dest        Opened destination file.
+         *
+         * \returns True on success.
+         */
+        bool extract_sis_compressed(common::ro_stream *stream, const sis_compressed &compressed, FILE *dest);
+
+        /**
+         * \brief Pool of host threads extracting file data out of a SIS.
+         *
+         * Each job reads through its own handle of the SIS file and inflates straight to the
+         * destination, so memory use is bounded by the number of workers, not by file sizes.
+         */
+        class sis_extract_pool {
+            struct job {
+                std::string dest_path_;
+                sis_compressed data_;
+            };
+
+            std::string sis_path_;
+            std::deque<job> jobs_;
+
+            std::mutex lock_;
+            std::condition_variable job_cond_;
+            std::condition_variable idle_cond_;
+
+            std::vector<std::thread> workers_;
+            std::uint32_t worker_count_;
+            std::uint32_t busy_count_;
+            std::uint32_t failed_count_;
+            bool abort_;
+
+            void worker_loop();
+
+        public:
+            static constexpr std::uint32_t MAX_WORKER_COUNT = 4;
+
+            explicit sis_extract_pool(const std::string &sis_path, const std::uint32_t worker_count);
+            ~sis_extract_pool();
+
+            /**
+             * \brief Queue a file to extract. Worker threads are started on the first queue.
+             *
+             * \param dest_path   UTF-8 path to the physical destination file.
+             * \param data        Descriptor of the file's data in the SIS.
+             */
+            void queue(const std::string &dest_path, const sis_compressed &data);
+
+            /**
+             * \brief Block until all queued files are extracted.
+             *
+             * \returns Number of files that failed to extract since the last wait.
+             */
+            std::uint32_t wait_all();
+        };
+
         // An interpreter that runs SIS install script
         class ss_interpreter {
             sis_controller *main_controller;
@@ -65,6 +133,14 @@ namespace eka2l1 {
 
             bool skip_next_file{ false };
 
+            std::unique_ptr<sis_extract_pool> extract_pool;
+            std::unordered_set<std::string> queued_paths;     ///< Destinations queued since the last wait.
+
+            /**
+             * \brief Wait for queued extractions, for steps that need installed files on disk.
+             */
+            void wait_extractions();
+
             bool appprop(const sis_uid uid, sis_property prop);
             bool package(const sis_uid uid);
 
@@ -90,7 +166,8 @@ namespace eka2l1 {
                 manager::packages *pkgmngr,
                 sis_controller *main_controller,
                 sis_data *inst_data,
-                drive_number install_drv);
+                drive_number install_drv,
+                const std::string &sis_path = "");
 
             /**
              * \brief Get the data in the index of a buffer block in the SIS.
@@ -110,7 +187,8 @@ namespace eka2l1 {
             /**
              * \brief Get the data in the index of a buffer block in the SIS, write it to a physical file.
              * 
-             * Usually uses for extracting large app data.
+             * Usually uses for extracting large app data. With a worker pool, the extraction is only
+             * queued, and may still be running when this returns.
              * 
              * \param path          UTF-8 path to the physical file.
              * \param data_idx      The index of the source buffer in block buffer.
@@ -123,9 +201,14 @@ namespace eka2l1 {
 
             bool interpret(sis_controller *controller, const std::uint16_t base_data_idx, std::atomic<int> &progress);
 
-            bool interpret(std::atomic<int> &progress) {
-                return interpret(main_controller, 0, progress);
-            }
+            /**
+             * \brief Run the install script of the main controller.
+             *
+             * Conditions and prompts are run in script order on the calling thread. If the SIS path
+             * was given, file data is extracted by a worker pool while the script goes on. All files
+             * are on disk when this returns.
+             */
+            bool interpret(std::atomic<int> &progress);
         };
     }
 }
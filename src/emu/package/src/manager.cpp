@@ -220,7 +220,7 @@ namespace eka2l1 {
 
                 // Interpret the file
                 loader::ss_interpreter interpreter(reinterpret_cast<common::ro_stream *>(&stream),
-                    sys, this, &res.controller, &res.data, drive);
+                    sys, this, &res.controller, &res.data, drive, common::ucs2_to_utf8(path));
 
                 // Set up hooks
                 if (show_text) {
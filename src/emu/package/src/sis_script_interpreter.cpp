@@ -67,13 +67,20 @@ namespace eka2l1 {
             manager::packages *pkgmngr,
             sis_controller *main_controller,
             sis_data *inst_data,
-            drive_number inst_drv)
+            drive_number inst_drv,
+            const std::string &sis_path)
             : data_stream(stream)
             , mngr(pkgmngr)
             , io(io)
             , main_controller(main_controller)
             , install_data(inst_data)
             , install_drive(inst_drv) {
+            if (!sis_path.empty()) {
+                const std::uint32_t worker_count = common::clamp<std::uint32_t>(1, sis_extract_pool::MAX_WORKER_COUNT,
+                    std::thread::hardware_concurrency());
+
+                extract_pool = std::make_unique<sis_extract_pool>(sis_path, worker_count);
+            }
         }
 
         std::vector<uint8_t> ss_interpreter::get_small_file_buf(uint32_t data_idx, uint16_t crr_blck_idx) {
@@ -124,86 +131,223 @@ namespace eka2l1 {
             fclose(temp);
         }
 
-        void ss_interpreter::extract_file(const std::string &path, const uint32_t idx, uint16_t crr_blck_idx) {
-            std::string rp = eka2l1::file_directory(path);
-            eka2l1::create_directories(rp);
+        bool extract_sis_compressed(common::ro_stream *stream, const sis_compressed &compressed, FILE *dest) {
+            std::uint64_t left = ((compressed.len_low) | (static_cast<std::uint64_t>(compressed.len_high) << 32)) - 12;
+            stream->seek(compressed.offset, common::seek_where::beg);
 
-            // Delete the file, starts over
-            if (common::is_system_case_insensitive() && eka2l1::exists(path)) {
-                if (!common::remove(path)) {
-                    LOG_WARN(PACKAGE, "Unable to remove {} to extract new file", path);
+            std::vector<unsigned char> temp_chunk(CHUNK_SIZE);
+            std::vector<unsigned char> temp_inflated_chunk;
+
+            const bool deflated = (compressed.algorithm == sis_compressed_algorithm::deflated);
+            mz_stream inflate_stream{};
+
+            if (deflated) {
+                temp_inflated_chunk.resize(CHUNK_MAX_INFLATED_SIZE);
+
+                if (inflateInit(&inflate_stream) != MZ_OK) {
+                    LOG_ERROR(PACKAGE, "Can not intialize inflate stream");
+                    return false;
                 }
             }
 
-            FILE *file = fopen(path.c_str(), "wb");
+            std::uint64_t total_inflated_size = 0;
+            bool result = true;
 
-            sis_data_unit *data_unit = reinterpret_cast<sis_data_unit *>(install_data->data_units.fields[crr_blck_idx].get());
-            sis_file_data *data = reinterpret_cast<sis_file_data *>(data_unit->data_unit.fields[idx].get());
+            while (result && (left > 0)) {
+                const std::uint32_t grab = static_cast<std::uint32_t>(common::min<std::uint64_t>(left, CHUNK_SIZE));
 
-            sis_compressed compressed = data->raw_data;
+                if ((stream->read(temp_chunk.data(), grab) != grab) || !stream->valid()) {
+                    LOG_ERROR(PACKAGE, "Stream fail, skipping this file, should report to developers.");
+                    result = false;
+                    break;
+                }
 
-            std::uint64_t left = ((compressed.len_low) | (static_cast<std::uint64_t>(compressed.len_high) << 32)) - 12;
-            data_stream->seek(compressed.offset, common::seek_where::beg);
+                left -= grab;
 
-            std::vector<unsigned char> temp_chunk;
-            temp_chunk.resize(CHUNK_SIZE);
+                if (!deflated) {
+                    fwrite(temp_chunk.data(), 1, grab, dest);
+                    continue;
+                }
 
-            std::vector<unsigned char> temp_inflated_chunk;
-            temp_inflated_chunk.resize(CHUNK_MAX_INFLATED_SIZE);
+                inflate_stream.next_in = temp_chunk.data();
+                inflate_stream.avail_in = grab;
 
-            mz_stream stream;
+                // Drain the output as many times as this input needs, highly compressed data
+                // may inflate to more than a chunk
+                while (true) {
+                    inflate_stream.next_out = temp_inflated_chunk.data();
+                    inflate_stream.avail_out = static_cast<unsigned int>(temp_inflated_chunk.size());
 
-            stream.zalloc = nullptr;
-            stream.zfree = nullptr;
+                    const int res = inflate(&inflate_stream, MZ_NO_FLUSH);
 
-            if (compressed.algorithm == sis_compressed_algorithm::deflated) {
-                if (inflateInit(&stream) != MZ_OK) {
-                    LOG_ERROR(PACKAGE, "Can not intialize inflate stream");
+                    if ((res != MZ_OK) && (res != MZ_STREAM_END) && (res != MZ_BUF_ERROR)) {
+                        LOG_ERROR(PACKAGE, "Uncompress failed ({})! Report to developers", mz_error(res));
+                        result = false;
+                        break;
+                    }
+
+                    const std::size_t inflated_size = temp_inflated_chunk.size() - inflate_stream.avail_out;
+
+                    fwrite(temp_inflated_chunk.data(), 1, inflated_size, dest);
+                    total_inflated_size += inflated_size;
+
+                    if ((res != MZ_OK) || ((inflate_stream.avail_in == 0) && (inflate_stream.avail_out != 0))) {
+                        break;
+                    }
                 }
             }
 
-            std::uint32_t total_inflated_size = 0;
+            if (deflated) {
+                if (result && (total_inflated_size != compressed.uncompressed_size)) {
+                    LOG_ERROR(PACKAGE, "Sanity check failed: Total inflated size not equal to specified uncompress size "
+                              "in SISCompressed ({} vs {})!",
+                        total_inflated_size, compressed.uncompressed_size);
+                }
 
-            while (left > 0) {
-                std::fill(temp_chunk.begin(), temp_chunk.end(), 0);
-                int grab = static_cast<int>(left < CHUNK_SIZE ? left : CHUNK_SIZE);
+                inflateEnd(&inflate_stream);
+            }
 
-                data_stream->read(&temp_chunk[0], grab);
+            return result;
+        }
 
-                if (!data_stream->valid()) {
-                    LOG_ERROR(PACKAGE, "Stream fail, skipping this file, should report to developers.");
-                    return;
+        sis_extract_pool::sis_extract_pool(const std::string &sis_path, const std::uint32_t worker_count)
+            : sis_path_(sis_path)
+            , worker_count_(worker_count)
+            , busy_count_(0)
+            , failed_count_(0)
+            , abort_(false) {
+        }
+
+        sis_extract_pool::~sis_extract_pool() {
+            {
+                const std::lock_guard<std::mutex> guard(lock_);
+                abort_ = true;
+            }
+
+            job_cond_.notify_all();
+
+            for (std::thread &worker : workers_) {
+                worker.join();
+            }
+        }
+
+        void sis_extract_pool::worker_loop() {
+            // Each worker reads through its own handle, seeking one does not disturb the others
+            common::ro_std_file_stream stream(sis_path_, true);
+            std::unique_lock<std::mutex> unq(lock_);
+
+            while (true) {
+                job_cond_.wait(unq, [this]() { return abort_ || !jobs_.empty(); });
+
+                if (jobs_.empty()) {
+                    break;
                 }
 
-                if (compressed.algorithm == sis_compressed_algorithm::deflated) {
-                    uint32_t inflated_size = 0;
+                job todo = std::move(jobs_.front());
+                jobs_.pop_front();
 
-                    auto res = flate::inflate_data(&stream, temp_chunk.data(), temp_inflated_chunk.data(), grab, &inflated_size);
+                busy_count_++;
+                unq.unlock();
 
-                    if (!res) {
-                        LOG_ERROR(PACKAGE, "Uncompress failed! Report to developers");
-                        return;
-                    }
+                bool result = false;
+                FILE *file = fopen(todo.dest_path_.c_str(), "wb");
 
-                    fwrite(temp_inflated_chunk.data(), 1, inflated_size, file);
-                    total_inflated_size += inflated_size;
-                } else {
-                    fwrite(temp_chunk.data(), 1, grab, file);
+                if (file) {
+                    result = stream.valid() && extract_sis_compressed(&stream, todo.data_, file);
+                    fclose(file);
                 }
 
-                left -= grab;
+                if (!result) {
+                    LOG_ERROR(PACKAGE, "Failed to extract {}", todo.dest_path_);
+                }
+
+                unq.lock();
+
+                busy_count_--;
+                failed_count_ += result ? 0 : 1;
+
+                if (jobs_.empty() && (busy_count_ == 0)) {
+                    idle_cond_.notify_all();
+                }
             }
+        }
 
-            if (compressed.algorithm == sis_compressed_algorithm::deflated) {
-                if (total_inflated_size != compressed.uncompressed_size) {
-                    LOG_ERROR(PACKAGE, "Sanity check failed: Total inflated size not equal to specified uncompress size "
-                              "in SISCompressed ({} vs {})!",
-                        total_inflated_size, compressed.uncompressed_size);
+        void sis_extract_pool::queue(const std::string &dest_path, const sis_compressed &data) {
+            {
+                const std::lock_guard<std::mutex> guard(lock_);
+
+                if (workers_.empty()) {
+                    for (std::uint32_t i = 0; i < worker_count_; i++) {
+                        workers_.emplace_back([this]() { worker_loop(); });
+                    }
                 }
 
-                inflateEnd(&stream);
+                jobs_.push_back({ dest_path, data });
+            }
+
+            job_cond_.notify_one();
+        }
+
+        std::uint32_t sis_extract_pool::wait_all() {
+            std::unique_lock<std::mutex> unq(lock_);
+            idle_cond_.wait(unq, [this]() { return jobs_.empty() && (busy_count_ == 0); });
+
+            const std::uint32_t failed = failed_count_;
+            failed_count_ = 0;
+
+            return failed;
+        }
+
+        void ss_interpreter::wait_extractions() {
+            if (!extract_pool) {
+                return;
             }
 
+            const std::uint32_t failed = extract_pool->wait_all();
+
+            if (failed != 0) {
+                LOG_ERROR(PACKAGE, "{} files failed to extract", failed);
+            }
+
+            queued_paths.clear();
+        }
+
+        void ss_interpreter::extract_file(const std::string &path, const uint32_t idx, uint16_t crr_blck_idx) {
+            std::string rp = eka2l1::file_directory(path);
+            eka2l1::create_directories(rp);
+
+            // The same file written twice must keep the script order. On case-insensitive hosts,
+            // paths differing only in case name the same file.
+            const std::string queued_key = common::is_system_case_insensitive() ? common::lowercase_string(path) : path;
+
+            if (extract_pool && !queued_paths.insert(queued_key).second) {
+                wait_extractions();
+                queued_paths.insert(queued_key);
+            }
+
+            // Delete the file, starts over
+            if (common::is_system_case_insensitive() && eka2l1::exists(path)) {
+                if (!common::remove(path)) {
+                    LOG_WARN(PACKAGE, "Unable to remove {} to extract new file", path);
+                }
+            }
+
+            sis_data_unit *data_unit = reinterpret_cast<sis_data_unit *>(install_data->data_units.fields[crr_blck_idx].get());
+            sis_file_data *data = reinterpret_cast<sis_file_data *>(data_unit->data_unit.fields[idx].get());
+
+            if (extract_pool) {
+                extract_pool->queue(path, data->raw_data);
+                return;
+            }
+
+            FILE *file = fopen(path.c_str(), "wb");
+
+            if (!file) {
+                LOG_ERROR(PACKAGE, "Unable to open {} to extract", path);
+                return;
+            }
+
+            extract_sis_compressed(data_stream, data->raw_data, file);
             fclose(file);
         }
 
@@ -351,6 +495,8 @@ namespace eka2l1 {
             }
 
             case ss_expr_op::EFuncExists: {
+                // The file may be one this package is still extracting
+                wait_extractions();
                 pass = io->exist(expr->val.unicode_string);
                 break;
             }
@@ -365,6 +511,13 @@ namespace eka2l1 {
             return pass;
         }
 
+        bool ss_interpreter::interpret(std::atomic<int> &progress) {
+            const bool result = interpret(main_controller, 0, progress);
+            wait_extractions();
+
+            return result;
+        }
+
         bool ss_interpreter::interpret(sis_controller *controller, const std::uint16_t base_data_idx, std::atomic<int> &progress) {
             // Set current controller
             current_controllers.push(controller);
@@ -451,6 +604,7 @@ namespace eka2l1 {
                             }
 
                             if (!yes_choosen) {
+                                wait_extractions();
                                 mngr->delete_files_and_bucket(current_controllers.top()->info.uid.uid);
                             }
 
@@ -488,6 +642,8 @@ namespace eka2l1 {
 
                             if (FOUND_STR(raw_path.find(".sis")) || FOUND_STR(raw_path.find(".sisx"))) {
                                 LOG_INFO(PACKAGE, "Detected an SmartInstaller SIS, path at: {}", raw_path);
+
+                                wait_extractions();
                                 mngr->install_package(common::utf8_to_ucs2(raw_path), drive_c, progress);
                             }
                         } else {
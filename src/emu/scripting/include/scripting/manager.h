@@ -31,6 +31,7 @@
 #include <pybind11/pybind11.h>
 #endif
 
+#include <atomic>
 #include <map>
 #include <mutex>
 #include <tuple>
@@ -110,7 +111,18 @@ namespace eka2l1::manager {
         // ================= PYTHON SECTION ========================
         std::unordered_map<std::string, script_module> modules;
         std::unordered_map<std::uint32_t, breakpoint_info_list_record> breakpoints; ///< Breakpoints complete patching
-        std::unordered_map<std::string, std::map<std::uint64_t, ipc_operation_func_list>> ipc_functions;
+
+        /**
+         * IPC hooks, keyed by (interned server ID << 32 | opcode). The table is copied on write and old
+         * copies are kept until destruction, so messages are looked up without locking.
+         */
+        struct ipc_hook_table {
+            std::unordered_map<std::uint64_t, ipc_operation_func_list> send_funcs_;
+            std::unordered_map<std::uint64_t, ipc_operation_func_list> complete_funcs_;
+        };
+
+        std::atomic<const ipc_hook_table *> ipc_functions;
+        std::vector<std::unique_ptr<ipc_hook_table>> ipc_function_tables;
 
         struct breakpoint_hit_info {
             bool hit_;
@@ -149,10 +161,10 @@ namespace eka2l1::manager {
         void handle_process_switch(arm::core *core_switch, kernel::process *old_friend, kernel::process *new_friend);
         void handle_uid_process_change(kernel::process *aff, const std::uint32_t old_one);
 
-        void call_ipc_send(const std::string &server_name, const int opcode, const std::uint32_t arg0,
+        void call_ipc_send(const std::uint32_t server_id, const int opcode, const std::uint32_t arg0,
             const std::uint32_t arg1, const std::uint32_t arg2, const std::uint32_t arg3,
             const std::uint32_t flags, const std::uint32_t reqstsaddr, kernel::thread *callee);
-        void call_ipc_complete(const std::string &server_name, const int opcode,
+        void call_ipc_complete(const std::uint32_t server_id, const int opcode,
             ipc_msg *msg);
 
         /**
@@ -57,7 +57,8 @@ namespace eka2l1::manager {
     }
 
     scripts::scripts(system *sys)
-        : sys(sys)
+        : ipc_functions(nullptr)
+        , sys(sys)
         , ipc_send_callback_handle(0)
         , ipc_complete_callback_handle(0)
         , breakpoint_hit_callback_handle(0)
@@ -89,6 +90,10 @@ namespace eka2l1::manager {
             kern->unregister_uid_of_process_change_callback(uid_change_callback_handle);
         }
 
+        // Hooks may hold script objects, release them while the interpreter is still here
+        ipc_functions = nullptr;
+        ipc_function_tables.clear();
+
         modules.clear();
         interpreter.release();
     }
@@ -161,13 +166,13 @@ namespace eka2l1::manager {
         if (!ipc_send_callback_handle) {
             kernel_system *kern = sys->get_kernel_system();
             
-            ipc_send_callback_handle = kern->register_ipc_send_callback([this](const std::string& svr_name, const int ord, const ipc_arg& args, address reqstsaddr, kernel::thread* callee) {
-                call_ipc_send(svr_name, ord, args.args[0], args.args[1], args.args[2], args.args[3], args.flag, reqstsaddr, callee);
+            ipc_send_callback_handle = kern->register_ipc_send_callback([this](service::server *svr, const int ord, const ipc_arg& args, address reqstsaddr, kernel::thread* callee) {
+                call_ipc_send(svr->get_hook_id(), ord, args.args[0], args.args[1], args.args[2], args.args[3], args.flag, reqstsaddr, callee);
             });
 
             ipc_complete_callback_handle = kern->register_ipc_complete_callback([this](ipc_msg *msg, const std::int32_t complete_code) {
                 if (msg->msg_session)
-                    call_ipc_complete(msg->msg_session->get_server()->name(), msg->function, msg);
+                    call_ipc_complete(msg->msg_session->get_server()->get_hook_id(), msg->function, msg);
             });
 
             breakpoint_hit_callback_handle = kern->register_breakpoint_hit_callback([this](arm::core *core, kernel::thread *correspond, const vaddress addr) {
@@ -217,8 +222,39 @@ namespace eka2l1::manager {
         return fine;
     }
 
+    static std::uint64_t make_ipc_hook_key(const std::uint32_t server_id, const int opcode) {
+        return (static_cast<std::uint64_t>(server_id) << 32) | static_cast<std::uint32_t>(opcode);
+    }
+
     void scripts::register_ipc(const std::string &server_name, const int opcode, const int invoke_when, ipc_operation_func func) {
-        ipc_functions[server_name][(static_cast<std::uint64_t>(opcode) | (static_cast<std::uint64_t>(invoke_when) << 32))].push_back(func);
+        kernel::ipc_hook_filter &hooks = sys->get_kernel_system()->get_ipc_hooks();
+        const std::uint64_t key = make_ipc_hook_key(hooks.intern(server_name), opcode);
+
+        // Registering only happens from script code, which always runs with the script lock held
+        const ipc_hook_table *current = ipc_functions.load(std::memory_order_relaxed);
+        auto new_table = current ? std::make_unique<ipc_hook_table>(*current) : std::make_unique<ipc_hook_table>();
+
+        kernel::ipc_hook_point point = kernel::ipc_hook_point_send;
+
+        switch (invoke_when) {
+        case 0:
+            new_table->send_funcs_[key].push_back(func);
+            break;
+
+        case 2:
+            new_table->complete_funcs_[key].push_back(func);
+            point = kernel::ipc_hook_point_complete;
+            break;
+
+        default:
+            LOG_WARN(SCRIPTING, "Unsupported IPC hook invoke time {}, hook ignored", invoke_when);
+            return;
+        }
+
+        ipc_functions.store(new_table.get(), std::memory_order_release);
+        ipc_function_tables.push_back(std::move(new_table));
+
+        hooks.subscribe(server_name, opcode, point);
     }
 
     void scripts::write_breakpoint_block(kernel::process *pr, const vaddress target) {
@@ -330,15 +366,28 @@ namespace eka2l1::manager {
         }
     }
 
-    void scripts::call_ipc_send(const std::string &server_name, const int opcode, const std::uint32_t arg0, const std::uint32_t arg1,
+    void scripts::call_ipc_send(const std::uint32_t server_id, const int opcode, const std::uint32_t arg0, const std::uint32_t arg1,
         const std::uint32_t arg2, const std::uint32_t arg3, const std::uint32_t flags, const std::uint32_t reqsts_addr,
         kernel::thread *callee) {
+        const ipc_hook_table *table = ipc_functions.load(std::memory_order_acquire);
+
+        if (!table) {
+            return;
+        }
+
+        auto funcs_ite = table->send_funcs_.find(make_ipc_hook_key(server_id, opcode));
+
+        if (funcs_ite == table->send_funcs_.end()) {
+            return;
+        }
+
+        // Only the scripts themselves need to be serialized
         std::lock_guard<std::mutex> guard(smutex);
 
         eka2l1::system *crr_instance = scripting::get_current_instance();
         eka2l1::scripting::set_current_instance(sys);
 
-        for (auto &ipc_func : ipc_functions[server_name][opcode]) {
+        for (auto &ipc_func : funcs_ite->second) {
             std::visit(overloaded {
                 [&](const pybind11::function &func) {
 #if ENABLE_PYTHON_SCRIPTING
@@ -359,14 +408,26 @@ namespace eka2l1::manager {
         scripting::set_current_instance(crr_instance);
     }
 
-    void scripts::call_ipc_complete(const std::string &server_name,
+    void scripts::call_ipc_complete(const std::uint32_t server_id,
         const int opcode, ipc_msg *msg) {
+        const ipc_hook_table *table = ipc_functions.load(std::memory_order_acquire);
+
+        if (!table) {
+            return;
+        }
+
+        auto funcs_ite = table->complete_funcs_.find(make_ipc_hook_key(server_id, opcode));
+
+        if (funcs_ite == table->complete_funcs_.end()) {
+            return;
+        }
+
         std::lock_guard<std::mutex> guard(smutex);
 
         eka2l1::system *crr_instance = scripting::get_current_instance();
         eka2l1::scripting::set_current_instance(sys);
 
-        for (auto &ipc_func : ipc_functions[server_name][(2ULL << 32) | opcode]) {
+        for (auto &ipc_func : funcs_ite->second) {
             std::visit(overloaded {
                 [&](const pybind11::function &func) {
 #if ENABLE_PYTHON_SCRIPTING   
@@ -26,6 +26,7 @@
 #include <utils/des.h>
 #include <vfs/vfs.h>
 
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -51,6 +52,10 @@ namespace eka2l1 {
         struct command_line;
     }
 
+    namespace service {
+        class parsed_file_index;
+    }
+
     struct apa_app_info {
         std::uint32_t uid; ///< The UID of the application.
         epoc::filename app_path; ///< The path to the application DLL (EKA1) / EXE (EKA2)
@@ -183,6 +188,9 @@ namespace eka2l1 {
         std::vector<std::int64_t> watchs_;
         fbs_server *fbsserv;
 
+        // Parsed registrations from previous boots, new architecture only
+        std::unique_ptr<service::parsed_file_index> registry_index_;
+
         enum {
             AL_INITED = 0x1
         };
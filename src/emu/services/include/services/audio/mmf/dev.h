@@ -56,6 +56,7 @@ namespace eka2l1 {
 
         kernel::chunk *buffer_chunk_;
         kernel::handle last_buffer_handle_;
+        std::uint32_t pending_write_size_;      ///< Size of a played buffer the stream had no room for yet.
 
         epoc::notify_info finish_info_;
         epoc::notify_info buffer_fill_info_;
@@ -28,6 +28,7 @@
 #include <cstdint>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace eka2l1 {
@@ -92,6 +93,7 @@ namespace eka2l1 {
 
         std::uint32_t owner_uid;
 
+        // Sorted by key. Use add_new_entry, or sort_entries after filling it directly.
         std::vector<central_repo_entry> entries;
         std::vector<central_repo_client_subsession *> attached;
 
@@ -109,6 +111,29 @@ namespace eka2l1 {
         void write_changes(eka2l1::io_system *io, device_manager *mngr);
         central_repo_entry *find_entry(const std::uint32_t key);
 
+        /**
+         * \brief Sort entries by key and drop duplicated keys, keeping the first one.
+         * 
+         * Loaders fill the entry list in bulk and call this once, instead of paying a sorted
+         * insert for every key.
+         */
+        void sort_entries();
+
+        /**
+         * \brief Get the range of entries that may match the given partial key and mask.
+         * 
+         * Every key matching the pattern lies between (partial_key & mask) and (partial_key | ~mask),
+         * so the returned range is narrowed by binary search. Entries inside the range still need to
+         * be checked against the mask.
+         * 
+         * \param partial_key The bit pattern to be matched.
+         * \param mask        The mask that requires which bit is mandatory.
+         * 
+         * \returns Pair of begin and end iterator of the candidate range.
+         */
+        std::pair<std::vector<central_repo_entry>::iterator, std::vector<central_repo_entry>::iterator>
+        candidate_range(const std::uint32_t partial_key, const std::uint32_t mask);
+
         std::uint32_t get_default_meta_for_new_key(const std::uint32_t key);
 
         bool add_new_entry(const std::uint32_t key, const central_repo_entry_variant &var);
@@ -233,7 +258,11 @@ namespace eka2l1 {
             std::uint32_t match;
         };
 
-        std::vector<cenrep_notify_info> notifies;
+        // Single key requests (full mask), indexed by the key
+        std::unordered_map<std::uint32_t, cenrep_notify_info> key_notifies;
+
+        // Group requests, these need a mask check on every modification
+        std::vector<cenrep_notify_info> group_notifies;
 
         enum session_flags {
             active = 0x1
@@ -285,7 +314,8 @@ namespace eka2l1 {
 
         /*! \brief Notify that a modification has success.
          *
-         * This iters through all notify requests, if it matchs than notify request client.
+         * Complete the single key request of this key (if any), and all group requests whose
+         * pattern matches the key.
         */
         void modification_success(const std::uint32_t key);
 
@@ -34,6 +34,10 @@ namespace eka2l1 {
         struct entry;
     }
 
+    namespace service {
+        class parsed_file_index;
+    }
+
     enum ecom_opcodes {
         ecom_notify_on_change,
         ecom_cancel_notify_on_change,
@@ -114,10 +118,9 @@ namespace eka2l1 {
         bool register_implementation(const std::uint32_t interface_uid, ecom_implementation_info_ptr &impl);
 
         bool load_plugins(eka2l1::io_system *io);
-        bool load_and_install_plugin_from_buffer(const std::u16string &name, std::uint8_t *buf, const std::size_t size,
-            const drive_number drv);
+        bool install_plugin(const std::u16string &name, ecom_plugin &plugin, const drive_number drv);
 
-        bool load_plugin_on_drive(eka2l1::io_system *io, const drive_number drv);
+        bool load_plugin_on_drive(eka2l1::io_system *io, const drive_number drv, service::parsed_file_index &index);
 
         /*
          * \brief Search the ROM and ROFS for an archive of plugins.
@@ -133,7 +136,7 @@ namespace eka2l1 {
 
         /*! \brief Load archives
          */
-        bool load_archives(eka2l1::io_system *io);
+        bool load_archives(eka2l1::io_system *io, service::parsed_file_index &index);
 
         void connect(service::ipc_context &ctx) override;
 
@@ -60,6 +60,11 @@ namespace eka2l1 {
         std::vector<std::uint32_t> extended_interfaces;
 
         void do_state(common::chunkyseri &seri, const bool support_extended_interface, const bool old_abi);
+
+        /**
+         * \brief Serialize what the resource file parser fills in, for the persistent plugin index.
+         */
+        void do_index_state(common::chunkyseri &seri);
     };
 
     using ecom_implementation_info_ptr = std::shared_ptr<ecom_implementation_info>;
@@ -74,6 +79,8 @@ namespace eka2l1 {
         std::uint32_t uid;
 
         std::vector<ecom_interface_info> interfaces;
+
+        void do_index_state(common::chunkyseri &seri);
     };
 
     enum ecom_type {
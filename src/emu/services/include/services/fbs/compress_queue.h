@@ -20,32 +20,95 @@
 
 #pragma once
 
-#include <common/queue.h>
 #include <utils/reqsts.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
 #include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
 
 namespace eka2l1 {
     struct fbsbitmap;
     class fbs_server;
 
+    /**
+     * \brief Statistics of the compression queue.
+     */
+    struct compress_queue_stats {
+        std::uint32_t queue_depth_;             ///< Number of requests waiting to be picked by a worker.
+        std::uint64_t total_compressed_;        ///< Total bitmaps that went through a worker.
+        std::uint64_t total_latency_us_;        ///< Sum of latency from request to completion, in microseconds.
+        std::uint64_t total_bytes_saved_;       ///< Sum of bytes saved by compression.
+    };
+
     /**
      * \brief Queue that handle bitmap compression.
      * 
-     * This queue runs on separate thread.
+     * Requests are served by a pool of worker threads. The encoding runs concurrently on the workers,
+     * while the chunk allocation and notification steps are serialized, since they touch server state.
+     * 
+     * Requests coming from higher priority threads (foreground apps) are served first.
      */
     class compress_queue {
-        request_queue<fbsbitmap *> queue_;
+        struct compress_request {
+            fbsbitmap *bmp_;
+            int priority_;
+            std::uint64_t sequence_;
+            std::chrono::steady_clock::time_point queued_time_;
+        };
+
+        struct compress_request_comparator {
+            bool operator()(const compress_request &lhs, const compress_request &rhs) const {
+                if (lhs.priority_ == rhs.priority_) {
+                    // FIFO on same priority
+                    return lhs.sequence_ > rhs.sequence_;
+                }
+
+                return lhs.priority_ < rhs.priority_;
+            }
+        };
+
+        std::priority_queue<compress_request, std::vector<compress_request>, compress_request_comparator> queue_;
+        std::mutex queue_mutex_;
+        std::condition_variable queue_cond_;
+        std::condition_variable queue_full_cond_;
+        std::uint32_t max_pending_count_;
+        std::uint64_t sequence_counter_;
+        bool abort_;
+
+        std::vector<std::unique_ptr<std::thread>> workers_;
+
         fbs_server *serv_;
 
         std::vector<epoc::notify_info> notifies_;
         std::mutex notify_mutex_;
 
+        // Serialize chunk allocation, bitmap creation and notification between workers.
+        std::mutex commit_mutex_;
+
+        std::atomic<std::uint64_t> total_compressed_;
+        std::atomic<std::uint64_t> total_latency_us_;
+        std::atomic<std::uint64_t> total_bytes_saved_;
+
+        void worker_loop();
+
     protected:
-        void actual_compress(fbsbitmap *bmp);
+        void actual_compress(fbsbitmap *bmp, std::vector<std::uint8_t> &scratch);
 
     public:
-        explicit compress_queue(fbs_server *serv);
+        /**
+         * \brief Construct the compress queue.
+         * 
+         * \param serv          The FBS server that owns this queue.
+         * \param worker_count  Number of worker threads. 0 to derive from hardware concurrency.
+         */
+        explicit compress_queue(fbs_server *serv, const std::uint32_t worker_count = 0);
+        ~compress_queue();
 
         void notify(epoc::notify_info &nof);
 
@@ -63,19 +126,28 @@ namespace eka2l1 {
          * 
          * If the compress queue is full. This function stalls until the queue has slot for this bitmap.
          * 
-         * 
-         * \param bmp   The bitmap to compress.
+         * \param bmp       The bitmap to compress.
+         * \param priority  Priority of the request. Higher value gets served first.
          */
-        void compress(fbsbitmap *bmp);
+        void compress(fbsbitmap *bmp, const int priority = 0);
 
         /**
-         * \brief Run the compression queue.
+         * \brief Start the worker threads.
          */
         void run();
 
         /**
-         * \brief Abort the compression run.
+         * \brief Abort the compression run and join all workers.
          */
         void abort();
+
+        /**
+         * \brief Get a snapshot of the queue statistics.
+         */
+        compress_queue_stats get_stats();
+
+        std::size_t worker_count() const {
+            return workers_.size();
+        }
     };
-}
\ No newline at end of file
+}
@@ -325,7 +325,6 @@ namespace eka2l1 {
         std::unique_ptr<epoc::chunk_allocator> large_chunk_allocator;
 
         std::unique_ptr<compress_queue> compressor;
-        std::unique_ptr<std::thread> compressor_thread;
 
         epoc::open_font_session_cache_list *session_cache_list;
         epoc::open_font_session_cache_link *session_cache_link;
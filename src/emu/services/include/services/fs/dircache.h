@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace eka2l1 {
+    class io_system;
+    struct directory;
+}
+
+namespace eka2l1::epoc::fs {
+    struct entry;
+
+    /**
+     * \brief A directory listing, already packed in the layout the client TEntryArray expects.
+     *
+     * Each entry is the TEntry header, the name aligned to 4 bytes, and on 64-bit capable
+     * versions the high size word plus a reserved word.
+     */
+    struct packed_dir_listing {
+        std::vector<std::uint8_t> data_;
+        std::vector<std::uint32_t> offsets_; ///< Start of each entry, plus the end of the last one.
+        bool support_64bit_size_;
+
+        explicit packed_dir_listing(const bool support_64bit_size);
+
+        void add_entry(const entry &ent);
+
+        std::size_t entry_count() const {
+            return offsets_.size() - 1;
+        }
+
+        /**
+         * \brief Copy as many whole entries as the destination can take.
+         *
+         * \param first      Index of the first entry to copy.
+         * \param dest       Destination buffer.
+         * \param dest_size  Size of the destination buffer, in bytes.
+         * \param written    Receives the number of bytes copied.
+         *
+         * \returns Number of entries copied.
+         */
+        std::size_t copy_entries(const std::size_t first, std::uint8_t *dest, const std::size_t dest_size,
+            std::size_t &written) const;
+
+        /**
+         * \brief Unpack one entry back to its structure form, for reads one entry at a time.
+         */
+        void get_entry(const std::size_t index, entry &ent) const;
+    };
+
+    using packed_dir_listing_ptr = std::shared_ptr<const packed_dir_listing>;
+
+    /**
+     * \brief Drain a directory into a packed listing.
+     */
+    std::shared_ptr<packed_dir_listing> pack_dir_listing(io_system *io, directory *dir, const bool support_64bit_size);
+
+    /**
+     * \brief Cache of packed listings, keyed on the host path of the listed directory.
+     *
+     * Listings of a directory are dropped when the host directory watcher reports a change in it,
+     * or when the file server itself changes an entry in it. Directories that are not on a host
+     * file system (ROM), or that the host can not watch, are never cached.
+     *
+     * Each cached directory holds a host watch. Directories are evicted least recently used first,
+     * together with their watch, when the listings go over the size budget or the directory count
+     * goes over its limit.
+     */
+    class dir_listing_cache {
+        struct cached_dir {
+            std::int64_t watch_ = -1;
+            std::uint64_t generation_ = 0;
+            std::size_t size_ = 0;
+
+            std::unordered_map<std::u16string, packed_dir_listing_ptr> listings_;
+            std::list<std::u16string>::iterator lru_link_;
+        };
+
+        io_system *io_;
+
+        std::mutex lock_;
+        std::unordered_map<std::u16string, cached_dir> dirs_;
+        std::list<std::u16string> lru_;
+
+        std::size_t total_size_;
+        std::size_t max_size_;
+        std::size_t max_dirs_;
+
+        void drop_listings(cached_dir &dir);
+        void invalidate_host_dir(const std::u16string &host_key);
+        void evict_to_budget(std::vector<std::int64_t> &evicted_watches);
+        void unwatch_all(const std::vector<std::int64_t> &watches);
+
+        std::u16string host_key_of(const std::u16string &guest_dir);
+
+    public:
+        static constexpr std::size_t DEFAULT_MAX_SIZE = 8 * 1024 * 1024;
+        static constexpr std::size_t DEFAULT_MAX_DIRS = 256;
+
+        explicit dir_listing_cache(io_system *io, const std::size_t max_size = DEFAULT_MAX_SIZE,
+            const std::size_t max_dirs = DEFAULT_MAX_DIRS);
+        ~dir_listing_cache();
+
+        /**
+         * \brief Get the listing of an opened directory, packing it on a miss.
+         *
+         * \param path                Path given to open the directory, with the optional wildcard filter.
+         * \param attrib              Attribute mask the directory was opened with.
+         * \param dir                 The opened directory, drained only on a miss.
+         * \param support_64bit_size  True if entries carry the high size word.
+         *
+         * \returns The listing. It stays valid for the caller even if the cache drops it later.
+         */
+        packed_dir_listing_ptr get_listing(const std::u16string &path, const std::uint32_t attrib, directory *dir,
+            const bool support_64bit_size);
+
+        /**
+         * \brief Drop cached listings that may contain the given entry.
+         *
+         * Both the parent directory and, in case the entry is a directory, the entry itself are dropped.
+         *
+         * \param path Full guest path of the created, deleted or modified entry.
+         */
+        void invalidate(const std::u16string &path);
+
+        std::size_t size() const {
+            return total_size_;
+        }
+
+        /**
+         * \brief Get the number of directories the cache holds a host watch on.
+         */
+        std::size_t watched_dir_count();
+    };
+}
@@ -22,14 +22,20 @@
 
 #include <services/context.h>
 #include <services/framework.h>
+#include <services/fs/dircache.h>
+#include <services/fs/ioworker.h>
 #include <kernel/server.h>
 #include <utils/des.h>
+#include <utils/reqsts.h>
 
 #include <mem/ptr.h>
 
 #include <atomic>
 #include <clocale>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <regex>
 #include <unordered_map>
 
@@ -80,7 +86,14 @@ namespace eka2l1 {
 
         bool exclusive{ false };
         kernel::uid process{ 0 };
-        
+
+        // Directory only: the packed listing being read, and the next entry to give out
+        epoc::fs::packed_dir_listing_ptr dir_listing;
+        std::size_t dir_listing_cursor{ 0 };
+
+        // File only: the pool that may still have I/O queued on this node
+        epoc::fs::io_worker_pool *io_pool{ nullptr };
+
         void deref() override;
     };
 
@@ -97,9 +110,7 @@ namespace eka2l1 {
     struct fs_server_client : public service::typical_session {
         std::u16string ss_path;
 
-        fs_node *get_file_node(const int handle) {
-            return obj_table_.get<fs_node>(handle);
-        }
+        fs_node *get_file_node(const int handle);
 
         explicit fs_server_client(service::typical_server *srv, kernel::uid suid, epoc::version client_version, service::ipc_context *ctx);
         void fetch(service::ipc_context *ctx) override;
@@ -295,6 +306,27 @@ namespace eka2l1 {
         service::property *system_drive_prop;
         std::u16string default_sys_path;
 
+        epoc::fs::dir_listing_cache dir_cache;
+
+        // The message itself is gone once the handler returns, keep what is needed to complete it
+        struct pending_io {
+            const void *key = nullptr;
+            epoc::notify_info info;
+            kernel::process *owner = nullptr;
+            address length_des = 0;         ///< Descriptor that receives the result as its length, zero for none.
+            std::int64_t result = 0;
+            bool done = false;
+        };
+
+        std::unique_ptr<epoc::fs::io_worker_pool> io_pool;
+        std::map<std::uint64_t, pending_io> pending_ios;    ///< Ordered by submission.
+        std::mutex pending_ios_lock;
+        std::uint64_t pending_io_counter;
+        int io_complete_evt;
+
+        void complete_async_io(const std::uint64_t id);
+        void finish_async_ios(const void *key, const std::uint64_t last_id);
+
         void connect(service::ipc_context &ctx) override;
         void disconnect(service::ipc_context &ctx) override;
 
@@ -311,6 +343,32 @@ namespace eka2l1 {
 
     public:
         explicit fs_server(system *sys);
+        ~fs_server() override;
+
+        /**
+         * \brief Run a file operation on the I/O worker pool, and complete the message once it is done.
+         *
+         * Requests of the same key complete in the order they were queued.
+         *
+         * \param ctx         Context of the message to complete later.
+         * \param key         What the operation works on, usually the file node. Operations on the same key are ordered.
+         * \param work        The operation, run on a worker thread. It must not touch kernel state.
+         * \param length_arg  Index of the descriptor argument whose length is set to the result, or -1.
+         */
+        void queue_async_io(service::ipc_context *ctx, const void *key, epoc::fs::io_worker_pool::work_func work,
+            const int length_arg = -1);
+
+        /**
+         * \brief Wait for the queued operations of a key, and complete their requests.
+         *
+         * Call this before handling a request synchronously on the key, so it does not complete
+         * ahead of the queued ones. The kernel must be locked.
+         */
+        void flush_async_io(const void *key);
+
+        epoc::fs::io_worker_pool *get_io_pool() {
+            return io_pool.get();
+        }
 
         file *get_file(const kernel::uid session_uid, const std::uint32_t handle);
     };
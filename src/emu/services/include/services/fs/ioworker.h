@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace eka2l1::epoc::fs {
+    /**
+     * \brief Pool of host threads doing file I/O on behalf of the file server.
+     *
+     * Jobs are submitted with a key, usually the file node they work on. Jobs of the same key run
+     * one after another in submission order, jobs of different keys may run concurrently.
+     */
+    class io_worker_pool {
+    public:
+        using work_func = std::function<std::int64_t()>;
+        using done_func = std::function<void(std::int64_t)>;
+
+    private:
+        struct job {
+            work_func work_;
+            done_func done_;
+        };
+
+        struct strand {
+            std::deque<job> jobs_;
+            bool running_ = false;
+        };
+
+        std::unordered_map<const void *, strand> strands_;
+        std::deque<const void *> ready_;
+
+        std::mutex lock_;
+        std::condition_variable ready_cond_;
+        std::condition_variable idle_cond_;
+
+        std::vector<std::thread> workers_;
+        std::uint32_t worker_count_;
+        bool abort_;
+
+        void worker_loop();
+
+    public:
+        static constexpr std::uint32_t DEFAULT_WORKER_COUNT = 2;
+
+        explicit io_worker_pool(const std::uint32_t worker_count = DEFAULT_WORKER_COUNT);
+        ~io_worker_pool();
+
+        /**
+         * \brief Queue a job. Worker threads are started on the first submit.
+         *
+         * \param key   Ordering key. Jobs with the same key never overlap.
+         * \param work  The I/O to do. Its result is passed to the done callback.
+         * \param done  Called on the worker thread right after the work finished.
+         */
+        void submit(const void *key, work_func work, done_func done);
+
+        /**
+         * \brief Block until all jobs queued with the given key have finished.
+         */
+        void wait_idle(const void *key);
+
+        bool is_idle(const void *key);
+    };
+}
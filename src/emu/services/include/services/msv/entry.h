@@ -23,8 +23,11 @@
 #include <common/uid.h>
 
 #include <cstdint>
+#include <list>
 #include <optional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace eka2l1 {
     class io_system;
@@ -52,18 +55,45 @@ namespace eka2l1::epoc::msv {
     };
 
     struct entry_indexer {
-        std::vector<entry> entries_;
+    protected:
+        struct entry_node {
+            entry ent_;
+            bool loaded_; ///< True if the body data (UIDs, strings, time) is in memory.
+            std::list<std::uint32_t>::iterator lru_pos_;
+        };
+
+        // Keyed by entry ID without the drive bits. Nodes do not move, so entry pointers stay valid.
+        std::unordered_map<std::uint32_t, entry_node> entries_;
+
+        // Parent ID to child keys, sorted by ID
+        std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> children_;
+
+        // Keys of entries with loaded data, most recently used first
+        std::list<std::uint32_t> lru_;
+        std::size_t max_loaded_entries_;
+
+        std::size_t index_record_count_; ///< Number of records in the entries file, including superseded ones.
 
         io_system *io_;
         drive_number rom_drv_;
         language preferred_lang_;
         std::u16string msg_dir_;
 
-    protected:
         bool create_standard_entries(drive_number crr_drive);
         bool create_root_entry();
 
-        bool update_entries_file(const std::size_t entry_pos_start);
+        /**
+         * \brief       Append the index record of an entry to the entries file.
+         * 
+         * The entries file is a journal: a record of an ID supersedes previous records of the same ID.
+         */
+        bool append_entries_file(const entry &ent);
+
+        /**
+         * \brief       Rewrite the entries file with one record per entry.
+         */
+        bool rewrite_entries_file();
+
         bool load_entries_file(drive_number crr_drive);
 
         std::optional<std::u16string> get_entry_data_file(entry &ent);
@@ -84,11 +114,35 @@ namespace eka2l1::epoc::msv {
          */
         bool load_entry_data(entry &ent);
 
+        entry_node *find_node(const std::uint32_t id);
+
+        /**
+         * \brief       Make sure the body data of the entry is in memory, and mark it as recently used.
+         */
+        void touch_node(const std::uint32_t key, entry_node &node);
+
+        /**
+         * \brief       Drop body data of least recently used entries above the limit.
+         * 
+         * This is done at the start of each lookup, so entries returned by a lookup stay loaded until the next one.
+         */
+        void trim_loaded_entries();
+
     public:
-        explicit entry_indexer(io_system *io, const std::u16string &msg_folder, const language preferred_lang);
+        explicit entry_indexer(io_system *io, const std::u16string &msg_folder, const language preferred_lang,
+            const std::size_t max_loaded_entries = 512);
+
         bool add_entry(entry &ent);
 
         entry *get_entry(const std::uint32_t id);
         std::vector<entry *> get_entries_by_parent(const std::uint32_t parent_id);
+
+        std::size_t total_entries() const {
+            return entries_.size();
+        }
+
+        std::size_t loaded_entries() const {
+            return lru_.size();
+        }
     };
-}
\ No newline at end of file
+}
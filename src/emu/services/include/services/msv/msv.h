@@ -95,7 +95,8 @@ namespace eka2l1 {
 
         std::uint32_t flags_;
 
-        std::vector<epoc::msv::entry *> child_entries_;
+        // Copies, since entry data held by the indexer may be unloaded between two packs
+        std::vector<epoc::msv::entry> child_entries_;
 
     protected:
         bool listen(epoc::notify_info &info, epoc::des8 *change, epoc::des8 *sel);
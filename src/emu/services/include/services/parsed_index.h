@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace eka2l1 {
+    class io_system;
+}
+
+namespace eka2l1::service {
+    /**
+     * \brief Identity of a file a parsed record was built from.
+     */
+    struct parsed_file_stamp {
+        std::u16string path_;
+        std::uint64_t size_;
+        std::uint64_t last_write_;
+
+        bool operator==(const parsed_file_stamp &rhs) const {
+            return (size_ == rhs.size_) && (last_write_ == rhs.last_write_);
+        }
+    };
+
+    /**
+     * \brief Persistent index of data parsed from guest files.
+     *
+     * Servers that parse a lot of resource files at startup store the parsed result here, keyed
+     * on the path, size and last write time of the files it was built from. On the next boot,
+     * a file that did not change is served from the index instead of being opened and parsed again.
+     *
+     * The index is dropped as a whole when its tag changes. Servers use the tag for anything
+     * else the parsed data depends on, such as the format of the record or the system language.
+     */
+    class parsed_file_index {
+        struct record {
+            std::vector<parsed_file_stamp> sources_; ///< The key file first, then the files it pulled in.
+            std::vector<std::uint8_t> data_;
+            bool used_ = false;
+        };
+
+        io_system *io_;
+        std::u16string index_path_;
+        std::uint64_t tag_;
+
+        std::unordered_map<std::u16string, record> records_;
+        bool dirty_;
+
+        std::uint32_t hit_count_;
+        std::uint32_t miss_count_;
+
+        bool sources_unchanged(const std::vector<parsed_file_stamp> &sources);
+
+    public:
+        explicit parsed_file_index(io_system *io, const std::u16string &index_path, const std::uint64_t tag);
+
+        /**
+         * \brief Load the index from disk.
+         *
+         * \returns False if the index does not exist, is corrupted or has another tag.
+         *          The index is then empty and will be rebuilt.
+         */
+        bool load();
+
+        /**
+         * \brief Write the index back to disk if anything changed.
+         *
+         * Records that were neither found nor stored since the index was loaded belong to files
+         * that no longer exist, and are dropped.
+         *
+         * \returns True on success, or if there was nothing to write.
+         */
+        bool save();
+
+        /**
+         * \brief Get the stamp of a file as it is now.
+         */
+        std::optional<parsed_file_stamp> stamp(const std::u16string &path);
+
+        /**
+         * \brief Find the parsed data of a file.
+         *
+         * \param key   Stamp of the file, as it is now.
+         *
+         * \returns Parsed data if the file and all files the record was built from are unchanged,
+         *          else nullptr.
+         */
+        const std::vector<std::uint8_t> *find(const parsed_file_stamp &key);
+
+        /**
+         * \brief Store parsed data of a file.
+         *
+         * \param sources   Stamps of the file and of all other files the data was built from.
+         * \param data      The parsed data.
+         */
+        void store(const std::vector<parsed_file_stamp> &sources, std::vector<std::uint8_t> data);
+
+        std::size_t size() const {
+            return records_.size();
+        }
+
+        std::uint32_t hit_count() const {
+            return hit_count_;
+        }
+
+        std::uint32_t miss_count() const {
+            return miss_count_;
+        }
+    };
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <services/ui/icon/common.h>
+
+#include <common/hash.h>
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace eka2l1::epoc {
+    /**
+     * \brief What decides that two icon requests want the same bitmap.
+     *
+     * Like the original server, only the bitmap ID, the folded container file name and
+     * whether it's an app icon matter.
+     */
+    struct akn_icon_cache_key {
+        std::uint32_t file_id; ///< Interned folded file name.
+        int bitmap_id;
+        bool app_icon;
+    };
+
+    inline bool operator==(const akn_icon_cache_key &lhs, const akn_icon_cache_key &rhs) {
+        return (lhs.file_id == rhs.file_id) && (lhs.bitmap_id == rhs.bitmap_id) && (lhs.app_icon == rhs.app_icon);
+    }
+}
+
+namespace std {
+    template <>
+    struct hash<eka2l1::epoc::akn_icon_cache_key> {
+        std::size_t operator()(eka2l1::epoc::akn_icon_cache_key const &key) const noexcept {
+            std::size_t seed = 0x1C0AC4E;
+
+            eka2l1::common::hash_combine(seed, key.file_id);
+            eka2l1::common::hash_combine(seed, key.bitmap_id);
+            eka2l1::common::hash_combine(seed, key.app_icon);
+
+            return seed;
+        }
+    };
+}
+
+namespace eka2l1::epoc {
+    /**
+     * \brief Icons given out by the icon server, indexed by their spec.
+     *
+     * Each icon counts its users. When the last one frees it, the icon is kept around in a LRU
+     * list, in case it's asked again. Once unused icons take more memory than the budget, the
+     * oldest ones are evicted and their bitmaps are given to the release function.
+     */
+    class akn_icon_cache {
+    public:
+        using release_func = std::function<void(const akn_icon_srv_return_data &data)>;
+
+    private:
+        struct entry {
+            akn_icon_srv_return_data data_;
+            std::size_t memory_size_;
+            int use_count_;
+
+            std::list<akn_icon_cache_key>::iterator lru_link_;
+        };
+
+        std::unordered_map<std::u16string, std::uint32_t> file_ids_;
+        std::unordered_map<akn_icon_cache_key, entry> entries_;
+        std::list<akn_icon_cache_key> lru_; ///< Unused icons, most recently freed first.
+
+        release_func release_;
+
+        std::size_t unused_size_;
+        std::size_t budget_;
+
+        void evict_to_budget();
+
+    public:
+        static constexpr std::size_t DEFAULT_BUDGET = 4 * 1024 * 1024;
+
+        explicit akn_icon_cache(release_func release, const std::size_t budget = DEFAULT_BUDGET);
+
+        /**
+         * \brief Make the lookup key of an icon spec.
+         */
+        akn_icon_cache_key make_key(const akn_icon_params &spec);
+
+        /**
+         * \brief Take a new use of an icon, if it's in the cache.
+         *
+         * \returns The icon's bitmaps, or nothing if the icon is not cached.
+         */
+        std::optional<akn_icon_srv_return_data> acquire(const akn_icon_cache_key &key);
+
+        /**
+         * \brief Add a newly created icon, with one use.
+         *
+         * \param key         Key of the icon.
+         * \param data        The icon's bitmaps.
+         * \param memory_size Memory the bitmaps take, counted against the budget once unused.
+         */
+        void add(const akn_icon_cache_key &key, const akn_icon_srv_return_data &data, const std::size_t memory_size);
+
+        /**
+         * \brief Drop one use of an icon.
+         *
+         * \param key         Key of the icon.
+         * \param keep_cached False to release the bitmaps right away when the icon becomes unused.
+         *
+         * \returns False if the icon is not in the cache.
+         */
+        bool release(const akn_icon_cache_key &key, const bool keep_cached);
+
+        void set_budget(const std::size_t budget);
+
+        std::size_t count() const {
+            return entries_.size();
+        }
+
+        /**
+         * \brief Memory taken by icons that are cached but not used.
+         */
+        std::size_t unused_size() const {
+            return unused_size_;
+        }
+    };
+}
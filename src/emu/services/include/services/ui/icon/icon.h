@@ -17,6 +17,7 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <services/ui/icon/cache.h>
 #include <services/ui/icon/common.h>
 #include <services/faker.h>
 #include <services/framework.h>
@@ -24,15 +25,6 @@
 #include <memory>
 
 namespace eka2l1 {
-    constexpr std::uint32_t MAX_CACHE_SIZE = 1024;
-
-    struct icon_data_item {
-        epoc::akn_icon_params spec;
-        epoc::akn_icon_srv_return_data ret;
-
-        int use_count{ 0 };
-    };
-
     class fbs_server;
 
     class akn_icon_server_session : public service::typical_session {
@@ -52,14 +44,12 @@ namespace eka2l1 {
         std::uint32_t flags{ 0 };
 
         fbs_server *fbss;
-        std::vector<icon_data_item> icons;
+        epoc::akn_icon_cache icons;
 
         std::unique_ptr<service::faker> icon_process;
 
         void init_server();
-        std::optional<epoc::akn_icon_srv_return_data> find_existing_icon(epoc::akn_icon_params &spec, std::size_t *idx = nullptr);
-        void add_icon(const epoc::akn_icon_srv_return_data &ret, const epoc::akn_icon_params &spec);
-        bool cache_or_delete_icon(const std::size_t icon_idx);
+        void delete_icon_bitmaps(const epoc::akn_icon_srv_return_data &ret);
 
     public:
         epoc::akn_icon_init_data *get_init_data() {
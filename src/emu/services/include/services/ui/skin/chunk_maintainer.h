@@ -25,13 +25,19 @@
 #include <services/fbs/fbs.h>
 
 #include <cstdint>
+#include <list>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace eka2l1::kernel {
     class chunk;
 }
 
+namespace eka2l1::common {
+    class chunkyseri;
+}
+
 namespace eka2l1::epoc {
     struct skn_file;
     struct skn_bitmap_info;
@@ -89,6 +95,23 @@ namespace eka2l1::epoc {
             std::int64_t gran_size_;
         };
 
+        struct scalable_gfx_key {
+            pid item_id_;
+            std::int32_t layout_type_;
+            vec2 layout_size_;
+
+            bool operator==(const scalable_gfx_key &rhs) const {
+                return (item_id_ == rhs.item_id_) && (layout_type_ == rhs.layout_type_) && (layout_size_ == rhs.layout_size_);
+            }
+        };
+
+        struct scalable_gfx_key_hash {
+            std::size_t operator()(const scalable_gfx_key &key) const;
+        };
+
+        // Front is the most recently stored item, back is the next one to be evicted.
+        using scalable_gfx_lru_list = std::list<std::pair<scalable_gfx_key, std::size_t>>;
+
         kernel::chunk *shared_chunk_;
         std::size_t current_granularity_off_;
         std::size_t max_size_gran_;
@@ -103,6 +126,31 @@ namespace eka2l1::epoc {
 
         std::unique_ptr<akn_skin_bitmap_store> bitmap_store_;
 
+        // Host-side indexes, kept in sync with the guest-visible tables in the shared chunk.
+        std::unordered_map<std::uint64_t, std::int32_t> item_def_index_;
+        std::unordered_map<scalable_gfx_key, scalable_gfx_lru_list::iterator, scalable_gfx_key_hash> scalable_gfx_index_;
+        scalable_gfx_lru_list scalable_gfx_lru_;
+
+        /**
+         * \brief   Get size of an item definition entry in the definition area.
+         */
+        const std::uint32_t definition_size() const;
+
+        /**
+         * \brief   Get pointer to the item definition at the given index.
+         */
+        akns_item_def *item_definition_at(const std::int32_t index);
+
+        /**
+         * \brief   Rebuild the item definition index from the definition area.
+         */
+        void rebuild_item_definition_index();
+
+        /**
+         * \brief   Empty all areas and host indexes, bringing the chunk back to its freshly created state.
+         */
+        void clear_areas();
+
         /**
          * \brief    Get maximum number of filename that the filename area can hold.
          * \returns  uint32_t(-1) if the filename area doesn't exist, else the expected value.
@@ -323,6 +371,35 @@ namespace eka2l1::epoc {
          */
         akns_item_def *get_item_definition(const epoc::pid &id);
 
+        /**
+         * \brief   Calculate the key identifying the chunk layout an import would produce.
+         *
+         * The key covers the SKN file content, the filename base and the chunk configuration.
+         *
+         * \param   skn_data        Content of the SKN file.
+         * \param   skn_size        Size of the SKN file in bytes.
+         * \param   filename_base   Filename base that will be passed to import.
+         *
+         * \returns The key, to be used with do_import_cache_state.
+         */
+        std::uint64_t import_cache_key(const std::uint8_t *skn_data, const std::size_t skn_size,
+            const std::u16string &filename_base) const;
+
+        /**
+         * \brief   Serialize or deserialize the imported skin areas.
+         *
+         * When reading, the areas are only restored if the cache was written with the same key and
+         * the same chunk layout. On failure, the chunk is reset to be empty so an import can follow.
+         *
+         * Scalable graphics are not part of the cache, since they refer to runtime bitmap handles.
+         *
+         * \param   seri    The serializer.
+         * \param   key     The key returned from import_cache_key.
+         *
+         * \returns True on success.
+         */
+        bool do_import_cache_state(common::chunkyseri &seri, const std::uint64_t key);
+
         bool store_scalable_gfx(const pid item_id, const skn_layout_info layout_info, fbsbitmap *bmp, fbsbitmap *mask);
 
         const std::uint32_t level() const {
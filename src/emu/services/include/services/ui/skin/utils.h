@@ -46,4 +46,12 @@ namespace eka2l1::epoc {
      * \returns The path to the resource folder correspond to specified PID, else nullopt.
      */
     std::optional<std::u16string> get_resource_path_of_skin(eka2l1::io_system *io, const epoc::pid skin_pid);
+
+    /**
+     * \brief Get the path to the file caching the imported chunk layout of skin with specified package ID.
+     * 
+     * \param   skin_pid      The PID of the skin.
+     * \returns Path to the cache file. The file may not exist.
+     */
+    std::u16string get_import_cache_path_of_skin(const epoc::pid skin_pid);
 }
\ No newline at end of file
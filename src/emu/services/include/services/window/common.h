@@ -419,6 +419,13 @@ namespace eka2l1::epoc {
         all = pointer_move | pointer_simulated_event
     };
 
+    enum pointer_capture_flags {
+        pointer_capture_disabled = 0,
+        pointer_capture_enabled = 0x01,
+        pointer_capture_drag_drop = 0x02, ///< Capture drag-and-drop events.
+        pointer_capture_all_groups = 0x04 ///< Capture events going to windows of all groups, not just this group.
+    };
+
     enum class text_alignment {
         left,
         center,
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common/vecx.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace eka2l1::epoc {
+    struct screen;
+    struct window;
+    struct window_user;
+
+    /**
+     * \brief Filter for hit-testing. Return true if the window accepts the pointer event.
+     */
+    typedef bool (*window_hit_filter)(void *userdata, epoc::window *win);
+
+    /**
+     * \brief Uniform grid over absolute window extents.
+     * 
+     * Each cell holds the windows overlapping it, sorted from front to back by their rank. The grid
+     * never dereferences the windows it stores.
+     */
+    class window_hit_grid {
+        struct entry {
+            epoc::window *win_;
+            std::uint32_t rank_;
+            eka2l1::rect extent_;
+        };
+
+        std::unordered_map<std::uint64_t, std::vector<entry>> cells_;
+        std::unordered_map<epoc::window *, entry> entries_;
+
+        int cell_shift_;
+
+        bool get_cell_range(const eka2l1::rect &extent, eka2l1::vec2 &first, eka2l1::vec2 &last) const;
+
+    public:
+        explicit window_hit_grid(const int cell_shift = 5);
+
+        void clear();
+
+        /**
+         * \brief Add a window to the grid, or update its extent and rank.
+         * 
+         * \param win       The window to add.
+         * \param extent    Absolute extent of the window, in screen pixels.
+         * \param rank      Order of the window. Smaller rank is more in front.
+         */
+        void insert(epoc::window *win, const eka2l1::rect &extent, const std::uint32_t rank);
+
+        /**
+         * \brief Remove a window from the grid.
+         * \returns True if the window was in the grid.
+         */
+        bool remove(epoc::window *win);
+
+        /**
+         * \brief Get the front-most window containing the given point.
+         * 
+         * \param pos       Position in screen pixels.
+         * \param filter    Optional filter. Windows rejected are skipped, and the ones behind are tried.
+         * \param userdata  Userdata passed to the filter.
+         * 
+         * \returns The window found, or nullptr.
+         */
+        epoc::window *topmost_at(const eka2l1::vec2 &pos, window_hit_filter filter = nullptr, void *userdata = nullptr) const;
+
+        std::size_t size() const {
+            return entries_.size();
+        }
+    };
+
+    /**
+     * \brief Spatial index of client windows of a screen, used to route pointer events.
+     * 
+     * Extent and visibility changes are applied to the grid as they happen. Z-order changes invalidate
+     * the ranks, which are computed again with a single tree walk on the next query.
+     * 
+     * The index also tracks the window grabbing the pointer and the window capturing it.
+     */
+    class window_hit_index {
+        epoc::screen *scr_;
+        window_hit_grid grid_;
+
+        std::unordered_map<epoc::window_user *, std::uint32_t> ranks_;
+        bool dirty_;
+
+        epoc::window_user *grab_target_;
+        epoc::window_user *capture_target_;
+        std::uint32_t capture_flags_;
+
+        void rebuild();
+
+    public:
+        explicit window_hit_index(epoc::screen *scr);
+
+        /**
+         * \brief Mark the window order as changed.
+         */
+        void invalidate() {
+            dirty_ = true;
+        }
+
+        /**
+         * \brief Update the extent and visibility of a window in the index.
+         */
+        void update_window(epoc::window_user *win);
+
+        /**
+         * \brief Forget a window being destroyed. Grab and capture on it are also released.
+         */
+        void remove_window(epoc::window_user *win);
+
+        /**
+         * \brief Get the front-most visible client window at the given position.
+         * 
+         * \param pos       Position in screen pixels.
+         * \param filter    Optional filter, see window_hit_grid::topmost_at.
+         * \param userdata  Userdata passed to the filter.
+         */
+        epoc::window_user *topmost_at(const eka2l1::vec2 &pos, window_hit_filter filter = nullptr, void *userdata = nullptr);
+
+        epoc::window_user *grab_target() const {
+            return grab_target_;
+        }
+
+        void set_grab_target(epoc::window_user *win) {
+            grab_target_ = win;
+        }
+
+        /**
+         * \brief Set pointer capture of a window.
+         * 
+         * \param win       The window.
+         * \param flags     Capture flags. See epoc::pointer_capture_flags.
+         */
+        void set_capture(epoc::window_user *win, const std::uint32_t flags);
+
+        /**
+         * \brief Get the window capturing an event that would be delivered to the given window.
+         * 
+         * \param hit   The window that the event hits. Can be nullptr.
+         * \returns The capturing window, or nullptr if the event is not captured.
+         */
+        epoc::window_user *capture_target_for(epoc::window_user *hit);
+    };
+}
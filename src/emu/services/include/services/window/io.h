@@ -30,19 +30,26 @@ namespace eka2l1 {
 }
 
 namespace eka2l1::epoc {
+    struct screen;
+    struct window_user;
+
     /**
-     * \brief Walk through all windows and deliver pointer to those who are applicable.
+     * \brief Deliver pointer events to the windows under them.
+     * 
+     * Targets are looked up in the screen's spatial index, with pointer grab and capture applied.
      */
-    struct window_pointer_focus_walker : public epoc::window_tree_walker {
-        std::vector<std::pair<epoc::event, bool>> evts_;
-        eka2l1::vec2 scr_coord_;
+    struct window_pointer_shipper {
+        std::vector<epoc::event> evts_;
 
         void add_new_event(const epoc::event &evt);
-        void process_event_to_target_window(epoc::window *win, epoc::event &evt);
-
-        bool do_it(epoc::window *win) override;
+        void process_event_to_target_window(epoc::window_user *user, epoc::event &evt);
 
-        void clear();
+        /**
+         * \brief Deliver all queued pointer events.
+         * 
+         * \param scr  The screen where the events happen.
+         */
+        void start_shipping(epoc::screen *scr);
     };
 
     /**
@@ -23,6 +23,7 @@
 #include <drivers/graphics/common.h>
 #include <services/window/classes/config.h>
 #include <services/window/common.h>
+#include <services/window/hittest.h>
 
 #include <cstdint>
 #include <map>
@@ -86,6 +87,8 @@ namespace eka2l1::epoc {
         std::map<std::int32_t, eka2l1::rect> pointer_areas_;
         eka2l1::vec2 pointer_cursor_pos_;
 
+        epoc::window_hit_index hit_index_; ///< Spatial index of client windows, for routing pointer events.
+
         typedef void (*focus_change_callback_handler)(void *userdata, epoc::window_group *focus);
         using focus_change_callback = std::pair<void *, focus_change_callback_handler>;
 
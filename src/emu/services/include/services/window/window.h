@@ -371,7 +371,7 @@ namespace eka2l1 {
         void load_wsini();
         void parse_wsini();
 
-        epoc::window_pointer_focus_walker touch_shipper;
+        epoc::window_pointer_shipper touch_shipper;
         epoc::window_key_shipper key_shipper;
 
         void handle_input_from_driver(drivers::input_event input_event);
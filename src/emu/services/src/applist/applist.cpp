@@ -22,17 +22,21 @@
 #include <services/applist/op.h>
 #include <services/fbs/fbs.h>
 #include <services/context.h>
+#include <services/parsed_index.h>
 
 #include <common/benchmark.h>
+#include <common/chunkyseri.h>
 #include <common/cvt.h>
 #include <common/log.h>
 #include <common/path.h>
 #include <common/pystr.h>
+#include <common/time.h>
 #include <common/types.h>
 
 #include <common/common.h>
 #include <system/epoc.h>
 #include <kernel/kernel.h>
+#include <loader/rom.h>
 #include <loader/rsc.h>
 #include <utils/apacmd.h>
 #include <utils/bafl.h>
@@ -53,6 +57,86 @@ namespace eka2l1 {
 
     static const char16_t *APA_APP_RUNNER = u"apprun.exe";
 
+    // Bump when the layout of indexed registrations changes
+    static constexpr std::uint64_t APA_REGISTRY_INDEX_FORMAT = 1;
+    static const char16_t *APA_REGISTRY_INDEX_PATH = u"C:\\Private\\10003a3f\\cache\\registry.idx";
+
+    template <typename T, unsigned int MAX_ELEMENTS>
+    static void absorb_buf_static(common::chunkyseri &seri, epoc::buf_static<T, MAX_ELEMENTS> &buf) {
+        std::basic_string<T> str = buf.to_std_string(nullptr);
+        seri.absorb(str);
+
+        if (seri.get_seri_mode() == common::SERI_MODE_READ) {
+            buf.assign(nullptr, str);
+        }
+    }
+
+    /**
+     * \brief Serialize a parsed registration for the registry index.
+     *
+     * Icons are not part of it. They are only loaded on the old architecture, which is not indexed.
+     */
+    static void absorb_registry(common::chunkyseri &seri, apa_app_registry &reg, std::u16string &localised_path) {
+        seri.absorb(reg.mandatory_info.uid);
+        absorb_buf_static(seri, reg.mandatory_info.app_path);
+        absorb_buf_static(seri, reg.mandatory_info.short_caption);
+        absorb_buf_static(seri, reg.mandatory_info.long_caption);
+
+        seri.absorb(reg.caps.ability);
+        seri.absorb(reg.caps.support_being_asked_to_create_new_file);
+        seri.absorb(reg.caps.is_hidden);
+        seri.absorb(reg.caps.launch_in_background);
+        absorb_buf_static(seri, reg.caps.group_name);
+        seri.absorb(reg.caps.flags);
+        seri.absorb(reg.caps.reserved);
+
+        seri.absorb(reg.rsc_path);
+        seri.absorb(reg.localised_info_rsc_path);
+        seri.absorb(reg.localised_info_rsc_id);
+        seri.absorb(reg.default_screen_number);
+        seri.absorb(reg.icon_count);
+        seri.absorb(reg.icon_file_path);
+
+        seri.absorb_container(reg.data_types, [](common::chunkyseri &seri, data_type &type) {
+            seri.absorb(type.priority_);
+            seri.absorb(type.type_);
+        });
+
+        seri.absorb_container(reg.view_datas, [](common::chunkyseri &seri, view_data &view) {
+            seri.absorb(view.uid_);
+            seri.absorb(view.screen_mode_);
+            seri.absorb(view.icon_count_);
+            seri.absorb(view.caption_);
+        });
+
+        seri.absorb_container(reg.ownership_list);
+        seri.absorb(reg.land_drive);
+        seri.absorb(localised_path);
+    }
+
+    static void resolve_registry_icon_path(eka2l1::io_system *io, apa_app_registry &reg, const std::u16string &localised_path) {
+        if (eka2l1::is_absolute(reg.icon_file_path, std::u16string(u"c:\\"), true)) {
+            return;
+        }
+
+        // Try to absolute icon path
+        // Search the registration file drive, and than the localizable registration file
+        std::u16string try_1 = eka2l1::absolute_path(reg.icon_file_path,
+            std::u16string(1, drive_to_char16(reg.land_drive)) + u":\\", true);
+
+        if (io->exist(try_1)) {
+            reg.icon_file_path = try_1;
+        } else {
+            try_1[0] = localised_path[0];
+
+            if (io->exist(try_1)) {
+                reg.icon_file_path = try_1;
+            } else {
+                reg.icon_file_path = u"";
+            }
+        }
+    }
+
     applist_server::applist_server(system *sys)
         : service::typical_server(sys, get_app_list_server_name_by_epocver(sys->get_symbian_version_use()))
         , fbsserv(nullptr) {
@@ -153,6 +237,26 @@ namespace eka2l1 {
         }
 
         apa_app_registry reg;
+        std::optional<service::parsed_file_stamp> reg_stamp;
+
+        if (registry_index_) {
+            reg_stamp = registry_index_->stamp(nearest_path);
+
+            if (reg_stamp) {
+                if (const std::vector<std::uint8_t> *data = registry_index_->find(reg_stamp.value())) {
+                    std::u16string localised_path;
+
+                    common::chunkyseri seri(const_cast<std::uint8_t *>(data->data()), data->size(), common::SERI_MODE_READ);
+                    absorb_registry(seri, reg, localised_path);
+
+                    // Icon files are looked up again, they may have come or gone without the registration changing
+                    resolve_registry_icon_path(io, reg, localised_path);
+
+                    regs.push_back(std::move(reg));
+                    return true;
+                }
+            }
+        }
 
         reg.land_drive = land_drive;
         reg.rsc_path = nearest_path;
@@ -241,25 +345,32 @@ namespace eka2l1 {
             common::ucs2_to_utf8(reg.mandatory_info.long_caption.to_std_string(nullptr)),
             reg.mandatory_info.uid);
 
-        if (!eka2l1::is_absolute(reg.icon_file_path, std::u16string(u"c:\\"), true)) {
-            // Try to absolute icon path
-            // Search the registration file drive, and than the localizable registration file
-            std::u16string try_1 = eka2l1::absolute_path(reg.icon_file_path,
-                std::u16string(1, drive_to_char16(land_drive)) + u":\\", true);
+        if (reg_stamp) {
+            // The localised file is picked from the content of the registration, so it is a source too
+            std::vector<service::parsed_file_stamp> sources{ reg_stamp.value() };
 
-            if (io->exist(try_1)) {
-                reg.icon_file_path = try_1;
-            } else {
-                try_1[0] = localised_path[0];
+            if (std::optional<service::parsed_file_stamp> localised_stamp = registry_index_->stamp(localised_path)) {
+                sources.push_back(localised_stamp.value());
+            }
 
-                if (io->exist(try_1)) {
-                    reg.icon_file_path = try_1;
-                } else {
-                    reg.icon_file_path = u"";
-                }
+            std::u16string indexed_localised_path = localised_path;
+            std::vector<std::uint8_t> data;
+
+            {
+                common::chunkyseri seri(nullptr, 0, common::SERI_MODE_MEASURE);
+                absorb_registry(seri, reg, indexed_localised_path);
+
+                data.resize(seri.size());
             }
+
+            common::chunkyseri seri(data.data(), data.size(), common::SERI_MODE_WRITE);
+            absorb_registry(seri, reg, indexed_localised_path);
+
+            registry_index_->store(sources, std::move(data));
         }
 
+        resolve_registry_icon_path(io, reg, localised_path);
+
         regs.push_back(std::move(reg));
         return true;
     }
@@ -348,6 +459,10 @@ namespace eka2l1 {
         }
 
         sort_registry_list();
+
+        if (registry_index_) {
+            registry_index_->save();
+        }
     }
 
     void applist_server::on_drive_change(void *userdata, drive_number drv, drive_action act) {
@@ -359,6 +474,10 @@ namespace eka2l1 {
                 rescan_registries_on_drive_oldarch(io, drv);
             } else {
                 rescan_registries_on_drive_newarch(io, drv);
+
+                if (registry_index_) {
+                    registry_index_->save();
+                }
             }
 
             sort_registry_list();
@@ -425,6 +544,19 @@ namespace eka2l1 {
     void applist_server::rescan_registries(eka2l1::io_system *io) {        
         LOG_INFO(SERVICE_APPLIST, "Loading app registries");
 
+        const std::uint64_t begin_time = common::get_current_time_in_microseconds_since_epoch();
+
+        if (!kern->is_eka1()) {
+            // The language picks which localised files are read. Registrations in ROM have no modification time,
+            // so a different ROM must not reuse the index either.
+            loader::rom *rom_info = sys->get_rom_info();
+            const std::uint64_t index_tag = (APA_REGISTRY_INDEX_FORMAT << 56) ^ (static_cast<std::uint64_t>(kern->get_current_language()) << 40)
+                ^ (rom_info ? static_cast<std::uint64_t>(rom_info->header.time) : 0);
+
+            registry_index_ = std::make_unique<service::parsed_file_index>(io, APA_REGISTRY_INDEX_PATH, index_tag);
+            registry_index_->load();
+        }
+
         for (drive_number drv = drive_z; drv >= drive_a; drv--) {
             if (io->get_drive_entry(drv)) {
                 if (kern->is_eka1()) {
@@ -437,6 +569,14 @@ namespace eka2l1 {
 
         sort_registry_list();
 
+        if (registry_index_) {
+            registry_index_->save();
+
+            LOG_INFO(SERVICE_APPLIST, "Loaded {} registrations in {} us ({} from index, {} parsed)", regs.size(),
+                common::get_current_time_in_microseconds_since_epoch() - begin_time, registry_index_->hit_count(),
+                registry_index_->miss_count());
+        }
+
         // Register drive change callback
         io->register_drive_change_notify([this](void *userdata, drive_number drv, drive_action act) {
             return on_drive_change(userdata, drv, act);
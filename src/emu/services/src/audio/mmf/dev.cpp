@@ -123,6 +123,7 @@ namespace eka2l1 {
         , last_buffer_(0)
         , buffer_chunk_(nullptr)
         , last_buffer_handle_(0)
+        , pending_write_size_(0)
         , stream_state_(epoc::mmf_state_idle)
         , desired_state_(epoc::mmf_state_idle)
         , stream_(nullptr)
@@ -155,6 +156,19 @@ namespace eka2l1 {
             
             // Lock the access to this variable
             const std::lock_guard<std::mutex> guard(dev_access_lock_);
+
+            if (pending_write_size_ != 0) {
+                // The stream was full when the buffer was played, now it has made some room
+                drivers::dsp_output_stream *out_stream = reinterpret_cast<drivers::dsp_output_stream*>(stream_.get());
+
+                if (buffer_chunk_ && out_stream->write(reinterpret_cast<std::uint8_t*>(buffer_chunk_->host_base()), pending_write_size_)) {
+                    pending_write_size_ = 0;
+                }
+
+                // The guest gets its next buffer once this one is copied
+                kern->unlock();
+                return;
+            }
             
             if (finish_info_.empty()) {
                 finished_ = false;
@@ -366,6 +380,7 @@ namespace eka2l1 {
 
     void mmf_dev_server_session::stop(service::ipc_context *ctx) {
         stream_state_ = epoc::mmf_state_dead;
+        pending_write_size_ = 0;
         stream_->stop();
 
         // Done waiting for all notifications to be completed/ignored, it's time to do deref buffer chunk
@@ -561,7 +576,10 @@ namespace eka2l1 {
         stream_state_ = epoc::mmf_state_playing;
 
         drivers::dsp_output_stream *out_stream = reinterpret_cast<drivers::dsp_output_stream*>(stream_.get());
-        out_stream->write(reinterpret_cast<std::uint8_t*>(buffer_chunk_->host_base()), supplied_size);
+        if (!out_stream->write(reinterpret_cast<std::uint8_t*>(buffer_chunk_->host_base()), supplied_size)) {
+            // Retried when the stream notifies that it has copied a buffer
+            pending_write_size_ = supplied_size;
+        }
 
         ctx->complete(epoc::error_none);
     }
@@ -199,14 +199,17 @@ namespace eka2l1 {
 
             if (p->get_value_count() >= 3) {
                 entry.metadata_val = p->get<common::ini_value>(2)->get_as_native<std::uint32_t>();
-                repo.add_new_entry(entry.key, entry.data, entry.metadata_val);
             } else {
-                repo.add_new_entry(entry.key, entry.data);
+                entry.metadata_val = repo.get_default_meta_for_new_key(entry.key);
             }
 
+            // Sorted once all keys are in
+            repo.entries.push_back(std::move(entry));
+
             // TODO (pent0): Capability supply
         }
 
+        repo.sort_entries();
         return true;
     }
 
@@ -31,6 +31,8 @@
 
 #include <system/devices.h>
 
+#include <algorithm>
+
 namespace eka2l1 {
     /* 
      * The header of a CRE file is following:
@@ -238,6 +240,15 @@ namespace eka2l1 {
             }
         }
 
+        if (seri.get_seri_mode() == common::SERI_MODE_READ) {
+            // CRE files are written sorted already, this is cheap then
+            if (!std::is_sorted(repo.entries.begin(), repo.entries.end(), [](const central_repo_entry &lhs, const central_repo_entry &rhs) {
+                return lhs.key < rhs.key;
+            })) {
+                repo.sort_entries();
+            }
+        }
+
         if (repo.ver >= 1) {
             std::uint32_t deleted_settings_count = static_cast<std::uint32_t>(repo.deleted_settings.size());
             seri.absorb(deleted_settings_count);
@@ -50,59 +50,74 @@ namespace eka2l1 {
         return default_meta;
     }
 
-    bool central_repo::add_new_entry(const std::uint32_t key, const central_repo_entry_variant &var) {
-        if (find_entry(key)) {
-            return false;
-        }
-
-        // Find default meta
-        central_repo_entry entry;
-        entry.metadata_val = get_default_meta_for_new_key(key);
-        entry.key = key;
-        entry.data = var;
-
-        entries.push_back(entry);
+    static bool central_repo_entry_key_less(const central_repo_entry &lhs, const std::uint32_t key) {
+        return lhs.key < key;
+    }
 
-        return true;
+    bool central_repo::add_new_entry(const std::uint32_t key, const central_repo_entry_variant &var) {
+        return add_new_entry(key, var, get_default_meta_for_new_key(key));
     }
 
     bool central_repo::add_new_entry(const std::uint32_t key, const central_repo_entry_variant &var,
         const std::uint32_t meta) {
-        if (find_entry(key)) {
+        auto ite = std::lower_bound(entries.begin(), entries.end(), key, central_repo_entry_key_less);
+
+        if ((ite != entries.end()) && (ite->key == key)) {
             return false;
         }
 
-        // Find default meta
         central_repo_entry entry;
         entry.metadata_val = meta;
         entry.key = key;
         entry.data = var;
 
-        entries.push_back(entry);
+        entries.insert(ite, std::move(entry));
 
         return true;
     }
 
     central_repo_entry *central_repo::find_entry(const std::uint32_t key) {
-        auto ite = std::find_if(entries.begin(), entries.end(), [=](const central_repo_entry &e) {
-            return e.key == key;
-        });
+        auto ite = std::lower_bound(entries.begin(), entries.end(), key, central_repo_entry_key_less);
 
-        if (ite == entries.end()) {
+        if ((ite == entries.end()) || (ite->key != key)) {
             return nullptr;
         }
 
         return &(*ite);
     }
 
+    void central_repo::sort_entries() {
+        // Stable, so the first of the duplicated keys is kept, same as add_new_entry rejecting later ones
+        std::stable_sort(entries.begin(), entries.end(), [](const central_repo_entry &lhs, const central_repo_entry &rhs) {
+            return lhs.key < rhs.key;
+        });
+
+        entries.erase(std::unique(entries.begin(), entries.end(), [](const central_repo_entry &lhs, const central_repo_entry &rhs) {
+            return lhs.key == rhs.key;
+        }), entries.end());
+    }
+
+    std::pair<std::vector<central_repo_entry>::iterator, std::vector<central_repo_entry>::iterator>
+    central_repo::candidate_range(const std::uint32_t partial_key, const std::uint32_t mask) {
+        const std::uint32_t lowest_key = partial_key & mask;
+        const std::uint32_t highest_key = partial_key | ~mask;
+
+        auto range_begin = std::lower_bound(entries.begin(), entries.end(), lowest_key, central_repo_entry_key_less);
+        auto range_end = std::upper_bound(range_begin, entries.end(), highest_key, [](const std::uint32_t key, const central_repo_entry &rhs) {
+            return key < rhs.key;
+        });
+
+        return { range_begin, range_end };
+    }
+
     void central_repo::query_entries(const std::uint32_t partial_key, const std::uint32_t mask,
         std::vector<central_repo_entry *> &matched_entries,
         const central_repo_entry_type etype) {
-        std::uint32_t required_mask = mask & partial_key;
+        auto [range_begin, range_end] = candidate_range(partial_key, mask);
 
-        for (auto &entry : entries) {
-            if ((entry.key & required_mask) && (entry.data.etype == etype)) {
-                matched_entries.push_back(&entry);
+        for (auto ite = range_begin; ite != range_end; ite++) {
+            if (((ite->key & mask) == (partial_key & mask)) && (ite->data.etype == etype)) {
+                matched_entries.push_back(&(*ite));
             }
         }
     }
@@ -112,28 +127,40 @@ namespace eka2l1 {
         set_transaction_mode(central_repo_transaction_mode::read_write);
     }
 
+    static constexpr std::uint32_t CENREP_SINGLE_KEY_MASK = 0xFFFFFFFF;
+
     void central_repo_client_subsession::modification_success(const std::uint32_t key) {
-        // Iters through all
-        for (std::size_t i = 0; i < notifies.size(); i++) {
-            cenrep_notify_info &notify = notifies[i];
+        auto key_notify = key_notifies.find(key);
 
-            if ((key & (notify.match & notify.mask))) {
-                // Notify and delete this request from the list
+        if (key_notify != key_notifies.end()) {
+            // Notify and delete this request from the list
+            key_notify->second.sts.complete(0);
+            key_notifies.erase(key_notify);
+        }
+
+        common::erase_elements(group_notifies, [=](cenrep_notify_info &notify) {
+            if ((key & notify.mask) == (notify.match & notify.mask)) {
                 notify.sts.complete(0);
-                notifies.erase(notifies.begin() + i);
+                return true;
             }
-        }
 
-        // Done all requests
+            return false;
+        });
     }
 
     int central_repo_client_subsession::add_notify_request(epoc::notify_info &info,
         const std::uint32_t mask, const std::uint32_t match) {
-        auto find_result = std::find_if(notifies.begin(), notifies.end(), [&](const cenrep_notify_info &notify) {
-            return (notify.mask == mask) && (notify.match == match);
-        });
+        bool exists = false;
+
+        if (mask == CENREP_SINGLE_KEY_MASK) {
+            exists = (key_notifies.find(match) != key_notifies.end());
+        } else {
+            exists = std::find_if(group_notifies.begin(), group_notifies.end(), [&](const cenrep_notify_info &notify) {
+                return (notify.mask == mask) && (notify.match == match);
+            }) != group_notifies.end();
+        }
 
-        if (find_result != notifies.end()) {
+        if (exists) {
             return -1;
         } else {
             if (info.empty()) {
@@ -142,19 +169,41 @@ namespace eka2l1 {
             }
         }
 
-        notifies.push_back({ info, mask, match });
+        if (mask == CENREP_SINGLE_KEY_MASK) {
+            key_notifies.emplace(match, cenrep_notify_info{ info, mask, match });
+        } else {
+            group_notifies.push_back({ info, mask, match });
+        }
+
         return 0;
     }
 
     void central_repo_client_subsession::cancel_all_notify_requests() {
-        common::erase_elements(notifies, [=](cenrep_notify_info &info) {
+        for (auto &[key, info] : key_notifies) {
+            info.sts.complete(-3);
+        }
+
+        key_notifies.clear();
+
+        common::erase_elements(group_notifies, [=](cenrep_notify_info &info) {
             info.sts.complete(-3);
             return true;
         });
     }
 
     void central_repo_client_subsession::cancel_notify_request(const std::uint32_t match_key, const std::uint32_t mask) {
-        common::erase_elements(notifies, [=](cenrep_notify_info &info) {
+        if (mask == CENREP_SINGLE_KEY_MASK) {
+            auto key_notify = key_notifies.find(match_key);
+
+            if (key_notify != key_notifies.end()) {
+                key_notify->second.sts.complete(-3);
+                key_notifies.erase(key_notify);
+            }
+
+            return;
+        }
+
+        common::erase_elements(group_notifies, [=](cenrep_notify_info &info) {
             if ((info.match == match_key) && (info.mask == mask)) {
                 info.sts.complete(-3);
                 return true;
@@ -185,14 +234,7 @@ namespace eka2l1 {
         // If not in transaction, or if we are in transaction but read-mode
         // Directly get the repo data
         if (!active || mode == 0) {
-            auto result = std::find_if(attach_repo->entries.begin(), attach_repo->entries.end(),
-                [&](const central_repo_entry &entry) { return entry.key == key; });
-
-            if (result == attach_repo->entries.end()) {
-                return nullptr;
-            }
-
-            return &(*result);
+            return attach_repo->find_entry(key);
         }
 
         transactor.changes.emplace(key, central_repo_entry{});
@@ -459,7 +501,11 @@ namespace eka2l1 {
         found_uid_result_array[0] = 0;
         std::string cache_arg;
 
-        for (auto &entry : attach_repo->entries) {
+        auto [range_begin, range_end] = attach_repo->candidate_range(filter->partial_key, filter->id_mask);
+
+        for (auto ite = range_begin; ite != range_end; ite++) {
+            central_repo_entry &entry = *ite;
+
             // Try to match the key first
             if ((entry.key & filter->id_mask) != (filter->partial_key & filter->id_mask)) {
                 // Mask doesn't match, abandon this entry
@@ -27,11 +27,14 @@
 #include <common/log.h>
 #include <common/path.h>
 #include <common/pystr.h>
+#include <common/time.h>
 
 #include <services/ecom/ecom.h>
+#include <services/parsed_index.h>
 #include <vfs/vfs.h>
 
 #include <system/epoc.h>
+#include <loader/rom.h>
 #include <loader/spi.h>
 #include <common/uid.h>
 
@@ -42,6 +45,84 @@
 #include <utils/err.h>
 
 namespace eka2l1 {
+    // Bump when the layout of indexed plugins changes
+    static constexpr std::uint64_t ECOM_PLUGIN_INDEX_FORMAT = 1;
+    static const char16_t *ECOM_PLUGIN_INDEX_PATH = u"C:\\Private\\10009d8f\\cache\\plugins.idx";
+
+    struct ecom_parsed_plugin {
+        std::u16string name_;
+        bool valid_ = false;
+        ecom_plugin plugin_;
+    };
+
+    using ecom_parsed_plugins = std::vector<ecom_parsed_plugin>;
+
+    static void absorb_parsed_plugins(common::chunkyseri &seri, ecom_parsed_plugins &plugins) {
+        seri.absorb_container(plugins, [](common::chunkyseri &seri, ecom_parsed_plugin &parsed) {
+            seri.absorb(parsed.name_);
+            seri.absorb(parsed.valid_);
+
+            // Invalid descriptions are indexed too, so they are not parsed again on every boot
+            if (parsed.valid_) {
+                parsed.plugin_.do_index_state(seri);
+            }
+        });
+    }
+
+    static ecom_parsed_plugin parse_plugin_from_buffer(const std::u16string &name, std::uint8_t *buf, const std::size_t size) {
+        common::ro_buf_stream stream(buf, size);
+        loader::rsc_file rsc(reinterpret_cast<common::ro_stream *>(&stream));
+
+        ecom_parsed_plugin parsed;
+        parsed.name_ = name;
+        parsed.valid_ = load_plugin(rsc, parsed.plugin_);
+
+        return parsed;
+    }
+
+    /**
+     * \brief Get plugins described by a file, from the index if the file did not change.
+     *
+     * \param parse   Parse the file on a miss. Returns nullopt if the file is corrupted, in which
+     *                case nothing is indexed.
+     */
+    static std::optional<ecom_parsed_plugins> get_parsed_plugins(service::parsed_file_index &index, const std::u16string &path,
+        const std::function<std::optional<ecom_parsed_plugins>()> &parse) {
+        std::optional<service::parsed_file_stamp> stamp = index.stamp(path);
+
+        if (stamp) {
+            if (const std::vector<std::uint8_t> *data = index.find(stamp.value())) {
+                ecom_parsed_plugins plugins;
+
+                common::chunkyseri seri(const_cast<std::uint8_t *>(data->data()), data->size(), common::SERI_MODE_READ);
+                absorb_parsed_plugins(seri, plugins);
+
+                return plugins;
+            }
+        }
+
+        std::optional<ecom_parsed_plugins> plugins = parse();
+
+        if (!plugins || !stamp) {
+            return plugins;
+        }
+
+        std::vector<std::uint8_t> data;
+
+        {
+            common::chunkyseri seri(nullptr, 0, common::SERI_MODE_MEASURE);
+            absorb_parsed_plugins(seri, plugins.value());
+
+            data.resize(seri.size());
+        }
+
+        common::chunkyseri seri(data.data(), data.size(), common::SERI_MODE_WRITE);
+        absorb_parsed_plugins(seri, plugins.value());
+
+        index.store({ stamp.value() }, std::move(data));
+        return plugins;
+    }
+
     bool ecom_server::register_implementation(const std::uint32_t interface_uid,
         ecom_implementation_info_ptr &impl) {
         auto &interface = interfaces[interface_uid];
@@ -104,19 +185,7 @@ namespace eka2l1 {
         return results;
     }
 
-    bool ecom_server::load_and_install_plugin_from_buffer(const std::u16string &name, std::uint8_t *buf, const std::size_t size,
-        const drive_number drv) {
-        common::ro_buf_stream stream(buf, size);
-        loader::rsc_file rsc(reinterpret_cast<common::ro_stream *>(&stream));
-
-        ecom_plugin plugin;
-
-        bool result = load_plugin(rsc, plugin);
-
-        if (!result) {
-            return false;
-        }
-
+    bool ecom_server::install_plugin(const std::u16string &name, ecom_plugin &plugin, const drive_number drv) {
         for (auto &pinterface : plugin.interfaces) {
             // Get from the current interface on server
             auto &interface_on_server = interfaces[pinterface.uid];
@@ -238,35 +307,45 @@ namespace eka2l1 {
         return true;
     }
 
-    bool ecom_server::load_archives(eka2l1::io_system *io) {
+    bool ecom_server::load_archives(eka2l1::io_system *io, service::parsed_file_index &index) {
         std::vector<std::string> archives = get_ecom_plugin_archives(io);
 
         for (const std::string &archive : archives) {
             const drive_number drv = char16_to_drive(archive[0]);
+            const std::u16string archive_path = common::utf8_to_ucs2(archive);
+
+            std::optional<ecom_parsed_plugins> plugins = get_parsed_plugins(index, archive_path, [&]() -> std::optional<ecom_parsed_plugins> {
+                symfile f = io->open_file(archive_path, READ_MODE | BIN_MODE);
+                std::vector<std::uint8_t> buf;
+                buf.resize(f->size());
+
+                f->read_file(&buf[0], static_cast<std::uint32_t>(buf.size()), 1);
+                f->close();
 
-            symfile f = io->open_file(common::utf8_to_ucs2(archive), READ_MODE | BIN_MODE);
-            std::vector<std::uint8_t> buf;
-            buf.resize(f->size());
+                common::chunkyseri seri(buf.data(), buf.size(), common::SERI_MODE_READ);
+                loader::spi_file spi(0);
 
-            f->read_file(&buf[0], static_cast<std::uint32_t>(buf.size()), 1);
-            f->close();
+                if (!spi.do_state(seri)) {
+                    return std::nullopt;
+                }
+
+                ecom_parsed_plugins parsed;
 
-            common::chunkyseri seri(buf.data(), buf.size(), common::SERI_MODE_READ);
-            loader::spi_file spi(0);
+                for (auto &entry : spi.entries) {
+                    parsed.push_back(parse_plugin_from_buffer(common::utf8_to_ucs2(entry.name), &entry.file[0], entry.file.size()));
+                }
 
-            bool result = spi.do_state(seri);
+                return parsed;
+            });
 
-            if (!result) {
+            if (!plugins) {
                 LOG_TRACE(SERVICE_ECOM, "SPI file {} corrupted!", archive);
                 return false;
             }
 
-            for (auto &entry : spi.entries) {
-                result = load_and_install_plugin_from_buffer(
-                    common::utf8_to_ucs2(entry.name), &entry.file[0], entry.file.size(), drv);
-
-                if (!result) {
-                    LOG_WARN(SERVICE_ECOM, "Can't load and install plugin \"{}\"", entry.name);
+            for (ecom_parsed_plugin &parsed : plugins.value()) {
+                if (!parsed.valid_ || !install_plugin(parsed.name_, parsed.plugin_, drv)) {
+                    LOG_WARN(SERVICE_ECOM, "Can't load and install plugin \"{}\"", common::ucs2_to_utf8(parsed.name_));
                 }
             }
         }
@@ -275,22 +354,36 @@ namespace eka2l1 {
     }
 
     bool ecom_server::load_plugins(eka2l1::io_system *io) {
+        const std::uint64_t begin_time = common::get_current_time_in_microseconds_since_epoch();
+
+        // Plugins in ROM have no modification time, a different ROM must not reuse the index
+        loader::rom *rom_info = sys->get_rom_info();
+        const std::uint64_t index_tag = (ECOM_PLUGIN_INDEX_FORMAT << 56) ^ (rom_info ? static_cast<std::uint64_t>(rom_info->header.time) : 0);
+
+        service::parsed_file_index index(io, ECOM_PLUGIN_INDEX_PATH, index_tag);
+        index.load();
+
         // Load archives first
-        if (!load_archives(io)) {
+        if (!load_archives(io, index)) {
             return false;
         }
 
         for (drive_number drv = drive_a; drv <= drive_z; drv = (drive_number)((int)drv + 1)) {
             if (io->get_drive_entry(drv)) {
                 // Load and ignore invalid plugins
-                load_plugin_on_drive(io, drv);
+                load_plugin_on_drive(io, drv, index);
             }
         }
 
+        index.save();
+
+        LOG_INFO(SERVICE_ECOM, "Loaded {} implementations in {} us ({} plugin files from index, {} parsed)", implementations.size(),
+            common::get_current_time_in_microseconds_since_epoch() - begin_time, index.hit_count(), index.miss_count());
+
         return true;
     }
 
-    bool ecom_server::load_plugin_on_drive(eka2l1::io_system *io, const drive_number drv) {
+    bool ecom_server::load_plugin_on_drive(eka2l1::io_system *io, const drive_number drv, service::parsed_file_index &index) {
         // Opening directory
         std::u16string plugin_dir_path;
         plugin_dir_path += drive_to_char16(drv);
@@ -305,16 +398,24 @@ namespace eka2l1 {
         }
 
         while (auto entry = plugin_dir->get_next_entry()) {
-            symfile f = io->open_file(common::utf8_to_ucs2(entry->full_path), READ_MODE | BIN_MODE);
+            const std::u16string plugin_path = common::utf8_to_ucs2(entry->full_path);
+
+            std::optional<ecom_parsed_plugins> plugins = get_parsed_plugins(index, plugin_path, [&]() -> std::optional<ecom_parsed_plugins> {
+                symfile f = io->open_file(plugin_path, READ_MODE | BIN_MODE);
+
+                assert(f);
+
+                std::vector<std::uint8_t> dat;
+                dat.resize(f->size());
+                f->read_file(&dat[0], static_cast<std::uint32_t>(dat.size()), 1);
+                f->close();
 
-            assert(f);
+                return ecom_parsed_plugins{ parse_plugin_from_buffer(plugin_path, &dat[0], dat.size()) };
+            });
 
-            std::vector<std::uint8_t> dat;
-            dat.resize(f->size());
-            f->read_file(&dat[0], static_cast<std::uint32_t>(dat.size()), 1);
-            f->close();
+            ecom_parsed_plugin &parsed = plugins.value()[0];
 
-            if (!load_and_install_plugin_from_buffer(common::utf8_to_ucs2(entry->full_path), &dat[0], dat.size(), drv)) {
+            if (!parsed.valid_ || !install_plugin(parsed.name_, parsed.plugin_, drv)) {
                 LOG_ERROR(SERVICE_ECOM, "Can't load and install plugins description {}", entry->name);
                 return false;
             }
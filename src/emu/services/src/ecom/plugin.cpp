@@ -367,4 +367,33 @@ namespace eka2l1 {
             }
         }
     }
+
+    void ecom_implementation_info::do_index_state(common::chunkyseri &seri) {
+        seri.absorb(uid);
+        seri.absorb(version);
+        seri.absorb(format);
+        seri.absorb(flags);
+
+        seri.absorb(display_name);
+        seri.absorb(default_data);
+        seri.absorb(opaque_data);
+
+        seri.absorb_container(extended_interfaces);
+    }
+
+    void ecom_plugin::do_index_state(common::chunkyseri &seri) {
+        seri.absorb(type);
+        seri.absorb(uid);
+
+        seri.absorb_container(interfaces, [](common::chunkyseri &seri, ecom_interface_info &interface) {
+            seri.absorb(interface.uid);
+            seri.absorb_container(interface.implementations, [](common::chunkyseri &seri, ecom_implementation_info_ptr &impl) {
+                if (seri.get_seri_mode() == common::SERI_MODE_READ) {
+                    impl = std::make_shared<ecom_implementation_info>();
+                }
+
+                impl->do_index_state(seri);
+            });
+        });
+    }
 }
@@ -22,23 +22,68 @@
 #include <services/fbs/fbs.h>
 #include <utils/err.h>
 
+#include <common/algorithm.h>
+#include <common/buffer.h>
 #include <common/log.h>
 #include <common/runlen.h>
+#include <common/thread.h>
+
+#include <algorithm>
+#include <cstring>
 
 namespace eka2l1 {
-    compress_queue::compress_queue(fbs_server *serv)
-        : serv_(serv) {
-        queue_.max_pending_count_ = 256;
+    compress_queue::compress_queue(fbs_server *serv, const std::uint32_t worker_count)
+        : max_pending_count_(256)
+        , sequence_counter_(0)
+        , abort_(false)
+        , serv_(serv)
+        , total_compressed_(0)
+        , total_latency_us_(0)
+        , total_bytes_saved_(0) {
+        std::uint32_t count = worker_count;
+
+        if (count == 0) {
+            // Leave the rest of the cores to the CPU and the graphics thread
+            count = common::clamp<std::uint32_t>(1, 4, std::thread::hardware_concurrency() / 2);
+        }
+
+        workers_.resize(count);
     }
 
-    void compress_queue::compress(fbsbitmap *bmp) {
+    compress_queue::~compress_queue() {
+        abort();
+    }
+
+    void compress_queue::compress(fbsbitmap *bmp, const int priority) {
         if (bmp->bitmap_->header_.compression != epoc::bitmap_file_no_compression) {
             // Why?
             bmp->compress_done_nof.complete(0);
             return;
         }
 
-        queue_.push(bmp);
+        {
+            std::unique_lock<std::mutex> ulock(queue_mutex_);
+
+            while (!abort_ && (queue_.size() >= max_pending_count_)) {
+                queue_full_cond_.wait(ulock);
+            }
+
+            if (abort_) {
+                // The queue is shutting down, do not leave the requester waiting
+                bmp->compress_done_nof.complete(epoc::error_cancel);
+                return;
+            }
+
+            compress_request request;
+            request.bmp_ = bmp;
+            request.priority_ = priority;
+            request.sequence_ = sequence_counter_++;
+            request.queued_time_ = std::chrono::steady_clock::now();
+
+            queue_.push(request);
+        }
+
+        queue_cond_.notify_one();
     }
 
     static epoc::bitmap_file_compression get_suitable_compression_method(fbsbitmap *bmp) {
@@ -67,77 +112,82 @@ namespace eka2l1 {
         return epoc::bitmap_file_no_compression;
     }
 
-    static std::size_t estimate_compress_size(fbsbitmap *bmp, std::uint8_t *data_base) {
-        std::size_t est_size = 0;
-        data_base += bmp->bitmap_->data_offset_;
-
-        common::ro_buf_stream source(data_base, bmp->bitmap_->header_.bitmap_size - sizeof(loader::sbm_header));
-
-        switch (bmp->bitmap_->header_.bit_per_pixels) {
-        case 8:
-            compress_rle<8>(&source, nullptr, est_size);
-            break;
-
-        case 16:
-            compress_rle<16>(&source, nullptr, est_size);
-            break;
-
-        case 24:
-            compress_rle<24>(&source, nullptr, est_size);
-            break;
-
-        case 32:
-            compress_rle<32>(&source, nullptr, est_size);
-            break;
+    /**
+     * \brief Compress bitmap data in a single pass into a host scratch buffer.
+     * 
+     * The scratch is sized to the uncompressed data. If the encoder does not finish before
+     * the scratch is full, compression does not save anything and the function fails.
+     * 
+     * \param bmp           The bitmap to compress.
+     * \param base          Base of the large chunk.
+     * \param scratch       Host buffer to write compressed data to.
+     * \param comp_size     Compressed size on success.
+     * 
+     * \returns True if the data compressed to a smaller size.
+     */
+    static bool compress_data(fbsbitmap *bmp, std::uint8_t *base, std::vector<std::uint8_t> &scratch, std::size_t &comp_size) {
+        const std::size_t org_size = bmp->bitmap_->header_.bitmap_size - sizeof(loader::sbm_header);
+        base += bmp->bitmap_->data_offset_;
 
-        default:
-            break;
+        if (scratch.size() < org_size) {
+            scratch.resize(org_size);
         }
 
-        return est_size;
-    }
-
-    static bool compress_data(fbsbitmap *bmp, std::uint8_t *base, std::uint8_t *dest_ptr, const std::size_t dest_size) {
-        std::size_t est_size = 0;
-        base += bmp->bitmap_->data_offset_;
-
-        common::ro_buf_stream source(base, bmp->bitmap_->header_.bitmap_size - sizeof(loader::sbm_header));
-        common::wo_buf_stream dest(dest_ptr, dest_size);
+        common::ro_buf_stream source(base, org_size);
+        common::wo_buf_stream dest(scratch.data(), org_size);
 
         bool result = false;
+        comp_size = 0;
 
         switch (bmp->bitmap_->header_.bit_per_pixels) {
         case 8:
-            result = compress_rle<8>(&source, &dest, est_size);
+            result = compress_rle<8>(&source, &dest, comp_size);
             break;
 
         case 16:
-            result = compress_rle<16>(&source, &dest, est_size);
+            result = compress_rle<16>(&source, &dest, comp_size);
             break;
 
         case 24:
-            result = compress_rle<24>(&source, &dest, est_size);
+            result = compress_rle<24>(&source, &dest, comp_size);
             break;
 
         case 32:
-            result = compress_rle<32>(&source, nullptr, est_size);
+            result = compress_rle<32>(&source, &dest, comp_size);
             break;
 
         default:
             break;
         }
 
-        return result;
+        // Source is not fully consumed means destination overflowed
+        return result && !source.valid() && (comp_size < org_size);
     }
 
-    void compress_queue::actual_compress(fbsbitmap *bmp) {
-        fbsbitmap *clean_bitmap = bmp;
+    void compress_queue::actual_compress(fbsbitmap *bmp, std::vector<std::uint8_t> &scratch) {
         epoc::bitmap_file_compression target_compression = get_suitable_compression_method(bmp);
 
         if (target_compression == epoc::bitmap_file_no_compression) {
+            bmp->compress_done_nof.complete(epoc::error_none);
+            return;
+        }
+
+        // Encode outside of the commit lock. The source bitmap is not touched by the server until
+        // the compression done notification is completed.
+        std::uint8_t *data_base = serv_->get_large_chunk_base();
+        const std::size_t org_size = bmp->bitmap_->header_.bitmap_size - sizeof(loader::sbm_header);
+
+        std::size_t compressed_size = 0;
+
+        if (!compress_data(bmp, data_base, scratch, compressed_size)) {
+            // Not worth it, stop compress
+            bmp->compress_done_nof.complete(epoc::error_none);
             return;
         }
 
+        const std::lock_guard<std::mutex> commit_guard(commit_mutex_);
+        fbsbitmap *clean_bitmap = bmp;
+
         if (bmp->support_dirty_bitmap) {
             // Have to create new bitmap
             fbs_bitmap_data_info info;
@@ -147,42 +197,25 @@ namespace eka2l1 {
             clean_bitmap = serv_->create_bitmap(info, false, true);
         }
 
-        clean_bitmap->bitmap_->header_.compression = target_compression;
-        clean_bitmap->bitmap_->compressed_in_ram_ = true;
+        std::uint8_t *new_data = reinterpret_cast<std::uint8_t *>(serv_->allocate_large_data(compressed_size));
 
-        // Estimate compressed size
-        std::uint8_t *data_base = serv_->get_large_chunk_base();
-        const std::size_t estimated_size = estimate_compress_size(bmp, data_base);
-        const std::size_t org_size = bmp->bitmap_->header_.bitmap_size - sizeof(loader::sbm_header);
+        if (!new_data) {
+            LOG_ERROR(SERVICE_FBS, "Unable to allocate compressed data for bitmap {}", bmp->id);
 
-        if (estimated_size >= org_size) {
-            // Stop compress
             if (bmp->support_dirty_bitmap) {
                 serv_->free_bitmap(clean_bitmap);
             }
 
-            bmp->compress_done_nof.complete(epoc::error_none);
+            bmp->compress_done_nof.complete(epoc::error_no_memory);
             return;
         }
 
-        std::uint8_t *new_data = reinterpret_cast<std::uint8_t *>(serv_->allocate_large_data(estimated_size));
-        const bool compress_result = compress_data(bmp, data_base, new_data, estimated_size);
-
-        if (!compress_result) {
-            LOG_ERROR(SERVICE_FBS, "Unable to compress bitmap {}", bmp->id);
-
-            // Cleanup
-            serv_->free_large_data(new_data);
-
-            if (bmp->support_dirty_bitmap) {
-                serv_->free_bitmap(clean_bitmap);
-            }
-
-            return;
-        }
+        std::memcpy(new_data, scratch.data(), compressed_size);
 
+        clean_bitmap->bitmap_->header_.compression = target_compression;
+        clean_bitmap->bitmap_->compressed_in_ram_ = true;
         clean_bitmap->bitmap_->data_offset_ = static_cast<int>(new_data - data_base);
-        clean_bitmap->bitmap_->header_.bitmap_size = static_cast<std::uint32_t>(estimated_size + sizeof(loader::sbm_header));
+        clean_bitmap->bitmap_->header_.bitmap_size = static_cast<std::uint32_t>(compressed_size + sizeof(loader::sbm_header));
 
         // Notify dirty bitmaps
         {
@@ -201,17 +234,91 @@ namespace eka2l1 {
         // Mark old bitmap as dirty
         bmp->bitmap_->settings_.dirty_bitmap(true);
 
-        LOG_TRACE(SERVICE_FBS, "Bitmap ID {} compressed with ratio {}%, clean bitmap ID {}", bmp->id, static_cast<int>(static_cast<double>(estimated_size) / static_cast<double>(org_size) * 100.0), clean_bitmap->id);
+        total_bytes_saved_ += org_size - compressed_size;
+
+        LOG_TRACE(SERVICE_FBS, "Bitmap ID {} compressed with ratio {}%, clean bitmap ID {}", bmp->id, static_cast<int>(static_cast<double>(compressed_size) / static_cast<double>(org_size) * 100.0), clean_bitmap->id);
+    }
+
+    void compress_queue::worker_loop() {
+        common::set_thread_name("FBS Server compressor thread");
+
+        // Each worker keeps its own scratch, to not reallocate on every bitmap.
+        std::vector<std::uint8_t> scratch;
+
+        while (true) {
+            compress_request request;
+
+            {
+                std::unique_lock<std::mutex> ulock(queue_mutex_);
+
+                while (!abort_ && queue_.empty()) {
+                    queue_cond_.wait(ulock);
+                }
+
+                if (abort_) {
+                    break;
+                }
+
+                request = queue_.top();
+                queue_.pop();
+            }
+
+            queue_full_cond_.notify_one();
+            actual_compress(request.bmp_, scratch);
+
+            const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - request.queued_time_);
+
+            total_latency_us_ += static_cast<std::uint64_t>(latency.count());
+            total_compressed_++;
+        }
     }
 
     void compress_queue::run() {
-        while (auto bmp = queue_.pop()) {
-            actual_compress(bmp.value());
+        for (auto &worker : workers_) {
+            if (!worker) {
+                worker = std::make_unique<std::thread>([this]() { worker_loop(); });
+            }
         }
     }
 
     void compress_queue::abort() {
-        queue_.abort();
+        {
+            const std::lock_guard<std::mutex> guard(queue_mutex_);
+            abort_ = true;
+        }
+
+        queue_cond_.notify_all();
+        queue_full_cond_.notify_all();
+
+        for (auto &worker : workers_) {
+            if (worker && worker->joinable()) {
+                worker->join();
+            }
+        }
+
+        // Workers are gone, cancel the requests they did not get to
+        const std::lock_guard<std::mutex> guard(queue_mutex_);
+
+        while (!queue_.empty()) {
+            queue_.top().bmp_->compress_done_nof.complete(epoc::error_cancel);
+            queue_.pop();
+        }
+    }
+
+    compress_queue_stats compress_queue::get_stats() {
+        compress_queue_stats stats;
+
+        {
+            const std::lock_guard<std::mutex> guard(queue_mutex_);
+            stats.queue_depth_ = static_cast<std::uint32_t>(queue_.size());
+        }
+
+        stats.total_compressed_ = total_compressed_;
+        stats.total_latency_us_ = total_latency_us_;
+        stats.total_bytes_saved_ = total_bytes_saved_;
+
+        return stats;
     }
 
     void compress_queue::notify(epoc::notify_info &nof) {
@@ -231,4 +338,4 @@ namespace eka2l1 {
         nof.complete(epoc::error_cancel);
         return true;
     }
-}
\ No newline at end of file
+}
@@ -244,11 +244,6 @@ namespace eka2l1 {
         , bmp_font_vtab(0) {
     }
 
-    static void compressor_thread_func(compress_queue *queue) {
-        common::set_thread_name("FBS Server compressor thread");
-        queue->run();
-    }
-
     int fbs_server::legacy_level() const {
         if (kern->is_eka1()) {
             return 2;
@@ -362,10 +357,10 @@ namespace eka2l1 {
         large_chunk_allocator->allocate(4);
         shared_chunk_allocator->allocate(4);
 
-        // Create compressor thread
+        // Create compressor workers
         if (sys->get_config()->fbs_enable_compression_queue) {
             compressor = std::make_unique<compress_queue>(this);
-            compressor_thread = std::make_unique<std::thread>(compressor_thread_func, compressor.get());
+            compressor->run();
         }
     }
 
@@ -422,7 +417,13 @@ namespace eka2l1 {
     fbs_server::~fbs_server() {
         if (compressor) {
             compressor->abort();
-            compressor_thread->join();
+
+            const compress_queue_stats stats = compressor->get_stats();
+            if (stats.total_compressed_ != 0) {
+                LOG_TRACE(SERVICE_FBS, "Compressed {} bitmaps with {} workers, average latency {}us, total {} bytes saved",
+                    stats.total_compressed_, compressor->worker_count(), stats.total_latency_us_ / stats.total_compressed_,
+                    stats.total_bytes_saved_);
+            }
         }
 
         clear_all_sessions();
@@ -26,6 +26,7 @@
 #include <common/cvt.h>
 #include <common/fileutils.h>
 #include <common/log.h>
+#include <common/pixelconv.h>
 
 #include <services/fbs/fbs.h>
 #include <services/fbs/palette.h>
@@ -896,6 +897,7 @@ namespace eka2l1 {
 
             switch (dib_header.bit_per_pixels) {
             case 8:
+            case 12:
             case 16: {
                 dib_header.header_size = sizeof(common::dib_header_v1);
                 dib_header.comp = 0;
@@ -935,85 +937,43 @@ namespace eka2l1 {
 
                 const std::uint8_t *packed_data = reinterpret_cast<const std::uint8_t *>(bitmap->data_offset_ + base);
 
-                switch (bitmap->settings_.current_display_mode()) {
-                case epoc::display_mode::color64k:
-                    for (std::size_t y = 0; y < bitmap->header_.size_pixels.y; y++) {
-                        for (std::size_t x = 0; x < bitmap->header_.size_pixels.x; x++) {
-                            const std::uint16_t pixel = *reinterpret_cast<const std::uint16_t *>(packed_data + y * byte_width + x * 2);
-                            std::uint8_t r = static_cast<std::uint8_t>((pixel & 0xF800) >> 8);
-                            r += r >> 5;
-
-                            std::uint8_t g = static_cast<std::uint8_t>((pixel & 0x07E0) >> 3);
-                            g += g >> 6;
-
-                            std::uint8_t b = static_cast<std::uint8_t>((pixel & 0x001F) << 3);
-                            b += b >> 5;
-
-                            file.write(reinterpret_cast<const char *>(&b), 1);
-                            file.write(reinterpret_cast<const char *>(&g), 1);
-                            file.write(reinterpret_cast<const char *>(&r), 1);
-                        }
-
-                        const std::size_t fill_align = common::align(bitmap->header_.size_pixels.x * 3, 4)
-                            - bitmap->header_.size_pixels.x * 3;
-
-                        const char fill_char = 0;
+                common::pixel_format src_format = common::pixel_format_bgr24;
+                const std::uint32_t *palette = nullptr;
+                std::uint32_t grey_palette[256];
 
-                        for (std::size_t i = 0; i < fill_align; i++) {
-                            file.write(&fill_char, 1);
-                        }
-                    }
+                switch (bitmap->settings_.current_display_mode()) {
+                case epoc::display_mode::color4k:
+                    src_format = common::pixel_format_rgb444;
+                    break;
 
+                case epoc::display_mode::color64k:
+                    src_format = common::pixel_format_rgb565;
                     break;
 
                 case epoc::display_mode::color256:
-                    for (std::size_t y = 0; y < bitmap->header_.size_pixels.y; y++) {
-                        for (std::size_t x = 0; x < bitmap->header_.size_pixels.x; x++) {
-                            const std::uint8_t pixel = *reinterpret_cast<const std::uint8_t *>(packed_data + y * byte_width + x);
-                            std::uint32_t palette_color = epoc::get_suitable_palette_256(sysver)[pixel];
-
-                            file.write(reinterpret_cast<const char *>(&palette_color) + 2, 1);
-                            file.write(reinterpret_cast<const char *>(&palette_color) + 1, 1);
-                            file.write(reinterpret_cast<const char *>(&palette_color) + 0, 1);
-                        }
-
-                        const std::size_t fill_align = common::align(bitmap->header_.size_pixels.x * 3, 4)
-                            - bitmap->header_.size_pixels.x * 3;
-
-                        const char fill_char = 0;
-
-                        for (std::size_t i = 0; i < fill_align; i++) {
-                            file.write(&fill_char, 1);
-                        }
-                    }
-
+                    src_format = common::pixel_format_palette8;
+                    palette = epoc::get_suitable_palette_256(sysver).data();
                     break;
 
                 case epoc::display_mode::gray256:
-                    for (std::size_t y = 0; y < bitmap->header_.size_pixels.y; y++) {
-                        for (std::size_t x = 0; x < bitmap->header_.size_pixels.x; x++) {
-                            const std::uint8_t pixel = *reinterpret_cast<const std::uint8_t *>(packed_data + y * byte_width + x);
-
-                            file.write(reinterpret_cast<const char *>(&pixel), 1);
-                            file.write(reinterpret_cast<const char *>(&pixel), 1);
-                            file.write(reinterpret_cast<const char *>(&pixel), 1);
-                        }
-
-                        const std::size_t fill_align = common::align(bitmap->header_.size_pixels.x * 3, 4)
-                            - bitmap->header_.size_pixels.x * 3;
-
-                        const char fill_char = 0;
-
-                        for (std::size_t i = 0; i < fill_align; i++) {
-                            file.write(&fill_char, 1);
-                        }
-                    }
-
+                    src_format = common::pixel_format_palette8;
+                    common::make_grey_palette(8, grey_palette);
+                    palette = grey_palette;
                     break;
 
                 default:
                     file.write(bitmap->data_offset_ + base, dib_header.uncompressed_size);
-                    break;
+                    return true;
+                }
+
+                // BMP rows are aligned to 4 bytes, the padding stays zero
+                std::vector<std::uint8_t> converted_line(common::align(bitmap->header_.size_pixels.x * 3, 4), 0);
+
+                for (std::size_t y = 0; y < bitmap->header_.size_pixels.y; y++) {
+                    common::convert_pixels(converted_line.data(), converted_line.size(), common::pixel_format_bgr24,
+                        packed_data + y * byte_width, byte_width, src_format, bitmap->header_.size_pixels.x, 1, palette);
+
+                    file.write(reinterpret_cast<const char *>(converted_line.data()), converted_line.size());
                 }
             }
 
@@ -1045,6 +1005,7 @@ namespace eka2l1 {
         bmp->compress_done_nof = notify_for_me;
 
         // Done async. Please kernel dont freak out.
-        compressor->compress(bmp);
+        // Requests from foreground apps carry higher thread priority, so they get served first.
+        compressor->compress(bmp, ctx->msg->own_thr->current_real_priority());
     }
 }
@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <services/fs/dircache.h>
+#include <services/fs/std.h>
+
+#include <common/algorithm.h>
+#include <common/cvt.h>
+#include <common/watcher.h>
+
+#include <vfs/vfs.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace eka2l1::epoc::fs {
+    // TEntry header, plus the name descriptor's length word
+    static constexpr std::size_t PACKED_ENTRY_HEADER_SIZE = entry_standard_size + 4;
+
+    packed_dir_listing::packed_dir_listing(const bool support_64bit_size)
+        : support_64bit_size_(support_64bit_size) {
+        offsets_.push_back(0);
+    }
+
+    void packed_dir_listing::add_entry(const entry &ent) {
+        const std::size_t name_size = ent.name.get_length() * sizeof(char16_t);
+        const std::size_t name_size_aligned = common::align(name_size, 4);
+
+        const std::size_t start = data_.size();
+        data_.resize(start + PACKED_ENTRY_HEADER_SIZE + name_size_aligned + (support_64bit_size_ ? 8 : 0), 0);
+
+        std::uint8_t *dest = data_.data() + start;
+
+        std::memcpy(dest, &ent, PACKED_ENTRY_HEADER_SIZE);
+        std::memcpy(dest + PACKED_ENTRY_HEADER_SIZE, &ent.name.data[0], name_size);
+
+        if (support_64bit_size_) {
+            // Epoc10 uses two reserved bytes
+            std::memcpy(dest + PACKED_ENTRY_HEADER_SIZE + name_size_aligned, &ent.size_high, 8);
+        }
+
+        offsets_.push_back(static_cast<std::uint32_t>(data_.size()));
+    }
+
+    std::size_t packed_dir_listing::copy_entries(const std::size_t first, std::uint8_t *dest, const std::size_t dest_size,
+        std::size_t &written) const {
+        written = 0;
+
+        // Keep the headroom the entry by entry packer used to ask for: room for the 64-bit words and 4 more bytes
+        const std::size_t headroom = support_64bit_size_ ? 4 : 12;
+
+        if ((first >= entry_count()) || (dest_size <= headroom)) {
+            return 0;
+        }
+
+        const std::uint64_t base = offsets_[first];
+        const std::uint64_t limit = base + dest_size - headroom;
+
+        // Entry i fits if it ends before the limit. Offsets are sorted, so the last fitting one is a binary search away.
+        auto last_ite = std::upper_bound(offsets_.begin() + first + 1, offsets_.end(), limit,
+            [](const std::uint64_t value, const std::uint32_t offset) { return value < offset; });
+
+        const std::size_t last = static_cast<std::size_t>(std::distance(offsets_.begin(), last_ite)) - 1;
+
+        written = static_cast<std::size_t>(offsets_[last] - base);
+        std::memcpy(dest, data_.data() + base, written);
+
+        return last - first;
+    }
+
+    void packed_dir_listing::get_entry(const std::size_t index, entry &ent) const {
+        const std::uint8_t *src = data_.data() + offsets_[index];
+
+        std::memcpy(&ent, src, PACKED_ENTRY_HEADER_SIZE);
+
+        const std::size_t name_size = ent.name.get_length() * sizeof(char16_t);
+        std::memcpy(&ent.name.data[0], src + PACKED_ENTRY_HEADER_SIZE, name_size);
+
+        if (support_64bit_size_) {
+            std::memcpy(&ent.size_high, src + PACKED_ENTRY_HEADER_SIZE + common::align(name_size, 4), 8);
+        } else {
+            ent.size_high = 0;
+            ent.reserved = 0;
+        }
+    }
+
+    std::shared_ptr<packed_dir_listing> pack_dir_listing(io_system *io, directory *dir, const bool support_64bit_size) {
+        auto listing = std::make_shared<packed_dir_listing>(support_64bit_size);
+
+        while (std::optional<entry_info> info = dir->get_next_entry()) {
+            entry ent;
+            build_symbian_entry_from_emulator_entry(io, info.value(), ent);
+            ent.reserved = 0;
+
+            listing->add_entry(ent);
+        }
+
+        return listing;
+    }
+
+    static void split_dir_and_filter(const std::u16string &path, std::u16string &dir, std::u16string &filter) {
+        const std::size_t sep = path.find_last_of(u"\\/");
+
+        if ((sep == std::u16string::npos) || (sep == path.length() - 1)) {
+            dir = path;
+            filter = u"*";
+
+            return;
+        }
+
+        dir = path.substr(0, sep + 1);
+        filter = path.substr(sep + 1);
+    }
+
+    dir_listing_cache::dir_listing_cache(io_system *io, const std::size_t max_size, const std::size_t max_dirs)
+        : io_(io)
+        , total_size_(0)
+        , max_size_(max_size)
+        , max_dirs_(max_dirs) {
+    }
+
+    dir_listing_cache::~dir_listing_cache() {
+        for (auto &[key, dir] : dirs_) {
+            io_->unwatch_directory(dir.watch_);
+        }
+    }
+
+    std::size_t dir_listing_cache::watched_dir_count() {
+        const std::lock_guard<std::mutex> guard(lock_);
+        return dirs_.size();
+    }
+
+    std::u16string dir_listing_cache::host_key_of(const std::u16string &guest_dir) {
+        std::optional<std::u16string> host_path = io_->get_raw_path(guest_dir);
+
+        if (!host_path) {
+            return u"";
+        }
+
+        std::u16string key = common::lowercase_ucs2_string(host_path.value());
+
+        while (!key.empty() && ((key.back() == u'\\') || (key.back() == u'/'))) {
+            key.pop_back();
+        }
+
+        return key;
+    }
+
+    void dir_listing_cache::drop_listings(cached_dir &dir) {
+        total_size_ -= dir.size_;
+
+        dir.size_ = 0;
+        dir.listings_.clear();
+    }
+
+    void dir_listing_cache::evict_to_budget(std::vector<std::int64_t> &evicted_watches) {
+        while (((total_size_ > max_size_) || (dirs_.size() > max_dirs_)) && !lru_.empty()) {
+            auto ite = dirs_.find(lru_.back());
+
+            drop_listings(ite->second);
+            evicted_watches.push_back(ite->second.watch_);
+
+            dirs_.erase(ite);
+            lru_.pop_back();
+        }
+    }
+
+    void dir_listing_cache::unwatch_all(const std::vector<std::int64_t> &watches) {
+        // Never called with the lock held: unwatching may wait for the watcher thread, which may be
+        // waiting for the lock in a change callback
+        for (const std::int64_t watch : watches) {
+            io_->unwatch_directory(watch);
+        }
+    }
+
+    void dir_listing_cache::invalidate_host_dir(const std::u16string &host_key) {
+        if (host_key.empty()) {
+            return;
+        }
+
+        const std::lock_guard<std::mutex> guard(lock_);
+        auto ite = dirs_.find(host_key);
+
+        if (ite == dirs_.end()) {
+            return;
+        }
+
+        // Listings being packed right now can not be trusted anymore
+        ite->second.generation_++;
+        drop_listings(ite->second);
+    }
+
+    void dir_listing_cache::invalidate(const std::u16string &path) {
+        std::u16string entry_path = path;
+
+        while (!entry_path.empty() && ((entry_path.back() == u'\\') || (entry_path.back() == u'/'))) {
+            entry_path.pop_back();
+        }
+
+        const std::size_t sep = entry_path.find_last_of(u"\\/");
+
+        if (sep == std::u16string::npos) {
+            return;
+        }
+
+        invalidate_host_dir(host_key_of(entry_path.substr(0, sep + 1)));
+        invalidate_host_dir(host_key_of(entry_path));
+    }
+
+    packed_dir_listing_ptr dir_listing_cache::get_listing(const std::u16string &path, const std::uint32_t attrib, directory *dir,
+        const bool support_64bit_size) {
+        std::u16string dir_path;
+        std::u16string filter;
+
+        split_dir_and_filter(path, dir_path, filter);
+
+        const std::u16string host_key = host_key_of(dir_path);
+
+        if (host_key.empty()) {
+            return pack_dir_listing(io_, dir, support_64bit_size);
+        }
+
+        const std::u16string listing_key = common::lowercase_ucs2_string(filter) + u'|'
+            + common::utf8_to_ucs2(std::to_string(attrib)) + (support_64bit_size ? u"|64" : u"|32");
+
+        std::uint64_t generation = 0;
+        bool watched = false;
+
+        {
+            const std::lock_guard<std::mutex> guard(lock_);
+            auto ite = dirs_.find(host_key);
+
+            if (ite != dirs_.end()) {
+                cached_dir &cdir = ite->second;
+                lru_.splice(lru_.begin(), lru_, cdir.lru_link_);
+
+                auto listing_ite = cdir.listings_.find(listing_key);
+
+                if (listing_ite != cdir.listings_.end()) {
+                    return listing_ite->second;
+                }
+
+                generation = cdir.generation_;
+                watched = true;
+            }
+        }
+
+        std::vector<std::int64_t> unneeded_watches;
+
+        if (!watched) {
+            // Register outside of the lock, see unwatch_all
+            const std::int64_t watch = io_->watch_directory(
+                dir_path, [this, host_key](void *userdata, common::directory_changes &changes) {
+                    invalidate_host_dir(host_key);
+                },
+                nullptr, common::directory_change_move | common::directory_change_last_write | common::directory_change_attrib);
+
+            if (watch == -1) {
+                // Without a watch we can't tell when host changes the directory
+                return pack_dir_listing(io_, dir, support_64bit_size);
+            }
+
+            {
+                const std::lock_guard<std::mutex> guard(lock_);
+                auto [ite, inserted] = dirs_.emplace(host_key, cached_dir{});
+
+                if (inserted) {
+                    ite->second.watch_ = watch;
+
+                    lru_.push_front(host_key);
+                    ite->second.lru_link_ = lru_.begin();
+
+                    evict_to_budget(unneeded_watches);
+                } else {
+                    // Watched by someone else in the meantime
+                    unneeded_watches.push_back(watch);
+                }
+
+                generation = ite->second.generation_;
+            }
+
+            unwatch_all(unneeded_watches);
+            unneeded_watches.clear();
+        }
+
+        std::shared_ptr<packed_dir_listing> listing = pack_dir_listing(io_, dir, support_64bit_size);
+
+        {
+            const std::lock_guard<std::mutex> guard(lock_);
+            auto ite = dirs_.find(host_key);
+
+            // If the directory was evicted or changed while packing, the listing may already be stale
+            if ((ite == dirs_.end()) || (ite->second.generation_ != generation)) {
+                return listing;
+            }
+
+            cached_dir &cdir = ite->second;
+
+            if (!cdir.listings_.emplace(listing_key, listing).second) {
+                return listing;
+            }
+
+            const std::size_t listing_size = listing->data_.size() + listing->offsets_.size() * sizeof(std::uint32_t);
+
+            cdir.size_ += listing_size;
+            total_size_ += listing_size;
+
+            lru_.splice(lru_.begin(), lru_, cdir.lru_link_);
+            evict_to_budget(unneeded_watches);
+        }
+
+        unwatch_all(unneeded_watches);
+        return listing;
+    }
+}
@@ -75,6 +75,13 @@ namespace eka2l1 {
             return;
         }
 
+        kernel_system *kern = ctx->sys->get_kernel_system();
+        const bool should_support_64bit_size = kern->get_epoc_version() >= epocver::epoc95;
+
+        // Pack the whole listing now, or reuse the one packed last time the directory was listed
+        node->dir_listing = server<fs_server>()->dir_cache.get_listing(*dir, attrib,
+            reinterpret_cast<directory *>(node->vfs_node.get()), should_support_64bit_size);
+
         size_t dir_handle = obj_table_.add(node);
 
         struct uid_type {
@@ -125,18 +132,15 @@ namespace eka2l1 {
             return;
         }
 
-        io_system *io = ctx->sys->get_io_system();
-        directory *dir = reinterpret_cast<directory *>(dir_node->vfs_node.get());
+        const epoc::fs::packed_dir_listing *listing = dir_node->dir_listing.get();
 
-        epoc::fs::entry entry;
-        std::optional<entry_info> info = dir->get_next_entry();
-
-        if (!info) {
+        if (dir_node->dir_listing_cursor >= listing->entry_count()) {
             ctx->complete(epoc::error_eof);
             return;
         }
 
-        epoc::fs::build_symbian_entry_from_emulator_entry(io, info.value(), entry);
+        epoc::fs::entry entry;
+        listing->get_entry(dir_node->dir_listing_cursor++, entry);
 
         ctx->write_data_to_descriptor_argument<epoc::fs::entry>(1, entry);
         ctx->complete(epoc::error_none);
@@ -158,66 +162,29 @@ namespace eka2l1 {
             return;
         }
 
-        directory *dir = reinterpret_cast<directory *>(dir_node->vfs_node.get());
-
         kernel::process *own_pr = ctx->msg->own_thr->owning_process();
 
         epoc::des8 *entry_arr = ptr<epoc::des8>(*entry_arr_vir_ptr).get(own_pr);
         epoc::buf_des<char> *entry_arr_buf = reinterpret_cast<epoc::buf_des<char> *>(entry_arr);
 
         std::uint8_t *entry_buf = reinterpret_cast<std::uint8_t *>(entry_arr->get_pointer(own_pr));
-        std::uint8_t *entry_buf_end = entry_buf + entry_arr_buf->max_length;
-        std::uint8_t *entry_buf_org = entry_buf;
-
-        size_t queried_entries = 0;
 
-        // 4 is for info (length + descriptor type)
-        size_t entry_no_name_size = epoc::fs::entry_standard_size + 4 + 8;
+        const epoc::fs::packed_dir_listing *listing = dir_node->dir_listing.get();
+        std::size_t written = 0;
 
-        kernel_system *kern = ctx->sys->get_kernel_system();
-        io_system *io = ctx->sys->get_io_system();
+        const std::size_t queried_entries = listing->copy_entries(dir_node->dir_listing_cursor, entry_buf,
+            entry_arr_buf->max_length, written);
 
-        const bool should_support_64bit_size = kern->get_epoc_version() >= epocver::epoc95;
+        dir_node->dir_listing_cursor += queried_entries;
+        entry_arr->set_length(own_pr, static_cast<std::uint32_t>(written));
 
-        while (entry_buf < entry_buf_end) {
-            epoc::fs::entry entry;
-            std::optional<entry_info> info = dir->peek_next_entry();
-
-            if (!info) {
-                entry_arr->set_length(own_pr, static_cast<std::uint32_t>(entry_buf - entry_buf_org));
-                LOG_TRACE(SERVICE_EFSRV, "Queried entries: 0x{:x}", queried_entries);
-                ctx->complete(epoc::error_eof);
-
-                return;
-            }
-
-            if (entry_buf + entry_no_name_size + common::align(common::utf8_to_ucs2(info->name).length() * 2, 4) + 4 > entry_buf_end) {
-                break;
-            }
-
-            epoc::fs::build_symbian_entry_from_emulator_entry(io, info.value(), entry);
-            const std::uint32_t entry_write_size = epoc::fs::entry_standard_size + 4;
-
-            memcpy(entry_buf, &entry, entry_write_size);
-            entry_buf += entry_write_size;
-
-            memcpy(entry_buf, &entry.name.data[0], info->name.length() * 2);
-            entry_buf += common::align(info->name.length() * 2, 4);
-
-            if (should_support_64bit_size) {
-                // Epoc10 uses two reserved bytes
-                memcpy(entry_buf, &entry.size_high, 8);
-                entry_buf += 8;
-            }
+        LOG_TRACE(SERVICE_EFSRV, "Queried entries: 0x{:x}", queried_entries);
 
-            queried_entries += 1;
-            dir->get_next_entry();
+        if (dir_node->dir_listing_cursor >= listing->entry_count()) {
+            ctx->complete(epoc::error_eof);
+            return;
         }
 
-        entry_arr->set_length(own_pr, static_cast<std::uint32_t>(entry_buf - entry_buf_org));
-
-        LOG_TRACE(SERVICE_EFSRV, "Queried entries: 0x{:x}", queried_entries);
-
         ctx->complete(epoc::error_none);
     }
 }
@@ -72,6 +72,10 @@ namespace eka2l1 {
 
     void fs_node::deref() {
         if (count == 1) {
+            if (io_pool) {
+                io_pool->wait_idle(this);
+            }
+
             vfs_node.reset();
         }
 
@@ -207,6 +211,8 @@ namespace eka2l1 {
             f->seek(size, file_seek_mode::beg);
         }
 
+        server<fs_server>()->dir_cache.invalidate(f->file_name());
+
         ctx->complete(epoc::error_none);
     }
 
@@ -368,6 +374,9 @@ namespace eka2l1 {
             return;
         }
 
+        server<fs_server>()->dir_cache.invalidate(vfs_file->file_name());
+        server<fs_server>()->dir_cache.invalidate(new_path_abs);
+
         // Save state of file and reopening it
         size_t last_pos = vfs_file->tell();
         int last_mode = vfs_file->file_mode();
@@ -382,22 +391,69 @@ namespace eka2l1 {
         ctx->complete(epoc::error_none);
     }
 
-    void fs_server_client::file_write(service::ipc_context *ctx) {
-        std::optional<std::int32_t> handle_res = ctx->get_argument_value<std::int32_t>(3);
+    // Reads and writes from this size are done on the I/O workers, smaller ones are not worth the round trip
+    static constexpr std::int32_t ASYNC_IO_THRESHOLD = 64 * 1024;
 
-        if (!handle_res) {
-            ctx->complete(epoc::error_argument);
-            return;
+    static bool is_current_position(const std::int32_t pos_provided) {
+        // Low MaxUint64
+        return (pos_provided == static_cast<int>(0x80000000)) || (pos_provided == -1);
+    }
+
+    static std::size_t write_file_at(file *vfs_file, const void *data, const std::int32_t write_len, const std::int32_t write_pos_provided) {
+        std::uint64_t write_pos = vfs_file->tell();
+        std::uint64_t size_of_file = vfs_file->size();
+
+        if (!is_current_position(write_pos_provided)) {
+            write_pos = write_pos_provided;
         }
 
-        std::optional<std::string> write_data = ctx->get_argument_value<std::string>(0);
+        if (write_pos > size_of_file) {
+            // Fill the file with temporary 0
+            vfs_file->seek(0, file_seek_mode::end);
+            static char ZERO_BYTE = 0;
 
-        if (!write_data) {
+            if (vfs_file->write_file(&ZERO_BYTE, 1, static_cast<std::uint32_t>(write_pos - size_of_file)) != write_pos - size_of_file) {
+                LOG_WARN(SERVICE_EFSRV, "Unable to supply stubbed bytes for beyond file size write operation!");
+            }
+        }
+
+        // If this write pos is beyond the current end of file, use last pos
+        vfs_file->seek(write_pos, file_seek_mode::beg);
+        return vfs_file->write_file(data, 1, write_len);
+    }
+
+    static std::size_t read_file_at(file *vfs_file, void *dest, std::int32_t read_len, const std::int32_t read_pos_provided) {
+        std::uint64_t read_pos = vfs_file->tell();
+
+        if (!is_current_position(read_pos_provided)) {
+            read_pos = read_pos_provided;
+        }
+
+        vfs_file->seek(read_pos, file_seek_mode::beg);
+
+        const std::uint64_t size = vfs_file->size();
+
+        if (read_pos >= size) {
+            return 0;
+        }
+
+        if (size - read_pos < static_cast<std::uint64_t>(read_len)) {
+            read_len = static_cast<std::int32_t>(size - read_pos);
+        }
+
+        return vfs_file->read_file(dest, 1, read_len);
+    }
+
+    void fs_server_client::file_write(service::ipc_context *ctx) {
+        std::optional<std::int32_t> handle_res = ctx->get_argument_value<std::int32_t>(3);
+
+        if (!handle_res) {
             ctx->complete(epoc::error_argument);
             return;
         }
 
-        fs_node *node = get_file_node(*handle_res);
+        // Not waiting for queued I/O here, the write queues behind it
+        fs_node *node = obj_table_.get<fs_node>(*handle_res);
 
         if (node == nullptr || node->vfs_node->type != io_component_type::file) {
             ctx->complete(epoc::error_bad_handle);
@@ -414,29 +470,37 @@ namespace eka2l1 {
         std::int32_t write_len = *ctx->get_argument_value<std::int32_t>(1);
         std::int32_t write_pos_provided = *ctx->get_argument_value<std::int32_t>(2);
 
-        std::uint64_t write_pos = 0;
-        std::uint64_t size_of_file = vfs_file->size();
+        if (write_len >= ASYNC_IO_THRESHOLD) {
+            // Write straight from the client buffer, it stays untouched until the request completes
+            const std::uint8_t *write_data = ctx->get_descriptor_argument_ptr(0);
+
+            if (!write_data) {
+                ctx->complete(epoc::error_argument);
+                return;
+            }
 
-        write_pos = vfs_file->tell();
+            write_len = static_cast<std::int32_t>(std::min<std::size_t>(write_len, ctx->get_argument_data_size(0)));
 
-        // Low MaxUint64
-        if ((write_pos_provided != static_cast<int>(0x80000000)) && (write_pos_provided != -1)) {
-            write_pos = write_pos_provided;
+            server<fs_server>()->queue_async_io(
+                ctx, node, [vfs_file, write_data, write_len, write_pos_provided]() -> std::int64_t {
+                    return static_cast<std::int64_t>(write_file_at(vfs_file, write_data, write_len, write_pos_provided));
+                });
+
+            return;
         }
 
-        if (write_pos > size_of_file) {
-            // Fill the file with temporary 0
-            vfs_file->seek(0, file_seek_mode::end);
-            static char ZERO_BYTE = 0;
+        if (node->io_pool) {
+            server<fs_server>()->flush_async_io(node);
+        }
 
-            if (vfs_file->write_file(&ZERO_BYTE, 1, static_cast<std::uint32_t>(write_pos - size_of_file)) != write_pos - size_of_file) {
-                LOG_WARN(SERVICE_EFSRV, "Unable to supply stubbed bytes for beyond file size write operation!");
-            }
+        std::optional<std::string> write_data = ctx->get_argument_value<std::string>(0);
+
+        if (!write_data) {
+            ctx->complete(epoc::error_argument);
+            return;
         }
 
-        // If this write pos is beyond the current end of file, use last pos
-        vfs_file->seek(write_pos, file_seek_mode::beg);
-        size_t wrote_size = vfs_file->write_file(write_data.value().data(), 1, write_len);
+        write_file_at(vfs_file, write_data.value().data(), write_len, write_pos_provided);
 
         //LOG_TRACE(SERVICE_EFSRV, "File {} wroted with size: {}, at {}", common::ucs2_to_utf8(vfs_file->file_name()), wrote_size, write_pos);
 
@@ -451,7 +515,8 @@ namespace eka2l1 {
             return;
         }
 
-        fs_node *node = get_file_node(*handle_res);
+        // Not waiting for queued I/O here, the read queues behind it
+        fs_node *node = obj_table_.get<fs_node>(*handle_res);
 
         if (node == nullptr || node->vfs_node->type != io_component_type::file) {
             ctx->complete(epoc::error_bad_handle);
@@ -463,28 +528,34 @@ namespace eka2l1 {
         int read_len = *ctx->get_argument_value<std::int32_t>(1);
         int read_pos_provided = *ctx->get_argument_value<std::int32_t>(2);
 
-        std::uint64_t read_pos = 0;
-        std::uint64_t last_pos = vfs_file->tell();
+        if (read_len >= ASYNC_IO_THRESHOLD) {
+            // Read straight into the client buffer
+            std::uint8_t *read_dest = ctx->get_descriptor_argument_ptr(0);
 
-        read_pos = last_pos;
+            if (!read_dest) {
+                ctx->complete(epoc::error_argument);
+                return;
+            }
 
-        // Low MaxUint64
-        if ((read_pos_provided != static_cast<int>(0x80000000)) && (read_pos_provided != -1)) {
-            read_pos = read_pos_provided;
-        }
+            read_len = static_cast<int>(std::min<std::size_t>(read_len, ctx->get_argument_max_data_size(0)));
 
-        vfs_file->seek(read_pos, file_seek_mode::beg);
+            server<fs_server>()->queue_async_io(
+                ctx, node, [vfs_file, read_dest, read_len, read_pos_provided]() -> std::int64_t {
+                    return static_cast<std::int64_t>(read_file_at(vfs_file, read_dest, read_len, read_pos_provided));
+                },
+                0);
 
-        uint64_t size = vfs_file->size();
+            return;
+        }
 
-        if (size - read_pos < read_len) {
-            read_len = static_cast<int>(size - read_pos);
+        if (node->io_pool) {
+            server<fs_server>()->flush_async_io(node);
         }
 
         std::vector<char> read_data;
         read_data.resize(read_len);
 
-        size_t read_finish_len = vfs_file->read_file(read_data.data(), 1, read_len);
+        size_t read_finish_len = read_file_at(vfs_file, read_data.data(), read_len, read_pos_provided);
         ctx->write_data_to_descriptor_argument(0, reinterpret_cast<uint8_t *>(read_data.data()), static_cast<std::uint32_t>(read_finish_len));
 
         //LOG_TRACE(SERVICE_EFSRV, "Readed {} from {} to address 0x{:x}", read_finish_len, read_pos, ctx->msg->args.args[0]);
@@ -514,6 +585,11 @@ namespace eka2l1 {
             ctx->sys->get_io_system()->delete_entry(path);
         }
 
+        if (node->temporary || (node->open_mode & (WRITE_MODE | APPEND_MODE))) {
+            // Size and modified time seen in listings are stale now
+            server<fs_server>()->dir_cache.invalidate(vfs_file->file_name());
+        }
+
         // Reset its status, so seek back, this is just in case it got used again
         vfs_file->seek(0, file_seek_mode::beg);
 
@@ -698,6 +774,23 @@ namespace eka2l1 {
             return;
         }
 
+        if (buffer_length >= static_cast<std::uint32_t>(ASYNC_IO_THRESHOLD)) {
+            // Nobody else knows about this file, so it is its own ordering key
+            std::shared_ptr<file> section_file = std::move(target_file);
+
+            server<fs_server>()->queue_async_io(
+                ctx, section_file.get(), [section_file, buffer, buffer_length, position]() -> std::int64_t {
+                    section_file->seek(position, eka2l1::file_seek_mode::beg);
+                    const std::size_t readed_size = section_file->read_file(buffer, buffer_length, 1);
+                    section_file->close();
+
+                    return static_cast<std::int64_t>(readed_size);
+                },
+                0);
+
+            return;
+        }
+
         target_file->seek(position, eka2l1::file_seek_mode::beg);
         const std::size_t readed_size = target_file->read_file(buffer, buffer_length, 1);
         target_file->close();
@@ -851,6 +944,12 @@ namespace eka2l1 {
 
         new_node->mix_mode = real_mode;
         new_node->open_mode = access_mode;
+        new_node->io_pool = server<fs_server>()->get_io_pool();
+
+        if (access_mode & WRITE_MODE) {
+            // The file may just have been created or truncated
+            server<fs_server>()->dir_cache.invalidate(name);
+        }
 
         return obj_table_.add(new_node);
     }
@@ -26,6 +26,7 @@
 #include <utils/des.h>
 
 #include <clocale>
+#include <limits>
 #include <cwctype>
 #include <memory>
 #include <regex>
@@ -38,6 +39,7 @@
 
 #include <system/epoc.h>
 #include <kernel/kernel.h>
+#include <kernel/timing.h>
 #include <vfs/vfs.h>
 
 #include <utils/err.h>
@@ -96,16 +98,140 @@ namespace eka2l1 {
 
     fs_server::fs_server(system *sys)
         : service::typical_server(sys, epoc::fs::get_server_name_through_epocver(sys->get_symbian_version_use()))
+        , dir_cache(sys->get_io_system())
+        , io_pool(std::make_unique<epoc::fs::io_worker_pool>())
+        , pending_io_counter(0)
         , flags(0) {
         // Create property references to system drive
         // TODO (pent0): Not hardcode the drive. Maybe dangerous, who knows.
         default_sys_path = u"C:\\";
-        system_drive_prop = &(*sys->get_kernel_system()->create<service::property>());
+        system_drive_prop = sys->get_kernel_system()->create<service::property>(static_cast<int>(FS_UID),
+            static_cast<int>(SYSTEM_DRIVE_KEY));
         system_drive_prop->define(service::property_type::int_data, 0);
         system_drive_prop->set_int(drive_c);
 
-        system_drive_prop->first = static_cast<int>(FS_UID);
-        system_drive_prop->second = static_cast<int>(SYSTEM_DRIVE_KEY);
+        io_complete_evt = kern->get_ntimer()->register_event("FsAsyncIoComplete",
+            [this](std::uint64_t data, std::uint64_t microsecs_late) { complete_async_io(data); });
+    }
+
+    fs_server::~fs_server() {
+        // Workers may still schedule completions while draining
+        io_pool.reset();
+        kern->get_ntimer()->remove_event(io_complete_evt);
+    }
+
+    void fs_server::queue_async_io(service::ipc_context *ctx, const void *key, epoc::fs::io_worker_pool::work_func work,
+        const int length_arg) {
+        pending_io pending;
+        pending.key = key;
+        pending.info = epoc::notify_info(ctx->msg->request_sts, ctx->msg->own_thr);
+        pending.owner = ctx->msg->own_thr->owning_process();
+
+        if (length_arg >= 0) {
+            const ipc_arg_type arg_type = ctx->msg->args.get_arg_type(length_arg);
+
+            if (!kern->is_eka1() && !((int)arg_type & (int)ipc_arg_type::flag_des)) {
+                ctx->complete(epoc::error_argument);
+                return;
+            }
+
+            pending.length_des = ctx->msg->args.args[length_arg];
+        }
+
+        std::uint64_t id = 0;
+
+        {
+            const std::lock_guard<std::mutex> guard(pending_ios_lock);
+            id = pending_io_counter++;
+
+            pending_ios.emplace(id, std::move(pending));
+        }
+
+        io_pool->submit(key, std::move(work), [this, id](const std::int64_t result) {
+            {
+                const std::lock_guard<std::mutex> guard(pending_ios_lock);
+                pending_io &done_io = pending_ios[id];
+
+                done_io.result = result;
+                done_io.done = true;
+            }
+
+            kern->get_ntimer()->schedule_event(0, io_complete_evt, id);
+        });
+    }
+
+    void fs_server::finish_async_ios(const void *key, const std::uint64_t last_id) {
+        std::vector<pending_io> finished;
+
+        {
+            const std::lock_guard<std::mutex> guard(pending_ios_lock);
+
+            for (auto ite = pending_ios.begin(); (ite != pending_ios.end()) && (ite->first <= last_id);) {
+                if (ite->second.key != key) {
+                    ite++;
+                    continue;
+                }
+
+                // Jobs of a key finish in order, anything after an unfinished one waits for it
+                if (!ite->second.done) {
+                    break;
+                }
+
+                finished.push_back(std::move(ite->second));
+                ite = pending_ios.erase(ite);
+            }
+        }
+
+        for (pending_io &pending : finished) {
+            if (pending.length_des) {
+                epoc::des8 *des = ptr<epoc::des8>(pending.length_des).get(pending.owner);
+
+                if (!des) {
+                    pending.info.complete(epoc::error_argument);
+                    continue;
+                }
+
+                des->set_length(pending.owner, static_cast<std::uint32_t>(pending.result));
+            }
+
+            pending.info.complete(epoc::error_none);
+        }
+    }
+
+    void fs_server::complete_async_io(const std::uint64_t id) {
+        const void *key = nullptr;
+
+        {
+            const std::lock_guard<std::mutex> guard(pending_ios_lock);
+            auto ite = pending_ios.find(id);
+
+            // Already completed by a flush
+            if (ite == pending_ios.end()) {
+                return;
+            }
+
+            key = ite->second.key;
+        }
+
+        kern->lock();
+        finish_async_ios(key, id);
+        kern->unlock();
+    }
+
+    void fs_server::flush_async_io(const void *key) {
+        io_pool->wait_idle(key);
+        finish_async_ios(key, std::numeric_limits<std::uint64_t>::max());
+    }
+
+    fs_node *fs_server_client::get_file_node(const int handle) {
+        fs_node *node = obj_table_.get<fs_node>(handle);
+
+        // Anything else done on the node must see the result of the queued I/O, and complete after it
+        if (node && node->io_pool) {
+            server<fs_server>()->flush_async_io(node);
+        }
+
+        return node;
     }
 
     void fs_server_client::fetch(service::ipc_context *ctx) {
@@ -228,6 +354,9 @@ namespace eka2l1 {
 
         bool res = io->rename(target, dest);
 
+        server<fs_server>()->dir_cache.invalidate(target);
+        server<fs_server>()->dir_cache.invalidate(dest);
+
         if (!res) {
             ctx->complete(epoc::error_general);
             return;
@@ -274,6 +403,9 @@ namespace eka2l1 {
             return;
         }
 
+        server<fs_server>()->dir_cache.invalidate(target);
+        server<fs_server>()->dir_cache.invalidate(dest);
+
         // A new app list may be created
         ctx->complete(epoc::error_none);
     }
@@ -296,6 +428,8 @@ namespace eka2l1 {
             return;
         }
 
+        server<fs_server>()->dir_cache.invalidate(path);
+
         ctx->complete(epoc::error_none);
     }
 
@@ -559,6 +693,22 @@ namespace eka2l1 {
             return;
         }
 
+        // Creating recursively, every missing parent may have been created too
+        const bool recursive = *ctx->get_argument_value<std::int32_t>(1);
+        std::u16string created = eka2l1::file_directory(*dir);
+
+        while (!created.empty()) {
+            server<fs_server>()->dir_cache.invalidate(created);
+
+            const std::size_t parent_sep = created.find_last_of(u"\\/", created.length() - 2);
+
+            if (!recursive || (parent_sep == std::u16string::npos) || (parent_sep <= 2)) {
+                break;
+            }
+
+            created.erase(parent_sep + 1);
+        }
+
         ctx->complete(epoc::error_none);
     }
 
@@ -573,6 +723,8 @@ namespace eka2l1 {
         io_system *io = ctx->sys->get_io_system();
         io->delete_entry(dir.value());
 
+        server<fs_server>()->dir_cache.invalidate(dir.value());
+
         ctx->complete(epoc::error_none);
     }
 
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <services/fs/ioworker.h>
+#include <common/thread.h>
+
+namespace eka2l1::epoc::fs {
+    io_worker_pool::io_worker_pool(const std::uint32_t worker_count)
+        : worker_count_(worker_count ? worker_count : 1)
+        , abort_(false) {
+    }
+
+    io_worker_pool::~io_worker_pool() {
+        {
+            const std::lock_guard<std::mutex> guard(lock_);
+            abort_ = true;
+        }
+
+        ready_cond_.notify_all();
+
+        for (std::thread &worker : workers_) {
+            worker.join();
+        }
+    }
+
+    void io_worker_pool::worker_loop() {
+        common::set_thread_name("File server I/O worker");
+
+        std::unique_lock<std::mutex> ulock(lock_);
+
+        while (true) {
+            while (!abort_ && ready_.empty()) {
+                ready_cond_.wait(ulock);
+            }
+
+            // Jobs already queued are drained, the done callbacks may hold messages waiting for them
+            if (ready_.empty()) {
+                break;
+            }
+
+            const void *key = ready_.front();
+            ready_.pop_front();
+
+            strand &target = strands_[key];
+            job current = std::move(target.jobs_.front());
+            target.jobs_.pop_front();
+
+            ulock.unlock();
+
+            const std::int64_t result = current.work_();
+
+            if (current.done_) {
+                current.done_(result);
+            }
+
+            ulock.lock();
+
+            // The strand stays owned by this worker until its queue runs dry, which keeps the order
+            strand &after = strands_[key];
+
+            if (after.jobs_.empty()) {
+                strands_.erase(key);
+                idle_cond_.notify_all();
+            } else {
+                ready_.push_back(key);
+                ready_cond_.notify_one();
+            }
+        }
+    }
+
+    void io_worker_pool::submit(const void *key, work_func work, done_func done) {
+        {
+            const std::lock_guard<std::mutex> guard(lock_);
+
+            if (workers_.empty()) {
+                for (std::uint32_t i = 0; i < worker_count_; i++) {
+                    workers_.emplace_back([this]() { worker_loop(); });
+                }
+            }
+
+            strand &target = strands_[key];
+            target.jobs_.push_back({ std::move(work), std::move(done) });
+
+            if (target.running_) {
+                return;
+            }
+
+            target.running_ = true;
+            ready_.push_back(key);
+        }
+
+        ready_cond_.notify_one();
+    }
+
+    void io_worker_pool::wait_idle(const void *key) {
+        std::unique_lock<std::mutex> ulock(lock_);
+
+        while (strands_.find(key) != strands_.end()) {
+            idle_cond_.wait(ulock);
+        }
+    }
+
+    bool io_worker_pool::is_idle(const void *key) {
+        const std::lock_guard<std::mutex> guard(lock_);
+        return strands_.find(key) == strands_.end();
+    }
+}
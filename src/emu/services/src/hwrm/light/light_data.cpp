@@ -27,17 +27,14 @@
 namespace eka2l1::epoc::hwrm::light {
     bool resource_data::initialise_components(kernel_system *kern) {
         // Create and define the property. Remember to destroy later.
-        infos_prop_ = kern->create<service::property>();
+        infos_prop_ = kern->create<service::property>(eka2l1::epoc::hwrm::SERVICE_UID,
+            eka2l1::epoc::hwrm::light::LIGHT_STATUS_PROP_KEY);
 
         if (!infos_prop_) {
             LOG_ERROR(SERVICE_HWRM, "Failed to create light service's status property! Abort.");
             return false;
         }
 
-        // Set the category and key, then define
-        infos_prop_->first = eka2l1::epoc::hwrm::SERVICE_UID;
-        infos_prop_->second = eka2l1::epoc::hwrm::light::LIGHT_STATUS_PROP_KEY;
-
         // Define and allocate the size that fit our maximum need.
         infos_prop_->define(service::property_type::bin_data, MAXIMUM_LIGHT * sizeof(target_info));
 
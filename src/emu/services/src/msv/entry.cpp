@@ -30,9 +30,20 @@
 #include <utils/bafl.h>
 #include <utils/err.h>
 
+#include <algorithm>
+
 namespace eka2l1::epoc::msv {
-    entry_indexer::entry_indexer(io_system *io, const std::u16string &msg_folder, const language preferred_lang)
-        : io_(io)
+    static constexpr std::uint32_t MSV_ENTRY_DRIVE_MASK = 0x0FFFFFFF;
+
+    static std::uint32_t get_entry_key(const std::uint32_t id) {
+        return id & MSV_ENTRY_DRIVE_MASK;
+    }
+
+    entry_indexer::entry_indexer(io_system *io, const std::u16string &msg_folder, const language preferred_lang,
+        const std::size_t max_loaded_entries)
+        : max_loaded_entries_(max_loaded_entries)
+        , index_record_count_(0)
+        , io_(io)
         , rom_drv_(drive_z)
         , preferred_lang_(preferred_lang)
         , msg_dir_(msg_folder) {
@@ -49,16 +60,14 @@ namespace eka2l1::epoc::msv {
 
         if (!load_entries_file(drive_c)) {
             entries_.clear();
+            children_.clear();
+            lru_.clear();
 
             create_root_entry();
             create_standard_entries(drive_c);
         }
     }
 
-    static bool msv_entry_comparator(const entry &lhs, const entry &rhs) {
-        return (lhs.id_ & 0x0FFFFFFF) < (rhs.id_ & 0x0FFFFFFF);
-    }
-
     struct entry_index_info {
         std::uint32_t id_;
         std::uint32_t service_id_;
@@ -78,58 +87,97 @@ namespace eka2l1::epoc::msv {
         }
 
         entry_index_info index_info;
+        index_record_count_ = 0;
 
         while (entry_file->valid()) {
             if (entry_file->read_file(&index_info, sizeof(entry_index_info), 1) != sizeof(entry_index_info)) {
                 break;
             }
 
-            epoc::msv::entry ent;
-            ent.id_ = index_info.id_;
-            ent.parent_id_ = index_info.parent_id_;
-            ent.service_id_ = index_info.service_id_;
-            ent.flags_ = index_info.flags_;
+            // Later records of the same entry supersede earlier ones
+            entry_node &node = entries_[get_entry_key(index_info.id_)];
+            node.ent_.id_ = index_info.id_;
+            node.ent_.parent_id_ = index_info.parent_id_;
+            node.ent_.service_id_ = index_info.service_id_;
+            node.ent_.flags_ = index_info.flags_;
+            node.loaded_ = false;
 
-            entries_.push_back(ent);
+            index_record_count_++;
         }
 
-        // Now that we complete the tree, load all the data
-        for (std::size_t i = 0; i < entries_.size(); i++) {
-            if (!load_entry_data(entries_[i])) {
-                LOG_WARN(SERVICE_MSV, "Unable to load entry data for entry ID {}", entries_[i].id_);
-            }
+        entry_file->close();
+
+        // Entry data is loaded on demand, only build the parent lookup now
+        for (auto &[key, node] : entries_) {
+            children_[static_cast<std::uint32_t>(node.ent_.parent_id_)].push_back(key);
+        }
+
+        for (auto &[parent, childs] : children_) {
+            std::sort(childs.begin(), childs.end());
+        }
+
+        if (index_record_count_ > entries_.size()) {
+            rewrite_entries_file();
         }
 
         return true;
     }
 
-    bool entry_indexer::update_entries_file(const std::size_t entry_pos_start) {
+    static void make_entry_index_info(const entry &ent, entry_index_info &index_info) {
+        index_info.id_ = ent.id_;
+        index_info.parent_id_ = ent.parent_id_;
+        index_info.service_id_ = ent.service_id_;
+        index_info.flags_ = ent.flags_;
+    }
+
+    bool entry_indexer::append_entries_file(const entry &ent) {
         std::u16string msg_entries_file = eka2l1::add_path(msg_dir_, u"Entries.chs");
+        symfile entry_file = io_->open_file(msg_entries_file, APPEND_MODE | BIN_MODE);
 
-        // Open the entry file first
+        if (!entry_file) {
+            LOG_ERROR(SERVICE_MSV, "Unable to open entries file to update entries list!");
+            return false;
+        }
+
+        entry_index_info index_info;
+        make_entry_index_info(ent, index_info);
+
+        if (entry_file->write_file(&index_info, sizeof(entry_index_info), 1) != sizeof(entry_index_info)) {
+            LOG_ERROR(SERVICE_MSV, "Unable to update MSV entry ID {} (write failure)", ent.id_);
+            return false;
+        }
+
+        index_record_count_++;
+        return true;
+    }
+
+    bool entry_indexer::rewrite_entries_file() {
+        std::u16string msg_entries_file = eka2l1::add_path(msg_dir_, u"Entries.chs");
         symfile entry_file = io_->open_file(msg_entries_file, WRITE_MODE | BIN_MODE);
 
         if (!entry_file) {
-            LOG_ERROR(SERVICE_MSV, "Unable to open entries file to update entries list!");
+            LOG_ERROR(SERVICE_MSV, "Unable to open entries file to rewrite entries list!");
             return false;
         }
 
-        entry_file->seek(entry_pos_start * sizeof(entry_index_info), file_seek_mode::beg);
+        std::vector<entry_index_info> index_infos;
+        index_infos.reserve(entries_.size());
 
-        for (std::size_t i = entry_pos_start; i < entries_.size(); i++) {
+        for (auto &[key, node] : entries_) {
             entry_index_info index_info;
+            make_entry_index_info(node.ent_, index_info);
 
-            index_info.id_ = entries_[i].id_;
-            index_info.parent_id_ = entries_[i].parent_id_;
-            index_info.service_id_ = entries_[i].service_id_;
-            index_info.flags_ = entries_[i].flags_;
+            index_infos.push_back(index_info);
+        }
 
-            if (entry_file->write_file(&index_info, sizeof(entry_index_info), 1) != sizeof(entry_index_info)) {
-                LOG_ERROR(SERVICE_MSV, "Unable to update MSV entry number {} (write failure)", i);
-                return false;
-            }
+        const std::size_t total_size = index_infos.size() * sizeof(entry_index_info);
+
+        if (entry_file->write_file(index_infos.data(), static_cast<std::uint32_t>(total_size), 1) != total_size) {
+            LOG_ERROR(SERVICE_MSV, "Unable to rewrite MSV entries file (write failure)");
+            return false;
         }
 
+        index_record_count_ = index_infos.size();
         return true;
     }
 
@@ -172,16 +220,13 @@ namespace eka2l1::epoc::msv {
         while (back_trace->parent_id_ != epoc::error_not_found) {
             parent_dir = get_folder_name(ent.parent_id_, MSV_FOLDER_TYPE_PATH) + u"\\" + parent_dir;
 
-            entry my_parent;
-            my_parent.id_ = back_trace->parent_id_;
-
-            auto ent_ite = std::lower_bound(entries_.begin(), entries_.end(), my_parent, msv_entry_comparator);
+            entry_node *parent_node = find_node(back_trace->parent_id_);
 
-            if ((ent_ite == entries_.end()) || (ent_ite->id_ != back_trace->parent_id_)) {
+            if (!parent_node) {
                 break;
             }
 
-            back_trace = &(*ent_ite);
+            back_trace = &parent_node->ent_;
         }
 
         file_path = eka2l1::add_path(file_path, parent_dir);
@@ -261,26 +306,73 @@ namespace eka2l1::epoc::msv {
         return true;
     }
 
+    entry_indexer::entry_node *entry_indexer::find_node(const std::uint32_t id) {
+        auto ite = entries_.find(get_entry_key(id));
+
+        if ((ite == entries_.end()) || (ite->second.ent_.id_ != id)) {
+            return nullptr;
+        }
+
+        return &ite->second;
+    }
+
+    void entry_indexer::touch_node(const std::uint32_t key, entry_node &node) {
+        if (node.loaded_) {
+            lru_.splice(lru_.begin(), lru_, node.lru_pos_);
+            return;
+        }
+
+        if (!load_entry_data(node.ent_)) {
+            LOG_WARN(SERVICE_MSV, "Unable to load entry data for entry ID {}", node.ent_.id_);
+        }
+
+        // Even on failure, don't retry the disk on every lookup
+        node.loaded_ = true;
+        node.lru_pos_ = lru_.insert(lru_.begin(), key);
+    }
+
+    void entry_indexer::trim_loaded_entries() {
+        while (lru_.size() > max_loaded_entries_) {
+            entry_node &node = entries_[lru_.back()];
+
+            std::u16string().swap(node.ent_.description_);
+            std::u16string().swap(node.ent_.details_);
+
+            node.loaded_ = false;
+            lru_.pop_back();
+        }
+    }
+
     entry *entry_indexer::get_entry(const std::uint32_t id) {
-        entry ent;
-        ent.id_ = id;
+        trim_loaded_entries();
+
+        entry_node *node = find_node(id);
 
-        auto ite_pos = std::lower_bound(entries_.begin(), entries_.end(), ent, msv_entry_comparator);
-        if ((ite_pos == entries_.end()) || (ite_pos->id_ != id)) {
+        if (!node) {
             return nullptr;
         }
 
-        return &(*ite_pos);
+        touch_node(get_entry_key(id), *node);
+        return &node->ent_;
     }
 
     std::vector<entry *> entry_indexer::get_entries_by_parent(const std::uint32_t parent_id) {
-        // TODO: Build a lookup map to increase speed.
+        trim_loaded_entries();
+
         std::vector<entry *> ents;
+        auto childs_ite = children_.find(parent_id);
 
-        for (auto &entry : entries_) {
-            if (entry.parent_id_ == parent_id) {
-                ents.push_back(&entry);
-            }
+        if (childs_ite == children_.end()) {
+            return ents;
+        }
+
+        ents.reserve(childs_ite->second.size());
+
+        for (const std::uint32_t key : childs_ite->second) {
+            entry_node &node = entries_[key];
+            touch_node(key, node);
+
+            ents.push_back(&node.ent_);
         }
 
         return ents;
@@ -290,24 +382,25 @@ namespace eka2l1::epoc::msv {
         ent.flags_ = entry::STATUS_PRESENT;
 
         // Find an entry with existing ID, if it exists then this entry will not be added.
-        if (std::binary_search(entries_.begin(), entries_.end(), ent, msv_entry_comparator)) {
+        const std::uint32_t key = get_entry_key(ent.id_);
+        auto result = entries_.emplace(key, entry_node{ ent, true, lru_.end() });
+
+        if (!result.second) {
             return false;
         }
 
-        // Add this entry. And sort by ID
-        entries_.push_back(ent);
-        std::sort(entries_.begin(), entries_.end(), msv_entry_comparator);
+        entry_node &node = result.first->second;
+        node.lru_pos_ = lru_.insert(lru_.begin(), key);
 
-        // Find the entry again in this sort list, and update the entries file from this position.
-        auto ite_pos = std::lower_bound(entries_.begin(), entries_.end(), ent, msv_entry_comparator);
-        const std::size_t start_update_pos = std::distance(entries_.begin(), ite_pos);
+        std::vector<std::uint32_t> &childs = children_[static_cast<std::uint32_t>(ent.parent_id_)];
+        childs.insert(std::upper_bound(childs.begin(), childs.end(), key), key);
 
-        if (!update_entries_file((start_update_pos == 0) ? 0 : (start_update_pos - 1))) {
+        if (!append_entries_file(node.ent_)) {
             return false;
         }
 
         // Save this entry to the correspond folder
-        return save_entry_data(*ite_pos);
+        return save_entry_data(node.ent_);
     }
 
     bool entry_indexer::create_root_entry() {
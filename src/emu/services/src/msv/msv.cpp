@@ -400,7 +400,13 @@ namespace eka2l1 {
         }
 
         epoc::msv::entry_indexer *indexer = server<msv_server>()->indexer_.get();
-        child_entries_ = indexer->get_entries_by_parent(details->parent_id_);
+        const std::vector<epoc::msv::entry *> childs = indexer->get_entries_by_parent(details->parent_id_);
+
+        child_entries_.clear();
+
+        for (epoc::msv::entry *child : childs) {
+            child_entries_.push_back(*child);
+        }
 
         if (child_entries_.empty()) {
             ctx->complete(epoc::error_not_found);
@@ -425,7 +431,7 @@ namespace eka2l1 {
 
         while ((written < buffer_max_size) && (!child_entries_.empty())) {
             common::chunkyseri measurer(nullptr, 0x1000, common::SERI_MODE_MEASURE);
-            pack_entry_to_buffer(measurer, *child_entries_.back());
+            pack_entry_to_buffer(measurer, child_entries_.back());
 
             if (measurer.size() + written > buffer_max_size) {
                 is_overflow = true;
@@ -433,7 +439,7 @@ namespace eka2l1 {
             }
 
             // Start writing to this buffer
-            pack_entry_to_buffer(seri, *child_entries_.back());
+            pack_entry_to_buffer(seri, child_entries_.back());
 
             details->child_count_in_array_++;
 
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <services/parsed_index.h>
+
+#include <common/chunkyseri.h>
+#include <common/cvt.h>
+#include <common/log.h>
+#include <common/path.h>
+#include <vfs/vfs.h>
+
+#define XXH_INLINE_ALL
+#include <xxhash.h>
+
+#include <cstring>
+
+namespace eka2l1::service {
+    static constexpr std::int16_t PARSED_FILE_INDEX_VERSION = 1;
+
+    static std::u16string make_record_key(const std::u16string &path) {
+        return common::lowercase_ucs2_string(path);
+    }
+
+    static void absorb_stamp(common::chunkyseri &seri, parsed_file_stamp &stamp) {
+        seri.absorb(stamp.path_);
+        seri.absorb(stamp.size_);
+        seri.absorb(stamp.last_write_);
+    }
+
+    static void absorb_bytes(common::chunkyseri &seri, std::vector<std::uint8_t> &data) {
+        std::uint32_t size = static_cast<std::uint32_t>(data.size());
+        seri.absorb(size);
+
+        if (seri.get_seri_mode() == common::SERI_MODE_READ) {
+            data.resize(size);
+        }
+
+        seri.absorb_impl(data.data(), size);
+    }
+
+    parsed_file_index::parsed_file_index(io_system *io, const std::u16string &index_path, const std::uint64_t tag)
+        : io_(io)
+        , index_path_(index_path)
+        , tag_(tag)
+        , dirty_(false)
+        , hit_count_(0)
+        , miss_count_(0) {
+    }
+
+    bool parsed_file_index::load() {
+        records_.clear();
+
+        // Either way, what is on disk will be rewritten
+        dirty_ = true;
+
+        symfile index_file = io_->open_file(index_path_, READ_MODE | BIN_MODE);
+
+        if (!index_file) {
+            return false;
+        }
+
+        std::vector<std::uint8_t> buf(index_file->size());
+        const std::size_t read_size = index_file->read_file(buf.data(), 1, static_cast<std::uint32_t>(buf.size()));
+        index_file->close();
+
+        if ((read_size != buf.size()) || (buf.size() < sizeof(std::uint64_t))) {
+            return false;
+        }
+
+        // A torn write must not make the server trust garbage lengths
+        std::uint64_t checksum = 0;
+        std::memcpy(&checksum, buf.data(), sizeof(std::uint64_t));
+
+        std::uint8_t *body = buf.data() + sizeof(std::uint64_t);
+        const std::size_t body_size = buf.size() - sizeof(std::uint64_t);
+
+        if (XXH64(body, body_size, 0) != checksum) {
+            LOG_WARN(SERVICE_TRACK, "Parsed file index {} is corrupted, rebuilding", common::ucs2_to_utf8(index_path_));
+            return false;
+        }
+
+        common::chunkyseri seri(body, body_size, common::SERI_MODE_READ);
+
+        if (!seri.section("ParsedFileIndex", PARSED_FILE_INDEX_VERSION)) {
+            return false;
+        }
+
+        std::uint64_t tag = 0;
+        seri.absorb(tag);
+
+        if (tag != tag_) {
+            return false;
+        }
+
+        std::uint32_t count = 0;
+        seri.absorb(count);
+
+        for (std::uint32_t i = 0; i < count; i++) {
+            record rec;
+
+            seri.absorb_container(rec.sources_, absorb_stamp);
+            absorb_bytes(seri, rec.data_);
+
+            if (rec.sources_.empty()) {
+                records_.clear();
+                return false;
+            }
+
+            const std::u16string key = make_record_key(rec.sources_[0].path_);
+            records_.emplace(key, std::move(rec));
+        }
+
+        dirty_ = false;
+        return true;
+    }
+
+    bool parsed_file_index::save() {
+        for (auto ite = records_.begin(); ite != records_.end();) {
+            if (!ite->second.used_) {
+                ite = records_.erase(ite);
+                dirty_ = true;
+            } else {
+                ite++;
+            }
+        }
+
+        if (!dirty_) {
+            return true;
+        }
+
+        auto do_state = [this](common::chunkyseri &seri) {
+            seri.section("ParsedFileIndex", PARSED_FILE_INDEX_VERSION);
+            seri.absorb(tag_);
+
+            std::uint32_t count = static_cast<std::uint32_t>(records_.size());
+            seri.absorb(count);
+
+            for (auto &[key, rec] : records_) {
+                seri.absorb_container(rec.sources_, absorb_stamp);
+                absorb_bytes(seri, rec.data_);
+            }
+        };
+
+        std::vector<std::uint8_t> buf;
+
+        {
+            common::chunkyseri seri(nullptr, 0, common::SERI_MODE_MEASURE);
+            do_state(seri);
+
+            buf.resize(sizeof(std::uint64_t) + seri.size());
+        }
+
+        std::uint8_t *body = buf.data() + sizeof(std::uint64_t);
+        const std::size_t body_size = buf.size() - sizeof(std::uint64_t);
+
+        common::chunkyseri seri(body, body_size, common::SERI_MODE_WRITE);
+        do_state(seri);
+
+        const std::uint64_t checksum = XXH64(body, body_size, 0);
+        std::memcpy(buf.data(), &checksum, sizeof(std::uint64_t));
+
+        io_->create_directories(eka2l1::file_directory(index_path_, true));
+        symfile index_file = io_->open_file(index_path_, WRITE_MODE | BIN_MODE);
+
+        if (!index_file) {
+            LOG_WARN(SERVICE_TRACK, "Unable to write parsed file index {}", common::ucs2_to_utf8(index_path_));
+            return false;
+        }
+
+        index_file->write_file(buf.data(), 1, static_cast<std::uint32_t>(buf.size()));
+        index_file->close();
+
+        dirty_ = false;
+        return true;
+    }
+
+    std::optional<parsed_file_stamp> parsed_file_index::stamp(const std::u16string &path) {
+        std::optional<entry_info> info = io_->get_entry_info(path);
+
+        if (!info || (info->type != io_component_type::file)) {
+            return std::nullopt;
+        }
+
+        return parsed_file_stamp{ path, static_cast<std::uint64_t>(info->size), info->last_write };
+    }
+
+    bool parsed_file_index::sources_unchanged(const std::vector<parsed_file_stamp> &sources) {
+        for (std::size_t i = 1; i < sources.size(); i++) {
+            std::optional<parsed_file_stamp> current = stamp(sources[i].path_);
+
+            if (!current || !(current.value() == sources[i])) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    const std::vector<std::uint8_t> *parsed_file_index::find(const parsed_file_stamp &key) {
+        auto ite = records_.find(make_record_key(key.path_));
+
+        if ((ite == records_.end()) || !(ite->second.sources_[0] == key) || !sources_unchanged(ite->second.sources_)) {
+            miss_count_++;
+            return nullptr;
+        }
+
+        hit_count_++;
+        ite->second.used_ = true;
+
+        return &ite->second.data_;
+    }
+
+    void parsed_file_index::store(const std::vector<parsed_file_stamp> &sources, std::vector<std::uint8_t> data) {
+        if (sources.empty()) {
+            return;
+        }
+
+        record &rec = records_[make_record_key(sources[0].path_)];
+        rec.sources_ = sources;
+        rec.data_ = std::move(data);
+        rec.used_ = true;
+
+        dirty_ = true;
+    }
+}
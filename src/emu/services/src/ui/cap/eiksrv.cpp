@@ -56,12 +56,9 @@ namespace eka2l1::epoc::cap {
 
     eik_status_pane_maintainer::eik_status_pane_maintainer(kernel_system *kern)
         : prop_(nullptr) {
-        prop_ = kern->create<service::property>();
+        prop_ = kern->create<service::property>(AVKON_INTERNAL_UID, STATUS_PANE_SYSTEM_DATA_KEY);
         prop_->define(service::property_type::bin_data, sizeof(akn_status_pane_data));
 
-        prop_->first = AVKON_INTERNAL_UID;
-        prop_->second = STATUS_PANE_SYSTEM_DATA_KEY;
-
         // Update data for the first time
         publish_data();
     }
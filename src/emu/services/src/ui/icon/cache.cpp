@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <services/ui/icon/cache.h>
+
+#include <common/algorithm.h>
+
+namespace eka2l1::epoc {
+    akn_icon_cache::akn_icon_cache(release_func release, const std::size_t budget)
+        : release_(std::move(release))
+        , unused_size_(0)
+        , budget_(budget) {
+    }
+
+    akn_icon_cache_key akn_icon_cache::make_key(const akn_icon_params &spec) {
+        const std::u16string folded = common::lowercase_ucs2_string(std::u16string(spec.file_name.data,
+            spec.file_name.get_length()));
+
+        auto file_ite = file_ids_.emplace(folded, static_cast<std::uint32_t>(file_ids_.size())).first;
+        return { file_ite->second, spec.bitmap_id, spec.app_icon };
+    }
+
+    std::optional<akn_icon_srv_return_data> akn_icon_cache::acquire(const akn_icon_cache_key &key) {
+        auto ite = entries_.find(key);
+
+        if (ite == entries_.end()) {
+            return std::nullopt;
+        }
+
+        entry &ent = ite->second;
+
+        if (ent.use_count_++ == 0) {
+            // Back in use, eviction can't touch it anymore
+            lru_.erase(ent.lru_link_);
+            unused_size_ -= ent.memory_size_;
+        }
+
+        return ent.data_;
+    }
+
+    void akn_icon_cache::add(const akn_icon_cache_key &key, const akn_icon_srv_return_data &data, const std::size_t memory_size) {
+        entry &ent = entries_[key];
+
+        ent.data_ = data;
+        ent.memory_size_ = memory_size;
+        ent.use_count_ = 1;
+    }
+
+    bool akn_icon_cache::release(const akn_icon_cache_key &key, const bool keep_cached) {
+        auto ite = entries_.find(key);
+
+        if (ite == entries_.end()) {
+            return false;
+        }
+
+        entry &ent = ite->second;
+
+        if (--ent.use_count_ > 0) {
+            return true;
+        }
+
+        if (!keep_cached) {
+            release_(ent.data_);
+            entries_.erase(ite);
+
+            return true;
+        }
+
+        lru_.push_front(key);
+        ent.lru_link_ = lru_.begin();
+        unused_size_ += ent.memory_size_;
+
+        evict_to_budget();
+        return true;
+    }
+
+    void akn_icon_cache::evict_to_budget() {
+        while ((unused_size_ > budget_) && !lru_.empty()) {
+            auto ite = entries_.find(lru_.back());
+            lru_.pop_back();
+
+            unused_size_ -= ite->second.memory_size_;
+            release_(ite->second.data_);
+
+            entries_.erase(ite);
+        }
+    }
+
+    void akn_icon_cache::set_budget(const std::size_t budget) {
+        budget_ = budget;
+        evict_to_budget();
+    }
+}
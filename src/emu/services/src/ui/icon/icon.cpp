@@ -22,6 +22,7 @@
 #include <services/fbs/fbs.h>
 
 #include <common/cvt.h>
+#include <config/config.h>
 #include <system/epoc.h>
 #include <loader/mif.h>
 #include <utils/err.h>
@@ -60,7 +61,14 @@ namespace eka2l1 {
     }
 
     akn_icon_server::akn_icon_server(eka2l1::system *sys)
-        : service::typical_server(sys, "!AknIconServer") {
+        : service::typical_server(sys, "!AknIconServer")
+        , icons([this](const epoc::akn_icon_srv_return_data &ret) { delete_icon_bitmaps(ret); }) {
+        // Negative keeps the default budget
+        const int budget_kb = sys->get_config()->akn_icon_cache_budget_kb;
+
+        if (budget_kb >= 0) {
+            icons.set_budget(static_cast<std::size_t>(budget_kb) * 1024);
+        }
     }
 
     void akn_icon_server::connect(service::ipc_context &context) {
@@ -81,8 +89,9 @@ namespace eka2l1 {
             return;
         }
 
-        std::size_t icon_index = 0;
-        std::optional<epoc::akn_icon_srv_return_data> cached = find_existing_icon(spec.value(), &icon_index);
+        const epoc::akn_icon_cache_key key = icons.make_key(spec.value());
+        std::optional<epoc::akn_icon_srv_return_data> cached = icons.acquire(key);
+
         if (!cached) {
             eka2l1::vec2 size = spec->size;
 
@@ -109,10 +118,12 @@ namespace eka2l1 {
             ret->content_dim.y = size.y;
             ret->mask_handle = mask->id;
 
-            add_icon(ret.value(), spec.value());
+            const std::size_t memory_size = static_cast<std::size_t>(bmp->bitmap_->header_.bitmap_size)
+                + mask->bitmap_->header_.bitmap_size;
+
+            icons.add(key, ret.value(), memory_size);
         } else {
             ret.emplace(cached.value());
-            icons[icon_index].use_count++;
         }
 
         ctx->write_data_to_descriptor_argument(0, spec.value());
@@ -120,16 +131,9 @@ namespace eka2l1 {
         ctx->complete(epoc::error_none);
     }
 
-    bool akn_icon_server::cache_or_delete_icon(const std::size_t icon_idx) {
-        if (icon_idx >= icons.size()) {
-            return false;
-        }
-
-        icon_data_item &icon = icons[icon_idx];
-
-        // TODO: Cache
-        fbsbitmap *original = fbss->get<fbsbitmap>(icon.ret.bitmap_handle);
-        fbsbitmap *mask = fbss->get<fbsbitmap>(icon.ret.mask_handle);
+    void akn_icon_server::delete_icon_bitmaps(const epoc::akn_icon_srv_return_data &ret) {
+        fbsbitmap *original = fbss->get<fbsbitmap>(ret.bitmap_handle);
+        fbsbitmap *mask = fbss->get<fbsbitmap>(ret.mask_handle);
 
         if (original) {
             // Try to free original bitmap, ignore result.
@@ -142,73 +146,26 @@ namespace eka2l1 {
             mask->count--;
             fbss->free_bitmap(mask);
         }
-
-        // Delete the icon from the icon item list
-        icons.erase(icons.begin() + icon_idx);
-
-        return true;
     }
 
     void akn_icon_server::free_bitmap(service::ipc_context *ctx) {
         std::optional<epoc::akn_icon_params> params = ctx->get_argument_data_from_descriptor<epoc::akn_icon_params>(0);
 
-        std::size_t icon_index = 0;
-        if (!find_existing_icon(params.value(), &icon_index)) {
-            // We can't find the icon. The params is fraud!!
-            ctx->complete(epoc::error_not_found);
+        if (!params) {
+            ctx->complete(epoc::error_argument);
             return;
         }
 
-        // We have found the icon
-        // Decrease the reference count
-        icons[icon_index].use_count--;
+        // When no one uses the icon anymore, it stays cached unless the client asked otherwise
+        const bool keep_cached = !(params->flags & (1 << epoc::akn_icon_params::flag_exclude_from_cache));
 
-        // If the reference count is 0, it means no one is using this bitmap anymore, for now. We have two options:
-        // Cache the bitmap, or delete it from the server
-        if (icons[icon_index].use_count == 0) {
-            if (!cache_or_delete_icon(icon_index)) {
-                ctx->complete(epoc::error_general);
-                return;
-            }
+        if (!icons.release(icons.make_key(params.value()), keep_cached)) {
+            // We can't find the icon. The params is fraud!!
+            ctx->complete(epoc::error_not_found);
+            return;
         }
 
         // Success, return error none.
         ctx->complete(epoc::error_none);
     }
-
-    std::optional<epoc::akn_icon_srv_return_data> akn_icon_server::find_existing_icon(epoc::akn_icon_params &spec, std::size_t *idx) {
-        for (std::size_t i = 0; i < icons.size(); i++) {
-            epoc::akn_icon_params cached_spec = icons[i].spec;
-
-            /**
-             * The original implementation only check for the equal of:
-             * - The bitmap ID.
-             * - The bitmap container file (compare folded aka ignoring case)
-             * - App icon?
-             *
-             * These three are the decesive elements that decide if two requests are trying to get the same bitmap.
-             */
-            if (spec.bitmap_id == cached_spec.bitmap_id) {
-                if (common::compare_ignore_case(spec.file_name.to_std_string(nullptr), cached_spec.file_name.to_std_string(nullptr)) == 0) {
-                    if (spec.app_icon == cached_spec.app_icon) {
-                        if (idx) {
-                            *idx = i;
-                        }
-
-                        return icons[i].ret;
-                    }
-                }
-            }
-        }
-        return std::nullopt;
-    }
-
-    void akn_icon_server::add_icon(const epoc::akn_icon_srv_return_data &ret, const epoc::akn_icon_params &spec) {
-        icon_data_item item;
-        item.ret = ret;
-        item.spec = spec;
-        item.use_count = 1;
-
-        icons.push_back(item);
-    }
 }
@@ -1,3 +1,4 @@
+#include <common/chunkyseri.h>
 #include <common/path.h>
 #include <common/time.h>
 #include <common/vecx.h>
@@ -5,6 +6,9 @@
 #include <services/ui/skin/chunk_maintainer.h>
 #include <services/ui/skin/skn.h>
 
+#define XXH_INLINE_ALL
+#include <xxhash.h>
+
 namespace eka2l1::epoc {
     constexpr std::int64_t AKNS_CHUNK_ITEM_DEF_HASH_BASE_SIZE_GRAN = -4;
     constexpr std::int64_t AKNS_CHUNK_ITEM_DEF_AREA_BASE_SIZE_GRAN = 11;
@@ -100,6 +104,19 @@ namespace eka2l1::epoc {
         return { static_cast<std::int32_t>(hash), static_cast<std::int32_t>(hash >> 32) };
     }
 
+    static std::uint64_t make_id_hash_from_pid(const pid &id) {
+        return static_cast<std::uint32_t>(id.first) | (static_cast<std::uint64_t>(static_cast<std::uint32_t>(id.second)) << 32);
+    }
+
+    std::size_t akn_skin_chunk_maintainer::scalable_gfx_key_hash::operator()(const scalable_gfx_key &key) const {
+        std::uint64_t hash = make_id_hash_from_pid(key.item_id_) * 0x9E3779B97F4A7C15ULL;
+        hash ^= static_cast<std::uint32_t>(key.layout_type_) + (hash << 6) + (hash >> 2);
+        hash ^= (static_cast<std::uint64_t>(static_cast<std::uint32_t>(key.layout_size_.x)) << 32 | static_cast<std::uint32_t>(key.layout_size_.y))
+            + (hash << 6) + (hash >> 2);
+
+        return static_cast<std::size_t>(hash);
+    }
+
     akn_skin_chunk_maintainer::akn_skin_chunk_maintainer(kernel::chunk *shared_chunk, const std::size_t granularity,
         const std::uint32_t flags)
         : shared_chunk_(shared_chunk)
@@ -231,44 +248,48 @@ namespace eka2l1::epoc {
         return (id.first + id.second) % MAX_HASH_AVAIL;
     }
 
-    std::int32_t akn_skin_chunk_maintainer::get_item_definition_index(const epoc::pid &id) {
+    const std::uint32_t akn_skin_chunk_maintainer::definition_size() const {
         if (flags_ & akn_skin_chunk_maintainer_lookup_use_linked_list) {
-            std::int32_t *hash = reinterpret_cast<std::int32_t *>(get_area_base(epoc::akn_skin_chunk_area_base_offset::item_def_hash_base));
+            return sizeof(akns_item_def_v2);
+        }
 
-            epoc::akns_item_def *defs = reinterpret_cast<decltype(defs)>(get_area_base(epoc::akn_skin_chunk_area_base_offset::item_def_area_base));
-            std::uint32_t hash_index = calculate_item_hash(id);
+        return sizeof(akns_item_def_v1);
+    }
 
-            std::int32_t head = hash[hash_index];
+    akns_item_def *akn_skin_chunk_maintainer::item_definition_at(const std::int32_t index) {
+        std::uint8_t *defs = reinterpret_cast<std::uint8_t *>(get_area_base(
+            akn_skin_chunk_area_base_offset::item_def_area_base));
 
-            if (head < 0) {
-                return -1;
-            }
+        if (!defs) {
+            return nullptr;
+        }
 
-            while (head >= 0 && defs[head].id_ != id) {
-                head = defs[head].next_hash_;
-            }
+        return reinterpret_cast<akns_item_def *>(defs + index * definition_size());
+    }
 
-            return head;
+    std::int32_t akn_skin_chunk_maintainer::get_item_definition_index(const epoc::pid &id) {
+        // The definition area is only ever written by us, so the host index always mirrors it.
+        // The guest-visible hash table (on newer versions) is still kept up to date for clients.
+        auto result = item_def_index_.find(make_id_hash_from_pid(id));
+
+        if (result == item_def_index_.end()) {
+            return -1;
         }
 
-        // Lookup with the old method uses in old Symbian version: iterate through the definition
-        // data area and look for identical ID
-        epoc::akns_item_def_v1 *items = reinterpret_cast<epoc::akns_item_def_v1 *>(
-            get_area_base(epoc::akn_skin_chunk_area_base_offset::item_def_area_base));
+        return result->second;
+    }
 
-        const std::size_t total_items = get_area_current_size(epoc::akn_skin_chunk_area_base_offset::item_def_area_base)
-            / sizeof(epoc::akns_item_def_v1);
+    void akn_skin_chunk_maintainer::rebuild_item_definition_index() {
+        item_def_index_.clear();
 
-        epoc::akns_item_def_v1 *target_item = std::find_if(items, items + total_items, [=](const akns_item_def_v1 &this_item) {
-            return this_item.id_ == id;
-        });
+        const std::size_t total_items = get_area_current_size(epoc::akn_skin_chunk_area_base_offset::item_def_area_base)
+            / definition_size();
 
-        if (target_item == items + total_items) {
-            // The end. We can't find it.
-            return -1;
+        for (std::size_t i = 0; i < total_items; i++) {
+            // Like the lookup on the guest side, the first definition with the ID wins
+            item_def_index_.emplace(make_id_hash_from_pid(item_definition_at(static_cast<std::int32_t>(i))->id_),
+                static_cast<std::int32_t>(i));
         }
-
-        return static_cast<std::int32_t>(std::distance(items, target_item));
     }
 
     std::int32_t akn_skin_chunk_maintainer::update_data(const std::uint8_t *new_data, std::uint8_t *old_data, const std::size_t new_size, const std::size_t old_size) {
@@ -320,11 +341,7 @@ namespace eka2l1::epoc {
         void *old_data = nullptr;
         akns_item_def *current_def = nullptr;
 
-        std::uint32_t definition_size = sizeof(akns_item_def_v1);
-
-        if (flags_ & akn_skin_chunk_maintainer_lookup_use_linked_list) {
-            definition_size = sizeof(akns_item_def_v2);
-        }
+        const std::uint32_t entry_size = definition_size();
 
         if (index < 0) {
             const std::size_t def_size = get_area_current_size(epoc::akn_skin_chunk_area_base_offset::item_def_area_base);
@@ -335,22 +352,22 @@ namespace eka2l1::epoc {
                 + def_size;
 
             set_area_current_size(epoc::akn_skin_chunk_area_base_offset::item_def_area_base,
-                static_cast<std::uint32_t>(def_size + definition_size));
+                static_cast<std::uint32_t>(def_size + entry_size));
 
-            std::memcpy(current_head, &def, definition_size);
+            std::memcpy(current_head, &def, entry_size);
+
+            index = static_cast<std::int32_t>(def_size / entry_size);
 
             // Update the hash
             if (flags_ & akn_skin_chunk_maintainer_lookup_use_linked_list) {
-                update_definition_hash(reinterpret_cast<akns_item_def *>(current_head),
-                    static_cast<std::int32_t>(def_size / sizeof(akns_item_def)));
+                update_definition_hash(reinterpret_cast<akns_item_def *>(current_head), index);
             }
 
+            item_def_index_.emplace(make_id_hash_from_pid(def.id_), index);
             current_def = reinterpret_cast<akns_item_def *>(current_head);
         } else {
             // The definition already exists. Recopy it
-            current_def = reinterpret_cast<akns_item_def *>(get_area_base(
-                              epoc::akn_skin_chunk_area_base_offset::item_def_area_base))
-                + index;
+            current_def = item_definition_at(index);
 
             if (current_def->type_ == def.type_ && current_def->data_.type_ == epoc::akns_mtptr_type::akns_mtptr_type_relative_ram) {
                 std::uint32_t *data_size = current_def->data_.get_relative<std::uint32_t>(
@@ -367,9 +384,9 @@ namespace eka2l1::epoc {
 
             std::int32_t head = 0;
             if (flags_ & akn_skin_chunk_maintainer_lookup_use_linked_list) {
-                std::int32_t head = current_def->next_hash_;
+                head = current_def->next_hash_;
             }
-            std::memcpy(current_def, &def, definition_size);
+            std::memcpy(current_def, &def, entry_size);
 
             if (flags_ & akn_skin_chunk_maintainer_lookup_use_linked_list) {
                 current_def->next_hash_ = head;
@@ -543,14 +560,7 @@ namespace eka2l1::epoc {
             return nullptr;
         }
 
-        akns_item_def *defs = reinterpret_cast<akns_item_def *>(get_area_base(
-            akn_skin_chunk_area_base_offset::item_def_area_base));
-
-        if (!defs) {
-            return nullptr;
-        }
-
-        return defs + index;
+        return item_definition_at(index);
     }
 
     bool akn_skin_chunk_maintainer::import_color_table(const skn_color_table &table) {
@@ -881,41 +891,183 @@ namespace eka2l1::epoc {
         const std::size_t gfx_current_size = get_area_current_size(epoc::akn_skin_chunk_area_base_offset::gfx_area_base);
         const std::size_t def_count = gfx_current_size / sizeof(def);
 
-        // update if exist
-        for (std::size_t i = 0; i < def_count; i++) {
-            if (table[i].item_id == item_id
-                && table[i].layout_type == layout_info.layout_type
-                && table[i].layout_size == layout_info.layout_size) {
-                bitmap_store_->remove_stored_bitmap(table[i].bitmap_handle);
-                bitmap_store_->remove_stored_bitmap(table[i].mask_handle);
-                std::uint8_t *dest = reinterpret_cast<std::uint8_t *>(table + i);
-                std::copy(new_data, new_data + sizeof(def), dest);
-                return true;
-            }
-        }
+        const scalable_gfx_key key{ item_id, layout_info.layout_type, layout_info.layout_size };
+        auto existing = scalable_gfx_index_.find(key);
 
-        if (def_count >= gfx_area_size / sizeof(def)) {
-            // replace the oldest one if the chunk is full
-            std::uint64_t oldest_timestamp = table[0].item_timestamp;
-            std::size_t oldest_index = 0;
-            for (std::size_t i = 0; i < def_count; i++) {
-                if (table[i].item_timestamp < oldest_timestamp) {
-                    oldest_timestamp = table[i].item_timestamp;
-                    oldest_index = i;
-                }
+        std::size_t slot = 0;
+
+        if (existing != scalable_gfx_index_.end()) {
+            // update if exist
+            slot = existing->second->second;
+            bitmap_store_->remove_stored_bitmap(table[slot].bitmap_handle);
+            bitmap_store_->remove_stored_bitmap(table[slot].mask_handle);
+
+            scalable_gfx_lru_.splice(scalable_gfx_lru_.begin(), scalable_gfx_lru_, existing->second);
+        } else if (def_count >= gfx_area_size / sizeof(def)) {
+            if (scalable_gfx_lru_.empty()) {
+                // The area can't even hold one item
+                return false;
             }
-            bitmap_store_->remove_stored_bitmap(table[oldest_index].bitmap_handle);
-            bitmap_store_->remove_stored_bitmap(table[oldest_index].mask_handle);
-            std::uint8_t *dest = reinterpret_cast<std::uint8_t *>(table + oldest_index);
-            std::copy(new_data, new_data + sizeof(def), dest);
+
+            // replace the least recently stored one if the chunk is full
+            auto oldest = std::prev(scalable_gfx_lru_.end());
+            slot = oldest->second;
+
+            bitmap_store_->remove_stored_bitmap(table[slot].bitmap_handle);
+            bitmap_store_->remove_stored_bitmap(table[slot].mask_handle);
+
+            scalable_gfx_index_.erase(oldest->first);
+            oldest->first = key;
+
+            scalable_gfx_lru_.splice(scalable_gfx_lru_.begin(), scalable_gfx_lru_, oldest);
+            scalable_gfx_index_.emplace(key, scalable_gfx_lru_.begin());
         } else {
             // add a new one
-            std::uint8_t *dest = reinterpret_cast<std::uint8_t *>(table + def_count);
+            slot = def_count;
             set_area_current_size(
                 epoc::akn_skin_chunk_area_base_offset::gfx_area_base,
                 static_cast<std::uint32_t>(gfx_current_size + sizeof(def)));
-            std::copy(new_data, new_data + sizeof(def), dest);
+
+            scalable_gfx_lru_.emplace_front(key, slot);
+            scalable_gfx_index_.emplace(key, scalable_gfx_lru_.begin());
         }
+
+        std::uint8_t *dest = reinterpret_cast<std::uint8_t *>(table + slot);
+        std::copy(new_data, new_data + sizeof(def), dest);
+
+        return true;
+    }
+
+    void akn_skin_chunk_maintainer::clear_areas() {
+        for (const auto &area : areas_) {
+            set_area_current_size(area.base_, 0);
+        }
+
+        // Fill hash area with negative again
+        std::uint8_t *hash_area = reinterpret_cast<std::uint8_t *>(get_area_base(akn_skin_chunk_area_base_offset::item_def_hash_base));
+        std::fill(hash_area, hash_area + get_area_size(akn_skin_chunk_area_base_offset::item_def_hash_base), 0xFF);
+
+        akns_srv_scalable_item_def *table = reinterpret_cast<akns_srv_scalable_item_def *>(
+            get_area_base(epoc::akn_skin_chunk_area_base_offset::gfx_area_base));
+
+        for (const auto &item : scalable_gfx_lru_) {
+            bitmap_store_->remove_stored_bitmap(table[item.second].bitmap_handle);
+            bitmap_store_->remove_stored_bitmap(table[item.second].mask_handle);
+        }
+
+        item_def_index_.clear();
+        scalable_gfx_index_.clear();
+        scalable_gfx_lru_.clear();
+    }
+
+    static constexpr std::uint32_t AKNS_IMPORT_CACHE_MAGIC = 0x43534B41; // AKSC
+    static constexpr std::uint32_t AKNS_IMPORT_CACHE_VERSION = 1;
+
+    std::uint64_t akn_skin_chunk_maintainer::import_cache_key(const std::uint8_t *skn_data, const std::size_t skn_size,
+        const std::u16string &filename_base) const {
+        XXH64_state_t *const state = XXH64_createState();
+        XXH64_reset(state, AKNS_IMPORT_CACHE_VERSION);
+
+        XXH64_update(state, skn_data, skn_size);
+        XXH64_update(state, filename_base.data(), filename_base.length() * sizeof(char16_t));
+
+        // Chunk configuration decides the layout of everything stored
+        const std::uint64_t chunk_size = shared_chunk_->max_size();
+
+        XXH64_update(state, &flags_, sizeof(flags_));
+        XXH64_update(state, &level_, sizeof(level_));
+        XXH64_update(state, &granularity_, sizeof(granularity_));
+        XXH64_update(state, &chunk_size, sizeof(chunk_size));
+
+        const std::uint64_t hash = XXH64_digest(state);
+        XXH64_freeState(state);
+
+        return hash;
+    }
+
+    bool akn_skin_chunk_maintainer::do_import_cache_state(common::chunkyseri &seri, const std::uint64_t key) {
+        const bool is_reading = (seri.get_seri_mode() == common::SERI_MODE_READ);
+
+        // Serializer skips reads past the end, so start from values that never pass the check
+        std::uint32_t magic = is_reading ? 0 : AKNS_IMPORT_CACHE_MAGIC;
+        std::uint32_t version = is_reading ? 0 : AKNS_IMPORT_CACHE_VERSION;
+        std::uint64_t cache_key = is_reading ? ~key : key;
+
+        seri.absorb(magic);
+        seri.absorb(version);
+        seri.absorb(cache_key);
+
+        if ((magic != AKNS_IMPORT_CACHE_MAGIC) || (version != AKNS_IMPORT_CACHE_VERSION) || (cache_key != key)) {
+            return false;
+        }
+
+        std::uint32_t *header = reinterpret_cast<std::uint32_t *>(shared_chunk_->host_base());
+        std::uint32_t area_count = static_cast<std::uint32_t>(areas_.size());
+
+        seri.absorb(area_count);
+
+        if (area_count != areas_.size()) {
+            return false;
+        }
+
+        for (const auto &area : areas_) {
+            // Scalable graphics refer to runtime bitmaps, they are never cached
+            if (area.base_ == akn_skin_chunk_area_base_offset::gfx_area_base) {
+                continue;
+            }
+
+            std::uint32_t area_type = static_cast<std::uint32_t>(area.base_);
+            std::uint32_t area_offset = header[area_type];
+            std::uint32_t area_size = header[area_type + 1];
+            std::uint32_t area_current_size = header[area_type + 2];
+
+            const std::size_t header_size_before = seri.size();
+
+            seri.absorb(area_type);
+            seri.absorb(area_offset);
+            seri.absorb(area_size);
+            seri.absorb(area_current_size);
+
+            // The layout must be exactly the same, and the content must fit. A truncated header keeps
+            // the current values, so it could match the layout by accident: check it was read whole.
+            if ((seri.size() != header_size_before + 4 * sizeof(std::uint32_t))
+                || (area_type != static_cast<std::uint32_t>(area.base_)) || (area_offset != header[area_type])
+                || (area_size != header[area_type + 1]) || (area_current_size > area_size)) {
+                if (is_reading) {
+                    clear_areas();
+                }
+
+                return false;
+            }
+
+            // The hash table has no current size, it's always used whole
+            const std::uint32_t content_size = (area.base_ == akn_skin_chunk_area_base_offset::item_def_hash_base)
+                ? area_size
+                : area_current_size;
+
+            std::uint8_t *content = reinterpret_cast<std::uint8_t *>(shared_chunk_->host_base()) + area_offset;
+
+            const std::size_t size_before = seri.size();
+            seri.absorb_impl(content, content_size);
+
+            if (seri.size() != size_before + content_size) {
+                // Truncated cache
+                if (is_reading) {
+                    clear_areas();
+                }
+
+                return false;
+            }
+
+            if (is_reading) {
+                set_area_current_size(area.base_, area_current_size);
+            }
+        }
+
+        if (is_reading) {
+            rebuild_item_definition_index();
+        }
+
         return true;
     }
 }
\ No newline at end of file
@@ -25,8 +25,12 @@
 #include <services/fbs/fbs.h>
 #include <vfs/vfs.h>
 
+#include <common/buffer.h>
+#include <common/chunkyseri.h>
 #include <common/cvt.h>
 #include <common/log.h>
+#include <common/path.h>
+#include <common/time.h>
 #include <utils/err.h>
 
 #include <system/epoc.h>
@@ -183,11 +187,75 @@ namespace eka2l1 {
         }
 
         symfile skin_file_obj = io->open_file(skin_path.value(), READ_MODE | BIN_MODE);
-        eka2l1::ro_file_stream skin_file_stream(skin_file_obj.get());
 
+        if (!skin_file_obj) {
+            LOG_ERROR(SERVICE_UI, "Unable to open active skin file {}", common::ucs2_to_utf8(skin_path.value()));
+            return;
+        }
+
+        std::vector<std::uint8_t> skin_data(skin_file_obj->size());
+        skin_file_obj->read_file(skin_data.data(), 1, static_cast<std::uint32_t>(skin_data.size()));
+        skin_file_obj->close();
+
+        const std::u16string filename_base = resource_path.value_or(u"");
+        const std::uint64_t cache_key = chunk_maintainer_->import_cache_key(skin_data.data(), skin_data.size(), filename_base);
+        const std::u16string cache_path = epoc::get_import_cache_path_of_skin(skin_pid);
+
+        const std::uint64_t begin_time = common::get_current_time_in_microseconds_since_epoch();
+
+        // Map the cached layout directly if this exact skin was imported before
+        if (symfile cache_file = io->open_file(cache_path, READ_MODE | BIN_MODE)) {
+            std::vector<std::uint8_t> cache_data(cache_file->size());
+            cache_file->read_file(cache_data.data(), 1, static_cast<std::uint32_t>(cache_data.size()));
+            cache_file->close();
+
+            common::chunkyseri seri(cache_data.data(), cache_data.size(), common::SERI_MODE_READ);
+
+            if (chunk_maintainer_->do_import_cache_state(seri, cache_key)) {
+                LOG_INFO(SERVICE_UI, "Active skin loaded from import cache in {} us",
+                    common::get_current_time_in_microseconds_since_epoch() - begin_time);
+
+                return;
+            }
+        }
+
+        common::ro_buf_stream skin_file_stream(skin_data.data(), skin_data.size());
         epoc::skn_file skin_parser(reinterpret_cast<common::ro_stream *>(&skin_file_stream));
 
-        chunk_maintainer_->import(skin_parser, resource_path.value_or(u""));
+        if (!chunk_maintainer_->import(skin_parser, filename_base)) {
+            LOG_ERROR(SERVICE_UI, "Failed to import active skin to the skin chunk");
+            return;
+        }
+
+        LOG_INFO(SERVICE_UI, "Active skin parsed and imported in {} us",
+            common::get_current_time_in_microseconds_since_epoch() - begin_time);
+
+        // Write the cache for next boot
+        std::vector<std::uint8_t> cache_data;
+
+        {
+            common::chunkyseri seri(nullptr, 0, common::SERI_MODE_MEASURE);
+            chunk_maintainer_->do_import_cache_state(seri, cache_key);
+
+            cache_data.resize(seri.size());
+        }
+
+        common::chunkyseri seri(cache_data.data(), cache_data.size(), common::SERI_MODE_WRITE);
+
+        if (!chunk_maintainer_->do_import_cache_state(seri, cache_key)) {
+            return;
+        }
+
+        io->create_directories(eka2l1::file_directory(cache_path, true));
+        symfile cache_file = io->open_file(cache_path, WRITE_MODE | BIN_MODE);
+
+        if (!cache_file) {
+            LOG_WARN(SERVICE_UI, "Unable to write skin import cache to {}", common::ucs2_to_utf8(cache_path));
+            return;
+        }
+
+        cache_file->write_file(cache_data.data(), 1, static_cast<std::uint32_t>(cache_data.size()));
+        cache_file->close();
     }
 
     void akn_skin_server::do_initialisation() {
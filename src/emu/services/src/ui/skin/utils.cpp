@@ -92,4 +92,8 @@ namespace eka2l1::epoc {
 
         return std::nullopt;
     }
-}
\ No newline at end of file
+
+    std::u16string get_import_cache_path_of_skin(const epoc::pid skin_pid) {
+        return u"C:\\private\\10207114\\cache\\" + pid_to_string(skin_pid) + u".skc";
+    }
+}
@@ -36,6 +36,7 @@
 
 #include <common/buffer.h>
 #include <common/log.h>
+#include <common/pixelconv.h>
 #include <common/runlen.h>
 #include <common/time.h>
 
@@ -72,63 +73,16 @@ namespace eka2l1::epoc {
         return (dsp == epoc::display_mode::color16) || (dsp == epoc::display_mode::color256);
     }
 
-    static char *converted_one_bpp_to_twenty_four_bpp_bitmap(epoc::bitwise_bitmap *bw_bmp,
-        const std::uint32_t *original_ptr, std::vector<char> &converted_pool) {
-        std::uint32_t byte_width_converted = common::align(bw_bmp->header_.size_pixels.x * 3, 4);
+    static char *converted_to_twenty_four_bpp_bitmap(epoc::bitwise_bitmap *bw_bmp, const char *original_ptr,
+        const common::pixel_format format, const std::uint32_t *palette, std::vector<char> &converted_pool) {
+        const std::uint32_t byte_width_converted = common::align(bw_bmp->header_.size_pixels.x * 3, 4);
         converted_pool.resize(byte_width_converted * bw_bmp->header_.size_pixels.y);
 
-        char *return_ptr = &converted_pool[0];
+        common::convert_pixels(reinterpret_cast<std::uint8_t *>(converted_pool.data()), byte_width_converted, common::pixel_format_bgr24,
+            reinterpret_cast<const std::uint8_t *>(original_ptr), bw_bmp->byte_width_, format, bw_bmp->header_.size_pixels.x,
+            bw_bmp->header_.size_pixels.y, palette);
 
-        for (std::size_t y = 0; y < bw_bmp->header_.size_pixels.y; y++) {
-            for (std::size_t x = 0; x < bw_bmp->header_.size_pixels.x; x++) {
-                std::uint32_t word_per_line = (bw_bmp->header_.size_pixels.x + 31) / 32;
-                std::uint32_t color = original_ptr[y * word_per_line + x / 32];
-                std::uint32_t converted_color =  0;
-                if (color & (1 << (x & 0x1F))) {
-                    converted_color = 0xFFFFFF;
-                }
-
-                std::memcpy(return_ptr + byte_width_converted * y + x * 3, reinterpret_cast<const char *>(&converted_color), 3);
-            }
-        }
-        return return_ptr;
-    }
-
-    static char *converted_palette_bitmap_to_twenty_four_bitmap(epoc::bitwise_bitmap *bw_bmp,
-        const std::uint8_t *original_ptr, std::vector<char> &converted_pool, epoc::palette_256 &the_palette) {
-        std::uint32_t byte_width_converted = common::align(bw_bmp->header_.size_pixels.x * 3, 4);
-        converted_pool.resize(byte_width_converted * bw_bmp->header_.size_pixels.y);
-
-        char *return_ptr = &converted_pool[0];
-
-        epoc::display_mode dsp = bw_bmp->settings_.current_display_mode();
-        if (dsp == epoc::display_mode::none) {
-            dsp = bw_bmp->settings_.initial_display_mode();
-        }
-
-        for (std::size_t y = 0; y < bw_bmp->header_.size_pixels.y; y++) {
-            for (std::size_t x = 0; x < bw_bmp->header_.size_pixels.x; x++) {
-                switch (dsp) {
-                case epoc::display_mode::color256: {
-                    const std::uint8_t palette_index = original_ptr[y * bw_bmp->byte_width_ + x];
-                    const std::uint32_t palette_color = the_palette[palette_index];
-                    const std::size_t location = byte_width_converted * y + x * 3;
-
-                    return_ptr[location + 2] = palette_color & 0xFF;
-                    return_ptr[location + 1] = (palette_color >> 8) & 0xFF;
-                    return_ptr[location] = (palette_color >> 16) & 0xFF;
-
-                    break;
-                }
-
-                default:
-                    LOG_ERROR(SERVICE_WINDOW, "Unhandled display mode to convert {}", static_cast<int>(dsp));
-                    break;
-                }
-            }
-        }
-
-        return return_ptr;
+        return converted_pool.data();
     }
 
     static std::uint32_t get_suitable_bpp_for_bitmap(epoc::bitwise_bitmap *bmp) {
@@ -289,8 +243,20 @@ namespace eka2l1::epoc {
 
             // GPU don't support them. Convert them on CPU
             if (is_palette_bitmap(bmp)) {
-                data_pointer = converted_palette_bitmap_to_twenty_four_bitmap(bmp, reinterpret_cast<const std::uint8_t *>(data_pointer),
-                    converted, epoc::get_suitable_palette_256(kern->get_epoc_version()));
+                epoc::display_mode dsp = bmp->settings_.current_display_mode();
+                if (dsp == epoc::display_mode::none) {
+                    dsp = bmp->settings_.initial_display_mode();
+                }
+
+                if (dsp == epoc::display_mode::color256) {
+                    data_pointer = converted_to_twenty_four_bpp_bitmap(bmp, data_pointer, common::pixel_format_palette8,
+                        epoc::get_suitable_palette_256(kern->get_epoc_version()).data(), converted);
+                } else {
+                    LOG_ERROR(SERVICE_WINDOW, "Unhandled display mode to convert {}", static_cast<int>(dsp));
+
+                    converted.assign(common::align(bmp->header_.size_pixels.x * 3, 4) * bmp->header_.size_pixels.y, 0);
+                    data_pointer = converted.data();
+                }
 
                 bpp = 24;
                 raw_size = static_cast<std::uint32_t>(converted.size());
@@ -301,13 +267,21 @@ namespace eka2l1::epoc {
 
             switch (bpp) {
             case 1:
-                data_pointer = converted_one_bpp_to_twenty_four_bpp_bitmap(bmp, reinterpret_cast<const std::uint32_t *>(data_pointer),
-                    converted);
+            case 2:
+            case 4: {
+                // Grey levels, expanded to the same level on all channels
+                std::uint32_t grey_palette[16];
+                common::make_grey_palette(bpp, grey_palette);
+
+                data_pointer = converted_to_twenty_four_bpp_bitmap(bmp, data_pointer,
+                    static_cast<common::pixel_format>(common::pixel_format_palette1 + (bpp >> 1)), grey_palette, converted);
+
                 bpp = 24;
                 raw_size = static_cast<std::uint32_t>(converted.size());
                 pixels_per_line = 0;
 
                 break;
+            }
 
             default:
                 break;
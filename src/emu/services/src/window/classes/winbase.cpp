@@ -39,6 +39,8 @@ namespace eka2l1::epoc {
         if (parent) {
             sibling = parent->child;
             parent->child = this;
+
+            scr->hit_index_.invalidate();
         }
     }
 
@@ -135,6 +137,8 @@ namespace eka2l1::epoc {
         sibling = *prev;
         parent = new_parent;
         *prev = this;
+
+        scr->hit_index_.invalidate();
     }
 
     bool window::check_order_change(const int new_pos) {
@@ -176,6 +180,7 @@ namespace eka2l1::epoc {
         }
 
         window *ite = parent->child;
+        scr->hit_index_.invalidate();
 
         if (parent->child == this) {
             // Make the next sibling oldest
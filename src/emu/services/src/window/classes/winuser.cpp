@@ -98,6 +98,9 @@ namespace eka2l1::epoc {
     }
 
     window_user::~window_user() {
+        // Windows also die with their client, not only through free. Don't leave them in the index.
+        scr->hit_index_.remove_window(this);
+
         wipeout();
         client->remove_redraws(this);
     }
@@ -152,6 +155,8 @@ namespace eka2l1::epoc {
             // We need to invalidate the whole new window
             invalidate(bounding_rect());
         }
+
+        scr->hit_index_.update_window(this);
     }
 
     static bool should_purge_window_user(void *win, epoc::event &evt) {
@@ -182,6 +187,8 @@ namespace eka2l1::epoc {
             client->walk_event(should_purge_window_user, this);
         }
 
+        scr->hit_index_.update_window(this);
+
         if (should_trigger_redraw) {
             // Redraw the screen. NOW!
             client->get_ws().get_anim_scheduler()->schedule(client->get_ws().get_graphics_driver(),
@@ -396,7 +403,6 @@ namespace eka2l1::epoc {
 
         set_visible(false);
         remove_from_sibling_list();
-
         wipeout();
 
         context.complete(epoc::error_none);
@@ -444,6 +450,7 @@ namespace eka2l1::epoc {
 
     void window_user::activate(service::ipc_context &context, ws_cmd &cmd) {
         flags |= flags_active;
+        scr->hit_index_.update_window(this);
 
         invalidate(bounding_rect());
         context.complete(epoc::error_none);
@@ -512,6 +519,8 @@ namespace eka2l1::epoc {
         case EWsWinOpSetPos: {
             eka2l1::vec2 *pos_to_set = reinterpret_cast<eka2l1::vec2 *>(cmd.data_ptr);
             pos = *pos_to_set;
+            scr->hit_index_.update_window(this);
+
             ctx.complete(epoc::error_none);
             break;
         }
@@ -580,6 +589,14 @@ namespace eka2l1::epoc {
             break;
         }
 
+        case EWsWinOpSetPointerCapture: {
+            const std::uint32_t capture_flags = *reinterpret_cast<std::uint32_t *>(cmd.data_ptr);
+            scr->hit_index_.set_capture(this, capture_flags);
+
+            ctx.complete(epoc::error_none);
+            break;
+        }
+
         case EWsWinOpSetPointerGrab: {
             flags &= ~flags_allow_pointer_grab;
 
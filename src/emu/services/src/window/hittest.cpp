@@ -0,0 +1,300 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <services/window/classes/winbase.h>
+#include <services/window/classes/wingroup.h>
+#include <services/window/classes/winuser.h>
+#include <services/window/common.h>
+#include <services/window/hittest.h>
+#include <services/window/screen.h>
+
+#include <common/algorithm.h>
+
+#include <algorithm>
+
+namespace eka2l1::epoc {
+    // Extents are clipped to this, so a huge window does not span millions of cells
+    static constexpr int HIT_GRID_MAX_COORD = 1 << 13;
+
+    static std::uint64_t make_cell_key(const int cell_x, const int cell_y) {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(cell_y)) << 32) | static_cast<std::uint32_t>(cell_x);
+    }
+
+    static bool extent_contains(const eka2l1::rect &extent, const eka2l1::vec2 &pos) {
+        return (pos.x >= extent.top.x) && (pos.x < extent.top.x + extent.size.x) && (pos.y >= extent.top.y)
+            && (pos.y < extent.top.y + extent.size.y);
+    }
+
+    window_hit_grid::window_hit_grid(const int cell_shift)
+        : cell_shift_(cell_shift) {
+    }
+
+    void window_hit_grid::clear() {
+        cells_.clear();
+        entries_.clear();
+    }
+
+    bool window_hit_grid::get_cell_range(const eka2l1::rect &extent, eka2l1::vec2 &first, eka2l1::vec2 &last) const {
+        if ((extent.size.x <= 0) || (extent.size.y <= 0)) {
+            return false;
+        }
+
+        const int x1 = common::clamp(-HIT_GRID_MAX_COORD, HIT_GRID_MAX_COORD, extent.top.x);
+        const int y1 = common::clamp(-HIT_GRID_MAX_COORD, HIT_GRID_MAX_COORD, extent.top.y);
+        const int x2 = common::clamp(-HIT_GRID_MAX_COORD, HIT_GRID_MAX_COORD, extent.top.x + extent.size.x);
+        const int y2 = common::clamp(-HIT_GRID_MAX_COORD, HIT_GRID_MAX_COORD, extent.top.y + extent.size.y);
+
+        if ((x1 >= x2) || (y1 >= y2)) {
+            return false;
+        }
+
+        first = eka2l1::vec2(x1 >> cell_shift_, y1 >> cell_shift_);
+        last = eka2l1::vec2((x2 - 1) >> cell_shift_, (y2 - 1) >> cell_shift_);
+
+        return true;
+    }
+
+    void window_hit_grid::insert(epoc::window *win, const eka2l1::rect &extent, const std::uint32_t rank) {
+        remove(win);
+
+        const entry new_entry{ win, rank, extent };
+        entries_.emplace(win, new_entry);
+
+        eka2l1::vec2 first;
+        eka2l1::vec2 last;
+
+        if (!get_cell_range(extent, first, last)) {
+            return;
+        }
+
+        for (int y = first.y; y <= last.y; y++) {
+            for (int x = first.x; x <= last.x; x++) {
+                std::vector<entry> &cell = cells_[make_cell_key(x, y)];
+
+                // Usually windows come in rank order, so this is an append
+                auto pos = std::upper_bound(cell.begin(), cell.end(), rank, [](const std::uint32_t rank, const entry &ent) {
+                    return rank < ent.rank_;
+                });
+
+                cell.insert(pos, new_entry);
+            }
+        }
+    }
+
+    bool window_hit_grid::remove(epoc::window *win) {
+        auto ite = entries_.find(win);
+
+        if (ite == entries_.end()) {
+            return false;
+        }
+
+        eka2l1::vec2 first;
+        eka2l1::vec2 last;
+
+        if (get_cell_range(ite->second.extent_, first, last)) {
+            for (int y = first.y; y <= last.y; y++) {
+                for (int x = first.x; x <= last.x; x++) {
+                    auto cell_ite = cells_.find(make_cell_key(x, y));
+
+                    if (cell_ite == cells_.end()) {
+                        continue;
+                    }
+
+                    std::vector<entry> &cell = cell_ite->second;
+                    cell.erase(std::remove_if(cell.begin(), cell.end(), [win](const entry &ent) {
+                        return ent.win_ == win;
+                    }),
+                        cell.end());
+
+                    if (cell.empty()) {
+                        cells_.erase(cell_ite);
+                    }
+                }
+            }
+        }
+
+        entries_.erase(ite);
+        return true;
+    }
+
+    epoc::window *window_hit_grid::topmost_at(const eka2l1::vec2 &pos, window_hit_filter filter, void *userdata) const {
+        if ((pos.x < -HIT_GRID_MAX_COORD) || (pos.x >= HIT_GRID_MAX_COORD) || (pos.y < -HIT_GRID_MAX_COORD)
+            || (pos.y >= HIT_GRID_MAX_COORD)) {
+            return nullptr;
+        }
+
+        auto cell_ite = cells_.find(make_cell_key(pos.x >> cell_shift_, pos.y >> cell_shift_));
+
+        if (cell_ite == cells_.end()) {
+            return nullptr;
+        }
+
+        for (const entry &ent : cell_ite->second) {
+            if (!extent_contains(ent.extent_, pos)) {
+                continue;
+            }
+
+            if (!filter || filter(userdata, ent.win_)) {
+                return ent.win_;
+            }
+        }
+
+        return nullptr;
+    }
+
+    struct window_rank_walker : public window_tree_walker {
+        std::vector<epoc::window_user *> windows_;
+
+        bool do_it(window *win) override {
+            if (win->type == window_kind::client) {
+                windows_.push_back(reinterpret_cast<epoc::window_user *>(win));
+            }
+
+            return false;
+        }
+    };
+
+    window_hit_index::window_hit_index(epoc::screen *scr)
+        : scr_(scr)
+        , dirty_(true)
+        , grab_target_(nullptr)
+        , capture_target_(nullptr)
+        , capture_flags_(0) {
+    }
+
+    static bool should_index_window(epoc::window_user *win) {
+        return win->is_visible() && (win->size.x > 0) && (win->size.y > 0);
+    }
+
+    void window_hit_index::rebuild() {
+        grid_.clear();
+        ranks_.clear();
+
+        dirty_ = false;
+
+        if (!scr_->root || !scr_->root->child) {
+            grab_target_ = nullptr;
+            capture_target_ = nullptr;
+            capture_flags_ = 0;
+
+            return;
+        }
+
+        // Same order as the walk pointer events used to take: front to back
+        window_rank_walker walker;
+        scr_->root->child->walk_tree(&walker, epoc::window_tree_walk_style::bonjour_children_and_previous_siblings);
+
+        for (std::uint32_t rank = 0; rank < static_cast<std::uint32_t>(walker.windows_.size()); rank++) {
+            epoc::window_user *win = walker.windows_[rank];
+            ranks_.emplace(win, rank);
+
+            if (should_index_window(win)) {
+                grid_.insert(win, eka2l1::rect(win->absolute_position(), win->size), rank);
+            }
+        }
+
+        // Drop grab and capture on windows that are no longer in the tree
+        if (grab_target_ && (ranks_.find(grab_target_) == ranks_.end())) {
+            grab_target_ = nullptr;
+        }
+
+        if (capture_target_ && (ranks_.find(capture_target_) == ranks_.end())) {
+            capture_target_ = nullptr;
+            capture_flags_ = 0;
+        }
+    }
+
+    void window_hit_index::update_window(epoc::window_user *win) {
+        if (dirty_) {
+            return;
+        }
+
+        // Children extents are relative to this window, they have to be recalculated too
+        if (win->child) {
+            dirty_ = true;
+            return;
+        }
+
+        auto rank_ite = ranks_.find(win);
+
+        if (rank_ite == ranks_.end()) {
+            dirty_ = true;
+            return;
+        }
+
+        if (should_index_window(win)) {
+            grid_.insert(win, eka2l1::rect(win->absolute_position(), win->size), rank_ite->second);
+        } else {
+            grid_.remove(win);
+        }
+    }
+
+    void window_hit_index::remove_window(epoc::window_user *win) {
+        grid_.remove(win);
+        ranks_.erase(win);
+
+        if (grab_target_ == win) {
+            grab_target_ = nullptr;
+        }
+
+        if (capture_target_ == win) {
+            capture_target_ = nullptr;
+            capture_flags_ = 0;
+        }
+    }
+
+    epoc::window_user *window_hit_index::topmost_at(const eka2l1::vec2 &pos, window_hit_filter filter, void *userdata) {
+        if (dirty_) {
+            rebuild();
+        }
+
+        return reinterpret_cast<epoc::window_user *>(grid_.topmost_at(pos, filter, userdata));
+    }
+
+    void window_hit_index::set_capture(epoc::window_user *win, const std::uint32_t flags) {
+        if (flags & epoc::pointer_capture_enabled) {
+            capture_target_ = win;
+            capture_flags_ = flags;
+
+            return;
+        }
+
+        if (capture_target_ == win) {
+            capture_target_ = nullptr;
+            capture_flags_ = 0;
+        }
+    }
+
+    epoc::window_user *window_hit_index::capture_target_for(epoc::window_user *hit) {
+        if (!capture_target_ || (hit == capture_target_)) {
+            return nullptr;
+        }
+
+        if (capture_flags_ & epoc::pointer_capture_all_groups) {
+            return capture_target_;
+        }
+
+        // Only capture events going to windows of the same group
+        if (hit && (hit->get_group() == capture_target_->get_group())) {
+            return capture_target_;
+        }
+
+        return nullptr;
+    }
+}
@@ -20,98 +20,100 @@
 #include <services/window/classes/wingroup.h>
 #include <services/window/classes/winuser.h>
 #include <services/window/io.h>
+#include <services/window/screen.h>
 #include <services/window/window.h>
 
 #include <kernel/kernel.h>
 
 namespace eka2l1::epoc {
-    void window_pointer_focus_walker::add_new_event(const epoc::event &evt) {
-        evts_.emplace_back(evt, false);
+    void window_pointer_shipper::add_new_event(const epoc::event &evt) {
+        evts_.push_back(evt);
     }
 
-    void window_pointer_focus_walker::process_event_to_target_window(epoc::window *win, epoc::event &evt) {
-        assert(win->type == epoc::window_kind::client);
+    void window_pointer_shipper::process_event_to_target_window(epoc::window_user *user, epoc::event &evt) {
+        const eka2l1::vec2 scr_coord = evt.adv_pointer_evt_.pos;
+        const eka2l1::vec2 abs_pos = user->absolute_position();
 
-        epoc::window_user *user = reinterpret_cast<epoc::window_user *>(win);
-        // Stop, we found it!
-        // Send it right now
-        evt.adv_pointer_evt_.pos = scr_coord_ - user->pos;
+        evt.adv_pointer_evt_.pos = scr_coord - abs_pos;
 
         if (user->parent->type == epoc::window_kind::top_client) {
-            evt.adv_pointer_evt_.parent_pos = scr_coord_;
+            evt.adv_pointer_evt_.parent_pos = scr_coord;
         } else {
             // It must be client kind
             assert(user->parent->type == epoc::window_kind::client);
-            evt.adv_pointer_evt_.parent_pos = reinterpret_cast<epoc::window_user *>(user->parent)->pos
-                + evt.adv_pointer_evt_.pos;
+            evt.adv_pointer_evt_.parent_pos = scr_coord - (abs_pos - user->pos);
         }
 
-        evt.handle = win->get_client_handle();
+        evt.handle = user->get_client_handle();
 
-        kernel_system *kern = win->client->get_ws().get_kernel_system();
+        kernel_system *kern = user->client->get_ws().get_kernel_system();
 
         kern->lock();
-        win->queue_event(evt);
+        user->queue_event(evt);
         kern->unlock();
     }
 
-    bool window_pointer_focus_walker::do_it(epoc::window *win) {
-        if (evts_.empty()) {
-            return true;
-        }
+    static bool should_window_accept_pointer_event(void *userdata, epoc::window *win) {
+        epoc::event *evt = reinterpret_cast<epoc::event *>(userdata);
+        epoc::window_user *user = reinterpret_cast<epoc::window_user *>(win);
 
-        if (win->type != epoc::window_kind::client) {
-            return false;
-        }
+        const bool filter_enter_exit = ((evt->type == epoc::event_code::touch_enter) || (evt->type == epoc::event_code::touch_exit))
+            && (user->filter & epoc::pointer_filter_type::pointer_enter);
 
-        epoc::window_user *user = reinterpret_cast<epoc::window_user *>(win);
+        const bool filter_drag = evt->adv_pointer_evt_.evtype == epoc::event_type::drag && (user->filter & epoc::pointer_filter_type::pointer_drag);
 
+        // Filter out events, assuming move event never exist (phone)
+        // When you use touch on your phone, you drag your finger. Move your mouse simply doesn't exist.
+        return !(filter_enter_exit || filter_drag);
+    }
+
+    void window_pointer_shipper::start_shipping(epoc::screen *scr) {
         std::optional<eka2l1::rect> contain_area;
-        auto contain_rect_this_mode_ite = user->scr->pointer_areas_.find(user->scr->crr_mode);
+        auto contain_rect_this_mode_ite = scr->pointer_areas_.find(scr->crr_mode);
 
-        if (contain_rect_this_mode_ite != user->scr->pointer_areas_.end()) {
+        if (contain_rect_this_mode_ite != scr->pointer_areas_.end()) {
             contain_area = contain_rect_this_mode_ite->second;
         }
 
-        for (auto &[evt, sent_to_highest_z] : evts_) {
+        epoc::window_hit_index &index = scr->hit_index_;
+
+        for (auto &evt : evts_) {
             // Is this event really in the pointer area, if area exists. If not, pass
             if (contain_area && !contain_area->contains(evt.adv_pointer_evt_.pos)) {
                 continue;
             }
 
-            const bool filter_enter_exit = ((evt.type == epoc::event_code::touch_enter) || (evt.type == epoc::event_code::touch_exit))
-                && (user->filter & epoc::pointer_filter_type::pointer_enter);
+            epoc::window_user *target = index.grab_target();
 
-            const bool filter_drag = evt.adv_pointer_evt_.evtype == epoc::event_type::drag && (user->filter & epoc::pointer_filter_type::pointer_drag);
+            if (target) {
+                // Grabbed window receives everything until the button is released, filter still applies
+                if (!should_window_accept_pointer_event(&evt, target)) {
+                    target = nullptr;
+                }
+            } else {
+                target = index.topmost_at(evt.adv_pointer_evt_.pos, should_window_accept_pointer_event, &evt);
+                epoc::window_user *capturer = index.capture_target_for(target);
 
-            // Filter out events, assuming move event never exist (phone)
-            // When you use touch on your phone, you drag your finger. Move your mouse simply doesn't exist.
-            if (filter_enter_exit || filter_drag) {
-                continue;
+                if (capturer) {
+                    target = capturer;
+                }
             }
 
-            eka2l1::rect window_rect{ user->pos, user->size };
-            evt.type = epoc::event_code::touch;
-
-            if (!sent_to_highest_z) {
-                if (window_rect.contains(evt.adv_pointer_evt_.pos)) {
-                    scr_coord_ = evt.adv_pointer_evt_.pos;
-
-                    process_event_to_target_window(win, evt);
-                    sent_to_highest_z = true;
-                }
+            if ((evt.adv_pointer_evt_.evtype == epoc::event_type::button1up) || (evt.adv_pointer_evt_.evtype == epoc::event_type::button2up)
+                || (evt.adv_pointer_evt_.evtype == epoc::event_type::button3up)) {
+                index.set_grab_target(nullptr);
+            } else if (target && (evt.adv_pointer_evt_.evtype == epoc::event_type::button1down) && (target->flags & epoc::window::flags_allow_pointer_grab)) {
+                index.set_grab_target(target);
+            }
 
+            if (!target) {
                 continue;
-            } else {
-                // Check to see if capture flag is enabled
-                // TODO:
             }
-        }
 
-        return false;
-    }
+            evt.type = epoc::event_code::touch;
+            process_event_to_target_window(target, evt);
+        }
 
-    void window_pointer_focus_walker::clear() {
         evts_.clear();
     }
 
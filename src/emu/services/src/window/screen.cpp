@@ -99,7 +99,8 @@ namespace eka2l1::epoc {
         , crr_mode(1)
         , next(nullptr)
         , screen_buffer_chunk(nullptr)
-        , focus(nullptr) {
+        , focus(nullptr)
+        , hit_index_(this) {
         root = std::make_unique<epoc::window>(nullptr, this, nullptr);
         disp_mode = scr_conf.disp_mode;
 
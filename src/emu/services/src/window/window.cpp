@@ -1321,6 +1321,9 @@ namespace eka2l1 {
     window_server::~window_server() {
         drivers::graphics_driver *drv = get_graphics_driver();
 
+        // Windows unlink themselves from their screen when destroyed, so clients must go first
+        clients.clear();
+
         // Destroy all screens
         while (screens != nullptr) {
             epoc::screen *next = screens->next;
@@ -1541,8 +1544,7 @@ namespace eka2l1 {
                     make_mouse_event(original_input_evt, guest_event, get_current_focus_screen());
 
                     touch_shipper.add_new_event(guest_event);
-                    root_current->walk_tree(&touch_shipper, epoc::window_tree_walk_style::bonjour_children_and_previous_siblings);
-                    touch_shipper.clear();
+                    touch_shipper.start_shipping(scr);
                 } else {
                     key_shipper.add_new_event(guest_event);
                     key_shipper.start_shipping();
@@ -1921,7 +1923,7 @@ namespace eka2l1 {
         }
 
         bool do_it(epoc::window *win) {
-            if (win && win->type != epoc::window_kind::group && ((accept_pri == -1) || (win->priority == accept_pri))) {
+            if ((accept_pri != -1) && (win->priority != accept_pri)) {
                 return false;
             }
 
@@ -1959,6 +1961,22 @@ namespace eka2l1 {
         }
     };
 
+    // Walk only window groups, in the same front to back order as window::walk_tree, without
+    // visiting the client windows under them.
+    static bool walk_window_groups(epoc::window *first, epoc::window_tree_walker *walker) {
+        for (epoc::window *win = first; win != nullptr; win = win->sibling) {
+            if (win->type != epoc::window_kind::group) {
+                continue;
+            }
+
+            if (walk_window_groups(win->child, walker) || walker->do_it(win)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
     std::uint32_t window_server::get_total_window_groups(const int pri, const int scr_num) {
         epoc::screen *scr = get_screen(scr_num);
 
@@ -1971,7 +1989,7 @@ namespace eka2l1 {
 
         // Tchhh... Im referencing a game...
         window_group_tree_moonwalker walker(scr, nullptr, 0, pri, -1);
-        scr->root->child->walk_tree(&walker, epoc::window_tree_walk_style::bonjour_children_and_previous_siblings);
+        walk_window_groups(scr->root->child, &walker);
 
         return walker.total;
     }
@@ -1985,7 +2003,7 @@ namespace eka2l1 {
         }
 
         window_group_tree_moonwalker walker(scr, ids, 0, pri, max);
-        scr->root->child->walk_tree(&walker, epoc::window_tree_walk_style::bonjour_children_and_previous_siblings);
+        walk_window_groups(scr->root->child, &walker);
 
         return walker.total;
     }
@@ -1999,7 +2017,7 @@ namespace eka2l1 {
         }
 
         window_group_tree_moonwalker walker(scr, infos, window_group_tree_moonwalker::FLAGS_GET_CHAIN, pri, max);
-        scr->root->child->walk_tree(&walker, epoc::window_tree_walk_style::bonjour_children_and_previous_siblings);
+        walk_window_groups(scr->root->child, &walker);
 
         return walker.total;
     }
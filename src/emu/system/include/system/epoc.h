@@ -92,6 +92,8 @@ namespace eka2l1 {
         config::state *conf_;
         config::app_settings *settings_;
 
+        bool manual_timing_; ///< Guest time only moves through the timer's advance_clock.
+
         explicit system_create_components();
     };
 
@@ -85,7 +85,8 @@ namespace eka2l1 {
         : graphics_(nullptr)
         , audio_(nullptr)
         , conf_(nullptr)
-        , settings_(nullptr) {
+        , settings_(nullptr)
+        , manual_timing_(false) {
 
     }
     
@@ -129,6 +130,7 @@ namespace eka2l1 {
         std::unordered_map<uint32_t, hal_instance> hals_;
 
         bool startup_inited = false;
+        bool manual_timing_ = false;
 
         std::optional<filesystem_id> rom_fs_id_;
         std::optional<filesystem_id> physical_fs_id_;
@@ -493,7 +495,7 @@ namespace eka2l1 {
         exit = false;
 
         // Initialize all the system that doesn't depend on others first
-        timing_ = std::make_unique<ntimer>(DEFAULT_CPU_HZ);
+        timing_ = std::make_unique<ntimer>(DEFAULT_CPU_HZ, manual_timing_);
         timing_->set_realtime_level(get_realtime_level_from_string(conf_->rtos_level.c_str()));
 
         file_system_inst physical_fs = create_physical_filesystem(epocver::epoc94, "");
@@ -519,7 +521,8 @@ namespace eka2l1 {
         , adriver(param.audio_)
         , conf_(param.conf_)
         , app_settings_(param.settings_)
-        , exit(false) {
+        , exit(false)
+        , manual_timing_(param.manual_timing_) {
 #if EKA2L1_ARCH(ARM)
         cpu_type = arm_emulator_type::r12l1;
 #else
@@ -621,6 +624,8 @@ namespace eka2l1 {
             }
         }
 
+        kern_->get_profiler()->handle_requests();
+
         if (to_run == nullptr) {
             prepare_reschedule();
         } else {
@@ -636,6 +641,11 @@ namespace eka2l1 {
             }
 
             to_run->add_ticks(cpu->get_num_instruction_executed());
+
+            kernel::profiler *prof = kern_->get_profiler();
+            if (prof->should_sample()) {
+                prof->sample(cpu.get(), to_run);
+            }
         }
 
         if (!kern_->should_terminate()) {
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace eka2l1 {
+    namespace loader {
+        struct rom_dir;
+        struct rom_entry;
+    }
+
+    /**
+     * \brief Flat hash index from case-folded path to a node of a ROM directory tree.
+     *
+     * Paths are stored relative to the drive root, lowercased, with backslash separators and no
+     * leading or trailing separator. The root directory itself is the empty path.
+     *
+     * The index points into the tree it was built from, so it must be rebuilt when the tree changes.
+     */
+    class rom_path_index {
+        struct node {
+            std::u16string path_;
+            const loader::rom_dir *dir_;
+            const loader::rom_entry *entry_;
+        };
+
+        struct slot {
+            std::uint64_t hash_;
+            std::uint32_t node_plus_one_; ///< 0 if the slot is empty.
+        };
+
+        std::vector<node> nodes_;
+        std::vector<slot> slots_;
+
+        void add_dir(const loader::rom_dir &dir, const std::u16string &path);
+        void insert_slot(const std::uint64_t hash, const std::uint32_t node_index);
+
+        const node *find_node(const std::u16string &path) const;
+
+    public:
+        /**
+         * \brief Normalize a path to the form stored in the index.
+         *
+         * The drive letter, repeated separators and leading/trailing separators are removed, '/' becomes '\\',
+         * and the path is lowercased.
+         */
+        static std::u16string normalize(const std::u16string &path);
+
+        void build(const loader::rom_dir &root);
+        void clear();
+
+        /**
+         * \brief Find a file entry. Directories are not returned.
+         *
+         * \param path Path to the file, with or without drive.
+         * \returns Pointer to the entry, nullptr if not found.
+         */
+        const loader::rom_entry *find_entry(const std::u16string &path) const;
+
+        /**
+         * \brief Find a directory, to enumerate its entries and subdirectories.
+         *
+         * \param path Path to the directory, with or without drive.
+         * \returns Pointer to the directory, nullptr if not found.
+         */
+        const loader::rom_dir *find_dir(const std::u16string &path) const;
+
+        const std::size_t size() const {
+            return nodes_.size();
+        }
+
+        const bool empty() const {
+            return nodes_.empty();
+        }
+    };
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <loader/rom.h>
+#include <vfs/rom_index.h>
+
+#include <cwctype>
+
+namespace eka2l1 {
+    static std::uint64_t hash_folded_path(const std::u16string &path) {
+        // FNV-1a over the UTF-16 code units
+        std::uint64_t hash = 0xCBF29CE484222325ULL;
+
+        for (const char16_t c : path) {
+            hash ^= static_cast<std::uint64_t>(c);
+            hash *= 0x100000001B3ULL;
+        }
+
+        return hash;
+    }
+
+    std::u16string rom_path_index::normalize(const std::u16string &path) {
+        std::u16string result;
+        result.reserve(path.length());
+
+        std::size_t pos = 0;
+
+        // Skip the drive
+        if ((path.length() >= 2) && (path[1] == u':')) {
+            pos = 2;
+        }
+
+        for (; pos < path.length(); pos++) {
+            char16_t c = path[pos];
+
+            if ((c == u'\\') || (c == u'/')) {
+                if (!result.empty() && (result.back() != u'\\')) {
+                    result += u'\\';
+                }
+
+                continue;
+            }
+
+            // Same folding as lowercase_ucs2_string
+            result += static_cast<char16_t>(std::towlower(c));
+        }
+
+        if (!result.empty() && (result.back() == u'\\')) {
+            result.pop_back();
+        }
+
+        return result;
+    }
+
+    void rom_path_index::clear() {
+        nodes_.clear();
+        slots_.clear();
+    }
+
+    void rom_path_index::add_dir(const loader::rom_dir &dir, const std::u16string &path) {
+        nodes_.push_back({ path, &dir, nullptr });
+
+        const std::u16string prefix = path.empty() ? path : (path + u'\\');
+
+        for (const loader::rom_entry &entry : dir.entries) {
+            // Directory entries are reached through the subdirectory list
+            if (!entry.dir) {
+                nodes_.push_back({ normalize(prefix + entry.name), nullptr, &entry });
+            }
+        }
+
+        for (const loader::rom_dir &subdir : dir.subdirs) {
+            add_dir(subdir, normalize(prefix + subdir.name));
+        }
+    }
+
+    void rom_path_index::insert_slot(const std::uint64_t hash, const std::uint32_t node_index) {
+        const std::size_t mask = slots_.size() - 1;
+
+        for (std::size_t i = static_cast<std::size_t>(hash) & mask;; i = (i + 1) & mask) {
+            if (slots_[i].node_plus_one_ == 0) {
+                slots_[i].hash_ = hash;
+                slots_[i].node_plus_one_ = node_index + 1;
+
+                return;
+            }
+
+            // Keep the first one on duplicated names, like the sorted search did
+            if ((slots_[i].hash_ == hash) && (nodes_[slots_[i].node_plus_one_ - 1].path_ == nodes_[node_index].path_)) {
+                return;
+            }
+        }
+    }
+
+    void rom_path_index::build(const loader::rom_dir &root) {
+        clear();
+        add_dir(root, u"");
+
+        // Keep the load factor under one half, so probe sequences stay short
+        std::size_t slot_count = 16;
+
+        while (slot_count < nodes_.size() * 2) {
+            slot_count <<= 1;
+        }
+
+        slots_.resize(slot_count, slot{ 0, 0 });
+
+        for (std::uint32_t i = 0; i < static_cast<std::uint32_t>(nodes_.size()); i++) {
+            insert_slot(hash_folded_path(nodes_[i].path_), i);
+        }
+    }
+
+    const rom_path_index::node *rom_path_index::find_node(const std::u16string &path) const {
+        if (slots_.empty()) {
+            return nullptr;
+        }
+
+        const std::u16string folded = normalize(path);
+        const std::uint64_t hash = hash_folded_path(folded);
+        const std::size_t mask = slots_.size() - 1;
+
+        for (std::size_t i = static_cast<std::size_t>(hash) & mask; slots_[i].node_plus_one_ != 0; i = (i + 1) & mask) {
+            if (slots_[i].hash_ != hash) {
+                continue;
+            }
+
+            const node &candidate = nodes_[slots_[i].node_plus_one_ - 1];
+
+            if (candidate.path_ == folded) {
+                return &candidate;
+            }
+        }
+
+        return nullptr;
+    }
+
+    const loader::rom_entry *rom_path_index::find_entry(const std::u16string &path) const {
+        const node *result = find_node(path);
+        return result ? result->entry_ : nullptr;
+    }
+
+    const loader::rom_dir *rom_path_index::find_dir(const std::u16string &path) const {
+        const node *result = find_node(path);
+        return result ? result->dir_ : nullptr;
+    }
+}
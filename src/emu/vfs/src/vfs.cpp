@@ -29,6 +29,7 @@
 #include <loader/rom.h>
 #include <mem/mem.h>
 #include <mem/ptr.h>
+#include <vfs/rom_index.h>
 #include <vfs/vfs.h>
 
 #include <array>
@@ -497,8 +498,15 @@ namespace eka2l1 {
                     continue;
                 }
 
-                entry_info info = *(inst->get_entry_info(common::utf8_to_ucs2(
-                    eka2l1::add_path(vir_path, name))));
+                std::optional<entry_info> found_info = inst->get_entry_info(common::utf8_to_ucs2(
+                    eka2l1::add_path(vir_path, name)));
+
+                // Removed by the host since the directory was opened
+                if (!found_info) {
+                    continue;
+                }
+
+                entry_info info = std::move(found_info.value());
 
                 // Symbian usually sensitive about null terminator.
                 // It's best not include them.
@@ -864,9 +872,12 @@ namespace eka2l1 {
                 return false;
             }
 
-            if (watcher_->unwatch(static_cast<std::int32_t>(handle))) {
+            // The I/O system stores its filesystem ID in the high word
+            const std::int32_t watcher_handle = static_cast<std::int32_t>(handle);
+
+            if (watcher_->unwatch(watcher_handle)) {
                 for (auto &[drive, watch_array]: watches) {
-                    auto ite = std::find(watch_array.begin(), watch_array.end(), handle);
+                    auto ite = std::find(watch_array.begin(), watch_array.end(), watcher_handle);
                     if (ite != watch_array.end()) {
                         watch_array.erase(ite);
                     }
@@ -898,65 +909,61 @@ namespace eka2l1 {
         loader::rom *rom_cache;
         memory_system *mem;
 
-        loader::rom_dir *burn_tree_find_dir(const std::string &vir_path) {
-            auto ite = path_iterator(vir_path);
-            loader::rom_dir *last_dir_found = &(rom_cache->root.root_dirs[0].dir);
-
-            // Skip through the drive
-            ite++;
+        rom_path_index index;
+        const loader::rom_dir *indexed_root;
+        std::uint32_t indexed_checksum;
+        std::mutex index_lock;
 
-            std::vector<std::string> components;
-
-            for (; ite; ite++) {
-                components.push_back(*ite);
-            }
-
-            if (components.size() == 0) {
+        const loader::rom_dir *get_root_dir() {
+            if (rom_cache->root.root_dirs.empty()) {
                 return nullptr;
             }
 
-            for (std::size_t i = 0; i < components.size(); i++) {
-                loader::rom_dir temp;
-                temp.name = common::utf8_to_ucs2(components[i]);
+            return &(rom_cache->root.root_dirs[0].dir);
+        }
 
-                auto res1 = std::lower_bound(last_dir_found->subdirs.begin(), last_dir_found->subdirs.end(), temp,
-                    [](const loader::rom_dir &lhs, const loader::rom_dir &rhs) { return common::compare_ignore_case(lhs.name, rhs.name) == -1; });
+        // The ROM can be reloaded in place when the device changes. Rebuild the index if so.
+        const rom_path_index &get_index() {
+            const std::lock_guard<std::mutex> guard(index_lock);
+            const loader::rom_dir *root = get_root_dir();
 
-                if (res1 != last_dir_found->subdirs.end() && (common::compare_ignore_case(res1->name, temp.name) == 0)) {
-                    last_dir_found = &(last_dir_found->subdirs[std::distance(last_dir_found->subdirs.begin(), res1)]);
+            if ((root != indexed_root) || (rom_cache->header.checksum != indexed_checksum)) {
+                if (root) {
+                    index.build(*root);
                 } else {
-                    return nullptr;
+                    index.clear();
                 }
+
+                indexed_root = root;
+                indexed_checksum = rom_cache->header.checksum;
             }
 
-            return last_dir_found;
+            return index;
         }
 
-        std::optional<loader::rom_entry> burn_tree_find_entry(const std::string &vir_path) {
-            loader::rom_dir *last_dir_found = burn_tree_find_dir(eka2l1::file_directory(vir_path, true));
-
-            if (!last_dir_found) {
-                return std::nullopt;
-            }
-
-            loader::rom_entry temp_entry;
-            temp_entry.name = common::utf8_to_ucs2(eka2l1::filename(vir_path, true));
+        const loader::rom_dir *burn_tree_find_dir(const std::u16string &vir_path) {
+            return get_index().find_dir(vir_path);
+        }
 
-            auto res2 = std::lower_bound(last_dir_found->entries.begin(), last_dir_found->entries.end(), temp_entry,
-                [](const loader::rom_entry &lhs, const loader::rom_entry &rhs) { return common::compare_ignore_case(lhs.name, rhs.name) == -1; });
+        std::optional<loader::rom_entry> burn_tree_find_entry(const std::u16string &vir_path) {
+            const loader::rom_entry *entry = get_index().find_entry(vir_path);
 
-            if (res2 != last_dir_found->entries.end() && !res2->dir && (common::compare_ignore_case(temp_entry.name, res2->name) == 0)) {
-                return *res2;
+            if (!entry) {
+                return std::nullopt;
             }
 
-            return std::nullopt;
+            return *entry;
         }
 
     public:
         explicit rom_file_system(loader::rom *cache, memory_system *mem, epocver ver, const std::string &product_code)
             : physical_file_system(ver, product_code)
             , rom_cache(cache)
-            , mem(mem) {
+            , mem(mem)
+            , indexed_root(nullptr)
+            , indexed_checksum(0) {
+            // Build the path index now, instead of on the first lookup
+            get_index();
         }
 
         bool delete_entry(const std::u16string &path) override {
@@ -995,7 +1002,7 @@ namespace eka2l1 {
                 return abstract_file_system_err_code::no;
             }
 
-            if (burn_tree_find_entry(common::ucs2_to_utf8(path))) {
+            if (burn_tree_find_entry(path)) {
                 return abstract_file_system_err_code::ok;
             }
 
@@ -1023,7 +1030,7 @@ namespace eka2l1 {
                 }
             }
 
-            auto entry = burn_tree_find_entry(common::ucs2_to_utf8(new_path));
+            auto entry = burn_tree_find_entry(new_path);
             auto ff = physical_file_system::open_file(new_path, mode);
 
             // Dont change order!
@@ -1040,7 +1047,7 @@ namespace eka2l1 {
                 return std::nullopt;
             }
 
-            auto entry = burn_tree_find_entry(common::ucs2_to_utf8(path));
+            auto entry = burn_tree_find_entry(path);
 
             if (!entry) {
                 return physical_file_system::get_entry_info(path);
@@ -1058,11 +1065,10 @@ namespace eka2l1 {
         }
 
         std::optional<std::u16string> find_entry_with_address(const std::u16string &clue, const address addr) override {
-            std::u16string the_base_path = clue;
-            loader::rom_dir *the_base_dir = &(rom_cache->root.root_dirs[0].dir);
+            const loader::rom_dir *the_base_dir = get_root_dir();
 
-            if (!the_base_path.empty()) {
-                the_base_dir = burn_tree_find_dir(common::ucs2_to_utf8(clue));
+            if (!clue.empty()) {
+                the_base_dir = burn_tree_find_dir(clue);
             }
 
             if (!the_base_dir) {
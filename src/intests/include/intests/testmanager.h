@@ -30,9 +30,12 @@ public:
     /**
          * \brief Run all the tests
          * 
+         * \param aFilter A category, or a category and a test name separated by a backslash.
+         *                Only the matching tests are run. Empty to run all of them.
+         * 
          * \returns The number of successful test
          */
-    TInt Run();
+    TInt Run(const TDesC &aFilter = KNullDesC);
 
     /**
          * \brief Get the number of total tests.
@@ -40,6 +43,14 @@ public:
          */
     TInt TotalTests();
 
+    /**
+         * \brief Get the number of tests the last run went through.
+         * 
+         */
+    TInt RanTests() const {
+        return iRanTests;
+    }
+
     /**
          * \brief Add new test to test manager.
          * 
@@ -59,6 +70,7 @@ private:
 
     RArray<TTest> iTests;
     TInt iCurrentTest;
+    TInt iRanTests;
     TFileName iSessionPath;
     TInt iWorkingDrive;
 
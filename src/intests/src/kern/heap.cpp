@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <intests/absorber.h>
+#include <intests/testmanager.h>
+
+#include <e32debug.h>
+#include <e32hal.h>
+#include <e32std.h>
+
+static const TInt KTestHeapMinLength = 0x1000;
+static const TInt KTestHeapMaxLength = 0x100000;
+
+static RHeap *CreateTestHeapL() {
+    RHeap *heap = UserHeap::ChunkHeap(NULL, KTestHeapMinLength, KTestHeapMaxLength);
+    User::LeaveIfNull(heap);
+
+    return heap;
+}
+
+void HeapAllocFreeReuseL() {
+    RHeap *heap = CreateTestHeapL();
+
+    TAny *cells[3];
+    cells[0] = heap->Alloc(24);
+    cells[1] = heap->Alloc(100);
+    cells[2] = heap->Alloc(3000);
+
+    TBuf8<60> text;
+    text.Format(_L8("Cell count after three allocs: %d"), heap->Count());
+    EXPECT_INPUT_EQUAL_L(text);
+
+    const TBool lenOk = (heap->AllocLen(cells[0]) >= 24) && (heap->AllocLen(cells[1]) >= 100)
+        && (heap->AllocLen(cells[2]) >= 3000);
+
+    text.Format(_L8("Alloc lengths fit the request: %d"), lenOk);
+    EXPECT_INPUT_EQUAL_L(text);
+
+    // Freed cell of the same size should be handed out again
+    heap->Free(cells[1]);
+    TAny *reused = heap->Alloc(100);
+
+    text.Format(_L8("Freed cell reused: %d"), reused == cells[1]);
+    EXPECT_INPUT_EQUAL_L(text);
+
+    // Growing over the initial committed size should still work
+    TAny *big = heap->Alloc(KTestHeapMinLength * 4);
+
+    text.Format(_L8("Alloc beyond initial size: %d"), big != NULL);
+    EXPECT_INPUT_EQUAL_L(text);
+
+    heap->Free(big);
+    heap->Free(reused);
+    heap->Free(cells[2]);
+    heap->Free(cells[0]);
+
+    text.Format(_L8("Cell count after free all: %d"), heap->Count());
+    EXPECT_INPUT_EQUAL_L(text);
+
+    heap->Close();
+}
+
+void HeapReAllocPreserveDataL() {
+    RHeap *heap = CreateTestHeapL();
+
+    TUint8 *cell = reinterpret_cast<TUint8 *>(heap->Alloc(16));
+    for (TInt i = 0; i < 16; i++) {
+        cell[i] = static_cast<TUint8>(i * 3);
+    }
+
+    // Block the cell from growing in place
+    TAny *blocker = heap->Alloc(16);
+
+    TAny *stuck = heap->ReAlloc(cell, 256, RHeap::ENeverMove);
+
+    TBuf8<60> text;
+    text.Format(_L8("Never move realloc blocked: %d"), stuck == NULL);
+    EXPECT_INPUT_EQUAL_L(text);
+
+    TUint8 *moved = reinterpret_cast<TUint8 *>(heap->ReAlloc(cell, 256));
+    TBool sameData = (moved != NULL);
+
+    for (TInt i = 0; sameData && (i < 16); i++) {
+        sameData = (moved[i] == static_cast<TUint8>(i * 3));
+    }
+
+    text.Format(_L8("Data preserved after realloc: %d"), sameData);
+    EXPECT_INPUT_EQUAL_L(text);
+
+    TAny *shrunk = heap->ReAlloc(moved, 8);
+
+    text.Format(_L8("Shrink keeps the cell: %d"), shrunk == moved);
+    EXPECT_INPUT_EQUAL_L(text);
+
+    heap->Free(shrunk);
+    heap->Free(blocker);
+    heap->Close();
+}
+
+void HeapFreeListConsistentL() {
+    RHeap *heap = CreateTestHeapL();
+
+    TAny *cells[5];
+    for (TInt i = 0; i < 5; i++) {
+        cells[i] = heap->Alloc(40);
+    }
+
+    // Free neighbours out of order, they must end up as one free cell
+    heap->Free(cells[1]);
+    heap->Free(cells[3]);
+    heap->Free(cells[2]);
+
+    // Panics if the free list the guest sees is broken
+    heap->Check();
+
+    TAny *merged = heap->Alloc(100);
+
+    TBuf8<60> text;
+    text.Format(_L8("Merged cell reused: %d"), merged == cells[1]);
+    EXPECT_INPUT_EQUAL_L(text);
+
+    heap->Free(merged);
+    heap->Free(cells[4]);
+    heap->Free(cells[0]);
+    heap->Check();
+
+    text.Format(_L8("Cell count after free all: %d"), heap->Count());
+    EXPECT_INPUT_EQUAL_L(text);
+
+    heap->Close();
+}
+
+void HeapAllocBenchmarkL() {
+    static const TInt KRounds = 2000;
+    static const TInt KCellsPerRound = 16;
+
+    RHeap *heap = CreateTestHeapL();
+    TAny *cells[KCellsPerRound];
+
+    const TUint32 start = User::FastCounter();
+
+    for (TInt round = 0; round < KRounds; round++) {
+        for (TInt i = 0; i < KCellsPerRound; i++) {
+            cells[i] = heap->Alloc(8 + ((round + i * 7) % 24) * 8);
+        }
+
+        for (TInt i = 0; i < KCellsPerRound; i += 2) {
+            cells[i] = heap->ReAlloc(cells[i], 512);
+        }
+
+        for (TInt i = KCellsPerRound - 1; i >= 0; i--) {
+            heap->Free(cells[i]);
+        }
+    }
+
+    const TUint32 end = User::FastCounter();
+
+    TInt frequency = 0;
+    HAL::Get(HALData::EFastCounterFrequency, frequency);
+
+    // Timing is not deterministic, only log it. The guest can't count the instructions it retires: run only
+    // this test under eka2l1_bench (see the README) with hle-user-heap on and off, and compare the reports.
+    const TInt operations = KRounds * KCellsPerRound * 5 / 2;
+    const TUint32 ticks = end - start;
+
+    RDebug::Printf("Heap benchmark: %d operations took %u ticks, %u ticks per 1000 operations (frequency %d)", operations,
+        ticks, static_cast<TUint32>((static_cast<TUint64>(ticks) * 1000) / operations), frequency);
+
+    TBuf8<60> text;
+    text.Format(_L8("Cell count after benchmark: %d"), heap->Count());
+    EXPECT_INPUT_EQUAL_L(text);
+
+    heap->Close();
+}
+
+void AddKernHeapTestCasesL() {
+    ADD_TEST_CASE_L(HeapAllocFreeReuse, Heap, HeapAllocFreeReuseL);
+    ADD_TEST_CASE_L(HeapReAllocPreserveData, Heap, HeapReAllocPreserveDataL);
+    ADD_TEST_CASE_L(HeapFreeListConsistent, Heap, HeapFreeListConsistentL);
+    ADD_TEST_CASE_L(HeapAllocBenchmark, Heap, HeapAllocBenchmarkL);
+}
@@ -19,6 +19,7 @@
 #include <intests/ipc/ipc.h>
 #include <intests/kern/chunk.h>
 #include <intests/kern/codeseg.h>
+#include <intests/kern/heap.h>
 #include <intests/testmanager.h>
 #include <intests/ws/ws.h>
 
@@ -40,6 +41,7 @@ void MainWrapperL() {
     AddWsTestCasesL();
     AddIpcTestCasesL();
     AddKernChunkTestCasesL();
+    AddKernHeapTestCasesL();
     AddCodeSegTestCasesL();
     AddCmdTestCaseL();
     AddFileTestCasesL();
@@ -47,8 +49,15 @@ void MainWrapperL() {
     AddFbsFontTestCasesL();
     AddFbsBitmapTestCasesL();
 
-    TInt totalPass = instance->Run();
-    RDebug::Printf("%d/%d tests passed", totalPass, instance->TotalTests());
+    // The command line can pick a category or a single test, e.g. Heap\HeapAllocBenchmark
+    TFileName filter;
+
+    if (User::CommandLineLength() <= filter.MaxLength()) {
+        User::CommandLine(filter);
+    }
+
+    TInt totalPass = instance->Run(filter);
+    RDebug::Printf("%d/%d tests passed", totalPass, instance->RanTests());
 
     CleanupStack::PopAndDestroy();
 }
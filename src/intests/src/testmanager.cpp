@@ -29,13 +29,38 @@ CTestManager *CTestManager::NewL(const TAbsorberMode aAbsorbMode) {
     return self;
 }
 
-TInt CTestManager::Run() {
+static TBool MatchTestFilter(const TTest &aTest, const TDesC &aFilter) {
+    if (aFilter.Length() == 0) {
+        return ETrue;
+    }
+
+    if (aTest.iCategory->CompareF(aFilter) == 0) {
+        return ETrue;
+    }
+
+    TFileName fullName;
+    fullName.Append(*aTest.iCategory);
+    fullName.Append('\\');
+    fullName.Append(*aTest.iName);
+
+    return (fullName.CompareF(aFilter) == 0);
+}
+
+TInt CTestManager::Run(const TDesC &aFilter) {
     TInt successfulTests = 0;
     RFs &fs = iAbsorber->GetFsSession();
 
+    iRanTests = 0;
+
     for (iCurrentTest = 0; iCurrentTest < iTests.Count(); iCurrentTest++) {
         TTest &test = iTests[iCurrentTest];
 
+        if (!MatchTestFilter(test, aFilter)) {
+            continue;
+        }
+
+        iRanTests++;
+
         _LIT(KTestExt, ".expected");
         _LIT(KTestFolder, "expected\\");
 
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+.include "../../../priv/inc/sv.S"
+
+.global HeapAlloc
+.global HeapFree
+.global HeapReAlloc
+.global HeapAllocLen
+
+@ These replace RHeap member functions, so the heap object comes in r0 as the this pointer.
+@ Shift the arguments up by one register to make room for the dispatch function id.
+
+HeapAlloc:
+    mov r2, r1
+    mov r1, r0
+    CallHleDispatch 0x60
+
+HeapFree:
+    mov r2, r1
+    mov r1, r0
+    CallHleDispatch 0x61
+
+@ The mode argument does not fit in registers anymore, pass it on the stack (kept 8-byte aligned)
+HeapReAlloc:
+    str r3, [sp, #-8]!
+    mov r3, r2
+    mov r2, r1
+    mov r1, r0
+    mov r0, #0x62
+    swi 0xC10000
+    add sp, sp, #8
+    bx lr
+
+HeapAllocLen:
+    mov r2, r1
+    mov r1, r0
+    CallHleDispatch 0x63
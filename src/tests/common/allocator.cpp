@@ -20,8 +20,11 @@
 #include <catch2/catch.hpp>
 #include <common/allocator.h>
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <random>
+#include <vector>
 
 using namespace eka2l1;
 
@@ -128,4 +131,171 @@ TEST_CASE("bitmap_count_unaligned_start_end", "bitmap_allocator") {
     // First bitmap has 4 valid bits on (from offset 2), plus with bitmap 2 and 3 (4 bits before offset 70),
     // we got 4 + 12 + 4 = 20 bits 
     REQUIRE(alloc.allocated_count(2, 70) == 20);
-}
\ No newline at end of file
+}
+
+TEST_CASE("bitmap_alloc_long_run_across_many_words", "bitmap_allocator") {
+    common::bitmap_allocator alloc(32 * 200);
+
+    // Take everything, then free a run from the middle of word 2 to the middle of word 150
+    int all = 32 * 200;
+    REQUIRE(alloc.allocate_from(0, all) == 0);
+    REQUIRE(all == 32 * 200);
+
+    alloc.free(80, 32 * 148);
+
+    int to_alloc = 32 * 148;
+    REQUIRE(alloc.allocate_from(0, to_alloc) == 80);
+    REQUIRE(to_alloc == 32 * 148);
+
+    int one_more = 1;
+    REQUIRE(alloc.allocate_from(0, one_more) == -1);
+}
+
+TEST_CASE("bitmap_alloc_best_fit_across_words", "bitmap_allocator") {
+    common::bitmap_allocator alloc(32 * 4);
+
+    int all = 32 * 4;
+    alloc.allocate_from(0, all);
+
+    // Runs: 40 cells at 10, 6 cells at 70, 8 cells at 100
+    alloc.free(10, 40);
+    alloc.free(70, 6);
+    alloc.free(100, 8);
+
+    int to_alloc = 5;
+    REQUIRE(alloc.allocate_from(0, to_alloc, true) == 70);
+
+    to_alloc = 7;
+    REQUIRE(alloc.allocate_from(0, to_alloc, true) == 100);
+
+    to_alloc = 7;
+    REQUIRE(alloc.allocate_from(0, to_alloc, false) == 10);
+}
+
+TEST_CASE("bitmap_alloc_respect_start_offset", "bitmap_allocator") {
+    common::bitmap_allocator alloc(32 * 3);
+
+    int to_alloc = 4;
+    REQUIRE(alloc.allocate_from(37, to_alloc) == 37);
+    REQUIRE(alloc.get_word(1) == 0xF87FFFFF);
+}
+
+TEST_CASE("bitmap_alloc_matches_reference", "bitmap_allocator") {
+    static constexpr int TOTAL_CELLS = 32 * 50 + 7;
+
+    common::bitmap_allocator alloc(TOTAL_CELLS);
+    std::vector<bool> reference(alloc.words_.size() * 32, true);
+
+    std::mt19937 rng(0xE3A);
+
+    auto reference_find = [&](const int size, const bool best_fit) {
+        int best_offset = -1;
+        int best_length = 0x7FFFFFFF;
+
+        for (int i = 0; i < static_cast<int>(reference.size());) {
+            if (!reference[i]) {
+                i++;
+                continue;
+            }
+
+            int len = 0;
+            while ((i + len < static_cast<int>(reference.size())) && reference[i + len]) {
+                len++;
+            }
+
+            if (len >= size) {
+                if (!best_fit) {
+                    return i;
+                }
+
+                if (len < best_length) {
+                    best_length = len;
+                    best_offset = i;
+                }
+            }
+
+            i += len;
+        }
+
+        return best_offset;
+    };
+
+    std::vector<std::pair<int, int>> live;
+
+    for (int round = 0; round < 3000; round++) {
+        if (live.empty() || (rng() % 3 != 0)) {
+            int size = 1 + static_cast<int>(rng() % 70);
+            const bool best_fit = (rng() % 2 == 0);
+
+            const int expected = reference_find(size, best_fit);
+            const int offset = alloc.allocate_from(0, size, best_fit);
+
+            REQUIRE(offset == expected);
+
+            if (offset >= 0) {
+                for (int i = 0; i < size; i++) {
+                    reference[offset + i] = false;
+                }
+
+                live.push_back({ offset, size });
+            }
+        } else {
+            const std::size_t victim = rng() % live.size();
+            alloc.free(live[victim].first, live[victim].second);
+
+            for (int i = 0; i < live[victim].second; i++) {
+                reference[live[victim].first + i] = true;
+            }
+
+            live.erase(live.begin() + victim);
+        }
+    }
+}
+
+TEST_CASE("bitmap_alloc_heap_growth_benchmark", "[.][bitmap_allocator]") {
+    // 256 MB chunk with 4KB pages
+    static constexpr int TOTAL_PAGES = (256 * 1024 * 1024) / 0x1000;
+
+    common::bitmap_allocator alloc(TOTAL_PAGES);
+    std::vector<std::pair<int, int>> live;
+
+    std::mt19937 rng(0x256);
+    int committed = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // Grow like a heap does: mostly small commits, with some decommits along the way
+    while (true) {
+        int pages = 1 + static_cast<int>(rng() % 16);
+        const int offset = alloc.allocate_from(0, pages, (rng() % 4) == 0);
+
+        if (offset < 0) {
+            break;
+        }
+
+        committed += pages;
+        live.push_back({ offset, pages });
+
+        if (rng() % 8 == 0) {
+            const std::size_t victim = rng() % live.size();
+            alloc.free(live[victim].first, live[victim].second);
+
+            committed -= live[victim].second;
+            live.erase(live.begin() + victim);
+        }
+    }
+
+    const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    WARN("Filled " << TOTAL_PAGES << " pages with " << live.size() << " commits in " << duration.count() << "ms");
+
+    // Set bits are free pages
+    int free_pages = 0;
+
+    for (std::uint32_t i = 0; i < TOTAL_PAGES / 32; i++) {
+        for (std::uint32_t wv = alloc.get_word(i); wv != 0; wv &= wv - 1) {
+            free_pages++;
+        }
+    }
+
+    REQUIRE(free_pages == TOTAL_PAGES - committed);
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/asynclog.h>
+#include <common/log.h>
+
+#include <spdlog/sinks/base_sink.h>
+#include <spdlog/sinks/ostream_sink.h>
+
+#include <atomic>
+#include <cstdio>
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace eka2l1;
+
+static std::shared_ptr<spdlog::logger> make_stream_logger(std::ostringstream &stream) {
+    auto logger = std::make_shared<spdlog::logger>("asynclog test", std::make_shared<spdlog::sinks::ostream_sink_mt>(stream));
+    logger->set_pattern("%v");
+    logger->set_level(spdlog::level::trace);
+
+    return logger;
+}
+
+static std::vector<std::string> split_lines(const std::string &text) {
+    std::vector<std::string> lines;
+    std::istringstream stream(text);
+    std::string line;
+
+    while (std::getline(stream, line)) {
+        lines.push_back(line);
+    }
+
+    return lines;
+}
+
+// Holds the first record it receives until it is opened, so the ring can be filled deterministically
+struct gated_sink : public spdlog::sinks::base_sink<std::mutex> {
+    std::atomic<bool> open_{ false };
+    std::atomic<int> received_{ 0 };
+
+protected:
+    void sink_it_(const spdlog::details::log_msg &msg) override {
+        received_++;
+
+        while (!open_.load()) {
+            std::this_thread::yield();
+        }
+    }
+
+    void flush_() override {
+    }
+};
+
+TEST_CASE("async_logger_keeps_order_and_owns_arguments", "async_logger") {
+    std::ostringstream stream;
+
+    {
+        log::async_logger logger(make_stream_logger(stream));
+
+        for (int i = 0; i < 1000; i++) {
+            // The temporary is gone long before the background thread formats the record
+            logger.push(CONFIG, spdlog::level::info, "config.cpp", 42, "Value {} is {}", i, std::string("text") + std::to_string(i));
+        }
+
+        logger.flush();
+        REQUIRE(logger.overflow_count() == 0);
+    }
+
+    const std::vector<std::string> lines = split_lines(stream.str());
+    REQUIRE(lines.size() == 1000);
+
+    for (std::size_t i = 0; i < lines.size(); i++) {
+        REQUIRE(lines[i] == "config.cpp:42 [Config]: Value " + std::to_string(i) + " is text" + std::to_string(i));
+    }
+}
+
+TEST_CASE("async_logger_many_producers", "async_logger") {
+    static constexpr int PRODUCER_COUNT = 4;
+    static constexpr int RECORD_PER_PRODUCER = 2000;
+
+    std::ostringstream stream;
+    std::uint64_t dropped = 0;
+
+    {
+        log::async_logger logger(make_stream_logger(stream));
+        std::vector<std::thread> producers;
+
+        for (int p = 0; p < PRODUCER_COUNT; p++) {
+            producers.emplace_back([&logger, p]() {
+                for (int i = 0; i < RECORD_PER_PRODUCER; i++) {
+                    logger.push(CONFIG, spdlog::level::debug, "producer.cpp", p, "{} {}", p, i);
+                }
+            });
+        }
+
+        for (std::thread &producer : producers) {
+            producer.join();
+        }
+
+        logger.flush();
+        dropped = logger.overflow_count();
+    }
+
+    int last_seen[PRODUCER_COUNT] = { -1, -1, -1, -1 };
+    std::uint64_t received = 0;
+
+    for (const std::string &line : split_lines(stream.str())) {
+        int p = 0;
+        int i = 0;
+
+        if (std::sscanf(line.c_str(), "producer.cpp:%*d [Config]: %d %d", &p, &i) != 2) {
+            continue;
+        }
+
+        REQUIRE(i > last_seen[p]);
+        last_seen[p] = i;
+
+        received++;
+    }
+
+    REQUIRE(received + dropped == PRODUCER_COUNT * RECORD_PER_PRODUCER);
+}
+
+// Fails to be captured by the logger
+struct throwing_arg {
+    throwing_arg() = default;
+
+    throwing_arg(const throwing_arg &) {
+        throw std::runtime_error("No copy");
+    }
+};
+
+template <>
+struct fmt::formatter<throwing_arg> : fmt::formatter<int> {
+    template <typename FormatContext>
+    auto format(const throwing_arg &, FormatContext &ctx) {
+        return fmt::formatter<int>::format(0, ctx);
+    }
+};
+
+TEST_CASE("async_logger_publishes_when_capture_throws", "async_logger") {
+    std::ostringstream stream;
+
+    {
+        log::async_logger logger(make_stream_logger(stream));
+        throwing_arg arg;
+
+        logger.push(CONFIG, spdlog::level::info, "throw.cpp", 1, "Bad {}", arg);
+        logger.push(CONFIG, spdlog::level::info, "throw.cpp", 2, "After {}", 1);
+        logger.flush();
+    }
+
+    const std::vector<std::string> lines = split_lines(stream.str());
+    REQUIRE(lines.size() == 2);
+    REQUIRE(lines[0] == "throw.cpp:1 [Config]: <unable to capture log arguments>");
+    REQUIRE(lines[1] == "throw.cpp:2 [Config]: After 1");
+}
+
+TEST_CASE("async_logger_counts_overflow", "async_logger") {
+    auto sink = std::make_shared<gated_sink>();
+    auto target = std::make_shared<spdlog::logger>("asynclog gated", sink);
+
+    {
+        log::async_logger logger(target, 8);
+
+        // The slot of a record is freed only once the sink returns, so 8 records fit while the sink is held
+        for (int i = 0; i < 20; i++) {
+            logger.push(CONFIG, spdlog::level::info, "gate.cpp", 1, "Record {}", i);
+        }
+
+        REQUIRE(logger.overflow_count() == 12);
+
+        sink->open_ = true;
+        logger.flush();
+    }
+
+    // The 8 records, then the drop report written on shutdown
+    REQUIRE(sink->received_ == 9);
+}
+
+TEST_CASE("async_logger_rate_limits_per_class", "async_logger") {
+    std::ostringstream stream;
+
+    log::async_logger logger(make_stream_logger(stream), log::async_logger::DEFAULT_CAPACITY, 10);
+
+    for (int i = 0; i < 50; i++) {
+        logger.push(CONFIG, spdlog::level::trace, "limit.cpp", 1, "Chatty {}", i);
+        logger.push(FRONTEND_UI, spdlog::level::err, "limit.cpp", 2, "Error {}", i);
+    }
+
+    logger.flush();
+
+    REQUIRE(logger.rate_limited_count(CONFIG) == 40);
+    REQUIRE(logger.rate_limited_count(FRONTEND_UI) == 0);
+}
+
+TEST_CASE("async_logger_benchmark", "[.][async_logger]") {
+    static constexpr int RECORD_COUNT = 200000;
+
+    std::ostringstream sync_stream;
+    std::ostringstream async_stream;
+
+    auto sync_target = make_stream_logger(sync_stream);
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < RECORD_COUNT; i++) {
+        sync_target->trace("{:s}:{} [{:s}]: Hot path record {} at 0x{:X}", "bench.cpp", 7, log_class_to_string(CONFIG), i, i * 4);
+    }
+
+    const auto sync_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    std::chrono::microseconds async_time;
+    std::uint64_t dropped = 0;
+
+    {
+        log::async_logger logger(make_stream_logger(async_stream), 1 << 16);
+        start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < RECORD_COUNT; i++) {
+            logger.push(CONFIG, spdlog::level::trace, "bench.cpp", 7, "Hot path record {} at 0x{:X}", i, i * 4);
+        }
+
+        async_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        logger.flush();
+
+        dropped = logger.overflow_count();
+    }
+
+    WARN(RECORD_COUNT << " records on the logging thread: synchronous " << sync_time.count() << " us, asynchronous "
+                      << async_time.count() << " us (" << dropped << " dropped on a full ring)");
+}
@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/pixelconv.h>
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace eka2l1;
+
+static const common::pixel_kernel_level ALL_KERNEL_LEVELS[] = {
+    common::pixel_kernel_scalar,
+    common::pixel_kernel_sse2,
+    common::pixel_kernel_ssse3,
+    common::pixel_kernel_avx2,
+    common::pixel_kernel_neon
+};
+
+static const char *kernel_level_name(const common::pixel_kernel_level level) {
+    static const char *NAMES[] = { "scalar", "sse2", "ssse3", "avx2", "neon" };
+    return NAMES[level];
+}
+
+static std::size_t pixel_size_of(const common::pixel_format format) {
+    return (format == common::pixel_format_bgr24) ? 3 : 4;
+}
+
+// Straightforward per pixel conversion that the kernels are checked against
+static void reference_pixel(std::uint8_t *dest, const common::pixel_format dest_format, const std::uint8_t *src_row,
+    const common::pixel_format src_format, const std::size_t x, const std::uint32_t *palette) {
+    std::uint32_t b = 0, g = 0, r = 0;
+
+    switch (src_format) {
+    case common::pixel_format_palette1:
+    case common::pixel_format_palette2:
+    case common::pixel_format_palette4:
+    case common::pixel_format_palette8: {
+        const std::size_t bpp = static_cast<std::size_t>(1) << (src_format - common::pixel_format_palette1);
+        const std::size_t bit = x * bpp;
+        const std::uint32_t index = (src_row[bit / 8] >> (bit % 8)) & ((1 << bpp) - 1);
+
+        r = palette[index] & 0xFF;
+        g = (palette[index] >> 8) & 0xFF;
+        b = (palette[index] >> 16) & 0xFF;
+
+        break;
+    }
+
+    case common::pixel_format_rgb444: {
+        const std::uint32_t pixel = src_row[x * 2] | (src_row[x * 2 + 1] << 8);
+
+        b = (pixel & 0xF) * 255 / 15;
+        g = ((pixel >> 4) & 0xF) * 255 / 15;
+        r = ((pixel >> 8) & 0xF) * 255 / 15;
+
+        break;
+    }
+
+    case common::pixel_format_rgb565: {
+        const std::uint32_t pixel = src_row[x * 2] | (src_row[x * 2 + 1] << 8);
+
+        // Bit replication, same as the fbs bitmap dump did
+        b = (pixel & 0x1F) << 3;
+        b += b >> 5;
+        g = ((pixel >> 5) & 0x3F) << 2;
+        g += g >> 6;
+        r = (pixel >> 11) << 3;
+        r += r >> 5;
+
+        break;
+    }
+
+    case common::pixel_format_bgr24:
+    case common::pixel_format_bgra32: {
+        const std::size_t size = pixel_size_of(src_format);
+
+        b = src_row[x * size];
+        g = src_row[x * size + 1];
+        r = src_row[x * size + 2];
+
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    const std::size_t size = pixel_size_of(dest_format);
+
+    dest[x * size] = static_cast<std::uint8_t>(b);
+    dest[x * size + 1] = static_cast<std::uint8_t>(g);
+    dest[x * size + 2] = static_cast<std::uint8_t>(r);
+
+    if (size == 4) {
+        dest[x * size + 3] = (src_format == common::pixel_format_bgra32) ? src_row[x * 4 + 3] : 0xFF;
+    }
+}
+
+static std::size_t row_bytes_of(const common::pixel_format format, const std::size_t width) {
+    switch (format) {
+    case common::pixel_format_palette1:
+        return (width + 7) / 8;
+
+    case common::pixel_format_palette2:
+        return (width + 3) / 4;
+
+    case common::pixel_format_palette4:
+        return (width + 1) / 2;
+
+    case common::pixel_format_palette8:
+        return width;
+
+    case common::pixel_format_rgb444:
+    case common::pixel_format_rgb565:
+        return width * 2;
+
+    default:
+        return width * pixel_size_of(format);
+    }
+}
+
+static void check_conversion(const common::pixel_format src_format, const common::pixel_format dest_format,
+    const std::vector<std::uint8_t> &src, const std::size_t width, const std::size_t height,
+    const std::uint32_t *palette) {
+    const std::size_t src_stride = src.size() / height;
+    const std::size_t dest_stride = width * pixel_size_of(dest_format) + 5;
+
+    std::vector<std::uint8_t> expected(dest_stride * height, 0xCD);
+
+    for (std::size_t y = 0; y < height; y++) {
+        for (std::size_t x = 0; x < width; x++) {
+            reference_pixel(expected.data() + y * dest_stride, dest_format, src.data() + y * src_stride, src_format, x, palette);
+        }
+    }
+
+    for (const common::pixel_kernel_level level : ALL_KERNEL_LEVELS) {
+        if (!common::is_pixel_kernel_supported(level)) {
+            continue;
+        }
+
+        // Padding bytes must come out untouched
+        std::vector<std::uint8_t> result(dest_stride * height, 0xCD);
+
+        INFO("Kernel " << kernel_level_name(level) << ", source format " << src_format << ", width " << width);
+        REQUIRE(common::convert_pixels(result.data(), dest_stride, dest_format, src.data(), src_stride, src_format,
+            width, height, palette, level));
+        REQUIRE(result == expected);
+    }
+}
+
+TEST_CASE("pixelconv_16bpp_exhaustive", "pixelconv") {
+    // Every 16-bit value, as one long row and as rows hitting every tail length of the vector loops
+    std::vector<std::uint8_t> all_values(65536 * 2);
+
+    for (std::size_t i = 0; i < 65536; i++) {
+        all_values[i * 2] = static_cast<std::uint8_t>(i);
+        all_values[i * 2 + 1] = static_cast<std::uint8_t>(i >> 8);
+    }
+
+    for (const common::pixel_format src_format : { common::pixel_format_rgb444, common::pixel_format_rgb565 }) {
+        for (const common::pixel_format dest_format : { common::pixel_format_bgr24, common::pixel_format_bgra32 }) {
+            check_conversion(src_format, dest_format, all_values, 65536, 1, nullptr);
+
+            for (std::size_t width = 1; width <= 40; width++) {
+                const std::vector<std::uint8_t> rows(all_values.begin() + width * 600, all_values.begin() + width * 600 + width * 2 * 3);
+                check_conversion(src_format, dest_format, rows, width, 3, nullptr);
+            }
+        }
+    }
+}
+
+TEST_CASE("pixelconv_swizzles", "pixelconv") {
+    std::mt19937 rng(2021);
+
+    for (std::size_t width = 0; width <= 70; width++) {
+        for (const common::pixel_format src_format : { common::pixel_format_bgr24, common::pixel_format_bgra32 }) {
+            std::vector<std::uint8_t> src(width * pixel_size_of(src_format) * 4 + 4 * 3);
+
+            for (std::uint8_t &byte : src) {
+                byte = static_cast<std::uint8_t>(rng());
+            }
+
+            check_conversion(src_format, common::pixel_format_bgr24, src, width, 4, nullptr);
+            check_conversion(src_format, common::pixel_format_bgra32, src, width, 4, nullptr);
+        }
+    }
+}
+
+TEST_CASE("pixelconv_palette_expansion", "pixelconv") {
+    std::mt19937 rng(49);
+    std::uint32_t palette[256];
+
+    for (std::uint32_t &color : palette) {
+        color = rng() & 0xFFFFFF;
+    }
+
+    for (const common::pixel_format src_format : { common::pixel_format_palette1, common::pixel_format_palette2,
+             common::pixel_format_palette4, common::pixel_format_palette8 }) {
+        for (std::size_t width = 1; width <= 33; width++) {
+            // Stride padded like Symbian bitmaps, the padding holds garbage
+            const std::size_t src_stride = (row_bytes_of(src_format, width) + 3) & ~static_cast<std::size_t>(3);
+            std::vector<std::uint8_t> src(src_stride * 256);
+
+            for (std::size_t y = 0; y < 256; y++) {
+                for (std::size_t i = 0; i < src_stride; i++) {
+                    src[y * src_stride + i] = static_cast<std::uint8_t>(y + i * 37);
+                }
+            }
+
+            check_conversion(src_format, common::pixel_format_bgr24, src, width, 256, palette);
+            check_conversion(src_format, common::pixel_format_bgra32, src, width, 256, palette);
+        }
+    }
+
+    std::uint8_t dest[4];
+    const std::uint8_t src = 0;
+
+    REQUIRE_FALSE(common::convert_pixels(dest, 4, common::pixel_format_bgra32, &src, 1, common::pixel_format_palette8, 1, 1));
+    REQUIRE_FALSE(common::convert_pixels(dest, 4, common::pixel_format_rgb565, &src, 1, common::pixel_format_bgr24, 1, 1));
+}
+
+TEST_CASE("pixelconv_grey_palette", "pixelconv") {
+    std::uint32_t palette[256];
+
+    common::make_grey_palette(1, palette);
+    REQUIRE(palette[0] == 0);
+    REQUIRE(palette[1] == 0xFFFFFF);
+
+    common::make_grey_palette(2, palette);
+    REQUIRE(palette[1] == 0x555555);
+    REQUIRE(palette[2] == 0xAAAAAA);
+
+    common::make_grey_palette(4, palette);
+    REQUIRE(palette[1] == 0x111111);
+    REQUIRE(palette[15] == 0xFFFFFF);
+
+    common::make_grey_palette(8, palette);
+    REQUIRE(palette[0x7F] == 0x7F7F7F);
+}
+
+TEST_CASE("pixelconv_benchmark", "[.][pixelconv]") {
+    static constexpr std::size_t WIDTH = 1024;
+    static constexpr std::size_t HEIGHT = 1024;
+    static constexpr int ROUND_COUNT = 10;
+
+    struct bench_case {
+        const char *name;
+        common::pixel_format src_format;
+        common::pixel_format dest_format;
+    };
+
+    static const bench_case CASES[] = {
+        { "565 to 24", common::pixel_format_rgb565, common::pixel_format_bgr24 },
+        { "565 to 32", common::pixel_format_rgb565, common::pixel_format_bgra32 },
+        { "444 to 32", common::pixel_format_rgb444, common::pixel_format_bgra32 },
+        { "24 to 32", common::pixel_format_bgr24, common::pixel_format_bgra32 },
+        { "32 to 24", common::pixel_format_bgra32, common::pixel_format_bgr24 },
+        { "palette8 to 24", common::pixel_format_palette8, common::pixel_format_bgr24 },
+        { "palette1 to 24", common::pixel_format_palette1, common::pixel_format_bgr24 }
+    };
+
+    std::mt19937 rng(1);
+    std::vector<std::uint8_t> src(WIDTH * HEIGHT * 4);
+    std::vector<std::uint8_t> dest(WIDTH * HEIGHT * 4);
+
+    for (std::uint8_t &byte : src) {
+        byte = static_cast<std::uint8_t>(rng());
+    }
+
+    std::uint32_t palette[256];
+    common::make_grey_palette(8, palette);
+
+    for (const bench_case &bcase : CASES) {
+        // A naive loop storing byte by byte, like the converters used to
+        auto start = std::chrono::steady_clock::now();
+
+        for (int round = 0; round < ROUND_COUNT; round++) {
+            for (std::size_t i = 0; i < WIDTH * HEIGHT; i++) {
+                reference_pixel(dest.data(), bcase.dest_format, src.data(), bcase.src_format, i, palette);
+            }
+        }
+
+        const auto naive_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        for (const common::pixel_kernel_level level : ALL_KERNEL_LEVELS) {
+            if (!common::is_pixel_kernel_supported(level)) {
+                continue;
+            }
+
+            start = std::chrono::steady_clock::now();
+
+            for (int round = 0; round < ROUND_COUNT; round++) {
+                common::convert_pixels(dest.data(), WIDTH * pixel_size_of(bcase.dest_format), bcase.dest_format, src.data(),
+                    row_bytes_of(bcase.src_format, WIDTH), bcase.src_format, WIDTH, HEIGHT, palette, level);
+            }
+
+            const auto time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+            WARN(bcase.name << " (" << kernel_level_name(level) << "): " << (WIDTH * HEIGHT * ROUND_COUNT) / (time.count() + 1)
+                            << " Mpixels/s, naive " << (WIDTH * HEIGHT * ROUND_COUNT) / (naive_time.count() + 1) << " Mpixels/s");
+        }
+    }
+}
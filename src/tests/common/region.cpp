@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/region.h>
+
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+using namespace eka2l1;
+
+static constexpr int REGION_GRID_SIZE = 48;
+using region_grid = std::bitset<REGION_GRID_SIZE * REGION_GRID_SIZE>;
+
+static region_grid rasterize(const common::region &reg) {
+    region_grid grid;
+
+    for (const eka2l1::rect &rect : reg.rects_) {
+        for (int y = rect.top.y; y < rect.top.y + rect.size.y; y++) {
+            for (int x = rect.top.x; x < rect.top.x + rect.size.x; x++) {
+                grid.set(y * REGION_GRID_SIZE + x);
+            }
+        }
+    }
+
+    return grid;
+}
+
+static region_grid rasterize(const eka2l1::rect &rect) {
+    common::region reg;
+    reg.rects_.push_back(rect);
+
+    return rasterize(reg);
+}
+
+static void check_banded(const common::region &reg) {
+    const std::vector<eka2l1::rect> &rects = reg.rects_;
+
+    for (std::size_t i = 0; i < rects.size(); i++) {
+        REQUIRE(rects[i].size.x > 0);
+        REQUIRE(rects[i].size.y > 0);
+
+        if (i == 0) {
+            continue;
+        }
+
+        const eka2l1::rect &prev = rects[i - 1];
+
+        if (prev.top.y == rects[i].top.y) {
+            // Same band: same height, sorted and not touching
+            REQUIRE(prev.size.y == rects[i].size.y);
+            REQUIRE(prev.top.x + prev.size.x < rects[i].top.x);
+        } else {
+            REQUIRE(prev.top.y + prev.size.y <= rects[i].top.y);
+        }
+    }
+
+    // Touching bands must not have the same spans, or they should have been coalesced
+    std::size_t band_start = 0;
+    std::size_t prev_band_start = rects.size();
+
+    while (band_start < rects.size()) {
+        std::size_t band_end = band_start + 1;
+        while ((band_end < rects.size()) && (rects[band_end].top.y == rects[band_start].top.y)) {
+            band_end++;
+        }
+
+        if (prev_band_start < band_start) {
+            const eka2l1::rect &prev = rects[prev_band_start];
+
+            if ((prev.top.y + prev.size.y == rects[band_start].top.y) && (band_start - prev_band_start == band_end - band_start)) {
+                bool same = true;
+
+                for (std::size_t i = 0; i < band_end - band_start; i++) {
+                    if ((rects[prev_band_start + i].top.x != rects[band_start + i].top.x) || (rects[prev_band_start + i].size.x != rects[band_start + i].size.x)) {
+                        same = false;
+                        break;
+                    }
+                }
+
+                REQUIRE(!same);
+            }
+        }
+
+        prev_band_start = band_start;
+        band_start = band_end;
+    }
+}
+
+static bool same_rect(const eka2l1::rect &lhs, const eka2l1::rect &rhs) {
+    return (lhs.top == rhs.top) && (lhs.size == rhs.size);
+}
+
+static eka2l1::rect random_rect(std::mt19937 &rng) {
+    std::uniform_int_distribution<int> pos_dist(0, REGION_GRID_SIZE - 1);
+
+    const int x = pos_dist(rng);
+    const int y = pos_dist(rng);
+
+    std::uniform_int_distribution<int> width_dist(1, REGION_GRID_SIZE - x);
+    std::uniform_int_distribution<int> height_dist(1, REGION_GRID_SIZE - y);
+
+    return eka2l1::rect({ x, y }, { width_dist(rng), height_dist(rng) });
+}
+
+TEST_CASE("region_add_rect_coalesce", "region") {
+    common::region reg;
+
+    REQUIRE(reg.add_rect(eka2l1::rect({ 0, 0 }, { 10, 10 })));
+    REQUIRE(reg.add_rect(eka2l1::rect({ 0, 10 }, { 10, 10 })));
+    REQUIRE(reg.add_rect(eka2l1::rect({ 10, 0 }, { 10, 20 })));
+
+    REQUIRE(reg.rects_.size() == 1);
+    REQUIRE(same_rect(reg.rects_[0], eka2l1::rect({ 0, 0 }, { 20, 20 })));
+
+    // Already covered, nothing changes
+    REQUIRE(!reg.add_rect(eka2l1::rect({ 5, 5 }, { 5, 5 })));
+    REQUIRE(reg.rects_.size() == 1);
+}
+
+TEST_CASE("region_eliminate_hole", "region") {
+    common::region reg;
+    reg.add_rect(eka2l1::rect({ 0, 0 }, { 30, 30 }));
+    reg.eliminate(eka2l1::rect({ 10, 10 }, { 10, 10 }));
+
+    // Top band, middle band with two spans and bottom band
+    REQUIRE(reg.rects_.size() == 4);
+    REQUIRE(same_rect(reg.rects_[0], eka2l1::rect({ 0, 0 }, { 30, 10 })));
+    REQUIRE(same_rect(reg.rects_[1], eka2l1::rect({ 0, 10 }, { 10, 10 })));
+    REQUIRE(same_rect(reg.rects_[2], eka2l1::rect({ 20, 10 }, { 10, 10 })));
+    REQUIRE(same_rect(reg.rects_[3], eka2l1::rect({ 0, 20 }, { 30, 10 })));
+
+    REQUIRE(reg.contains(eka2l1::vec2(0, 0)));
+    REQUIRE(reg.contains(eka2l1::vec2(9, 15)));
+    REQUIRE(!reg.contains(eka2l1::vec2(10, 15)));
+    REQUIRE(!reg.contains(eka2l1::vec2(19, 19)));
+    REQUIRE(reg.contains(eka2l1::vec2(20, 19)));
+    REQUIRE(!reg.contains(eka2l1::vec2(30, 0)));
+    REQUIRE(!reg.contains(eka2l1::vec2(0, 30)));
+
+    REQUIRE(reg.contains(eka2l1::rect({ 0, 0 }, { 30, 10 })));
+    REQUIRE(!reg.contains(eka2l1::rect({ 5, 5 }, { 10, 10 })));
+
+    reg.add_rect(eka2l1::rect({ 10, 10 }, { 10, 10 }));
+    REQUIRE(reg.rects_.size() == 1);
+    REQUIRE(same_rect(reg.bounding_rect(), eka2l1::rect({ 0, 0 }, { 30, 30 })));
+}
+
+TEST_CASE("region_random_ops_match_pixel_grid", "region") {
+    std::mt19937 rng(0x5EED);
+    std::uniform_int_distribution<int> op_dist(0, 3);
+
+    for (int round = 0; round < 200; round++) {
+        common::region reg;
+        region_grid expected;
+
+        for (int step = 0; step < 24; step++) {
+            const eka2l1::rect rect = random_rect(rng);
+
+            switch (op_dist(rng)) {
+            case 0:
+            case 1: {
+                const region_grid rect_grid = rasterize(rect);
+                const bool modified = reg.add_rect(rect);
+
+                REQUIRE(modified == ((rect_grid & ~expected).any()));
+                expected |= rect_grid;
+                break;
+            }
+
+            case 2:
+                reg.eliminate(rect);
+                expected &= ~rasterize(rect);
+                break;
+
+            default: {
+                common::region other;
+                other.add_rect(rect);
+                other.add_rect(random_rect(rng));
+
+                const region_grid other_grid = rasterize(other);
+
+                if (rng() & 1) {
+                    reg = reg.intersect(other);
+                    expected &= other_grid;
+                } else {
+                    reg.eliminate(other);
+                    expected &= ~other_grid;
+                }
+
+                break;
+            }
+            }
+
+            check_banded(reg);
+            REQUIRE(rasterize(reg) == expected);
+        }
+
+        // Probe containment with pixels and rectangles
+        for (int probe = 0; probe < 32; probe++) {
+            const eka2l1::rect rect = random_rect(rng);
+            REQUIRE(reg.contains(rect.top) == expected.test(rect.top.y * REGION_GRID_SIZE + rect.top.x));
+            REQUIRE(reg.contains(rect) == ((rasterize(rect) & ~expected).none()));
+        }
+    }
+}
+
+TEST_CASE("region_window_stack_benchmark", "[.][region]") {
+    std::mt19937 rng(0xCAFE);
+    std::uniform_int_distribution<int> pos_dist(0, 600);
+    std::uniform_int_distribution<int> size_dist(16, 240);
+
+    static constexpr int WINDOW_COUNT = 400;
+    static constexpr int ROUNDS = 50;
+
+    std::vector<eka2l1::rect> windows;
+
+    for (int i = 0; i < WINDOW_COUNT; i++) {
+        windows.push_back(eka2l1::rect({ pos_dist(rng), pos_dist(rng) }, { size_dist(rng), size_dist(rng) }));
+    }
+
+    std::size_t total_rects = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int round = 0; round < ROUNDS; round++) {
+        // Visible regions from front to back, as the window server does
+        common::region covered;
+
+        for (const eka2l1::rect &window : windows) {
+            common::region visible;
+            visible.add_rect(window);
+            visible.eliminate(covered);
+
+            covered.add_rect(window);
+            total_rects += visible.rects_.size();
+        }
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    WARN("Visible regions of " << WINDOW_COUNT << " windows x " << ROUNDS << " rounds: " << elapsed.count()
+                               << "ms, " << total_rects << " rectangles produced");
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/ring.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using namespace eka2l1;
+
+TEST_CASE("spsc_ring_full_and_empty", "spsc_ring") {
+    common::spsc_ring<std::uint32_t> ring(3);
+    REQUIRE(ring.capacity() == 4);
+
+    for (std::uint32_t i = 0; i < 4; i++) {
+        REQUIRE(ring.push(i));
+    }
+
+    REQUIRE_FALSE(ring.push(4));
+
+    std::uint32_t val = 0;
+    REQUIRE(ring.pop(val));
+    REQUIRE(val == 0);
+
+    std::uint32_t rest[4];
+    REQUIRE(ring.pop_bulk(rest, 4) == 3);
+    REQUIRE(rest[0] == 1);
+    REQUIRE(rest[2] == 3);
+
+    REQUIRE(ring.empty());
+    REQUIRE_FALSE(ring.pop(val));
+}
+
+TEST_CASE("spsc_ring_threaded_in_order", "spsc_ring") {
+    static constexpr std::uint32_t TOTAL = 1000000;
+    common::spsc_ring<std::uint32_t> ring(256);
+
+    std::thread producer([&]() {
+        for (std::uint32_t i = 0; i < TOTAL; i++) {
+            while (!ring.push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::uint32_t expected = 0;
+    bool in_order = true;
+
+    while (expected < TOTAL) {
+        std::uint32_t val = 0;
+        if (ring.pop(val)) {
+            in_order = in_order && (val == expected);
+            expected++;
+        }
+    }
+
+    producer.join();
+    REQUIRE(in_order);
+}
+
+TEST_CASE("spsc_byte_ring_records_wrap", "spsc_byte_ring") {
+    common::spsc_byte_ring ring(30);
+    REQUIRE(ring.capacity() == 32);
+    REQUIRE(ring.max_record_size() == 28);
+
+    const std::uint8_t record[28] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14 };
+    std::vector<std::uint8_t> out;
+
+    REQUIRE_FALSE(ring.push(record, 29));
+    REQUIRE(ring.push(record, 10));
+    REQUIRE(ring.push(record + 3, 6));
+    REQUIRE_FALSE(ring.push(record, 9));
+
+    REQUIRE(ring.pop(out));
+    REQUIRE(out == std::vector<std::uint8_t>(record, record + 10));
+
+    // Goes over the end of the storage, the length included
+    REQUIRE(ring.push(record, 12));
+
+    REQUIRE(ring.pop(out));
+    REQUIRE(out == std::vector<std::uint8_t>(record + 3, record + 9));
+
+    REQUIRE(ring.pop(out));
+    REQUIRE(out == std::vector<std::uint8_t>(record, record + 12));
+
+    REQUIRE(ring.empty());
+    REQUIRE_FALSE(ring.pop(out));
+
+    // Empty records are records too
+    REQUIRE(ring.push(record, 0));
+    REQUIRE(ring.push(record, 5));
+    ring.clear();
+
+    REQUIRE(ring.empty());
+    REQUIRE(ring.push(record, 28));
+    REQUIRE(ring.pop(out));
+    REQUIRE(out.size() == 28);
+}
+
+static std::uint8_t byte_ring_test_byte(const std::uint32_t record, const std::size_t index) {
+    return static_cast<std::uint8_t>(record * 31 + index * 7);
+}
+
+TEST_CASE("spsc_byte_ring_threaded_no_loss_no_allocation", "spsc_byte_ring") {
+    static constexpr std::uint32_t TOTAL = 200000;
+    static constexpr std::size_t MAX_RECORD_SIZE = 700;
+
+    common::spsc_byte_ring ring(4096);
+    std::atomic<bool> go(false);
+
+    std::vector<std::uint8_t> out;
+    out.reserve(MAX_RECORD_SIZE);
+
+    std::thread producer([&]() {
+        std::uint8_t record[MAX_RECORD_SIZE];
+
+        while (!go.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+
+        for (std::uint32_t i = 0; i < TOTAL; i++) {
+            // Odd sizes, so records land everywhere across the end of the storage
+            const std::size_t size = (i * 97) % (MAX_RECORD_SIZE + 1);
+
+            for (std::size_t j = 0; j < size; j++) {
+                record[j] = byte_ring_test_byte(i, j);
+            }
+
+            while (!ring.push(record, size)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    // Popping must reuse the destination storage, never reallocate it
+    const std::size_t out_capacity = out.capacity();
+    const std::uint8_t *out_data = out.data();
+
+    go.store(true, std::memory_order_release);
+
+    std::uint32_t popped = 0;
+    std::uint64_t bytes = 0;
+    bool intact = true;
+    bool stable_storage = true;
+
+    while (popped < TOTAL) {
+        if (!ring.pop(out)) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        intact = intact && (out.size() == (popped * 97) % (MAX_RECORD_SIZE + 1));
+
+        for (std::size_t j = 0; intact && (j < out.size()); j++) {
+            intact = (out[j] == byte_ring_test_byte(popped, j));
+        }
+
+        stable_storage = stable_storage && (out.capacity() == out_capacity) && (out.data() == out_data);
+
+        bytes += out.size();
+        popped++;
+    }
+
+    producer.join();
+
+    INFO(bytes << " bytes in " << popped << " records");
+    REQUIRE(intact);
+    REQUIRE(ring.empty());
+    REQUIRE(stable_storage);
+}
@@ -0,0 +1,310 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <drivers/audio/audio.h>
+#include <drivers/audio/backend/dsp_shared.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace eka2l1;
+
+struct null_audio_output_stream : public drivers::audio_output_stream {
+    bool playing_ = false;
+
+    bool start() override {
+        playing_ = true;
+        return true;
+    }
+
+    bool stop() override {
+        playing_ = false;
+        return true;
+    }
+
+    bool is_playing() override {
+        return playing_;
+    }
+
+    bool set_volume(const float volume) override {
+        return true;
+    }
+};
+
+// The host side is pulled by the test itself, through the stream's data callback
+struct null_audio_driver : public drivers::audio_driver {
+    std::unique_ptr<drivers::audio_output_stream> new_output_stream(const std::uint32_t sample_rate,
+        const std::uint8_t channels, drivers::data_callback callback) override {
+        return std::make_unique<null_audio_output_stream>();
+    }
+
+    std::uint32_t native_sample_rate() override {
+        return 44100;
+    }
+};
+
+static constexpr drivers::four_cc TEST_CODEC_FOUR_CC_CODE = drivers::make_four_cc(' ', 'T', 'S', 'T');
+
+// Codec for the tests: every encoded byte becomes one frame, each channel holding the byte times 4
+struct test_dsp_output_stream : public drivers::dsp_output_stream_shared {
+    std::atomic<int> decode_count_;
+    std::atomic<int> copied_count_;
+
+    explicit test_dsp_output_stream(drivers::audio_driver *aud)
+        : drivers::dsp_output_stream_shared(aud)
+        , decode_count_(0)
+        , copied_count_(0) {
+        register_callback(
+            drivers::dsp_stream_notification_buffer_copied, [this](void *userdata) { copied_count_++; }, nullptr);
+    }
+
+    ~test_dsp_output_stream() override {
+        stop_decoder();
+    }
+
+    void get_supported_formats(std::vector<drivers::four_cc> &cc_list) override {
+        cc_list.push_back(drivers::PCM8_FOUR_CC_CODE);
+        cc_list.push_back(drivers::PCM16_FOUR_CC_CODE);
+        cc_list.push_back(TEST_CODEC_FOUR_CC_CODE);
+    }
+
+    void decode_data(drivers::dsp_buffer &original, std::vector<std::uint8_t> &dest) override {
+        decode_count_++;
+        dest.resize(original.size() * channels_ * sizeof(std::int16_t));
+
+        std::int16_t *target = reinterpret_cast<std::int16_t *>(dest.data());
+
+        for (std::size_t i = 0; i < original.size(); i++) {
+            for (std::uint32_t c = 0; c < channels_; c++) {
+                *target++ = static_cast<std::int16_t>(original[i] * 4);
+            }
+        }
+    }
+
+    // Pull from the callback until the given number of samples really got played
+    std::vector<std::int16_t> pull(const std::size_t sample_count, const std::size_t frames_per_callback = 256) {
+        std::vector<std::int16_t> result;
+        std::vector<std::int16_t> buffer(frames_per_callback * channels_);
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+        while ((result.size() < sample_count) && (std::chrono::steady_clock::now() < deadline)) {
+            // Never ask for more than what is wanted, so nothing gets played past it
+            const std::size_t frames_wanted = std::min<std::size_t>(frames_per_callback, (sample_count - result.size()) / channels_);
+            const std::size_t played_before = samples_played();
+
+            data_callback(buffer.data(), frames_wanted);
+
+            const std::size_t played = samples_played() - played_before;
+
+            if (played == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            result.insert(result.end(), buffer.begin(), buffer.begin() + played);
+        }
+
+        return result;
+    }
+
+    void wait_copied(const int count) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+        while ((copied_count_ < count) && (std::chrono::steady_clock::now() < deadline)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+};
+
+TEST_CASE("dsp_pcm_ring_wraps_and_discards", "dsp") {
+    drivers::dsp_pcm_ring ring;
+    ring.resize(8);
+
+    const std::int16_t source[6] = { 1, 2, 3, 4, 5, 6 };
+    std::int16_t dest[8] = {};
+
+    REQUIRE(ring.push(source, 6) == 6);
+    REQUIRE(ring.pop(dest, 4) == 4);
+
+    // Goes over the end of the ring, and only as much as there is room for
+    REQUIRE(ring.push(source, 6) == 6);
+    REQUIRE(ring.push(source, 6) == 0);
+
+    REQUIRE(ring.pop(dest, 8) == 8);
+    REQUIRE(dest[0] == 5);
+    REQUIRE(dest[1] == 6);
+    REQUIRE(dest[2] == 1);
+    REQUIRE(dest[7] == 6);
+
+    REQUIRE(ring.push(source, 4) == 4);
+    ring.discard();
+
+    REQUIRE(ring.pop(dest, 8) == 0);
+    REQUIRE(ring.push(source, 8) == 8);
+}
+
+TEST_CASE("dsp_stream_pcm8_takes_direct_path", "dsp") {
+    null_audio_driver driver;
+    test_dsp_output_stream stream(&driver);
+
+    REQUIRE(stream.set_properties(8000, 2));
+    REQUIRE(stream.format(drivers::PCM8_FOUR_CC_CODE));
+    REQUIRE(stream.start());
+
+    // More than the ring can hold, so the decoder has to wait for the callback
+    static constexpr std::size_t CHUNK_SIZE = 1000;
+    static constexpr int CHUNK_COUNT = 8;
+
+    std::vector<std::uint8_t> source(CHUNK_SIZE * CHUNK_COUNT);
+
+    for (std::size_t i = 0; i < source.size(); i++) {
+        source[i] = static_cast<std::uint8_t>(i * 7);
+    }
+
+    for (int i = 0; i < CHUNK_COUNT; i++) {
+        REQUIRE(stream.write(source.data() + i * CHUNK_SIZE, CHUNK_SIZE));
+    }
+
+    const std::vector<std::int16_t> played = stream.pull(source.size());
+    REQUIRE(played.size() == source.size());
+
+    for (std::size_t i = 0; i < source.size(); i++) {
+        REQUIRE(played[i] == static_cast<std::int8_t>(source[i]) * 256);
+    }
+
+    stream.wait_copied(CHUNK_COUNT);
+
+    REQUIRE(stream.copied_count_ == CHUNK_COUNT);
+    REQUIRE(stream.samples_copied() == source.size());
+    REQUIRE(stream.decode_count_ == 0);
+}
+
+TEST_CASE("dsp_stream_decodes_on_worker", "dsp") {
+    null_audio_driver driver;
+    test_dsp_output_stream stream(&driver);
+
+    REQUIRE(stream.set_properties(8000, 2));
+    REQUIRE(stream.format(TEST_CODEC_FOUR_CC_CODE));
+    REQUIRE(stream.start());
+
+    const std::uint8_t encoded[5] = { 1, 2, 3, 4, 5 };
+    REQUIRE(stream.write(encoded, sizeof(encoded)));
+
+    stream.wait_copied(1);
+    REQUIRE(stream.decode_count_ == 1);
+
+    // Decoded before the host asked for anything
+    const std::vector<std::int16_t> expected = { 4, 4, 8, 8, 12, 12, 16, 16, 20, 20 };
+    REQUIRE(stream.pull(10) == expected);
+
+    // Nothing left, the callback keeps repeating the last frame
+    std::int16_t buffer[4] = {};
+    stream.data_callback(buffer, 2);
+
+    REQUIRE(stream.samples_played() == 10);
+    REQUIRE(buffer[2] == 20);
+}
+
+TEST_CASE("dsp_stream_stop_discards_decoded", "dsp") {
+    null_audio_driver driver;
+    test_dsp_output_stream stream(&driver);
+
+    REQUIRE(stream.set_properties(8000, 1));
+    REQUIRE(stream.format(drivers::PCM16_FOUR_CC_CODE));
+    REQUIRE(stream.start());
+
+    // A second of audio, ten times what the ring holds
+    std::vector<std::int16_t> source(8000, 100);
+    REQUIRE(stream.write(reinterpret_cast<const std::uint8_t *>(source.data()),
+        static_cast<std::uint32_t>(source.size() * sizeof(std::int16_t))));
+
+    REQUIRE(stream.pull(100).size() == 100);
+    REQUIRE(stream.stop());
+
+    std::int16_t buffer[256];
+    stream.data_callback(buffer, 256);
+
+    REQUIRE(stream.samples_played() == 100);
+}
+
+TEST_CASE("dsp_stream_decode_cost_benchmark", "[.][dsp]") {
+    static constexpr std::uint32_t SAMPLE_RATE = 44100;
+    static constexpr std::uint32_t SECOND_COUNT = 20;
+    static constexpr std::size_t CHUNK_SIZE = 4096;
+    static constexpr std::size_t FRAMES_PER_CALLBACK = 512;
+
+    auto run = [](const drivers::four_cc format, const char *name) {
+        null_audio_driver driver;
+        test_dsp_output_stream stream(&driver);
+
+        REQUIRE(stream.set_properties(SAMPLE_RATE, 2));
+        REQUIRE(stream.format(format));
+        REQUIRE(stream.start());
+
+        // PCM8 carries one sample per byte, the test codec one frame per byte
+        const std::size_t sample_count = SAMPLE_RATE * SECOND_COUNT * 2;
+        const std::size_t encoded_size = (format == drivers::PCM8_FOUR_CC_CODE) ? sample_count : sample_count / 2;
+
+        std::vector<std::uint8_t> chunk(CHUNK_SIZE, 0x40);
+
+        std::vector<std::int16_t> buffer(FRAMES_PER_CALLBACK * 2);
+        std::size_t played = 0;
+        std::int64_t worst_callback_ns = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+
+        std::thread guest([&]() {
+            for (std::size_t written = 0; written < encoded_size; written += CHUNK_SIZE) {
+                stream.write(chunk.data(), static_cast<std::uint32_t>(std::min(CHUNK_SIZE, encoded_size - written)));
+            }
+        });
+
+        while (played < sample_count) {
+            const std::size_t played_before = stream.samples_played();
+            const auto callback_start = std::chrono::steady_clock::now();
+
+            stream.data_callback(buffer.data(), FRAMES_PER_CALLBACK);
+
+            worst_callback_ns = std::max<std::int64_t>(worst_callback_ns,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - callback_start).count());
+
+            if (stream.samples_played() == played_before) {
+                std::this_thread::yield();
+            }
+
+            played = stream.samples_played();
+        }
+
+        guest.join();
+
+        const auto total = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        WARN(name << ": " << total.count() / SECOND_COUNT << " us per second of " << SAMPLE_RATE
+                  << " Hz stereo audio, worst callback " << worst_callback_ns << " ns");
+    };
+
+    run(drivers::PCM8_FOUR_CC_CODE, "PCM8");
+    run(TEST_CODEC_FOUR_CC_CODE, "Decoder");
+}
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <config/config.h>
+#include <kernel/ipc_hook.h>
+#include <kernel/kernel.h>
+#include <kernel/server.h>
+#include <kernel/session.h>
+#include <services/context.h>
+#include <system/epoc.h>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+using namespace eka2l1;
+
+static constexpr int IPC_TEST_RECORD_OPCODE = 1;
+
+class ipc_test_server : public service::server {
+    void record(service::ipc_context &ctx) {
+        functions_seen.push_back(*ctx.get_argument_value<std::int32_t>(0));
+        ctx.complete(0);
+    }
+
+public:
+    std::vector<std::int32_t> functions_seen;
+
+    explicit ipc_test_server(eka2l1::system *sys)
+        : service::server(sys->get_kernel_system(), sys, "IpcTestServer", true) {
+        REGISTER_IPC(ipc_test_server, record, IPC_TEST_RECORD_OPCODE, "IpcTest::Record");
+    }
+};
+
+struct ipc_test_environment {
+    config::state conf_;
+    std::unique_ptr<eka2l1::system> sys_;
+
+    kernel_system *kern_;
+    ipc_test_server *server_;
+
+    explicit ipc_test_environment() {
+        system_create_components comp;
+        comp.conf_ = &conf_;
+
+        sys_ = std::make_unique<eka2l1::system>(comp);
+        sys_->startup();
+
+        kern_ = sys_->get_kernel_system();
+
+        std::unique_ptr<service::server> svr = std::make_unique<ipc_test_server>(sys_.get());
+        server_ = reinterpret_cast<ipc_test_server *>(svr.get());
+
+        kern_->add_custom_server(svr);
+    }
+
+    service::session *create_session(const int async_slot_count) {
+        return kern_->create<service::session>(reinterpret_cast<server_ptr>(server_), async_slot_count);
+    }
+};
+
+static int send_record(service::session *ss, const std::int32_t value) {
+    return ss->send_receive(IPC_TEST_RECORD_OPCODE, eka2l1::ipc_arg(value, 0), 0);
+}
+
+TEST_CASE("ipc_session_slots_exhaust_and_reuse", "ipc") {
+    ipc_test_environment env;
+    service::session *ss = env.create_session(2);
+
+    REQUIRE(send_record(ss, 1) == 0);
+    REQUIRE(send_record(ss, 2) == 0);
+
+    // Both slots are delivered but not yet received
+    REQUIRE(send_record(ss, 3) == -1);
+
+    env.server_->process_accepted_msg();
+    REQUIRE(send_record(ss, 3) == 0);
+    REQUIRE(send_record(ss, 4) == -1);
+
+    env.server_->process_accepted_msg();
+    env.server_->process_accepted_msg();
+    env.server_->process_accepted_msg();
+
+    REQUIRE(env.server_->functions_seen == std::vector<std::int32_t>{ 1, 2, 3 });
+}
+
+TEST_CASE("ipc_server_receives_in_delivery_order", "ipc") {
+    ipc_test_environment env;
+    service::session *first = env.create_session(4);
+    service::session *second = env.create_session(4);
+
+    REQUIRE(send_record(first, 10) == 0);
+    REQUIRE(send_record(second, 20) == 0);
+    REQUIRE(send_record(first, 11) == 0);
+    REQUIRE(send_record(second, 21) == 0);
+
+    for (int i = 0; i < 4; i++) {
+        env.server_->process_accepted_msg();
+    }
+
+    REQUIRE(env.server_->functions_seen == std::vector<std::int32_t>{ 10, 20, 11, 21 });
+}
+
+TEST_CASE("ipc_round_trip_benchmark", "[.][ipc]") {
+    static constexpr int ROUND_TRIP_COUNT = 1000000;
+    static constexpr int SLOT_COUNT = 16;
+
+    ipc_test_environment env;
+    service::session *ss = env.create_session(SLOT_COUNT);
+
+    env.server_->functions_seen.reserve(ROUND_TRIP_COUNT);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // Keep all slots busy, like a window server client batching async requests
+    for (int i = 0; i < ROUND_TRIP_COUNT; i += SLOT_COUNT) {
+        for (int j = 0; j < SLOT_COUNT; j++) {
+            send_record(ss, i + j);
+        }
+
+        for (int j = 0; j < SLOT_COUNT; j++) {
+            env.server_->process_accepted_msg();
+        }
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    REQUIRE(env.server_->functions_seen.size() == ROUND_TRIP_COUNT);
+    WARN(ROUND_TRIP_COUNT << " IPC round trips with " << SLOT_COUNT << " slots: " << elapsed.count() << " us");
+}
+
+TEST_CASE("ipc_hook_filter_interns_and_matches", "ipc") {
+    kernel::ipc_hook_filter filter;
+
+    const std::uint32_t first_id = filter.intern("FirstServer");
+    const std::uint32_t second_id = filter.intern("SecondServer");
+
+    REQUIRE(first_id != second_id);
+    REQUIRE(filter.intern("FirstServer") == first_id);
+
+    REQUIRE_FALSE(filter.is_active(kernel::ipc_hook_point_send));
+    REQUIRE_FALSE(filter.is_hooked(first_id, 5, kernel::ipc_hook_point_send));
+
+    // Subscribing before the server exists gives it its ID
+    filter.subscribe("LaterServer", 5, kernel::ipc_hook_point_send);
+    filter.subscribe("FirstServer", 0x1000, kernel::ipc_hook_point_complete);
+
+    const std::uint32_t later_id = filter.intern("LaterServer");
+
+    REQUIRE(filter.is_active(kernel::ipc_hook_point_send));
+    REQUIRE(filter.is_hooked(later_id, 5, kernel::ipc_hook_point_send));
+    REQUIRE_FALSE(filter.is_hooked(later_id, 6, kernel::ipc_hook_point_send));
+    REQUIRE_FALSE(filter.is_hooked(later_id, 5, kernel::ipc_hook_point_complete));
+    REQUIRE_FALSE(filter.is_hooked(second_id, 5, kernel::ipc_hook_point_send));
+
+    // Opcodes past the bitmap are tracked per server, not per opcode
+    REQUIRE(filter.is_hooked(first_id, 0x1000, kernel::ipc_hook_point_complete));
+    REQUIRE(filter.is_hooked(first_id, -1, kernel::ipc_hook_point_complete));
+    REQUIRE_FALSE(filter.is_hooked(first_id, 5, kernel::ipc_hook_point_complete));
+}
+
+TEST_CASE("ipc_send_callbacks_only_see_subscribed_messages", "ipc") {
+    ipc_test_environment env;
+    std::vector<int> hooked_opcodes;
+
+    const std::size_t handle = env.kern_->register_ipc_send_callback([&](service::server *svr, const int ord, const ipc_arg &args,
+                                                                          address reqsts_addr, kernel::thread *callee) {
+        REQUIRE(svr == env.server_);
+        hooked_opcodes.push_back(ord);
+    });
+
+    const ipc_arg arg(0, 0);
+
+    env.kern_->call_ipc_send_callbacks(env.server_, IPC_TEST_RECORD_OPCODE, arg, 0, nullptr);
+    env.kern_->get_ipc_hooks().subscribe("IpcTestServer", IPC_TEST_RECORD_OPCODE, kernel::ipc_hook_point_send);
+
+    env.kern_->call_ipc_send_callbacks(env.server_, IPC_TEST_RECORD_OPCODE, arg, 0, nullptr);
+    env.kern_->call_ipc_send_callbacks(env.server_, IPC_TEST_RECORD_OPCODE + 1, arg, 0, nullptr);
+
+    REQUIRE(hooked_opcodes == std::vector<int>{ IPC_TEST_RECORD_OPCODE });
+    REQUIRE(env.kern_->unregister_ipc_send_callback(handle));
+}
+
+TEST_CASE("ipc_idle_hooks_benchmark", "[.][ipc]") {
+    static constexpr int ROUND_TRIP_COUNT = 1000000;
+    static constexpr int SLOT_COUNT = 16;
+
+    auto run = [](const bool with_idle_hooks) {
+        ipc_test_environment env;
+        service::session *ss = env.create_session(SLOT_COUNT);
+
+        std::size_t hook_calls = 0;
+
+        if (with_idle_hooks) {
+            // Like a loaded script hooking some other server's messages
+            env.kern_->register_ipc_send_callback([&](service::server *svr, const int ord, const ipc_arg &args,
+                                                      address reqsts_addr, kernel::thread *callee) { hook_calls++; });
+
+            env.kern_->get_ipc_hooks().subscribe("!AppListServer", 1, kernel::ipc_hook_point_send);
+        }
+
+        env.server_->functions_seen.reserve(ROUND_TRIP_COUNT);
+        const auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < ROUND_TRIP_COUNT; i += SLOT_COUNT) {
+            for (int j = 0; j < SLOT_COUNT; j++) {
+                // What the send system call does before delivering
+                env.kern_->call_ipc_send_callbacks(env.server_, IPC_TEST_RECORD_OPCODE, eka2l1::ipc_arg(i + j, 0), 0, nullptr);
+                send_record(ss, i + j);
+            }
+
+            for (int j = 0; j < SLOT_COUNT; j++) {
+                env.server_->process_accepted_msg();
+            }
+        }
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        REQUIRE(hook_calls == 0);
+        REQUIRE(env.server_->functions_seen.size() == ROUND_TRIP_COUNT);
+
+        return elapsed;
+    };
+
+    const auto no_hook_time = run(false);
+    const auto idle_hook_time = run(true);
+
+    WARN(ROUND_TRIP_COUNT << " IPC round trips: no hooks " << no_hook_time.count() << " us, hooks on other servers "
+                          << idle_hook_time.count() << " us");
+}
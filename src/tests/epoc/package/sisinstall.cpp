@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <config/config.h>
+#include <loader/sis_fields.h>
+#include <package/manager.h>
+#include <package/sis_script_interpreter.h>
+#include <vfs/vfs.h>
+
+#include "testdrive.h"
+
+#include <common/buffer.h>
+#include <common/cvt.h>
+#include <common/path.h>
+
+#include <miniz.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace eka2l1;
+
+static constexpr std::uint32_t SIS_INSTALL_TEST_UID = 0xE0001234;
+
+// The package registry is kept next to the drive, so the whole folder starts from scratch
+static std::string clear_sis_install_folder(const std::string &folder) {
+    std::filesystem::remove_all(folder);
+    return eka2l1::add_path(folder, "drive/");
+}
+
+struct sis_install_test_environment {
+    config::state conf_;
+    io_system io_;
+    test_drive_guard drive_;
+    std::unique_ptr<manager::packages> packages_;
+
+    std::string drive_dir_;
+
+    explicit sis_install_test_environment(const std::string &folder)
+        : drive_(io_, clear_sis_install_folder(folder))
+        , drive_dir_(drive_.host_dir) {
+        conf_.storage = folder;
+
+        packages_ = std::make_unique<manager::packages>(&io_, &conf_);
+    }
+
+    std::vector<std::uint8_t> read_installed(const std::string &name) {
+        std::ifstream stream(eka2l1::add_path(drive_dir_, "data/sisinstall/" + name), std::ios::binary);
+        return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+};
+
+// A SIS reduced to what the install script reads: a controller listing the files, the data units
+// describing them, and a file holding their deflated data
+struct sis_install_test_package {
+    std::string sis_path_;
+
+    loader::sis_controller controller_;
+    loader::sis_data data_;
+
+    std::vector<std::vector<std::uint8_t>> contents_;
+
+    explicit sis_install_test_package(const std::string &sis_path)
+        : sis_path_(sis_path) {
+        auto lang = std::make_shared<loader::sis_language>();
+        lang->language = loader::sis_lang::en;
+
+        controller_.langs.langs.fields.push_back(lang);
+        controller_.info.uid.uid = SIS_INSTALL_TEST_UID;
+        controller_.idx.data_index = 0;
+
+        data_.data_units.fields.push_back(std::make_shared<loader::sis_data_unit>());
+    }
+
+    void add_file(std::vector<std::uint8_t> content) {
+        const std::uint32_t idx = static_cast<std::uint32_t>(contents_.size());
+
+        auto file_des = std::make_shared<loader::sis_file_des>();
+        file_des->target.unicode_string = u"!:\\data\\sisinstall\\file" + common::utf8_to_ucs2(std::to_string(idx)) + u".bin";
+        file_des->op = loader::ss_op::EOpInstall;
+        file_des->idx = idx;
+
+        controller_.install_block.files.fields.push_back(file_des);
+        contents_.push_back(std::move(content));
+    }
+
+    void write() {
+        std::ofstream stream(sis_path_, std::ios::binary);
+        auto data_unit = reinterpret_cast<loader::sis_data_unit *>(data_.data_units.fields[0].get());
+
+        std::uint64_t offset = 0;
+
+        for (const std::vector<std::uint8_t> &content : contents_) {
+            mz_ulong compressed_size = mz_compressBound(static_cast<mz_ulong>(content.size()));
+            std::vector<std::uint8_t> compressed(compressed_size);
+
+            REQUIRE(mz_compress(compressed.data(), &compressed_size, content.data(), static_cast<mz_ulong>(content.size())) == MZ_OK);
+            stream.write(reinterpret_cast<const char *>(compressed.data()), compressed_size);
+
+            auto file_data = std::make_shared<loader::sis_file_data>();
+            file_data->raw_data.algorithm = loader::sis_compressed_algorithm::deflated;
+            file_data->raw_data.uncompressed_size = content.size();
+            file_data->raw_data.offset = offset;
+
+            // The length includes the algorithm and uncompressed size fields
+            const std::uint64_t field_len = compressed_size + 12;
+            file_data->raw_data.len_low = static_cast<std::uint32_t>(field_len);
+            file_data->raw_data.len_high = static_cast<std::uint32_t>(field_len >> 32);
+
+            data_unit->data_unit.fields.push_back(file_data);
+            offset += compressed_size;
+        }
+    }
+
+    bool install(sis_install_test_environment &env, const bool use_workers) {
+        common::ro_std_file_stream stream(sis_path_, true);
+        loader::ss_interpreter interpreter(&stream, &env.io_, env.packages_.get(), &controller_, &data_, drive_c,
+            use_workers ? sis_path_ : "");
+
+        std::atomic<int> progress(0);
+        return interpreter.interpret(progress);
+    }
+};
+
+static std::vector<std::uint8_t> make_compressible_content(std::mt19937 &rng, const std::size_t size) {
+    std::vector<std::uint8_t> content(size);
+    std::uniform_int_distribution<int> dist(0, 15);
+
+    for (std::uint8_t &b : content) {
+        b = static_cast<std::uint8_t>(dist(rng));
+    }
+
+    return content;
+}
+
+TEST_CASE("sis_install_extracts_on_workers", "sis_install") {
+    sis_install_test_environment env("sisinstalltest");
+    sis_install_test_package pkg("sisinstalltest/test.sis");
+
+    std::mt19937 rng(42);
+
+    for (int i = 0; i < 12; i++) {
+        pkg.add_file(make_compressible_content(rng, 0x1000 * (i + 1) + i));
+    }
+
+    // Inflates to much more than one chunk of output per chunk of input
+    pkg.add_file(std::vector<std::uint8_t>(0x200000, 0));
+    pkg.write();
+
+    REQUIRE(pkg.install(env, true));
+
+    for (std::size_t i = 0; i < pkg.contents_.size(); i++) {
+        REQUIRE(env.read_installed("file" + std::to_string(i) + ".bin") == pkg.contents_[i]);
+    }
+}
+
+TEST_CASE("sis_install_same_result_without_workers", "sis_install") {
+    sis_install_test_environment env("sisinstallserialtest");
+    sis_install_test_package pkg("sisinstallserialtest/test.sis");
+
+    std::mt19937 rng(7);
+
+    for (int i = 0; i < 4; i++) {
+        pkg.add_file(make_compressible_content(rng, 0x3000 + i));
+    }
+
+    pkg.add_file(std::vector<std::uint8_t>(0x100000, 0xAB));
+    pkg.write();
+
+    REQUIRE(pkg.install(env, false));
+
+    for (std::size_t i = 0; i < pkg.contents_.size(); i++) {
+        REQUIRE(env.read_installed("file" + std::to_string(i) + ".bin") == pkg.contents_[i]);
+    }
+}
+
+TEST_CASE("sis_install_benchmark", "[.][sis_install]") {
+    static constexpr int FILE_COUNT = 48;
+    static constexpr std::size_t FILE_SIZE = 4 * 1024 * 1024;
+
+    sis_install_test_environment env("sisinstallbench");
+    sis_install_test_package pkg("sisinstallbench/bench.sis");
+
+    std::mt19937 rng(1234);
+
+    for (int i = 0; i < FILE_COUNT; i++) {
+        pkg.add_file(make_compressible_content(rng, FILE_SIZE));
+    }
+
+    pkg.write();
+
+    auto start = std::chrono::steady_clock::now();
+    REQUIRE(pkg.install(env, false));
+
+    const auto serial_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    start = std::chrono::steady_clock::now();
+    REQUIRE(pkg.install(env, true));
+
+    const auto pool_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    REQUIRE(env.read_installed("file0.bin") == pkg.contents_[0]);
+    WARN("Install of " << FILE_COUNT << " files of " << FILE_SIZE << " bytes: one after another " << serial_time.count()
+                       << " ms, on workers " << pool_time.count() << " ms");
+}
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <catch2/catch.hpp>
+#include <config/config.h>
+#include <kernel/kernel.h>
+#include <kernel/property.h>
+#include <system/epoc.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace eka2l1;
+
+// Far from the categories services define at startup
+static constexpr int PROPERTY_TEST_CATEGORY_BASE = 0x7E000000;
+
+struct property_test_environment {
+    config::state conf_;
+    std::unique_ptr<eka2l1::system> sys_;
+
+    kernel_system *kern_;
+
+    explicit property_test_environment() {
+        system_create_components comp;
+        comp.conf_ = &conf_;
+
+        sys_ = std::make_unique<eka2l1::system>(comp);
+        sys_->startup();
+
+        kern_ = sys_->get_kernel_system();
+    }
+
+    property_ptr define_int(const int category, const int key, const int value) {
+        property_ptr prop = kern_->create<service::property>(category, key);
+        prop->define(service::property_type::int_data, 4);
+        prop->set_int(value);
+
+        return prop;
+    }
+};
+
+TEST_CASE("property_lookup_by_category_and_key", "property") {
+    property_test_environment env;
+
+    property_ptr first = env.define_int(PROPERTY_TEST_CATEGORY_BASE, 1, 10);
+    property_ptr second = env.define_int(PROPERTY_TEST_CATEGORY_BASE, 2, 20);
+    property_ptr other_category = env.define_int(PROPERTY_TEST_CATEGORY_BASE + 1, 1, 30);
+
+    REQUIRE(env.kern_->get_prop(PROPERTY_TEST_CATEGORY_BASE, 1) == first);
+    REQUIRE(env.kern_->get_prop(PROPERTY_TEST_CATEGORY_BASE, 2) == second);
+    REQUIRE(env.kern_->get_prop(PROPERTY_TEST_CATEGORY_BASE + 1, 1) == other_category);
+    REQUIRE_FALSE(env.kern_->get_prop(PROPERTY_TEST_CATEGORY_BASE, 3));
+
+    // Negative keys and categories are fine too
+    property_ptr negative = env.define_int(-1, -1, 40);
+    REQUIRE(env.kern_->get_prop(-1, -1) == negative);
+
+    REQUIRE(env.kern_->delete_prop(PROPERTY_TEST_CATEGORY_BASE, 1));
+    REQUIRE_FALSE(env.kern_->get_prop(PROPERTY_TEST_CATEGORY_BASE, 1));
+    REQUIRE_FALSE(env.kern_->delete_prop(PROPERTY_TEST_CATEGORY_BASE, 1));
+    REQUIRE(env.kern_->get_prop(PROPERTY_TEST_CATEGORY_BASE, 2) == second);
+}
+
+TEST_CASE("property_delete_keeps_attached_references", "property") {
+    property_test_environment env;
+
+    property_ptr prop = env.define_int(PROPERTY_TEST_CATEGORY_BASE, 1, 10);
+    property_ref_ptr attached = env.kern_->create<service::property_reference>(prop);
+
+    REQUIRE(env.kern_->delete_prop(PROPERTY_TEST_CATEGORY_BASE, 1));
+
+    // The attached handle still reaches the object, which is no longer defined
+    REQUIRE(attached->get_property_object() == prop);
+    REQUIRE_FALSE(prop->is_defined());
+    REQUIRE(prop->get_int() == -1);
+
+    // Defining again gives a fresh property, the deleted one stays undefined
+    property_ptr redefined = env.define_int(PROPERTY_TEST_CATEGORY_BASE, 1, 20);
+
+    REQUIRE(redefined != prop);
+    REQUIRE(env.kern_->get_prop(PROPERTY_TEST_CATEGORY_BASE, 1) == redefined);
+    REQUIRE_FALSE(attached->get_property_object()->is_defined());
+}
+
+TEST_CASE("property_duplicate_takes_over_on_destroy", "property") {
+    property_test_environment env;
+
+    property_ptr first = env.define_int(PROPERTY_TEST_CATEGORY_BASE, 1, 10);
+    property_ptr duplicate = env.define_int(PROPERTY_TEST_CATEGORY_BASE, 1, 20);
+
+    REQUIRE(env.kern_->get_prop(PROPERTY_TEST_CATEGORY_BASE, 1) == first);
+
+    env.kern_->destroy(first);
+    REQUIRE(env.kern_->get_prop(PROPERTY_TEST_CATEGORY_BASE, 1) == duplicate);
+}
+
+TEST_CASE("property_read_bin_truncates", "property") {
+    property_test_environment env;
+
+    property_ptr prop = env.kern_->create<service::property>(PROPERTY_TEST_CATEGORY_BASE, 1);
+    prop->define(service::property_type::bin_data, 16);
+
+    std::vector<std::uint8_t> data = { 1, 2, 3, 4, 5, 6 };
+    prop->set(data.data(), static_cast<std::uint32_t>(data.size()));
+
+    std::vector<std::uint8_t> whole(8, 0);
+    REQUIRE(prop->read_bin(whole.data(), static_cast<std::uint32_t>(whole.size())) == 6);
+    REQUIRE(std::equal(data.begin(), data.end(), whole.begin()));
+
+    std::vector<std::uint8_t> small(4, 0);
+    std::vector<std::uint8_t> expected_small = { 1, 2, 3, 4 };
+
+    REQUIRE(prop->read_bin(small.data(), static_cast<std::uint32_t>(small.size())) == 6);
+    REQUIRE(small == expected_small);
+}
+
+TEST_CASE("property_subscription_cancel_and_notify", "property") {
+    property_test_environment env;
+
+    property_ptr prop = env.define_int(PROPERTY_TEST_CATEGORY_BASE, 1, 0);
+    property_ref_ptr first = env.kern_->create<service::property_reference>(prop);
+    property_ref_ptr second = env.kern_->create<service::property_reference>(prop);
+
+    REQUIRE(first->subscribe(epoc::notify_info()));
+    REQUIRE(second->subscribe(epoc::notify_info()));
+
+    // Cancelling takes the subscription off the property
+    REQUIRE(first->cancel());
+    REQUIRE_FALSE(first->cancel());
+
+    // A notification consumes the rest
+    prop->set_int(1);
+    REQUIRE_FALSE(second->cancel());
+
+    // A reference dying while subscribed leaves nothing behind
+    REQUIRE(first->subscribe(epoc::notify_info()));
+    env.kern_->destroy(first);
+
+    prop->set_int(2);
+    REQUIRE(second->subscribe(epoc::notify_info()));
+    REQUIRE(second->cancel());
+}
+
+TEST_CASE("property_5k_benchmark", "[.][property]") {
+    static constexpr int PROPERTY_COUNT = 5000;
+    static constexpr int SUBSCRIBER_COUNT = 1000;
+    static constexpr int LOOKUP_COUNT = 200000;
+    static constexpr int NOTIFY_ROUND_COUNT = 200;
+
+    property_test_environment env;
+    std::vector<property_ptr> props;
+
+    for (int i = 0; i < PROPERTY_COUNT; i++) {
+        props.push_back(env.define_int(PROPERTY_TEST_CATEGORY_BASE + (i % 16), i, i));
+    }
+
+    std::mt19937 rng(4321);
+    std::uniform_int_distribution<int> key_dist(0, PROPERTY_COUNT - 1);
+
+    std::vector<int> keys(LOOKUP_COUNT);
+    std::generate(keys.begin(), keys.end(), [&]() { return key_dist(rng); });
+
+    std::size_t linear_found = 0;
+    std::size_t index_found = 0;
+
+    // The search the kernel did before the index, kept as reference
+    auto start = std::chrono::steady_clock::now();
+
+    for (const int key : keys) {
+        auto ite = std::find_if(props.begin(), props.end(), [&](property_ptr prop) {
+            return (prop->first == PROPERTY_TEST_CATEGORY_BASE + (key % 16)) && (prop->second == key);
+        });
+
+        linear_found += (ite != props.end());
+    }
+
+    const auto linear_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    start = std::chrono::steady_clock::now();
+
+    for (const int key : keys) {
+        property_ptr prop = env.kern_->get_prop(PROPERTY_TEST_CATEGORY_BASE + (key % 16), key);
+        index_found += (prop != nullptr);
+
+        prop->set_int(key);
+    }
+
+    const auto index_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    REQUIRE(linear_found == LOOKUP_COUNT);
+    REQUIRE(index_found == LOOKUP_COUNT);
+
+    // Subscribe everyone to a few hot properties, then notify and cancel in rounds
+    std::vector<property_ref_ptr> refs;
+
+    for (int i = 0; i < SUBSCRIBER_COUNT; i++) {
+        refs.push_back(env.kern_->create<service::property_reference>(props[i % 8]));
+    }
+
+    start = std::chrono::steady_clock::now();
+
+    for (int round = 0; round < NOTIFY_ROUND_COUNT; round++) {
+        for (property_ref_ptr ref : refs) {
+            ref->subscribe(epoc::notify_info());
+        }
+
+        // Half is cancelled, the other half is notified
+        for (int i = 0; i < SUBSCRIBER_COUNT; i += 2) {
+            REQUIRE(refs[i]->cancel());
+        }
+
+        for (int i = 0; i < 8; i++) {
+            props[i]->set_int(round);
+        }
+    }
+
+    const auto notify_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    WARN(LOOKUP_COUNT << " lookups over " << PROPERTY_COUNT << " properties: linear search " << linear_time.count()
+                      << " us, index with set " << index_time.count() << " us; " << NOTIFY_ROUND_COUNT << " rounds of "
+                      << SUBSCRIBER_COUNT << " subscribe, cancel and notify " << notify_time.count() << " us");
+}
@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/algorithm.h>
+#include <common/cvt.h>
+#include <common/path.h>
+#include <loader/rom.h>
+#include <vfs/rom_index.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace eka2l1;
+
+static void add_synthetic_files(loader::rom_dir &dir, const std::u16string &prefix, const std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+        loader::rom_entry entry;
+        entry.name = prefix + common::utf8_to_ucs2(std::to_string(i)) + u".dll";
+        entry.size = static_cast<std::uint32_t>(i * 16);
+        entry.address_lin = static_cast<std::uint32_t>(0x80000000 + i * 0x1000);
+        entry.attrib = 0;
+        entry.name_len = static_cast<std::uint8_t>(entry.name.length());
+
+        dir.entries.push_back(entry);
+    }
+
+    std::sort(dir.entries.begin(), dir.entries.end(), [](const loader::rom_entry &lhs, const loader::rom_entry &rhs) {
+        return common::compare_ignore_case(lhs.name, rhs.name) == -1;
+    });
+}
+
+static loader::rom_dir &add_synthetic_subdir(loader::rom_dir &dir, const std::u16string &name) {
+    loader::rom_dir subdir;
+    subdir.name = name;
+
+    dir.subdirs.push_back(subdir);
+    return dir.subdirs.back();
+}
+
+static void sort_subdirs(loader::rom_dir &dir) {
+    std::sort(dir.subdirs.begin(), dir.subdirs.end(), [](const loader::rom_dir &lhs, const loader::rom_dir &rhs) {
+        return common::compare_ignore_case(lhs.name, rhs.name) == -1;
+    });
+}
+
+// Roughly the shape of a S60v3 firmware: a big sys\bin, and many small resource and private folders
+static loader::rom_dir make_synthetic_rom_tree() {
+    loader::rom_dir root;
+
+    // References to subdirectories must stay valid while they are filled
+    root.subdirs.reserve(3);
+
+    loader::rom_dir &sys = add_synthetic_subdir(root, u"sys");
+    add_synthetic_files(add_synthetic_subdir(sys, u"bin"), u"Lib", 3000);
+
+    loader::rom_dir &resource = add_synthetic_subdir(root, u"resource");
+    add_synthetic_files(resource, u"Rsc", 400);
+
+    for (int i = 0; i < 200; i++) {
+        add_synthetic_files(add_synthetic_subdir(resource, u"Folder" + common::utf8_to_ucs2(std::to_string(i))), u"Item", 20);
+    }
+
+    loader::rom_dir &priv = add_synthetic_subdir(root, u"private");
+
+    for (int i = 0; i < 300; i++) {
+        add_synthetic_files(add_synthetic_subdir(priv, common::utf8_to_ucs2(std::to_string(0x10000000 + i))), u"Data", 5);
+    }
+
+    sort_subdirs(resource);
+    sort_subdirs(priv);
+    sort_subdirs(sys);
+    sort_subdirs(root);
+
+    return root;
+}
+
+// The lookup the ROM file system did before the index, kept as reference
+static const loader::rom_entry *reference_find_entry(const loader::rom_dir &root, const std::string &vir_path) {
+    auto ite = path_iterator(eka2l1::file_directory(vir_path, true));
+    const loader::rom_dir *last_dir_found = &root;
+
+    // Skip through the drive
+    ite++;
+
+    for (; ite; ite++) {
+        loader::rom_dir temp;
+        temp.name = common::utf8_to_ucs2(*ite);
+
+        auto res = std::lower_bound(last_dir_found->subdirs.begin(), last_dir_found->subdirs.end(), temp,
+            [](const loader::rom_dir &lhs, const loader::rom_dir &rhs) { return common::compare_ignore_case(lhs.name, rhs.name) == -1; });
+
+        if (res == last_dir_found->subdirs.end() || (common::compare_ignore_case(res->name, temp.name) != 0)) {
+            return nullptr;
+        }
+
+        last_dir_found = &(*res);
+    }
+
+    loader::rom_entry temp_entry;
+    temp_entry.name = common::utf8_to_ucs2(eka2l1::filename(vir_path, true));
+
+    auto res = std::lower_bound(last_dir_found->entries.begin(), last_dir_found->entries.end(), temp_entry,
+        [](const loader::rom_entry &lhs, const loader::rom_entry &rhs) { return common::compare_ignore_case(lhs.name, rhs.name) == -1; });
+
+    if (res != last_dir_found->entries.end() && !res->dir && (common::compare_ignore_case(temp_entry.name, res->name) == 0)) {
+        return &(*res);
+    }
+
+    return nullptr;
+}
+
+static std::vector<std::string> make_synthetic_queries(std::mt19937 &rng, const std::size_t count) {
+    std::vector<std::string> queries;
+    std::uniform_int_distribution<int> kind_dist(0, 3);
+    std::uniform_int_distribution<int> lib_dist(0, 3200);
+    std::uniform_int_distribution<int> folder_dist(0, 199);
+    std::uniform_int_distribution<int> item_dist(0, 21);
+
+    for (std::size_t i = 0; i < count; i++) {
+        switch (kind_dist(rng)) {
+        case 0:
+        case 1:
+            // Library loads dominate, some of them miss and fall back to other drives
+            queries.push_back("Z:\\sys\\bin\\LIB" + std::to_string(lib_dist(rng)) + ".DLL");
+            break;
+
+        case 2:
+            queries.push_back("z:\\Resource\\folder" + std::to_string(folder_dist(rng)) + "\\item" + std::to_string(item_dist(rng)) + ".dll");
+            break;
+
+        default:
+            queries.push_back("Z:\\private\\" + std::to_string(0x10000000 + folder_dist(rng)) + "\\Data1.dll");
+            break;
+        }
+    }
+
+    return queries;
+}
+
+TEST_CASE("rom_path_index_normalize", "rom_path_index") {
+    REQUIRE(rom_path_index::normalize(u"Z:\\Sys\\Bin\\EUser.DLL") == u"sys\\bin\\euser.dll");
+    REQUIRE(rom_path_index::normalize(u"z:/sys//bin/") == u"sys\\bin");
+    REQUIRE(rom_path_index::normalize(u"\\resource\\") == u"resource");
+    REQUIRE(rom_path_index::normalize(u"Z:\\").empty());
+}
+
+TEST_CASE("rom_path_index_finds_entries_and_dirs", "rom_path_index") {
+    loader::rom_dir root = make_synthetic_rom_tree();
+    rom_path_index index;
+    index.build(root);
+
+    const loader::rom_entry *entry = index.find_entry(u"Z:\\SYS\\BIN\\lib42.dll");
+    REQUIRE(entry);
+    REQUIRE(entry->name == u"Lib42.dll");
+
+    // Directories are not file entries, and files are not directories
+    REQUIRE_FALSE(index.find_entry(u"Z:\\sys\\bin"));
+    REQUIRE_FALSE(index.find_dir(u"Z:\\sys\\bin\\Lib42.dll"));
+    REQUIRE_FALSE(index.find_entry(u"Z:\\sys\\bin\\Lib3000.dll"));
+
+    const loader::rom_dir *dir = index.find_dir(u"Z:\\Resource\\FOLDER7\\");
+    REQUIRE(dir);
+    REQUIRE(dir->name == u"Folder7");
+    REQUIRE(dir->entries.size() == 20);
+
+    REQUIRE(index.find_dir(u"Z:\\") == &root);
+}
+
+TEST_CASE("rom_path_index_matches_tree_walk", "rom_path_index") {
+    loader::rom_dir root = make_synthetic_rom_tree();
+    rom_path_index index;
+    index.build(root);
+
+    std::mt19937 rng(1234);
+    const std::vector<std::string> queries = make_synthetic_queries(rng, 5000);
+
+    for (const std::string &query : queries) {
+        REQUIRE(index.find_entry(common::utf8_to_ucs2(query)) == reference_find_entry(root, query));
+    }
+}
+
+TEST_CASE("rom_path_index_benchmark", "[.][rom_path_index]") {
+    static constexpr std::size_t QUERY_COUNT = 200000;
+
+    loader::rom_dir root = make_synthetic_rom_tree();
+
+    auto start = std::chrono::steady_clock::now();
+
+    rom_path_index index;
+    index.build(root);
+
+    const auto build_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    std::mt19937 rng(5678);
+    const std::vector<std::string> queries = make_synthetic_queries(rng, QUERY_COUNT);
+
+    std::vector<std::u16string> queries_ucs2;
+    for (const std::string &query : queries) {
+        queries_ucs2.push_back(common::utf8_to_ucs2(query));
+    }
+
+    std::size_t reference_found = 0;
+    std::size_t index_found = 0;
+
+    // The file system used to receive UTF-8 paths, converted from the UCS-2 ones
+    start = std::chrono::steady_clock::now();
+
+    for (const std::u16string &query : queries_ucs2) {
+        reference_found += (reference_find_entry(root, common::ucs2_to_utf8(query)) != nullptr);
+    }
+
+    const auto reference_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    start = std::chrono::steady_clock::now();
+
+    for (const std::u16string &query : queries_ucs2) {
+        index_found += (index.find_entry(query) != nullptr);
+    }
+
+    const auto index_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    REQUIRE(reference_found == index_found);
+    WARN("Lookup of " << QUERY_COUNT << " paths over " << index.size() << " ROM nodes: tree walk "
+                      << reference_time.count() << " us, index " << index_time.count() << " us (built in "
+                      << build_time.count() << " us)");
+}
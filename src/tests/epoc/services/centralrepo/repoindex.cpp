@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2019 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project 
+ * (see bentokun.github.com/EKA2L1).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <services/centralrepo/cre.h>
+#include <services/centralrepo/repo.h>
+
+#include <common/chunkyseri.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+using namespace eka2l1;
+
+static void load_test_cre(central_repo &repo) {
+    std::ifstream fi("centralrepoassets/101f876f.cre", std::ios::binary | std::ios::ate);
+
+    std::vector<char> buf;
+    buf.resize(fi.tellg());
+
+    fi.seekg(0, std::ios::beg);
+    fi.read(&buf[0], buf.size());
+
+    common::chunkyseri seri(reinterpret_cast<std::uint8_t *>(&buf[0]), buf.size(), common::SERI_MODE_READ);
+    do_state_for_cre(seri, repo);
+}
+
+TEST_CASE("cre_entries_sorted_and_found", "centralrepo") {
+    central_repo repo;
+    load_test_cre(repo);
+
+    REQUIRE(repo.entries.size() == 19);
+    REQUIRE(std::is_sorted(repo.entries.begin(), repo.entries.end(), [](const central_repo_entry &lhs, const central_repo_entry &rhs) {
+        return lhs.key < rhs.key;
+    }));
+
+    for (const central_repo_entry &entry : repo.entries) {
+        central_repo_entry *found = repo.find_entry(entry.key);
+
+        REQUIRE(found);
+        REQUIRE(found->key == entry.key);
+    }
+
+    REQUIRE(!repo.find_entry(repo.entries.back().key + 1));
+}
+
+TEST_CASE("add_new_entry_keeps_order", "centralrepo") {
+    central_repo repo;
+    central_repo_entry_variant var;
+    var.etype = central_repo_entry_type::integer;
+    var.intd = 5;
+
+    REQUIRE(repo.add_new_entry(0x30, var, 0));
+    REQUIRE(repo.add_new_entry(0x10, var, 0));
+    REQUIRE(repo.add_new_entry(0x20, var, 0));
+    REQUIRE(!repo.add_new_entry(0x10, var, 0));
+
+    REQUIRE(repo.entries.size() == 3);
+    REQUIRE(repo.entries[0].key == 0x10);
+    REQUIRE(repo.entries[1].key == 0x20);
+    REQUIRE(repo.entries[2].key == 0x30);
+}
+
+TEST_CASE("query_entries_with_mask", "centralrepo") {
+    central_repo repo;
+    central_repo_entry_variant var;
+    var.etype = central_repo_entry_type::integer;
+    var.intd = 0;
+
+    repo.add_new_entry(0x02B30B11, var, 0);
+    repo.add_new_entry(0x07B10B52, var, 0);
+    repo.add_new_entry(0x07B20000, var, 0);
+    repo.add_new_entry(0x10000000, var, 0);
+
+    // Example from the documentation of query_entries
+    std::vector<central_repo_entry *> matched;
+    repo.query_entries(0x03B10000, 0xF0FF0000, matched, central_repo_entry_type::integer);
+
+    REQUIRE(matched.size() == 1);
+    REQUIRE(matched[0]->key == 0x07B10B52);
+
+    // Prefix mask
+    matched.clear();
+    repo.query_entries(0x07B00000, 0xFFF00000, matched, central_repo_entry_type::integer);
+
+    REQUIRE(matched.size() == 2);
+    REQUIRE(matched[0]->key == 0x07B10B52);
+    REQUIRE(matched[1]->key == 0x07B20000);
+
+    // Type must match too
+    matched.clear();
+    repo.query_entries(0x07B00000, 0xFFF00000, matched, central_repo_entry_type::real);
+
+    REQUIRE(matched.empty());
+}
+
+TEST_CASE("cre_lookup_benchmark", "[.][centralrepo]") {
+    static constexpr int LOOKUP_ROUNDS = 100000;
+
+    central_repo repo;
+    load_test_cre(repo);
+
+    std::uint32_t found_count = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < LOOKUP_ROUNDS; i++) {
+        for (const central_repo_entry &entry : repo.entries) {
+            found_count += (repo.find_entry(entry.key) != nullptr);
+        }
+    }
+
+    const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    WARN("Looked up " << found_count << " keys in " << duration.count() << "us");
+
+    REQUIRE(found_count == LOOKUP_ROUNDS * repo.entries.size());
+}
@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <services/fs/dircache.h>
+#include <services/fs/std.h>
+#include <vfs/vfs.h>
+
+#include "testdrive.h"
+
+#include <common/algorithm.h>
+#include <common/cvt.h>
+#include <common/path.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+
+using namespace eka2l1;
+
+static const char16_t *DIRCACHE_TEST_DIR = u"C:\\resource\\apps\\";
+
+struct dircache_test_drive {
+    io_system io_;
+    test_drive_guard drive_;
+    std::string host_dir_;
+
+    explicit dircache_test_drive(const std::string &drive_folder)
+        : drive_(io_, drive_folder) {
+        io_.create_directories(DIRCACHE_TEST_DIR);
+
+        host_dir_ = common::ucs2_to_utf8(*io_.get_raw_path(DIRCACHE_TEST_DIR));
+    }
+
+    void add_host_file(const std::string &name, const std::uint32_t uid3) {
+        std::ofstream stream(eka2l1::add_path(host_dir_, name), std::ios::binary);
+        const std::uint32_t uids[3] = { 0x10000037, 0x100039CE, uid3 };
+
+        stream.write(reinterpret_cast<const char *>(uids), sizeof(uids));
+    }
+
+    void fill(const std::uint32_t count) {
+        for (std::uint32_t i = 0; i < count; i++) {
+            add_host_file("app" + std::to_string(i) + ".rsc", 0x20000000 + i);
+        }
+    }
+
+    std::unique_ptr<directory> open(const std::u16string &path) {
+        return io_.open_dir(path, io_attrib_include_file | io_attrib_include_dir);
+    }
+};
+
+static std::size_t count_listed(const epoc::fs::packed_dir_listing &listing, const std::size_t buffer_size) {
+    std::vector<std::uint8_t> buffer(buffer_size);
+
+    std::size_t cursor = 0;
+    std::size_t written = 0;
+
+    while (const std::size_t copied = listing.copy_entries(cursor, buffer.data(), buffer.size(), written)) {
+        REQUIRE(written <= buffer.size());
+        cursor += copied;
+    }
+
+    return cursor;
+}
+
+TEST_CASE("packed_dir_listing_round_trip", "dircache") {
+    epoc::fs::packed_dir_listing listing(true);
+
+    for (int i = 0; i < 3; i++) {
+        epoc::fs::entry ent;
+        ent.attrib = 0x20;
+        ent.size = 100 + i;
+        ent.size_high = 0;
+        ent.reserved = 0;
+        ent.uid1 = ent.uid2 = 0;
+        ent.uid3 = 0x1000 + i;
+        ent.name = std::u16string(u"file") + static_cast<char16_t>(u'0' + i) + u".txt";
+
+        listing.add_entry(ent);
+    }
+
+    REQUIRE(listing.entry_count() == 3);
+
+    epoc::fs::entry ent;
+    listing.get_entry(2, ent);
+
+    REQUIRE(ent.size == 102);
+    REQUIRE(ent.uid3 == 0x1002);
+    REQUIRE(std::u16string(ent.name.data, ent.name.get_length()) == u"file2.txt");
+
+    // A buffer fitting only one entry at a time must still go through all of them
+    const std::size_t one_entry_size = listing.offsets_[1] + 4;
+    REQUIRE(count_listed(listing, one_entry_size) == 3);
+    REQUIRE(count_listed(listing, 4096) == 3);
+
+    std::size_t written = 0;
+    std::vector<std::uint8_t> small(one_entry_size - 1);
+
+    REQUIRE(listing.copy_entries(0, small.data(), small.size(), written) == 0);
+    REQUIRE(written == 0);
+}
+
+TEST_CASE("dir_listing_cache_hits_and_invalidates", "dircache") {
+    dircache_test_drive drive("dircachetest");
+    drive.fill(20);
+
+    epoc::fs::dir_listing_cache cache(&drive.io_);
+    const std::u16string search_path = std::u16string(DIRCACHE_TEST_DIR) + u"*.rsc";
+
+    auto first_dir = drive.open(search_path);
+    epoc::fs::packed_dir_listing_ptr first = cache.get_listing(search_path, io_attrib_include_file, first_dir.get(), true);
+
+    REQUIRE(first->entry_count() == 20);
+
+    auto second_dir = drive.open(search_path);
+    epoc::fs::packed_dir_listing_ptr second = cache.get_listing(search_path, io_attrib_include_file, second_dir.get(), true);
+
+    REQUIRE(second == first);
+
+    // The file server drops listings itself when it changes a directory
+    drive.add_host_file("new.rsc", 0x30000000);
+    cache.invalidate(std::u16string(DIRCACHE_TEST_DIR) + u"new.rsc");
+
+    auto third_dir = drive.open(search_path);
+    epoc::fs::packed_dir_listing_ptr third = cache.get_listing(search_path, io_attrib_include_file, third_dir.get(), true);
+
+    REQUIRE(third != first);
+    REQUIRE(third->entry_count() == 21);
+
+    // The old listing is still usable by handles that had it open
+    REQUIRE(first->entry_count() == 20);
+}
+
+static bool has_entry(const epoc::fs::packed_dir_listing &listing, const std::u16string &name) {
+    for (std::size_t i = 0; i < listing.entry_count(); i++) {
+        epoc::fs::entry ent;
+        listing.get_entry(i, ent);
+
+        if (std::u16string(ent.name.data, ent.name.get_length()) == name) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// The host watcher reports changes on its own thread, so give it some time to drop the listing
+static bool wait_for_listing(dircache_test_drive &drive, epoc::fs::dir_listing_cache &cache, const std::u16string &path,
+    const std::function<bool(const epoc::fs::packed_dir_listing &)> &pred) {
+    for (int i = 0; i < 200; i++) {
+        auto dir = drive.open(path);
+
+        if (pred(*cache.get_listing(path, io_attrib_include_file, dir.get(), true))) {
+            return true;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return false;
+}
+
+TEST_CASE("dir_listing_cache_follows_host_changes", "dircache") {
+    dircache_test_drive drive("dircachehost");
+    drive.fill(5);
+
+    epoc::fs::dir_listing_cache cache(&drive.io_);
+    const std::u16string search_path = std::u16string(DIRCACHE_TEST_DIR) + u"*.rsc";
+
+    auto first_dir = drive.open(search_path);
+    epoc::fs::packed_dir_listing_ptr first = cache.get_listing(search_path, io_attrib_include_file, first_dir.get(), true);
+
+    auto second_dir = drive.open(search_path);
+    REQUIRE(cache.get_listing(search_path, io_attrib_include_file, second_dir.get(), true) == first);
+
+    // Nothing tells the cache about these, only the host watcher
+    drive.add_host_file("new.rsc", 0x30000000);
+
+    REQUIRE(wait_for_listing(drive, cache, search_path, [](const epoc::fs::packed_dir_listing &listing) {
+        return listing.entry_count() == 6;
+    }));
+
+    std::filesystem::rename(eka2l1::add_path(drive.host_dir_, "app0.rsc"), eka2l1::add_path(drive.host_dir_, "renamed.rsc"));
+
+    REQUIRE(wait_for_listing(drive, cache, search_path, [](const epoc::fs::packed_dir_listing &listing) {
+        return has_entry(listing, u"renamed.rsc") && !has_entry(listing, u"app0.rsc");
+    }));
+}
+
+TEST_CASE("dir_listing_cache_skips_unwatchable_dir", "dircache") {
+    dircache_test_drive drive("dircachenowatch");
+    drive.fill(3);
+
+    epoc::fs::dir_listing_cache cache(&drive.io_);
+
+    // The host directory goes away after the open, so the watch fails
+    auto gone_dir = drive.open(DIRCACHE_TEST_DIR);
+    std::filesystem::remove_all(drive.host_dir_);
+
+    cache.get_listing(DIRCACHE_TEST_DIR, io_attrib_include_file, gone_dir.get(), true);
+    REQUIRE(cache.watched_dir_count() == 0);
+
+    std::filesystem::create_directories(drive.host_dir_);
+    drive.fill(5);
+
+    // The listing packed without a watch must not be reused
+    auto back_dir = drive.open(DIRCACHE_TEST_DIR);
+    REQUIRE(cache.get_listing(DIRCACHE_TEST_DIR, io_attrib_include_file, back_dir.get(), true)->entry_count() == 5);
+    REQUIRE(cache.watched_dir_count() == 1);
+}
+
+TEST_CASE("dir_listing_cache_unwatches_evicted_dirs", "dircache") {
+    dircache_test_drive drive("dircacheevict");
+    drive.fill(3);
+
+    static const char16_t *OTHER_DIR = u"C:\\resource\\other\\";
+    drive.io_.create_directories(OTHER_DIR);
+
+    epoc::fs::dir_listing_cache cache(&drive.io_, epoc::fs::dir_listing_cache::DEFAULT_MAX_SIZE, 1);
+
+    auto apps_dir = drive.open(DIRCACHE_TEST_DIR);
+    epoc::fs::packed_dir_listing_ptr apps = cache.get_listing(DIRCACHE_TEST_DIR, io_attrib_include_file, apps_dir.get(), true);
+
+    auto other_dir = drive.open(OTHER_DIR);
+    cache.get_listing(OTHER_DIR, io_attrib_include_file, other_dir.get(), true);
+
+    // Only the most recent directory keeps its watch
+    REQUIRE(cache.watched_dir_count() == 1);
+
+    auto apps_again_dir = drive.open(DIRCACHE_TEST_DIR);
+    epoc::fs::packed_dir_listing_ptr apps_again = cache.get_listing(DIRCACHE_TEST_DIR, io_attrib_include_file, apps_again_dir.get(), true);
+
+    REQUIRE(apps_again != apps);
+    REQUIRE(apps_again->entry_count() == 3);
+    REQUIRE(cache.watched_dir_count() == 1);
+}
+
+TEST_CASE("dir_listing_cache_10k_benchmark", "[.][dircache]") {
+    static constexpr std::uint32_t FILE_COUNT = 10000;
+    static constexpr int LIST_COUNT = 20;
+    static constexpr std::size_t CLIENT_BUFFER_SIZE = 0x2000;
+
+    dircache_test_drive drive("dircachebench");
+    drive.fill(FILE_COUNT);
+
+    epoc::fs::dir_listing_cache cache(&drive.io_);
+    std::size_t uncached_entries = 0;
+    std::size_t cached_entries = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Listing entry by entry, packing every time, like before the cache
+    for (int i = 0; i < LIST_COUNT; i++) {
+        auto dir = drive.open(DIRCACHE_TEST_DIR);
+        uncached_entries += count_listed(*epoc::fs::pack_dir_listing(&drive.io_, dir.get(), true), CLIENT_BUFFER_SIZE);
+    }
+
+    const auto uncached_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    const std::uint32_t attrib = io_attrib_include_file | io_attrib_include_dir;
+
+    // The first listing packs and fills the cache
+    {
+        auto dir = drive.open(DIRCACHE_TEST_DIR);
+        cache.get_listing(DIRCACHE_TEST_DIR, attrib, dir.get(), true);
+    }
+
+    start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < LIST_COUNT; i++) {
+        auto dir = drive.open(DIRCACHE_TEST_DIR);
+        cached_entries += count_listed(*cache.get_listing(DIRCACHE_TEST_DIR, attrib, dir.get(), true), CLIENT_BUFFER_SIZE);
+    }
+
+    const auto cached_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    REQUIRE(uncached_entries == FILE_COUNT * LIST_COUNT);
+    REQUIRE(cached_entries == uncached_entries);
+
+    WARN(LIST_COUNT << " listings of " << FILE_COUNT << " files: packed each time " << uncached_time.count()
+                    << " us, cached " << cached_time.count() << " us (" << cache.size() << " bytes cached)");
+}
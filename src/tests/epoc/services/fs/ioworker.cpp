@@ -0,0 +1,352 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <catch2/catch.hpp>
+#include <config/config.h>
+#include <kernel/chunk.h>
+#include <kernel/kernel.h>
+#include <kernel/process.h>
+#include <kernel/session.h>
+#include <kernel/thread.h>
+#include <kernel/timing.h>
+#include <services/context.h>
+#include <services/fs/fs.h>
+#include <services/fs/ioworker.h>
+#include <system/epoc.h>
+#include <utils/des.h>
+#include <utils/err.h>
+#include <utils/reqsts.h>
+#include <vfs/vfs.h>
+
+#include "testdrive.h"
+
+#include <common/path.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace eka2l1;
+
+TEST_CASE("io_worker_pool_keeps_order_per_key", "ioworker") {
+    static constexpr int JOB_PER_KEY = 200;
+
+    epoc::fs::io_worker_pool pool(4);
+
+    int keys[3];
+    std::vector<int> orders[3];
+    std::mutex orders_lock;
+
+    for (int i = 0; i < JOB_PER_KEY; i++) {
+        for (int k = 0; k < 3; k++) {
+            pool.submit(
+                &keys[k], [i]() -> std::int64_t { return i; },
+                [&orders, &orders_lock, k](const std::int64_t result) {
+                    const std::lock_guard<std::mutex> guard(orders_lock);
+                    orders[k].push_back(static_cast<int>(result));
+                });
+        }
+    }
+
+    for (int k = 0; k < 3; k++) {
+        pool.wait_idle(&keys[k]);
+        REQUIRE(pool.is_idle(&keys[k]));
+
+        const std::lock_guard<std::mutex> guard(orders_lock);
+        REQUIRE(orders[k].size() == JOB_PER_KEY);
+
+        for (int i = 0; i < JOB_PER_KEY; i++) {
+            REQUIRE(orders[k][i] == i);
+        }
+    }
+}
+
+TEST_CASE("io_worker_pool_runs_keys_concurrently", "ioworker") {
+    epoc::fs::io_worker_pool pool(2);
+
+    int blocked_key = 0;
+    int free_key = 0;
+
+    std::atomic<bool> release{ false };
+    std::atomic<bool> free_done{ false };
+
+    pool.submit(&blocked_key, [&release]() -> std::int64_t {
+        while (!release) {
+            std::this_thread::yield();
+        }
+
+        return 0;
+    }, nullptr);
+
+    pool.submit(&free_key, []() -> std::int64_t { return 0; }, [&free_done](const std::int64_t) { free_done = true; });
+
+    // A long job on one file must not hold back the others
+    pool.wait_idle(&free_key);
+    REQUIRE(free_done);
+    REQUIRE_FALSE(pool.is_idle(&blocked_key));
+
+    release = true;
+    pool.wait_idle(&blocked_key);
+}
+
+static constexpr std::int32_t FS_ASYNC_TEST_PENDING = static_cast<std::int32_t>(0x80000001);
+static constexpr std::uint32_t FS_ASYNC_TEST_DES_MAX_LENGTH = 0x100;
+
+// A client process with its request statuses and read descriptors in one local chunk
+struct fs_async_io_test_environment {
+    config::state conf_;
+    std::unique_ptr<eka2l1::system> sys_;
+
+    kernel_system *kern_;
+    ntimer *timing_;
+    fs_server *fs_;
+
+    kernel::process *client_;
+    kernel::chunk *client_data_;
+
+    explicit fs_async_io_test_environment() {
+        system_create_components comp;
+        comp.conf_ = &conf_;
+        comp.manual_timing_ = true;
+
+        sys_ = std::make_unique<eka2l1::system>(comp);
+        sys_->startup();
+
+        kern_ = sys_->get_kernel_system();
+        timing_ = sys_->get_ntimer();
+
+        std::unique_ptr<service::server> svr = std::make_unique<fs_server>(sys_.get());
+        fs_ = reinterpret_cast<fs_server *>(svr.get());
+
+        kern_->add_custom_server(svr);
+
+        client_ = kern_->create<kernel::process>(sys_->get_memory_system(), "FsAsyncIoClient", u"C:\\sys\\bin\\fsasyncioclient.exe", u"");
+        client_data_ = kern_->create<kernel::chunk>(sys_->get_memory_system(), client_, "", 0, 0x1000, 0x1000, prot_read_write,
+            kernel::chunk_type::normal, kernel::chunk_access::local, kernel::chunk_attrib::none);
+    }
+
+    kernel::thread *create_client_thread(const std::string &name) {
+        return kern_->create<kernel::thread>(sys_->get_memory_system(), timing_, client_, kernel::access_type::local_access,
+            name, 0, 0x2000, 0, 0x1000, false);
+    }
+
+    address guest_address(const std::uint32_t offset) {
+        return client_data_->base(client_).ptr_address() + offset;
+    }
+
+    template <typename T>
+    T *host_pointer(const std::uint32_t offset) {
+        return reinterpret_cast<T *>(reinterpret_cast<std::uint8_t *>(client_data_->host_base()) + offset);
+    }
+
+    // Run the completions the I/O workers scheduled, until the status changes or it takes too long
+    void wait_for_completion(const std::uint32_t status_offset) {
+        for (int i = 0; (i < 5000) && (host_pointer<epoc::request_status>(status_offset)->status == FS_ASYNC_TEST_PENDING); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            timing_->advance_clock(1);
+        }
+    }
+};
+
+struct fs_async_io_test_request {
+    kernel::thread *client_thread_;
+    service::session *session_;
+    std::uint32_t status_offset_;
+    std::uint32_t des_offset_;
+};
+
+static void queue_test_read(fs_async_io_test_environment &env, ipc_msg_ptr &msg, const fs_async_io_test_request &request,
+    const void *key, epoc::fs::io_worker_pool::work_func work) {
+    epoc::request_status *sts = env.host_pointer<epoc::request_status>(request.status_offset_);
+    sts->flags = 0;
+    sts->set(FS_ASYNC_TEST_PENDING, false);
+
+    epoc::des8 *des = env.host_pointer<epoc::des8>(request.des_offset_);
+    des->info = 0;
+    des->set_descriptor_type(epoc::buf);
+    des->set_max_length(FS_ASYNC_TEST_DES_MAX_LENGTH);
+
+    msg->function = 0;
+    msg->own_thr = request.client_thread_;
+    msg->msg_session = request.session_;
+    msg->request_sts = env.guest_address(request.status_offset_);
+    msg->args = ipc_arg(static_cast<int>(env.guest_address(request.des_offset_)), static_cast<int>(ipc_arg_type::des8));
+
+    service::ipc_context ctx(false);
+    ctx.sys = env.sys_.get();
+    ctx.msg = msg;
+
+    env.fs_->queue_async_io(&ctx, key, std::move(work), 0);
+}
+
+TEST_CASE("fs_async_reads_complete_own_requests_in_order", "ioworker") {
+    fs_async_io_test_environment env;
+
+    const server_ptr fs_svr = reinterpret_cast<server_ptr>(env.fs_);
+
+    const fs_async_io_test_request first{ env.create_client_thread("FsAsyncIoClient1"),
+        env.kern_->create<service::session>(fs_svr, 4), 0x0, 0x100 };
+    const fs_async_io_test_request second{ env.create_client_thread("FsAsyncIoClient2"),
+        env.kern_->create<service::session>(fs_svr, 4), 0x10, 0x400 };
+
+    // Both requests go through the same message, like the server's own one that is reused
+    // as soon as the handler returns
+    ipc_msg_ptr msg = env.kern_->create_msg(kernel::owner_type::kernel);
+    REQUIRE(msg);
+
+    int shared_file = 0;
+    std::atomic<bool> release_second{ false };
+
+    queue_test_read(env, msg, first, &shared_file, []() -> std::int64_t { return 0x40; });
+    queue_test_read(env, msg, second, &shared_file, [&release_second]() -> std::int64_t {
+        while (!release_second) {
+            std::this_thread::yield();
+        }
+
+        return 0xC0;
+    });
+
+    env.wait_for_completion(first.status_offset_);
+
+    REQUIRE(env.host_pointer<epoc::request_status>(first.status_offset_)->status == epoc::error_none);
+    REQUIRE(env.host_pointer<epoc::des8>(first.des_offset_)->get_length() == 0x40);
+    REQUIRE(first.client_thread_->request_count() == 1);
+
+    // The second read is still running, so its request must be untouched
+    REQUIRE(env.host_pointer<epoc::request_status>(second.status_offset_)->status == FS_ASYNC_TEST_PENDING);
+    REQUIRE(env.host_pointer<epoc::des8>(second.des_offset_)->get_length() == 0);
+    REQUIRE(second.client_thread_->request_count() == 0);
+
+    release_second = true;
+    env.wait_for_completion(second.status_offset_);
+
+    REQUIRE(env.host_pointer<epoc::request_status>(second.status_offset_)->status == epoc::error_none);
+    REQUIRE(env.host_pointer<epoc::des8>(second.des_offset_)->get_length() == 0xC0);
+    REQUIRE(second.client_thread_->request_count() == 1);
+
+    // The first request is not completed twice
+    REQUIRE(env.host_pointer<epoc::des8>(first.des_offset_)->get_length() == 0x40);
+    REQUIRE(first.client_thread_->request_count() == 1);
+
+    env.kern_->free_msg(msg);
+}
+
+static std::uint64_t busy_work(const std::uint64_t rounds) {
+    std::uint64_t value = 0x12345678;
+
+    for (std::uint64_t i = 0; i < rounds; i++) {
+        value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+
+    return value;
+}
+
+TEST_CASE("io_worker_pool_stream_benchmark", "[.][ioworker]") {
+    static constexpr std::size_t FILE_SIZE = 64 * 1024 * 1024;
+    static constexpr std::size_t CHUNK_SIZE = 256 * 1024;
+    static constexpr std::size_t CHUNK_COUNT = FILE_SIZE / CHUNK_SIZE;
+    static constexpr std::uint64_t WORK_PER_CHUNK = 200000;
+
+    io_system io;
+    test_drive_guard drive(io, "ioworkerbench");
+
+    {
+        std::ofstream stream(eka2l1::add_path(drive.host_dir, "stream.bin"), std::ios::binary);
+        std::vector<char> block(CHUNK_SIZE, 'E');
+
+        for (std::size_t i = 0; i < CHUNK_COUNT; i++) {
+            stream.write(block.data(), block.size());
+        }
+    }
+
+    // Stands for the guest buffer the chunks are read into
+    std::vector<std::uint8_t> guest_buffer(FILE_SIZE);
+    std::uint64_t sink = 0;
+
+    // Reading on the emulator thread: guest work and file reads take turns
+    symfile sync_file = io.open_file(u"C:\\stream.bin", READ_MODE | BIN_MODE);
+    REQUIRE(sync_file);
+
+    std::uint64_t sync_latency_us = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (std::size_t i = 0; i < CHUNK_COUNT; i++) {
+        const auto request_time = std::chrono::steady_clock::now();
+        sync_file->read_file(guest_buffer.data() + i * CHUNK_SIZE, 1, CHUNK_SIZE);
+        sync_latency_us += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - request_time).count();
+
+        sink += busy_work(WORK_PER_CHUNK);
+    }
+
+    const auto sync_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    // Reading on the workers: the emulator thread keeps doing guest work while the chunks arrive
+    symfile async_file = io.open_file(u"C:\\stream.bin", READ_MODE | BIN_MODE);
+    REQUIRE(async_file);
+
+    std::atomic<std::uint64_t> async_latency_us{ 0 };
+    std::atomic<std::size_t> async_read_size{ 0 };
+    std::uint64_t async_blocked_us = 0;
+
+    {
+        epoc::fs::io_worker_pool pool;
+        file *target = async_file.get();
+
+        start = std::chrono::steady_clock::now();
+
+        for (std::size_t i = 0; i < CHUNK_COUNT; i++) {
+            const auto request_time = std::chrono::steady_clock::now();
+            std::uint8_t *dest = guest_buffer.data() + i * CHUNK_SIZE;
+
+            pool.submit(
+                target, [target, dest]() -> std::int64_t {
+                    return static_cast<std::int64_t>(target->read_file(dest, 1, CHUNK_SIZE));
+                },
+                [&async_latency_us, &async_read_size, request_time](const std::int64_t result) {
+                    async_latency_us += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - request_time).count();
+                    async_read_size += static_cast<std::size_t>(result);
+                });
+
+            async_blocked_us += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - request_time).count();
+
+            sink += busy_work(WORK_PER_CHUNK);
+        }
+
+        pool.wait_idle(target);
+    }
+
+    const auto async_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    REQUIRE(async_read_size == FILE_SIZE);
+    REQUIRE(guest_buffer[FILE_SIZE - 1] == 'E');
+
+    const double file_mb = static_cast<double>(FILE_SIZE) / (1024.0 * 1024.0);
+
+    WARN("Streaming " << file_mb << " MB in " << CHUNK_SIZE / 1024 << " KB chunks alongside guest work (sink " << (sink & 1) << "): "
+                      << "emulator thread " << sync_time.count() << " us (" << file_mb * 1e6 / sync_time.count() << " MB/s, "
+                      << sync_latency_us / CHUNK_COUNT << " us blocked per chunk), "
+                      << "I/O workers " << async_time.count() << " us (" << file_mb * 1e6 / async_time.count() << " MB/s, "
+                      << async_blocked_us / CHUNK_COUNT << " us blocked and " << async_latency_us / CHUNK_COUNT << " us to completion per chunk)");
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <services/msv/entry.h>
+#include <vfs/vfs.h>
+
+#include "testdrive.h"
+
+#include <chrono>
+#include <memory>
+
+using namespace eka2l1;
+
+static const char16_t *MSV_TEST_MSG_DIR = u"C:\\private\\1000484b\\Mail2\\";
+static constexpr std::uint32_t MSV_TEST_FOLDER_ID = 0x1002;
+
+struct msv_test_store {
+    io_system io_;
+    test_drive_guard drive_;
+
+    explicit msv_test_store(const std::string &drive_folder)
+        : drive_(io_, drive_folder) {
+        io_.create_directories(MSV_TEST_MSG_DIR);
+    }
+
+    std::unique_ptr<epoc::msv::entry_indexer> make_indexer(const std::size_t max_loaded = 512) {
+        return std::make_unique<epoc::msv::entry_indexer>(&io_, MSV_TEST_MSG_DIR, language::en, max_loaded);
+    }
+};
+
+static void fill_test_store(epoc::msv::entry_indexer &indexer, const std::uint32_t count) {
+    epoc::msv::entry folder;
+    folder.id_ = MSV_TEST_FOLDER_ID;
+    folder.parent_id_ = 0x1000;
+    folder.service_id_ = 0x1001;
+    folder.type_uid_ = 0;
+    folder.mtm_uid_ = 0;
+    folder.data_ = 0;
+    folder.time_ = 0;
+    folder.description_ = u"Inbox";
+
+    REQUIRE(indexer.add_entry(folder));
+
+    // Add in reverse order, children must still come back sorted by ID
+    for (std::uint32_t i = count; i > 0; i--) {
+        epoc::msv::entry msg;
+        msg.id_ = 0x100000 + i;
+        msg.parent_id_ = MSV_TEST_FOLDER_ID;
+        msg.service_id_ = 0x1001;
+        msg.type_uid_ = 0x10000F6A;
+        msg.mtm_uid_ = 0x1000102C;
+        msg.data_ = i;
+        msg.time_ = i * 1000ULL;
+        msg.description_ = u"Message " + common::utf8_to_ucs2(std::to_string(i));
+        msg.details_ = u"+84000000";
+
+        REQUIRE(indexer.add_entry(msg));
+    }
+}
+
+TEST_CASE("msv_entry_index_lazy_load", "msv") {
+    msv_test_store store("msvtestdrv_lazy");
+
+    {
+        auto indexer = store.make_indexer();
+        fill_test_store(*indexer, 64);
+
+        // Duplicated ID is refused
+        epoc::msv::entry dup = *indexer->get_entry(0x100000 + 5);
+        REQUIRE(!indexer->add_entry(dup));
+    }
+
+    // Reopen: only the index is read, no entry data yet
+    auto indexer = store.make_indexer(16);
+    REQUIRE(indexer->total_entries() >= 65);
+    REQUIRE(indexer->loaded_entries() == 0);
+
+    epoc::msv::entry *msg = indexer->get_entry(0x100000 + 7);
+    REQUIRE(msg);
+    REQUIRE(msg->description_ == u"Message 7");
+    REQUIRE(msg->data_ == 7);
+    REQUIRE(indexer->loaded_entries() == 1);
+
+    std::vector<epoc::msv::entry *> childs = indexer->get_entries_by_parent(MSV_TEST_FOLDER_ID);
+    REQUIRE(childs.size() == 64);
+
+    for (std::uint32_t i = 0; i < 64; i++) {
+        REQUIRE(childs[i]->id_ == 0x100000 + i + 1);
+        REQUIRE(childs[i]->description_ == u"Message " + common::utf8_to_ucs2(std::to_string(i + 1)));
+    }
+
+    // The next lookup evicts down to the limit
+    REQUIRE(indexer->get_entry(0x100000 + 64));
+    REQUIRE(indexer->loaded_entries() <= 17);
+
+    REQUIRE(!indexer->get_entry(0x200000));
+    REQUIRE(indexer->get_entries_by_parent(0x200000).empty());
+}
+
+TEST_CASE("msv_entry_index_10k_benchmark", "[.][msv]") {
+    msv_test_store store("msvtestdrv_bench");
+    static constexpr std::uint32_t MESSAGE_COUNT = 10000;
+
+    auto start = std::chrono::steady_clock::now();
+
+    {
+        auto indexer = store.make_indexer();
+        fill_test_store(*indexer, MESSAGE_COUNT);
+    }
+
+    const auto fill_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    start = std::chrono::steady_clock::now();
+
+    auto indexer = store.make_indexer();
+
+    const auto open_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < 1000; i++) {
+        REQUIRE(indexer->get_entry(0x100000 + 1 + (i * 7919) % MESSAGE_COUNT));
+    }
+
+    const auto lookup_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    start = std::chrono::steady_clock::now();
+
+    REQUIRE(indexer->get_entries_by_parent(MSV_TEST_FOLDER_ID).size() == MESSAGE_COUNT);
+
+    const auto list_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    WARN("10k message store: fill " << fill_time.count() << "ms, open " << open_time.count() << "ms, 1000 lookups "
+                                    << lookup_time.count() << "ms, list folder " << list_time.count() << "ms");
+}
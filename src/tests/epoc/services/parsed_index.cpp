@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <catch2/catch.hpp>
+#include <services/parsed_index.h>
+#include <vfs/vfs.h>
+
+#include "testdrive.h"
+
+#include <common/cvt.h>
+#include <common/path.h>
+
+#include <chrono>
+#include <fstream>
+#include <string>
+
+using namespace eka2l1;
+
+static const char16_t *PARSED_INDEX_TEST_DIR = u"C:\\resource\\plugins\\";
+static const char16_t *PARSED_INDEX_TEST_INDEX = u"C:\\private\\10009d8f\\cache\\test.idx";
+
+struct parsed_index_test_drive {
+    io_system io_;
+    test_drive_guard drive_;
+    std::string host_dir_;
+
+    explicit parsed_index_test_drive(const std::string &drive_folder)
+        : drive_(io_, drive_folder) {
+        io_.create_directories(PARSED_INDEX_TEST_DIR);
+
+        host_dir_ = common::ucs2_to_utf8(*io_.get_raw_path(PARSED_INDEX_TEST_DIR));
+    }
+
+    std::u16string write_file(const std::string &name, const std::string &content) {
+        std::ofstream stream(eka2l1::add_path(host_dir_, name), std::ios::binary);
+        stream << content;
+
+        return std::u16string(PARSED_INDEX_TEST_DIR) + common::utf8_to_ucs2(name);
+    }
+};
+
+static std::vector<std::uint8_t> to_bytes(const std::string &str) {
+    return std::vector<std::uint8_t>(str.begin(), str.end());
+}
+
+TEST_CASE("parsed_file_index_reload_and_invalidate", "parsed_index") {
+    parsed_index_test_drive drive("parsedindextest");
+
+    const std::u16string plugin_path = drive.write_file("plugin.rsc", "plugin v1");
+    const std::u16string localised_path = drive.write_file("plugin_loc.rsc", "localised v1");
+
+    {
+        service::parsed_file_index index(&drive.io_, PARSED_INDEX_TEST_INDEX, 1);
+        REQUIRE_FALSE(index.load());
+
+        auto plugin_stamp = index.stamp(plugin_path);
+        auto localised_stamp = index.stamp(localised_path);
+
+        REQUIRE(plugin_stamp);
+        REQUIRE(localised_stamp);
+        REQUIRE_FALSE(index.find(plugin_stamp.value()));
+
+        index.store({ plugin_stamp.value(), localised_stamp.value() }, to_bytes("parsed"));
+        REQUIRE(index.save());
+    }
+
+    {
+        service::parsed_file_index index(&drive.io_, PARSED_INDEX_TEST_INDEX, 1);
+        REQUIRE(index.load());
+
+        // Lookups ignore the case of the path, like the file system does
+        auto plugin_stamp = index.stamp(plugin_path);
+        plugin_stamp->path_ = u"C:\\RESOURCE\\PLUGINS\\PLUGIN.RSC";
+
+        const std::vector<std::uint8_t> *data = index.find(plugin_stamp.value());
+
+        REQUIRE(data);
+        REQUIRE(*data == to_bytes("parsed"));
+        REQUIRE(index.hit_count() == 1);
+    }
+
+    // A changed source file must be parsed again
+    drive.write_file("plugin_loc.rsc", "localised v2, longer");
+
+    {
+        service::parsed_file_index index(&drive.io_, PARSED_INDEX_TEST_INDEX, 1);
+        REQUIRE(index.load());
+
+        REQUIRE_FALSE(index.find(index.stamp(plugin_path).value()));
+        REQUIRE(index.miss_count() == 1);
+
+        // Not found nor stored, so it is dropped
+        REQUIRE(index.save());
+    }
+
+    {
+        service::parsed_file_index index(&drive.io_, PARSED_INDEX_TEST_INDEX, 1);
+        REQUIRE(index.load());
+        REQUIRE(index.size() == 0);
+    }
+}
+
+TEST_CASE("parsed_file_index_tag_mismatch", "parsed_index") {
+    parsed_index_test_drive drive("parsedindextag");
+    const std::u16string plugin_path = drive.write_file("plugin.rsc", "plugin");
+
+    {
+        service::parsed_file_index index(&drive.io_, PARSED_INDEX_TEST_INDEX, 1);
+        index.load();
+        index.store({ index.stamp(plugin_path).value() }, to_bytes("parsed"));
+        index.save();
+    }
+
+    service::parsed_file_index index(&drive.io_, PARSED_INDEX_TEST_INDEX, 2);
+
+    REQUIRE_FALSE(index.load());
+    REQUIRE_FALSE(index.find(index.stamp(plugin_path).value()));
+}
+
+// Stands for a resource parser: read the whole file and walk over it
+static std::vector<std::uint8_t> parse_synthetic_resource(io_system &io, const std::u16string &path) {
+    symfile f = io.open_file(path, READ_MODE | BIN_MODE);
+    std::vector<std::uint8_t> content(f->size());
+
+    f->read_file(content.data(), 1, static_cast<std::uint32_t>(content.size()));
+    f->close();
+
+    std::vector<std::uint8_t> parsed;
+
+    for (std::size_t i = 0; i + 4 <= content.size(); i += 64) {
+        parsed.insert(parsed.end(), content.begin() + i, content.begin() + i + 4);
+    }
+
+    return parsed;
+}
+
+TEST_CASE("parsed_file_index_boot_benchmark", "[.][parsed_index]") {
+    static constexpr int FILE_COUNT = 2000;
+    static constexpr std::size_t FILE_SIZE = 4096;
+
+    parsed_index_test_drive drive("parsedindexbench");
+    std::vector<std::u16string> paths;
+
+    for (int i = 0; i < FILE_COUNT; i++) {
+        paths.push_back(drive.write_file("plugin" + std::to_string(i) + ".rsc", std::string(FILE_SIZE, static_cast<char>('a' + i % 26))));
+    }
+
+    auto boot = [&]() {
+        const auto start = std::chrono::steady_clock::now();
+
+        service::parsed_file_index index(&drive.io_, PARSED_INDEX_TEST_INDEX, 1);
+        index.load();
+
+        for (const std::u16string &path : paths) {
+            auto stamp = index.stamp(path);
+
+            if (!index.find(stamp.value())) {
+                index.store({ stamp.value() }, parse_synthetic_resource(drive.io_, path));
+            }
+        }
+
+        index.save();
+
+        REQUIRE(index.hit_count() + index.miss_count() == FILE_COUNT);
+        return std::make_pair(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start), index.hit_count());
+    };
+
+    const auto [cold_time, cold_hits] = boot();
+    const auto [warm_time, warm_hits] = boot();
+
+    REQUIRE(cold_hits == 0);
+    REQUIRE(warm_hits == FILE_COUNT);
+
+    WARN("Boot over " << FILE_COUNT << " resource files: cold " << cold_time.count() << " us, warm " << warm_time.count() << " us");
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <catch2/catch.hpp>
+#include <services/ui/icon/cache.h>
+
+#include <common/algorithm.h>
+#include <common/cvt.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace eka2l1;
+
+static epoc::akn_icon_params make_icon_spec(const std::u16string &file_name, const int bitmap_id) {
+    epoc::akn_icon_params spec;
+    spec.file_name = file_name;
+    spec.bitmap_id = bitmap_id;
+    spec.mask_id = bitmap_id + 1;
+    spec.app_icon = false;
+    spec.flags = 0;
+
+    return spec;
+}
+
+static epoc::akn_icon_srv_return_data make_icon_data(const int handle) {
+    epoc::akn_icon_srv_return_data data;
+    data.bitmap_handle = handle;
+    data.mask_handle = handle + 1;
+    data.content_dim = eka2l1::vec2(32, 32);
+
+    return data;
+}
+
+TEST_CASE("icon_cache_key_folds_file_name", "icon_cache") {
+    epoc::akn_icon_cache cache([](const epoc::akn_icon_srv_return_data &data) {});
+
+    const epoc::akn_icon_cache_key key = cache.make_key(make_icon_spec(u"Z:\\resource\\apps\\avkon2.mif", 16384));
+
+    REQUIRE(cache.make_key(make_icon_spec(u"z:\\RESOURCE\\apps\\AVKON2.MIF", 16384)) == key);
+    REQUIRE_FALSE(cache.make_key(make_icon_spec(u"z:\\resource\\apps\\avkon2.mif", 16386)) == key);
+    REQUIRE_FALSE(cache.make_key(make_icon_spec(u"z:\\resource\\apps\\other.mif", 16384)) == key);
+
+    epoc::akn_icon_params app_spec = make_icon_spec(u"z:\\resource\\apps\\avkon2.mif", 16384);
+    app_spec.app_icon = true;
+
+    REQUIRE_FALSE(cache.make_key(app_spec) == key);
+}
+
+TEST_CASE("icon_cache_keeps_unused_icons_within_budget", "icon_cache") {
+    std::vector<int> released;
+    epoc::akn_icon_cache cache([&](const epoc::akn_icon_srv_return_data &data) { released.push_back(data.bitmap_handle); }, 250);
+
+    const epoc::akn_icon_cache_key first = cache.make_key(make_icon_spec(u"z:\\a.mif", 1));
+    const epoc::akn_icon_cache_key second = cache.make_key(make_icon_spec(u"z:\\a.mif", 2));
+    const epoc::akn_icon_cache_key third = cache.make_key(make_icon_spec(u"z:\\a.mif", 3));
+
+    REQUIRE_FALSE(cache.acquire(first));
+
+    cache.add(first, make_icon_data(10), 100);
+    cache.add(second, make_icon_data(20), 100);
+    cache.add(third, make_icon_data(30), 100);
+
+    // Two users of the first icon
+    REQUIRE(cache.acquire(first)->bitmap_handle == 10);
+    REQUIRE(cache.release(first, true));
+    REQUIRE(cache.unused_size() == 0);
+
+    // Unused icons stay while they fit in the budget
+    REQUIRE(cache.release(first, true));
+    REQUIRE(cache.release(second, true));
+    REQUIRE(cache.unused_size() == 200);
+    REQUIRE(released.empty());
+
+    // Reusing one takes it out of eviction's reach
+    REQUIRE(cache.acquire(first)->bitmap_handle == 10);
+    REQUIRE(cache.unused_size() == 100);
+
+    // Going over the budget evicts the least recently freed icon
+    REQUIRE(cache.release(third, true));
+    REQUIRE(cache.release(first, true));
+
+    std::vector<int> expected_released = { 20 };
+
+    REQUIRE(released == expected_released);
+    REQUIRE(cache.count() == 2);
+    REQUIRE_FALSE(cache.acquire(second));
+
+    // Icons excluded from the cache go away as soon as they are unused
+    REQUIRE(cache.acquire(third));
+    REQUIRE(cache.release(third, false));
+
+    expected_released.push_back(30);
+
+    REQUIRE(released == expected_released);
+    REQUIRE_FALSE(cache.release(third, true));
+
+    cache.set_budget(0);
+    expected_released.push_back(10);
+
+    REQUIRE(released == expected_released);
+    REQUIRE(cache.count() == 0);
+}
+
+TEST_CASE("icon_cache_10k_benchmark", "[.][icon_cache]") {
+    static constexpr int ICON_COUNT = 10000;
+    static constexpr int FILE_COUNT = 20;
+    static constexpr int LOOKUP_COUNT = 20000;
+
+    epoc::akn_icon_cache cache([](const epoc::akn_icon_srv_return_data &data) {});
+    std::vector<epoc::akn_icon_params> specs;
+
+    for (int i = 0; i < ICON_COUNT; i++) {
+        specs.push_back(make_icon_spec(u"Z:\\resource\\apps\\Icons" + common::utf8_to_ucs2(std::to_string(i % FILE_COUNT)) + u".mif",
+            16384 + (i / FILE_COUNT) * 2));
+
+        cache.add(cache.make_key(specs.back()), make_icon_data(i), 4096);
+    }
+
+    std::mt19937 rng(2468);
+    std::uniform_int_distribution<int> icon_dist(0, ICON_COUNT - 1);
+
+    // Requests come with the file name in whatever case the client had
+    std::vector<epoc::akn_icon_params> requests;
+
+    for (int i = 0; i < LOOKUP_COUNT; i++) {
+        epoc::akn_icon_params request = specs[icon_dist(rng)];
+        request.file_name = common::lowercase_ucs2_string(request.file_name.to_std_string(nullptr));
+
+        requests.push_back(request);
+    }
+
+    std::size_t linear_found = 0;
+    std::size_t cache_found = 0;
+
+    // The scan the server did before the cache, kept as reference
+    auto start = std::chrono::steady_clock::now();
+
+    for (epoc::akn_icon_params &request : requests) {
+        for (epoc::akn_icon_params &cached_spec : specs) {
+            if ((request.bitmap_id == cached_spec.bitmap_id) && (request.app_icon == cached_spec.app_icon)
+                && (common::compare_ignore_case(request.file_name.to_std_string(nullptr), cached_spec.file_name.to_std_string(nullptr)) == 0)) {
+                linear_found++;
+                break;
+            }
+        }
+    }
+
+    const auto linear_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    start = std::chrono::steady_clock::now();
+
+    for (const epoc::akn_icon_params &request : requests) {
+        const epoc::akn_icon_cache_key key = cache.make_key(request);
+
+        if (cache.acquire(key)) {
+            cache_found++;
+            cache.release(key, true);
+        }
+    }
+
+    const auto cache_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    REQUIRE(linear_found == LOOKUP_COUNT);
+    REQUIRE(cache_found == LOOKUP_COUNT);
+
+    WARN(LOOKUP_COUNT << " icon lookups over " << ICON_COUNT << " cached icons: linear scan " << linear_time.count()
+                      << " us, hashed cache " << cache_time.count() << " us");
+}
@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <catch2/catch.hpp>
+#include <common/chunkyseri.h>
+#include <config/config.h>
+#include <kernel/chunk.h>
+#include <kernel/kernel.h>
+#include <services/fbs/fbs.h>
+#include <services/ui/skin/chunk_maintainer.h>
+#include <system/epoc.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace eka2l1;
+
+// Same granularity and flags the skin server uses on S^3
+static constexpr std::size_t SKIN_TEST_GRANULARITY = 4 * 1024;
+static constexpr std::uint32_t SKIN_TEST_FLAGS = epoc::akn_skin_chunk_maintainer_lookup_use_linked_list;
+
+struct skin_test_environment {
+    config::state conf_;
+    std::unique_ptr<eka2l1::system> sys_;
+
+    kernel_system *kern_;
+
+    explicit skin_test_environment() {
+        system_create_components comp;
+        comp.conf_ = &conf_;
+
+        sys_ = std::make_unique<eka2l1::system>(comp);
+        sys_->startup();
+
+        kern_ = sys_->get_kernel_system();
+    }
+
+    std::unique_ptr<epoc::akn_skin_chunk_maintainer> make_maintainer(const std::string &chunk_name) {
+        // Same layout as the skin server's shared chunk
+        kernel::chunk *skin_chunk = kern_->create<kernel::chunk>(sys_->get_memory_system(), nullptr, chunk_name,
+            0, 160 * 1024, 384 * 1024, prot_read_write, kernel::chunk_type::normal, kernel::chunk_access::global,
+            kernel::chunk_attrib::none);
+
+        return std::make_unique<epoc::akn_skin_chunk_maintainer>(skin_chunk, SKIN_TEST_GRANULARITY, SKIN_TEST_FLAGS);
+    }
+};
+
+static epoc::akns_item_def make_item_def(const epoc::pid id) {
+    epoc::akns_item_def def{};
+    def.id_ = id;
+    def.type_ = epoc::akns_item_type_color_table;
+    def.next_hash_ = -1;
+
+    return def;
+}
+
+static void define_item(epoc::akn_skin_chunk_maintainer &maintainer, const epoc::pid id, const std::uint32_t value) {
+    const epoc::akns_item_def def = make_item_def(id);
+    REQUIRE(maintainer.update_definition(def, &value, sizeof(value), 0));
+}
+
+static std::uint32_t item_value(epoc::akn_skin_chunk_maintainer &maintainer, const epoc::pid id) {
+    epoc::akns_item_def *def = maintainer.get_item_definition(id);
+    REQUIRE(def);
+
+    std::uint32_t *value = def->data_.get_relative<std::uint32_t>(
+        maintainer.get_area_base(epoc::akn_skin_chunk_area_base_offset::data_area_base));
+
+    REQUIRE(value);
+    return *value;
+}
+
+TEST_CASE("skin_item_definition_index_follows_updates", "skin") {
+    skin_test_environment env;
+    auto maintainer = env.make_maintainer("SkinTestIndexChunk");
+
+    define_item(*maintainer, { 0x101F86E3, 1 }, 10);
+    define_item(*maintainer, { 0x101F86E3, 2 }, 20);
+    define_item(*maintainer, { 0x10005A26, 1 }, 30);
+
+    REQUIRE(maintainer->get_item_definition_index({ 0x101F86E3, 1 }) == 0);
+    REQUIRE(maintainer->get_item_definition_index({ 0x101F86E3, 2 }) == 1);
+    REQUIRE(maintainer->get_item_definition_index({ 0x10005A26, 1 }) == 2);
+    REQUIRE(maintainer->get_item_definition_index({ 0x10005A26, 2 }) == -1);
+    REQUIRE_FALSE(maintainer->get_item_definition({ 0x10005A26, 2 }));
+
+    REQUIRE(item_value(*maintainer, { 0x101F86E3, 2 }) == 20);
+
+    // Redefining keeps the slot and only replaces the content
+    define_item(*maintainer, { 0x101F86E3, 2 }, 25);
+
+    REQUIRE(maintainer->get_item_definition_index({ 0x101F86E3, 2 }) == 1);
+    REQUIRE(item_value(*maintainer, { 0x101F86E3, 2 }) == 25);
+    REQUIRE(maintainer->get_area_current_size(epoc::akn_skin_chunk_area_base_offset::item_def_area_base)
+        == 3 * sizeof(epoc::akns_item_def));
+
+    // Guests still walk the hash chain, every item must be reachable from it
+    const std::int32_t *hash = reinterpret_cast<const std::int32_t *>(
+        maintainer->get_area_base(epoc::akn_skin_chunk_area_base_offset::item_def_hash_base));
+    epoc::akns_item_def *defs = reinterpret_cast<epoc::akns_item_def *>(
+        maintainer->get_area_base(epoc::akn_skin_chunk_area_base_offset::item_def_area_base));
+
+    for (const epoc::pid id : { epoc::pid{ 0x101F86E3, 1 }, epoc::pid{ 0x101F86E3, 2 }, epoc::pid{ 0x10005A26, 1 } }) {
+        std::int32_t index = hash[(id.first + id.second) % 128];
+
+        while ((index >= 0) && !(defs[index].id_ == id)) {
+            index = defs[index].next_hash_;
+        }
+
+        REQUIRE(index == maintainer->get_item_definition_index(id));
+    }
+}
+
+static std::vector<epoc::pid> stored_scalable_items(epoc::akn_skin_chunk_maintainer &maintainer, const std::size_t entry_size) {
+    const std::uint8_t *table = reinterpret_cast<const std::uint8_t *>(
+        maintainer.get_area_base(epoc::akn_skin_chunk_area_base_offset::gfx_area_base));
+    const std::size_t count = maintainer.get_area_current_size(epoc::akn_skin_chunk_area_base_offset::gfx_area_base) / entry_size;
+
+    std::vector<epoc::pid> items;
+
+    for (std::size_t i = 0; i < count; i++) {
+        // The item ID leads each entry
+        epoc::pid id;
+        std::memcpy(&id, table + i * entry_size, sizeof(id));
+
+        items.push_back(id);
+    }
+
+    return items;
+}
+
+TEST_CASE("skin_scalable_gfx_evicts_least_recently_stored", "skin") {
+    skin_test_environment env;
+    auto maintainer = env.make_maintainer("SkinTestGfxChunk");
+
+    std::vector<std::unique_ptr<fbsbitmap>> bitmaps;
+
+    auto store_item = [&](const std::int32_t item) {
+        bitmaps.push_back(std::make_unique<fbsbitmap>(nullptr, nullptr, false, false));
+        bitmaps.back()->id = static_cast<std::uint32_t>(bitmaps.size());
+
+        const epoc::skn_layout_info layout{ 0, eka2l1::vec2(32, 32) };
+        REQUIRE(maintainer->store_scalable_gfx({ 0x10005A26, item }, layout, bitmaps.back().get(), nullptr));
+    };
+
+    store_item(0);
+
+    const std::size_t entry_size = maintainer->get_area_current_size(epoc::akn_skin_chunk_area_base_offset::gfx_area_base);
+    const std::size_t capacity = maintainer->get_area_size(epoc::akn_skin_chunk_area_base_offset::gfx_area_base) / entry_size;
+
+    REQUIRE(entry_size > 0);
+    REQUIRE(capacity > 2);
+
+    for (std::int32_t i = 1; i < static_cast<std::int32_t>(capacity); i++) {
+        store_item(i);
+    }
+
+    // Storing an item again refreshes it in place
+    store_item(0);
+
+    REQUIRE(maintainer->get_area_current_size(epoc::akn_skin_chunk_area_base_offset::gfx_area_base) == capacity * entry_size);
+
+    // Area is full: item 1 is now the least recently stored and gives its slot away, item 0 stays
+    store_item(static_cast<std::int32_t>(capacity));
+
+    std::vector<epoc::pid> items = stored_scalable_items(*maintainer, entry_size);
+
+    REQUIRE(items.size() == capacity);
+    REQUIRE((items[1] == epoc::pid{ 0x10005A26, static_cast<std::int32_t>(capacity) }));
+    REQUIRE(std::find(items.begin(), items.end(), epoc::pid{ 0x10005A26, 0 }) != items.end());
+    REQUIRE(std::find(items.begin(), items.end(), epoc::pid{ 0x10005A26, 1 }) == items.end());
+
+    // Next in line is item 2
+    store_item(static_cast<std::int32_t>(capacity + 1));
+    items = stored_scalable_items(*maintainer, entry_size);
+
+    REQUIRE((items[2] == epoc::pid{ 0x10005A26, static_cast<std::int32_t>(capacity + 1) }));
+}
+
+static std::vector<std::uint8_t> write_import_cache(epoc::akn_skin_chunk_maintainer &maintainer, const std::uint64_t key) {
+    common::chunkyseri measurer(nullptr, 0, common::SERI_MODE_MEASURE);
+    REQUIRE(maintainer.do_import_cache_state(measurer, key));
+
+    std::vector<std::uint8_t> cache(measurer.size());
+    common::chunkyseri writer(cache.data(), cache.size(), common::SERI_MODE_WRITE);
+
+    REQUIRE(maintainer.do_import_cache_state(writer, key));
+    REQUIRE(writer.size() == cache.size());
+
+    return cache;
+}
+
+static bool read_import_cache(epoc::akn_skin_chunk_maintainer &maintainer, std::vector<std::uint8_t> cache, const std::uint64_t key) {
+    common::chunkyseri reader(cache.data(), cache.size(), common::SERI_MODE_READ);
+    return maintainer.do_import_cache_state(reader, key);
+}
+
+TEST_CASE("skin_import_cache_round_trip", "skin") {
+    skin_test_environment env;
+
+    auto source = env.make_maintainer("SkinTestCacheSourceChunk");
+    auto target = env.make_maintainer("SkinTestCacheTargetChunk");
+
+    const std::vector<std::uint8_t> skn_data = { 'S', 'K', 'N', 0, 1, 2, 3 };
+
+    const std::uint64_t key = source->import_cache_key(skn_data.data(), skn_data.size(), u"z:\\resource\\skins\\");
+    REQUIRE(target->import_cache_key(skn_data.data(), skn_data.size(), u"z:\\resource\\skins\\") == key);
+    REQUIRE_FALSE(source->import_cache_key(skn_data.data(), skn_data.size() - 1, u"z:\\resource\\skins\\") == key);
+    REQUIRE_FALSE(source->import_cache_key(skn_data.data(), skn_data.size(), u"c:\\resource\\skins\\") == key);
+
+    for (std::int32_t i = 0; i < 64; i++) {
+        define_item(*source, { 0x10005A26, i }, static_cast<std::uint32_t>(i * 3));
+    }
+
+    REQUIRE(source->update_filename(1, u"qgn_graf.mbm", u"z:\\resource\\skins\\"));
+
+    const std::vector<std::uint8_t> cache = write_import_cache(*source, key);
+
+    REQUIRE(read_import_cache(*target, cache, key));
+
+    for (std::int32_t i = 0; i < 64; i++) {
+        REQUIRE(target->get_item_definition_index({ 0x10005A26, i }) == i);
+        REQUIRE(item_value(*target, { 0x10005A26, i }) == static_cast<std::uint32_t>(i * 3));
+    }
+
+    REQUIRE(target->get_filename_offset_from_id(1) == source->get_filename_offset_from_id(1));
+
+    for (const auto area : { epoc::akn_skin_chunk_area_base_offset::item_def_area_base, epoc::akn_skin_chunk_area_base_offset::data_area_base,
+             epoc::akn_skin_chunk_area_base_offset::filename_area_base }) {
+        const std::size_t current_size = source->get_area_current_size(area);
+
+        REQUIRE(target->get_area_current_size(area) == current_size);
+        REQUIRE(std::memcmp(target->get_area_base(area), source->get_area_base(area), current_size) == 0);
+    }
+
+    // Items added after a restore land behind the cached ones
+    define_item(*target, { 0x10005A26, 64 }, 1000);
+    REQUIRE(target->get_item_definition_index({ 0x10005A26, 64 }) == 64);
+}
+
+TEST_CASE("skin_import_cache_rejects_stale_or_truncated", "skin") {
+    skin_test_environment env;
+
+    auto source = env.make_maintainer("SkinTestStaleSourceChunk");
+    auto target = env.make_maintainer("SkinTestStaleTargetChunk");
+
+    const std::vector<std::uint8_t> skn_data = { 'S', 'K', 'N', 4, 5, 6 };
+    const std::uint64_t key = source->import_cache_key(skn_data.data(), skn_data.size(), u"z:\\resource\\skins\\");
+
+    for (std::int32_t i = 0; i < 16; i++) {
+        define_item(*source, { 0x101F86E3, i }, static_cast<std::uint32_t>(i));
+    }
+
+    const std::vector<std::uint8_t> cache = write_import_cache(*source, key);
+
+    // Written for another skin
+    REQUIRE_FALSE(read_import_cache(*target, cache, key + 1));
+    REQUIRE_FALSE(target->get_item_definition({ 0x101F86E3, 0 }));
+
+    // Cut off in the middle of the areas, whatever got copied must be dropped again
+    for (const std::size_t cut : { std::size_t(8), cache.size() / 2, cache.size() - 1 }) {
+        REQUIRE_FALSE(read_import_cache(*target, std::vector<std::uint8_t>(cache.begin(), cache.begin() + cut), key));
+
+        REQUIRE_FALSE(target->get_item_definition({ 0x101F86E3, 0 }));
+        REQUIRE(target->get_area_current_size(epoc::akn_skin_chunk_area_base_offset::item_def_area_base) == 0);
+        REQUIRE(target->get_area_current_size(epoc::akn_skin_chunk_area_base_offset::data_area_base) == 0);
+    }
+
+    // The chunk is still usable for a full import afterwards
+    define_item(*target, { 0x101F86E3, 100 }, 7);
+    REQUIRE(target->get_item_definition_index({ 0x101F86E3, 100 }) == 0);
+}
+
+TEST_CASE("skin_item_lookup_benchmark", "[.][skin]") {
+    static constexpr std::int32_t ITEM_COUNT = 1500;
+    static constexpr int LOOKUP_COUNT = 200000;
+
+    skin_test_environment env;
+    auto maintainer = env.make_maintainer("SkinTestBenchmarkChunk");
+
+    for (std::int32_t i = 0; i < ITEM_COUNT; i++) {
+        define_item(*maintainer, { 0x10005A26 + (i % 4), i }, static_cast<std::uint32_t>(i));
+    }
+
+    // A frame draws a handful of skin items, each one looked up by ID
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<std::int32_t> item_dist(0, ITEM_COUNT - 1);
+
+    std::vector<epoc::pid> lookups(LOOKUP_COUNT);
+    std::generate(lookups.begin(), lookups.end(), [&]() {
+        const std::int32_t item = item_dist(rng);
+        return epoc::pid{ 0x10005A26 + (item % 4), item };
+    });
+
+    const epoc::akns_item_def *defs = reinterpret_cast<const epoc::akns_item_def *>(
+        maintainer->get_area_base(epoc::akn_skin_chunk_area_base_offset::item_def_area_base));
+
+    std::size_t linear_found = 0;
+    std::size_t index_found = 0;
+
+    // Walk of the definition area the server did before the index, kept as reference
+    auto start = std::chrono::steady_clock::now();
+
+    for (const epoc::pid &id : lookups) {
+        const epoc::akns_item_def *def = std::find_if(defs, defs + ITEM_COUNT, [&](const epoc::akns_item_def &def) {
+            return def.id_ == id;
+        });
+
+        linear_found += (def != defs + ITEM_COUNT);
+    }
+
+    const auto linear_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    start = std::chrono::steady_clock::now();
+
+    for (const epoc::pid &id : lookups) {
+        index_found += (maintainer->get_item_definition(id) != nullptr);
+    }
+
+    const auto index_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+    REQUIRE(linear_found == LOOKUP_COUNT);
+    REQUIRE(index_found == LOOKUP_COUNT);
+
+    WARN("Skin item lookup, " << ITEM_COUNT << " items: linear walk " << linear_time.count() / LOOKUP_COUNT
+                              << " ns per draw lookup, indexed " << index_time.count() / LOOKUP_COUNT << " ns per draw lookup");
+}
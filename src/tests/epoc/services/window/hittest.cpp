@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project.
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <services/window/classes/winbase.h>
+#include <services/window/hittest.h>
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace eka2l1;
+
+struct synthetic_window {
+    std::unique_ptr<epoc::window> win_;
+    eka2l1::rect extent_;
+};
+
+static std::vector<synthetic_window> make_synthetic_windows(std::mt19937 &rng, const std::size_t count) {
+    std::vector<synthetic_window> windows;
+
+    // A few full screen windows at the back, like app views and the status pane, then controls
+    std::uniform_int_distribution<int> pos_dist(0, 340);
+    std::uniform_int_distribution<int> size_dist(4, 120);
+
+    for (std::size_t i = 0; i < count; i++) {
+        synthetic_window synthetic;
+        synthetic.win_ = std::make_unique<epoc::window>(nullptr, nullptr, nullptr);
+
+        if (i + 4 >= count) {
+            synthetic.extent_ = eka2l1::rect({ 0, 0 }, { 360, 640 });
+        } else {
+            synthetic.extent_ = eka2l1::rect({ pos_dist(rng), pos_dist(rng) * 2 }, { size_dist(rng), size_dist(rng) });
+        }
+
+        windows.push_back(std::move(synthetic));
+    }
+
+    return windows;
+}
+
+static bool synthetic_contains(const eka2l1::rect &extent, const eka2l1::vec2 &pos) {
+    return (pos.x >= extent.top.x) && (pos.x < extent.top.x + extent.size.x) && (pos.y >= extent.top.y)
+        && (pos.y < extent.top.y + extent.size.y);
+}
+
+static epoc::window *linear_topmost_at(const std::vector<synthetic_window> &windows, const eka2l1::vec2 &pos,
+    epoc::window_hit_filter filter, void *userdata) {
+    for (const synthetic_window &synthetic : windows) {
+        if (synthetic_contains(synthetic.extent_, pos) && (!filter || filter(userdata, synthetic.win_.get()))) {
+            return synthetic.win_.get();
+        }
+    }
+
+    return nullptr;
+}
+
+static bool reject_one_window(void *userdata, epoc::window *win) {
+    return win != userdata;
+}
+
+TEST_CASE("window_hit_grid_front_most_wins", "window_hit_grid") {
+    epoc::window back(nullptr, nullptr, nullptr);
+    epoc::window front(nullptr, nullptr, nullptr);
+
+    epoc::window_hit_grid grid;
+
+    // Insert out of order to check ranks are respected
+    grid.insert(&back, eka2l1::rect({ 0, 0 }, { 100, 100 }), 1);
+    grid.insert(&front, eka2l1::rect({ 50, 50 }, { 100, 100 }), 0);
+
+    REQUIRE(grid.topmost_at({ 10, 10 }) == &back);
+    REQUIRE(grid.topmost_at({ 60, 60 }) == &front);
+    REQUIRE(grid.topmost_at({ 120, 120 }) == &front);
+    REQUIRE(grid.topmost_at({ 150, 150 }) == nullptr);
+    REQUIRE(grid.topmost_at({ -1, 0 }) == nullptr);
+
+    // Filter passes the event to the window behind
+    REQUIRE(grid.topmost_at({ 60, 60 }, reject_one_window, &front) == &back);
+
+    // Move the front window away
+    grid.insert(&front, eka2l1::rect({ 200, 200 }, { 10, 10 }), 0);
+    REQUIRE(grid.topmost_at({ 60, 60 }) == &back);
+    REQUIRE(grid.topmost_at({ 205, 205 }) == &front);
+
+    REQUIRE(grid.remove(&front));
+    REQUIRE(!grid.remove(&front));
+    REQUIRE(grid.topmost_at({ 205, 205 }) == nullptr);
+    REQUIRE(grid.size() == 1);
+}
+
+TEST_CASE("window_hit_grid_match_linear_walk", "window_hit_grid") {
+    std::mt19937 rng(0x1234);
+    std::vector<synthetic_window> windows = make_synthetic_windows(rng, 300);
+
+    epoc::window_hit_grid grid;
+
+    for (std::size_t i = 0; i < windows.size(); i++) {
+        grid.insert(windows[i].win_.get(), windows[i].extent_, static_cast<std::uint32_t>(i));
+    }
+
+    std::uniform_int_distribution<int> x_dist(-10, 370);
+    std::uniform_int_distribution<int> y_dist(-10, 650);
+    std::uniform_int_distribution<std::size_t> win_dist(0, windows.size() - 5);
+
+    for (int i = 0; i < 5000; i++) {
+        const eka2l1::vec2 pos(x_dist(rng), y_dist(rng));
+        REQUIRE(grid.topmost_at(pos) == linear_topmost_at(windows, pos, nullptr, nullptr));
+
+        epoc::window *rejected = windows[win_dist(rng)].win_.get();
+        REQUIRE(grid.topmost_at(pos, reject_one_window, rejected) == linear_topmost_at(windows, pos, reject_one_window, rejected));
+
+        // Move a window around once in a while
+        if (i % 16 == 0) {
+            const std::size_t moved = win_dist(rng);
+            windows[moved].extent_.top = eka2l1::vec2(x_dist(rng), y_dist(rng));
+
+            grid.insert(windows[moved].win_.get(), windows[moved].extent_, static_cast<std::uint32_t>(moved));
+        }
+    }
+}
+
+TEST_CASE("window_hit_grid_benchmark_1k_windows", "[.][window_hit_grid]") {
+    std::mt19937 rng(0xBEEF);
+    std::vector<synthetic_window> windows = make_synthetic_windows(rng, 1000);
+
+    epoc::window_hit_grid grid;
+
+    for (std::size_t i = 0; i < windows.size(); i++) {
+        grid.insert(windows[i].win_.get(), windows[i].extent_, static_cast<std::uint32_t>(i));
+    }
+
+    static constexpr int QUERY_COUNT = 200000;
+
+    std::vector<eka2l1::vec2> points;
+    std::uniform_int_distribution<int> x_dist(0, 359);
+    std::uniform_int_distribution<int> y_dist(0, 639);
+
+    for (int i = 0; i < QUERY_COUNT; i++) {
+        points.emplace_back(x_dist(rng), y_dist(rng));
+    }
+
+    std::size_t linear_hits = 0;
+    std::size_t grid_hits = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (const eka2l1::vec2 &point : points) {
+        linear_hits += (linear_topmost_at(windows, point, nullptr, nullptr) != nullptr);
+    }
+
+    const auto linear_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    start = std::chrono::steady_clock::now();
+
+    for (const eka2l1::vec2 &point : points) {
+        grid_hits += (grid.topmost_at(point) != nullptr);
+    }
+
+    const auto grid_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    REQUIRE(linear_hits == grid_hits);
+    WARN("Hit-test of " << QUERY_COUNT << " points over " << windows.size() << " windows: linear "
+                        << linear_time.count() << "us, grid " << grid_time.count() << "us");
+}
@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/chunkyseri.h>
+#include <config/config.h>
+#include <kernel/timing.h>
+#include <mem/chunk.h>
+#include <mem/mem.h>
+#include <system/epoc.h>
+
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+using namespace eka2l1;
+
+static constexpr std::uint32_t SNAPSHOT_TEST_CPU_HZ = 484000000;
+static constexpr std::size_t SNAPSHOT_TEST_CHUNK_SIZE = 0x40000;
+
+struct snapshot_test_environment {
+    config::state conf_;
+    std::unique_ptr<eka2l1::system> sys_;
+
+    memory_system *mem_;
+
+    explicit snapshot_test_environment() {
+        system_create_components comp;
+        comp.conf_ = &conf_;
+        comp.manual_timing_ = true;
+
+        sys_ = std::make_unique<eka2l1::system>(comp);
+        sys_->startup();
+
+        mem_ = sys_->get_memory_system();
+    }
+
+    mem::mem_model_chunk_impl create_disconnected_chunk() {
+        mem::mem_model_chunk_impl chunk = mem::make_new_mem_model_chunk(mem_->get_control(), 0, mem_->get_model_type());
+
+        mem::mem_model_chunk_creation_info create_info{};
+        create_info.size = SNAPSHOT_TEST_CHUNK_SIZE;
+        create_info.flags = mem::MEM_MODEL_CHUNK_REGION_USER_GLOBAL | mem::MEM_MODEL_CHUNK_TYPE_DISCONNECT;
+        create_info.perm = prot_read_write;
+
+        chunk->do_create(create_info);
+        return chunk;
+    }
+};
+
+template <typename F>
+static std::vector<std::uint8_t> take_snapshot(F do_state) {
+    common::chunkyseri measurer(nullptr, 0, common::SERI_MODE_MEASURE);
+    do_state(measurer);
+
+    std::vector<std::uint8_t> snapshot(measurer.size());
+    common::chunkyseri writer(snapshot.data(), snapshot.size(), common::SERI_MODE_WRITE);
+    do_state(writer);
+
+    REQUIRE(writer.size() == snapshot.size());
+    return snapshot;
+}
+
+TEST_CASE("chunk_snapshot_keeps_committed_pages_only", "snapshot") {
+    snapshot_test_environment env;
+
+    mem::mem_model_chunk_impl source = env.create_disconnected_chunk();
+    const std::size_t page_size = env.mem_->get_control()->page_size();
+
+    // Sparse commits, with a hole between the two runs
+    REQUIRE(source->commit(0, page_size * 2));
+    REQUIRE(source->commit(page_size * 10, page_size));
+
+    std::uint8_t *source_host = reinterpret_cast<std::uint8_t *>(source->host_base());
+
+    for (std::size_t i = 0; i < page_size * 2; i++) {
+        source_host[i] = static_cast<std::uint8_t>(i * 7);
+    }
+
+    std::memset(source_host + page_size * 10, 0x5A, page_size);
+
+    const std::vector<std::uint8_t> snapshot = take_snapshot([&](common::chunkyseri &seri) {
+        source->do_state(seri);
+    });
+
+    // Three pages of data, and much less than the whole chunk
+    REQUIRE(snapshot.size() >= page_size * 3);
+    REQUIRE(snapshot.size() < page_size * 4);
+
+    mem::mem_model_chunk_impl target = env.create_disconnected_chunk();
+
+    // Pages committed in the target but not in the snapshot must go away
+    REQUIRE(target->commit(page_size * 20, page_size));
+
+    std::vector<std::uint8_t> snapshot_copy = snapshot;
+    common::chunkyseri reader(snapshot_copy.data(), snapshot_copy.size(), common::SERI_MODE_READ);
+    target->do_state(reader);
+
+    REQUIRE(reader.size() == snapshot.size());
+
+    REQUIRE(target->is_page_committed(0));
+    REQUIRE(target->is_page_committed(page_size));
+    REQUIRE_FALSE(target->is_page_committed(page_size * 2));
+    REQUIRE(target->is_page_committed(page_size * 10));
+    REQUIRE_FALSE(target->is_page_committed(page_size * 20));
+
+    std::uint8_t *target_host = reinterpret_cast<std::uint8_t *>(target->host_base());
+
+    REQUIRE(std::memcmp(target_host, source_host, page_size * 2) == 0);
+    REQUIRE(std::memcmp(target_host + page_size * 10, source_host + page_size * 10, page_size) == 0);
+}
+
+TEST_CASE("normal_chunk_snapshot_restores_in_flexible_model", "snapshot") {
+    config::state conf;
+    memory_system mem(nullptr, &conf, mem::mem_model_type::flexible, false);
+
+    const std::size_t page_size = mem.get_control()->page_size();
+
+    auto create_normal_chunk = [&]() {
+        mem::mem_model_chunk_impl chunk = mem::make_new_mem_model_chunk(mem.get_control(), 0, mem::mem_model_type::flexible);
+
+        mem::mem_model_chunk_creation_info create_info{};
+        create_info.size = SNAPSHOT_TEST_CHUNK_SIZE;
+        create_info.flags = mem::MEM_MODEL_CHUNK_REGION_USER_GLOBAL | mem::MEM_MODEL_CHUNK_TYPE_NORMAL;
+        create_info.perm = prot_read_write;
+
+        chunk->do_create(create_info);
+        return chunk;
+    };
+
+    mem::mem_model_chunk_impl source = create_normal_chunk();
+    REQUIRE(source->adjust(0, static_cast<mem::vm_address>(page_size * 3)));
+
+    std::uint8_t *source_host = reinterpret_cast<std::uint8_t *>(source->host_base());
+
+    for (std::size_t i = 0; i < page_size * 3; i++) {
+        source_host[i] = static_cast<std::uint8_t>(i * 5);
+    }
+
+    const std::vector<std::uint8_t> snapshot = take_snapshot([&](common::chunkyseri &seri) {
+        source->do_state(seri);
+    });
+
+    // Fresh chunk, nothing committed yet
+    mem::mem_model_chunk_impl target = create_normal_chunk();
+
+    std::vector<std::uint8_t> snapshot_copy = snapshot;
+    common::chunkyseri reader(snapshot_copy.data(), snapshot_copy.size(), common::SERI_MODE_READ);
+    target->do_state(reader);
+
+    REQUIRE(reader.size() == snapshot.size());
+    REQUIRE(target->top() == page_size * 3);
+
+    REQUIRE(target->is_page_committed(0));
+    REQUIRE(target->is_page_committed(page_size * 2));
+    REQUIRE_FALSE(target->is_page_committed(page_size * 3));
+
+    REQUIRE(std::memcmp(target->host_base(), source_host, page_size * 3) == 0);
+}
+
+struct timer_fire_record {
+    std::uint64_t userdata_;
+    std::uint64_t clock_;
+
+    bool operator==(const timer_fire_record &rhs) const {
+        return (userdata_ == rhs.userdata_) && (clock_ == rhs.clock_);
+    }
+};
+
+static int register_recording_event(ntimer &timer, std::vector<timer_fire_record> &fires) {
+    return timer.register_event("SnapshotTestTick", [&timer, &fires](std::uint64_t userdata, int) {
+        fires.push_back({ userdata, timer.microseconds() });
+    }, true);
+}
+
+static std::vector<timer_fire_record> run_timer(ntimer &timer, std::vector<timer_fire_record> &fires, const int steps) {
+    const std::uint64_t start = timer.microseconds();
+
+    for (int i = 0; i < steps; i++) {
+        timer.advance_clock(250);
+    }
+
+    // Compare clocks relative to the point where the runs started
+    std::vector<timer_fire_record> result = fires;
+
+    for (timer_fire_record &fire : result) {
+        fire.clock_ -= start;
+    }
+
+    return result;
+}
+
+TEST_CASE("timer_snapshot_replays_identically", "snapshot") {
+    std::vector<timer_fire_record> source_fires;
+    ntimer source(SNAPSHOT_TEST_CPU_HZ, true);
+
+    const int source_evt = register_recording_event(source, source_fires);
+
+    // Let some time pass, so that the saved events are not relative to zero
+    source.advance_clock(3000);
+
+    source.schedule_event(1000, source_evt, 1);
+    source.schedule_event(500, source_evt, 2);
+    source.schedule_event(1000, source_evt, 3);
+    source.schedule_event(4000, source_evt, 4);
+
+    const std::vector<std::uint8_t> snapshot = take_snapshot([&](common::chunkyseri &seri) {
+        source.do_state(seri);
+    });
+
+    const std::vector<timer_fire_record> expected = run_timer(source, source_fires, 20);
+    REQUIRE(expected.size() == 4);
+
+    std::vector<timer_fire_record> restored_fires;
+    ntimer restored(SNAPSHOT_TEST_CPU_HZ, true);
+
+    // Registered under a different index, events must be matched by name
+    restored.register_event("SnapshotTestUnrelated", nullptr);
+    register_recording_event(restored, restored_fires);
+
+    std::vector<std::uint8_t> snapshot_copy = snapshot;
+    common::chunkyseri reader(snapshot_copy.data(), snapshot_copy.size(), common::SERI_MODE_READ);
+    restored.do_state(reader);
+
+    REQUIRE(run_timer(restored, restored_fires, 20) == expected);
+}
+
+TEST_CASE("timer_snapshot_skips_host_pointer_events", "snapshot") {
+    std::vector<timer_fire_record> source_fires;
+    ntimer source(SNAPSHOT_TEST_CPU_HZ, true);
+
+    int pointer_fire_count = 0;
+    auto count_pointer_fire = [&pointer_fire_count](std::uint64_t, int) {
+        pointer_fire_count++;
+    };
+
+    const int source_evt = register_recording_event(source, source_fires);
+    const int pointer_evt = source.register_event("SnapshotTestPointer", count_pointer_fire);
+
+    // The user data is a host address, it means nothing to another process
+    source.schedule_event(500, pointer_evt, reinterpret_cast<std::uint64_t>(&source_fires));
+    source.schedule_event(1000, source_evt, 1);
+
+    const std::vector<std::uint8_t> snapshot = take_snapshot([&](common::chunkyseri &seri) {
+        source.do_state(seri);
+    });
+
+    std::vector<timer_fire_record> restored_fires;
+    ntimer restored(SNAPSHOT_TEST_CPU_HZ, true);
+
+    restored.register_event("SnapshotTestPointer", count_pointer_fire);
+    register_recording_event(restored, restored_fires);
+
+    std::vector<std::uint8_t> snapshot_copy = snapshot;
+    common::chunkyseri reader(snapshot_copy.data(), snapshot_copy.size(), common::SERI_MODE_READ);
+    restored.do_state(reader);
+
+    const std::vector<timer_fire_record> fires = run_timer(restored, restored_fires, 20);
+
+    REQUIRE(pointer_fire_count == 0);
+    REQUIRE(fires.size() == 1);
+    REQUIRE(fires[0].userdata_ == 1);
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common/cvt.h>
+#include <vfs/vfs.h>
+
+#include <filesystem>
+#include <string>
+
+/**
+ * \brief Mount an empty host folder as a physical drive of an I/O system.
+ *
+ * The folder is wiped first, so nothing from a previous run is seen by the test.
+ */
+struct test_drive_guard {
+    eka2l1::io_system *io;
+    std::string host_dir;
+
+    explicit test_drive_guard(eka2l1::io_system &io_sys, const std::string &host_folder, const drive_number drive = drive_c)
+        : io(&io_sys)
+        , host_dir(host_folder) {
+        std::filesystem::remove_all(host_dir);
+        std::filesystem::create_directories(host_dir);
+
+        auto physical_fs = eka2l1::create_physical_filesystem(epocver::epoc94, "");
+        io->add_filesystem(physical_fs);
+        io->mount_physical_path(drive, drive_media::physical, io_attrib_internal, eka2l1::common::utf8_to_ucs2(host_dir));
+    }
+
+    ~test_drive_guard() {
+    }
+};
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2021 EKA2L1 Team.
+ * 
+ * This file is part of EKA2L1 project 
+ * (see bentokun.github.com/EKA2L1).
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kernel/btrace_format.h>
+
+#include <common/buffer.h>
+#include <common/log.h>
+
+#include <fmt/format.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace eka2l1;
+
+static void print_record(const kernel::btrace_record &record, const bool csv) {
+    if (record.thread_id_ == kernel::BTRACE_RECORD_DROPPED_THREAD_ID) {
+        if (csv) {
+            fmt::print("{},dropped,,,,,0x{:X},,\n", record.timestamp_, record.a1_);
+        } else {
+            fmt::print("[{}us] !!! {} records dropped\n", record.timestamp_, record.a1_);
+        }
+
+        return;
+    }
+
+    const std::uint32_t args_size = record.a0_ & 0xFF;
+    const std::uint32_t flags = (record.a0_ >> 8) & 0xFF;
+    const std::uint32_t category = (record.a0_ >> 16) & 0xFF;
+    const std::uint32_t subcategory = (record.a0_ >> 24) & 0xFF;
+
+    if (csv) {
+        fmt::print("{},{},{},{},{},{},0x{:X},0x{:X},0x{:X}\n", record.timestamp_, record.thread_id_, args_size,
+            flags, category, subcategory, record.a1_, record.a2_, record.a3_);
+    } else {
+        fmt::print("[{}us] Thread {} trace out (data size = {}, flags = {}, category = {}, subcategory = {}):\n"
+                   "\ta1 = 0x{:X}\n"
+                   "\ta2 = 0x{:X}\n"
+                   "\ta3 = 0x{:X}\n\n",
+            record.timestamp_, record.thread_id_, args_size, flags, category, subcategory, record.a1_,
+            record.a2_, record.a3_);
+    }
+}
+
+int main(int argc, char **argv) {
+    eka2l1::log::setup_log(nullptr);
+
+    if (argc < 2) {
+        LOG_INFO(eka2l1::SYSTEM, "Usage: btracedump [filename] [--csv]");
+        return -1;
+    }
+
+    const bool csv = (argc >= 3) && (strcmp(argv[2], "--csv") == 0);
+
+    eka2l1::common::ro_std_file_stream stream(argv[1], true);
+
+    if (!stream.valid()) {
+        LOG_ERROR(eka2l1::SYSTEM, "Unable to open capture file {}", argv[1]);
+        return -2;
+    }
+
+    kernel::btrace_capture_header header;
+
+    if ((stream.read(&header, sizeof(header)) != sizeof(header)) || (header.magic_ != kernel::BTRACE_CAPTURE_MAGIC)) {
+        LOG_ERROR(eka2l1::SYSTEM, "Not a BTrace capture file!");
+        return -3;
+    }
+
+    if ((header.version_ != kernel::BTRACE_CAPTURE_VERSION) || (header.record_size_ != sizeof(kernel::btrace_record))) {
+        LOG_ERROR(eka2l1::SYSTEM, "Unsupported capture version {} (record size {})", header.version_, header.record_size_);
+        return -4;
+    }
+
+    if (csv) {
+        fmt::print("timestamp_us,thread_id,size,flags,category,subcategory,a1,a2,a3\n");
+    }
+
+    std::vector<kernel::btrace_record> records(4096);
+    std::uint64_t total = 0;
+
+    while (true) {
+        const std::uint64_t bytes_read = stream.read(records.data(), records.size() * sizeof(kernel::btrace_record));
+        const std::size_t count = static_cast<std::size_t>(bytes_read / sizeof(kernel::btrace_record));
+
+        if (count == 0) {
+            break;
+        }
+
+        for (std::size_t i = 0; i < count; i++) {
+            print_record(records[i], csv);
+        }
+
+        total += count;
+    }
+
+    LOG_INFO(eka2l1::SYSTEM, "Decoded {} records", total);
+    return 0;
+}